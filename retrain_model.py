@@ -5,6 +5,7 @@ import tensorflow
 import pandas
 import numpy
 import time
+import json
 
 import warnings
 
@@ -35,6 +36,10 @@ segment_period = pandas.Timedelta('138D').value # span of a segment in nanosecon
 
 initial_capitals = numpy.array([5e+5, 1e+6, 5e+6, 1e+7, 5e+7, 1e+8, 5e+8, 1e+9]) # does not account for PDT
 
+calibration_rows = 4096 # number of training inputs the bot sets the ranges of its quantized network with
+holdout_fraction = 0.0 # share of the final train set held out (never trained on) to check the quantized network against the float network - 0 trains the model on every row
+golden_rows = 256 # number of training inputs saved with the probabilities of the model - model_benchmark checks the network of the bot against them
+
 def transform(data, scaler, fit=False):
     
     for feature in log_features: data[feature] = numpy.log(1e-9 + data[feature])
@@ -265,6 +270,29 @@ def save_model_weights(model, path):
     file.write(jstring)
     file.close()
     
+def save_calibration_data(calibration_inputs, holdout_inputs, holdout_transitions, golden_inputs, golden_features, golden_probabilities, path):
+    
+    rows = [{'set': 'calibration', 'inputs': [float(x) for x in inputs]} for inputs in calibration_inputs]
+    rows += [{'set': 'holdout', 'inputs': [float(x) for x in inputs], 'transition': int(transition)}
+             for inputs, transition in zip(holdout_inputs, holdout_transitions)]
+    rows += [{'set': 'golden', 'inputs': [float(x) for x in inputs], 'features': [float(x) for x in raw_features],
+              'probabilities': [float(x) for x in probabilities]}
+             for inputs, raw_features, probabilities in zip(golden_inputs, golden_features, golden_probabilities)]
+    
+    file = open(path, 'w')
+    file.write(json.dumps(rows))
+    file.close()
+    
+def save_golden_vectors(golden_inputs, golden_features, golden_probabilities, path):
+    
+    rows = [{'set': 'golden', 'inputs': [float(x) for x in inputs], 'features': [float(x) for x in raw_features],
+             'probabilities': [float(x) for x in probabilities]}
+            for inputs, raw_features, probabilities in zip(golden_inputs, golden_features, golden_probabilities)]
+    
+    file = open(path, 'w')
+    file.write(json.dumps(rows))
+    file.close()
+    
 transition_data = pandas.read_csv(trans_data_path)
 transition_data.rename(columns={'last_bid_price':'last_bid', 'last_ask_price':'last_ask', 'dp_2S':'dp', 'dt_2S':'dt',
                                 'rolling_csum_2S':'rolling_csum', 'rolling_vsum_2S':'rolling_vsum'}, inplace=True)
@@ -372,11 +400,33 @@ transform(train_data, scaler, True)
 
 remove_outliers(train_data)
 
+holdout_data = train_data.sample(frac=holdout_fraction, random_state=0) if holdout_fraction > 0.0 else train_data.iloc[:0] # never trained on
+train_data.drop(holdout_data.index, inplace=True)
+
 x_train = train_data[features]
 y_train = train_data[target]
 
 model = construct_and_train_nn(x_train, y_ohe(y_train), 32, 16, 3)
 
+calibration_inputs = x_train.sample(n=min(calibration_rows, len(x_train)), random_state=0).to_numpy()
+
+# golden vectors - the inputs, the features the bot computes before the log transform and the scaling, and the probabilities of the model
+golden_inputs = x_train.sample(n=min(golden_rows, len(x_train)), random_state=1)
+golden_probabilities = model.predict(golden_inputs, verbose=0)
+golden_features = golden_inputs.copy()
+golden_features[features] = scaler.inverse_transform(golden_features[features])
+
+for feature in features:
+    if feature in log_features: golden_features[feature] = numpy.exp(golden_features[feature]) - 1e-9
+
+save_calibration_data(calibration_inputs, holdout_data[features].to_numpy(), holdout_data[target].to_numpy(),
+                      golden_inputs.to_numpy(), golden_features[features].to_numpy(), golden_probabilities, f'{base_dir}calibration_data.json')
+
+# committed with the model files - the model_golden_vectors test of CMake checks the bot against them
+save_golden_vectors(golden_inputs.to_numpy(), golden_features[features].to_numpy(), golden_probabilities, f'{base_dir}golden_vectors.json')
+
+del holdout_data
+
 inverse_transform(train_data, scaler)
 
 train_data['chance_of_+1_transition'] = model.predict(x_train)[...,2]
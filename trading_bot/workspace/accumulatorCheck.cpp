@@ -0,0 +1,293 @@
+// accumulatorCheck.cpp : Checks the sliding window accumulators of the daily features (qplUtils.h) against a full
+// recomputation (computeDailyFeatures) on synthetic and recorded daily bars. Returns 1 if any accumulator differs.
+//
+// usage : accumulator_check <model scales> [symbols = 200] [bars = 1900] [recorded bar pages...]
+//
+// Every history goes through the two paths of the snapshot mode
+//     rebuilt : all of its bars are pushed into a new accumulator
+//     extended : an accumulator of the first part of its bars is saved and loaded (saveQplAccumulators) before every ...
+//     ... extension by a few bars that start with the last bar it saw, the way consecutive snapshots extend it
+// and the features are compared after the rebuild and after every extension. An extension whose first bar was adjusted
+// has to be refused.
+//
+// The synthetic histories are random walks with splits, days without volume, and days without a positive close.
+// The recorded bar pages are bodies of /v2/stocks/bars (such as the ones stand_in_server.py serves with --recorded) - the
+// bars of each ticker are appended in the order of the pages and only the last past_days of them are used.
+
+
+#include "tradingBot.h"
+#include "jsonStreamUtils.h"
+#include "qplUtils.h"
+#include "exceptUtils.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <cmath>
+
+const char accumulator_check_path[] = "accumulator_check.bin"; //accumulator file written between extensions - removed at the end
+
+struct checkCounts
+{
+    size_t checked = 0; //number of comparisons with a full recomputation
+    size_t inliers = 0; //number of them that were not outliers (every feature was compared)
+    size_t mismatches = 0;
+};
+
+struct history
+{
+    std::string ticker;
+    std::vector<bar> bars;
+};
+
+//a random walk of closing prices with the occasional split, day without volume, and stretch of days without a positive close
+history syntheticHistory(const size_t index, const size_t length)
+{
+    std::mt19937_64 generator(index + 1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    auto logUniform = [&](const double min, const double max) { return min * std::pow(max / min, uniform(generator)); };
+
+    history synthetic;
+    synthetic.ticker = "S" + std::to_string(index);
+
+    double close = logUniform(1.0, 500.0);
+    double base_volume = logUniform(1e4, 1e7);
+
+    std::normal_distribution<double> returns(uniform(generator) * 0.002 - 0.0005, logUniform(0.005, 0.05));
+    std::lognormal_distribution<double> volumes(0.0, 0.5);
+
+    int missing_closes = 0; //remaining days without a positive close
+
+    for (size_t day = 0; day < length; day++)
+    {
+        bar daily_bar;
+
+        char timestamp[32];
+        std::snprintf(timestamp, sizeof(timestamp), "%06zuT05:00:00Z", day); //only compared, never parsed
+
+        close *= std::max(0.5, 1.0 + returns(generator));
+
+        const double event = uniform(generator);
+
+        if (event < 0.001) close *= 0.5; //split
+        else if (event < 0.002) close *= 3.0; //reverse split
+        else if (event < 0.0025 && index % 10 == 9) missing_closes = 3;
+
+        daily_bar.t = timestamp;
+        daily_bar.c = missing_closes ? 0.0 : close;
+        daily_bar.v = (uniform(generator) < 0.002) ? 0 : static_cast<long long>(base_volume * volumes(generator));
+
+        if (missing_closes) missing_closes--;
+
+        synthetic.bars.push_back(daily_bar);
+    }
+
+    return synthetic;
+}
+
+//the bars of every ticker of the pages of /v2/stocks/bars in the order of the pages
+std::vector<history> recordedHistories(const std::vector<std::string>& page_paths)
+{
+    std::vector<history> histories;
+    std::unordered_map<std::string, size_t> positions;
+
+    barPageStream page_stream;
+    bar daily_bar;
+
+    auto appendBar = [&](const std::string& ticker, const jsonFields& fields)
+    {
+        auto position = positions.find(ticker);
+
+        if (position == positions.end())
+        {
+            position = positions.emplace(ticker, histories.size()).first;
+            histories.push_back({ ticker, {} });
+        }
+
+        applyFields<bar, updateDailyBar>(fields, daily_bar);
+        histories[position->second].bars.push_back(daily_bar);
+    };
+
+    for (const std::string& page_path : page_paths)
+    {
+        std::ifstream file(page_path, std::ios::binary);
+
+        if (!file.is_open()) throw exceptions::exception("Failed open the file : " + page_path);
+
+        std::stringstream content;
+        content << file.rdbuf();
+
+        const std::string page = content.str();
+
+        page_stream.startPage();
+        page_stream.feed(page.data(), page.size(), appendBar);
+
+        if (!page_stream.complete()) throw exceptions::exception("Received malformed json : " + page_path);
+    }
+
+    for (history& recorded : histories)
+    {
+        if (recorded.bars.size() > past_days) recorded.bars.erase(recorded.bars.begin(), recorded.bars.end() - past_days);
+    }
+
+    return histories;
+}
+
+void compare(qplAccumulator& accumulator, const dailyBarContainer& daily_bars, const inlierRanges& ranges, checkCounts& counts)
+{
+    dailyFeatureRecord record;
+
+    counts.checked++;
+
+    if (!verifyAccumulator(accumulator, daily_bars, ranges)) counts.mismatches++;
+    else if (!accumulator.computeFeatures(record, ranges) || record.is_an_outlier) return;
+    else counts.inliers++;
+}
+
+void checkHistory(const history& daily_history, const inlierRanges& ranges, std::mt19937_64& generator,
+    checkCounts& rebuilt, checkCounts& extended, checkCounts& adjusted)
+{
+    const std::vector<bar>& bars = daily_history.bars;
+
+    if (bars.size() < 2) return;
+
+    std::unique_ptr<dailyBarContainer> seen = std::make_unique<dailyBarContainer>(); //the bars the accumulator saw so far
+
+    //rebuilt from the full history
+
+    qplAccumulator accumulator;
+    accumulator.reset(ranges);
+
+    for (const bar& daily_bar : bars)
+    {
+        accumulator.push(daily_bar.t, daily_bar.c, daily_bar.v);
+        seen->push_back(daily_bar);
+    }
+
+    compare(accumulator, *seen, ranges, rebuilt);
+
+    //rebuilt from the first part of the history and extended a few bars at a time
+
+    const uint64_t ranges_checksum = dailyRangesChecksum(ranges);
+    const size_t first_part = std::uniform_int_distribution<size_t>(1, bars.size() - 1)(generator);
+
+    qplAccumulatorContainer accumulators;
+    qplAccumulator& first = accumulators[daily_history.ticker];
+
+    seen = std::make_unique<dailyBarContainer>();
+    first.reset(ranges);
+
+    for (size_t i = 0; i < first_part; i++)
+    {
+        first.push(bars[i].t, bars[i].c, bars[i].v);
+        seen->push_back(bars[i]);
+    }
+
+    compare(first, *seen, ranges, extended);
+
+    std::uniform_int_distribution<size_t> extension_length(1, 5);
+
+    for (size_t last = first_part - 1; last + 1 < bars.size();)
+    {
+        saveQplAccumulators(accumulator_check_path, ranges_checksum, accumulators);
+
+        accumulators.clear();
+
+        if (!loadQplAccumulators(accumulator_check_path, ranges_checksum, accumulators) || !accumulators.count(daily_history.ticker))
+        {
+            extended.mismatches++;
+
+            return;
+        }
+
+        qplAccumulator& loaded = accumulators[daily_history.ticker];
+
+        const size_t next = std::min(last + extension_length(generator), bars.size() - 1);
+
+        //the same bars with the last one the accumulator saw adjusted
+        std::vector<bar> extension(bars.begin() + last, bars.begin() + next + 1);
+
+        extension[0].c = extension[0].c * 1.01 + 0.01;
+
+        adjusted.checked++;
+
+        if (loaded.extend(extension)) adjusted.mismatches++;
+
+        extension[0] = bars[last];
+
+        if (!loaded.extend(extension))
+        {
+            extended.mismatches++;
+
+            return;
+        }
+
+        for (size_t i = last + 1; i <= next; i++) seen->push_back(bars[i]);
+
+        compare(loaded, *seen, ranges, extended);
+
+        last = next;
+    }
+}
+
+void printCounts(const std::string& name, const checkCounts& counts)
+{
+    std::cout << name << " : " << counts.checked << " CHECKED (" << counts.inliers << " INLIERS) - " << counts.mismatches << " MISMATCHES" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage : accumulator_check <model scales> [symbols = 200] [bars = 1900] [recorded bar pages...]" << std::endl;
+
+        return 1;
+    }
+
+    const size_t num_symbols = (argc > 2) ? std::stoul(argv[2]) : 200;
+    const size_t num_bars = std::min<size_t>((argc > 3) ? std::stoul(argv[3]) : 1900, past_days);
+
+    checkCounts rebuilt, extended, adjusted;
+
+    try
+    {
+        std::unique_ptr<MLModel> model = std::make_unique<MLModel>();
+
+        model->loadScales(argv[1]);
+
+        std::vector<history> histories;
+
+        for (size_t index = 0; index < num_symbols; index++) histories.push_back(syntheticHistory(index, num_bars));
+
+        const std::vector<history> recorded = recordedHistories(std::vector<std::string>(argv + std::min(argc, 4), argv + argc));
+
+        histories.insert(histories.end(), recorded.begin(), recorded.end());
+
+        std::cout << num_symbols << " SYNTHETIC HISTORIES OF " << num_bars << " BARS AND " << recorded.size() << " RECORDED ONES" << std::endl;
+
+        std::mt19937_64 generator(0);
+
+        for (const history& daily_history : histories) checkHistory(daily_history, model->ranges, generator, rebuilt, extended, adjusted);
+    }
+    catch (const std::runtime_error& runtime_error) { std::cout << "Runtime Error caught : " << runtime_error.what() << std::endl; return 1; }
+    catch (const exceptions::exception& exception) { std::cout << "Exception caught : " << exception.what() << std::endl; return 1; }
+    catch (const std::exception& exception) { std::cout << "Base Exception caught : " << exception.what() << std::endl; return 1; }
+
+    std::remove(accumulator_check_path);
+
+    printCounts("REBUILT", rebuilt);
+    printCounts("EXTENDED", extended);
+
+    std::cout << "ADJUSTED : " << adjusted.checked << " CHECKED - " << adjusted.mismatches << " NOT REFUSED" << std::endl;
+
+    return (rebuilt.mismatches || extended.mismatches || adjusted.mismatches) ? 1 : 0;
+}
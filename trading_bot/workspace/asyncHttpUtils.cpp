@@ -0,0 +1,873 @@
+
+#include "asyncHttpUtils.h"
+
+#ifdef __linux__
+
+#include "rateUtils.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+#include <algorithm>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+
+//called by OpenSSL when a new session was negotiated - TLS 1.3 sends its tickets after the handshake
+int storeNewSession(SSL* ssl, SSL_SESSION* session)
+{
+	const std::string* key = static_cast<const std::string*>(SSL_get_app_data(ssl));
+	tlsContext* context = static_cast<tlsContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+
+	if (!key || !context) return 0;
+
+	context->storeSession(*key, session);
+
+	return 1; //the context keeps the reference
+}
+
+tlsContext::tlsContext()
+{
+	context = SSL_CTX_new(TLS_client_method());
+
+	if (!context) throw exceptions::exception("Failed to create a TLS context.");
+
+	SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+	SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+
+	if (!SSL_CTX_set_default_verify_paths(context)) throw exceptions::exception("Failed to load the system's certificate store.");
+
+	//the sessions are kept by host and port instead of OpenSSL's internal cache (which is only used by servers)
+	SSL_CTX_set_app_data(context, this);
+	SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(context, storeNewSession);
+
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+	//servers often drop idle keep-alive connections without a close_notify - OpenSSL 3 treats that as a fatal error, which ...
+	//... makes the session impossible to resume (the end of each body is known from its framing so nothing is lost)
+	SSL_CTX_set_options(context, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+
+	//OpenSSL writes to the socket with write() - a pipelined request written after the server closed the connection ...
+	//... would raise SIGPIPE and end the process instead of failing with EPIPE and reconnecting
+	std::signal(SIGPIPE, SIG_IGN);
+}
+
+void tlsContext::trustCertificate(const std::string& path)
+{
+	if (!SSL_CTX_load_verify_locations(context, path.c_str(), nullptr)) throw exceptions::exception("Failed to load the certificate : " + path);
+}
+
+tlsContext::~tlsContext()
+{
+	for (auto& pair : sessions) SSL_SESSION_free(pair.second);
+
+	if (context) SSL_CTX_free(context);
+}
+
+void tlsContext::resumeSession(SSL* ssl, const std::string& key) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto session = sessions.find(key);
+
+	//the connection takes its own reference before the lock is released so another thread can replace the session
+	if (session != sessions.end()) SSL_set_session(ssl, session->second);
+}
+
+void tlsContext::storeSession(const std::string& key, SSL_SESSION* session)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	SSL_SESSION*& stored = sessions[key];
+
+	if (stored) SSL_SESSION_free(stored);
+
+	stored = session;
+}
+
+handshakeCounts tlsContext::counts() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return handshake_counts;
+}
+
+void tlsContext::recordHandshake(const bool resumed, const double seconds)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (resumed)
+	{
+		handshake_counts.resumed_handshakes++;
+		handshake_counts.resumed_handshake_seconds += seconds;
+	}
+	else
+	{
+		handshake_counts.handshakes++;
+		handshake_counts.handshake_seconds += seconds;
+	}
+}
+
+tlsContext& sharedTlsContext()
+{
+	static tlsContext context;
+
+	return context;
+}
+
+asyncTlsConnection::asyncTlsConnection(eventLoop& Loop, tlsContext& Tls_context) : loop(Loop), tls_context(Tls_context) {}
+
+asyncTlsConnection::~asyncTlsConnection()
+{
+	close();
+}
+
+void asyncTlsConnection::close()
+{
+	if (ssl)
+	{
+		//without a close_notify OpenSSL marks the session as not resumable - the socket is non-blocking so this never waits
+		if (SSL_is_init_finished(ssl)) SSL_shutdown(ssl);
+
+		ERR_clear_error();
+		SSL_free(ssl);
+
+		ssl = nullptr;
+		rx_bio = nullptr;
+	}
+
+	rx_timestamp = 0;
+
+	if (fd >= 0)
+	{
+		loop.forget(fd);
+
+		::close(fd);
+
+		fd = -1;
+	}
+}
+
+task<void> asyncTlsConnection::waitFor(const int ssl_error, const double timeout)
+{
+	bool ready = true;
+
+	if (ssl_error == SSL_ERROR_WANT_READ) ready = co_await loop.readable(fd, timeout);
+	else if (ssl_error == SSL_ERROR_WANT_WRITE) ready = co_await loop.writable(fd, timeout);
+	else
+	{
+		ERR_clear_error();
+
+		throw connectionLost();
+	}
+
+	if (!ready) throw exceptions::exception("Timed out while retrieving stock data.");
+}
+
+task<void> asyncTlsConnection::connect(const std::string& host, const std::string& port, const double timeout)
+{
+	close();
+
+	auto start = std::chrono::steady_clock::now();
+
+	//name resolution blocks - it only happens once per connection and is usually answered from the local cache
+	addrinfo hints{};
+	addrinfo* addresses = nullptr;
+
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) || !addresses) throw exceptions::exception("Could not resolve the host : " + host);
+
+	fd = socket(addresses->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if (fd < 0)
+	{
+		freeaddrinfo(addresses);
+
+		throw exceptions::exception("Failed to create a socket.");
+	}
+
+	int result = ::connect(fd, addresses->ai_addr, addresses->ai_addrlen);
+
+	freeaddrinfo(addresses);
+
+	if (result < 0 && errno != EINPROGRESS) { close(); throw connectionLost(); }
+
+	if (result < 0)
+	{
+		if (!co_await loop.writable(fd, timeout)) { close(); throw exceptions::exception("Timed out while connecting to " + host + "."); }
+
+		int error = 0;
+		socklen_t length = sizeof(error);
+
+		getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+
+		if (error) { close(); throw connectionLost(); }
+	}
+
+	int enabled = 1;
+
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled)); //requests are small and latency matters more than throughput
+
+	//let the kernel notice a connection that silently died while it was idle
+	int idle = keepalive_idle_seconds;
+	int interval = keepalive_interval_seconds;
+	int count = keepalive_probe_count;
+
+	setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enabled, sizeof(enabled));
+	setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+	setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+	setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+
+	ssl = SSL_new(tls_context.get());
+
+	if (!ssl) { close(); throw exceptions::exception("Failed to create a TLS session."); }
+
+	SSL_set_fd(ssl, fd);
+	SSL_set_tlsext_host_name(ssl, host.c_str());
+	SSL_set1_host(ssl, host.c_str());
+
+	//resume the last session negotiated with this host - new sessions are stored by storeNewSession
+	session_key = host + ":" + port;
+
+	SSL_set_app_data(ssl, &session_key);
+
+	tls_context.resumeSession(ssl, session_key);
+
+	while (true)
+	{
+		result = SSL_connect(ssl);
+
+		if (result == 1) break;
+
+		int error = SSL_get_error(ssl, result);
+
+		if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE)
+		{
+			ERR_clear_error();
+			close();
+
+			throw exceptions::exception("The TLS handshake with " + host + " failed.");
+		}
+
+		co_await waitFor(error, timeout);
+	}
+
+	tls_context.recordHandshake(SSL_session_reused(ssl) == 1, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+bool asyncTlsConnection::stillOpen()
+{
+	if (!ssl) return false;
+
+	//nothing should arrive on an idle connection except session tickets (handled by OpenSSL) or the server closing it
+	char byte;
+	size_t bytes = 0;
+
+	int result = SSL_peek_ex(ssl, &byte, 1, &bytes);
+
+	if (result <= 0 && SSL_get_error(ssl, result) == SSL_ERROR_WANT_READ) return true;
+
+	ERR_clear_error();
+	close();
+
+	return false;
+}
+
+task<void> asyncTlsConnection::writeAll(const std::string& data, const double timeout)
+{
+	if (!ssl) throw connectionLost();
+
+	size_t written = 0;
+
+	while (written < data.size())
+	{
+		size_t bytes = 0;
+
+		//SSL_write_ex has to be called again with the same arguments after SSL_ERROR_WANT_*
+		int result = SSL_write_ex(ssl, data.data() + written, data.size() - written, &bytes);
+
+		if (result > 0) { written += bytes; continue; }
+
+		co_await waitFor(SSL_get_error(ssl, result), timeout);
+	}
+}
+
+task<size_t> asyncTlsConnection::readSome(char* buffer, const size_t size, const double timeout)
+{
+	if (!ssl) throw connectionLost();
+
+	while (true)
+	{
+		size_t bytes = 0;
+
+		int result = SSL_read_ex(ssl, buffer, size, &bytes);
+
+		if (result > 0) co_return bytes;
+
+		int error = SSL_get_error(ssl, result);
+
+		if (error == SSL_ERROR_ZERO_RETURN) co_return 0; //the server closed the connection
+		if (error == SSL_ERROR_SYSCALL || error == SSL_ERROR_SSL) { ERR_clear_error(); co_return 0; }
+
+		co_await waitFor(error, timeout);
+	}
+}
+
+size_t asyncTlsConnection::readAvailable(char* buffer, const size_t size)
+{
+	if (!ssl) throw connectionLost();
+
+	while (true)
+	{
+		size_t bytes = 0;
+
+		int result = SSL_read_ex(ssl, buffer, size, &bytes);
+
+		if (result > 0) return bytes;
+
+		int error = SSL_get_error(ssl, result);
+
+		if (error == SSL_ERROR_WANT_READ && rx_bio && pumpSocket()) continue; //OpenSSL only sees what pumpSocket read
+		if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return 0;
+
+		ERR_clear_error();
+		close();
+
+		throw connectionLost();
+	}
+}
+
+bool asyncTlsConnection::enableRxTimestamps()
+{
+	if (!ssl) return false;
+	if (rx_bio) return true;
+
+	int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+	if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) return false;
+
+	BIO* bio = BIO_new(BIO_s_mem());
+
+	if (!bio) return false;
+
+	BIO_set_mem_eof_return(bio, -1); //an empty BIO means that nothing arrived yet, not that the connection was closed
+
+	//the records OpenSSL already read stay buffered in ssl - only the reading side is replaced, writes still go to the socket
+	SSL_set0_rbio(ssl, bio);
+
+	rx_bio = bio;
+	rx_buffer.resize(65536);
+
+	return true;
+}
+
+bool asyncTlsConnection::pumpSocket()
+{
+	char control[256]; //room for the timestamps
+	iovec vector{ rx_buffer.data(), rx_buffer.size() };
+
+	msghdr header{};
+
+	header.msg_iov = &vector;
+	header.msg_iovlen = 1;
+	header.msg_control = control;
+	header.msg_controllen = sizeof(control);
+
+	ssize_t bytes = recvmsg(fd, &header, MSG_DONTWAIT);
+
+	if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return false;
+
+	if (bytes <= 0)
+	{
+		close();
+
+		throw connectionLost();
+	}
+
+	//on a TCP socket the timestamp is the one of the newest segment that was read
+	for (cmsghdr* message = CMSG_FIRSTHDR(&header); message; message = CMSG_NXTHDR(&header, message))
+	{
+		if (message->cmsg_level != SOL_SOCKET || message->cmsg_type != SCM_TIMESTAMPING) continue;
+
+		scm_timestamping timestamps;
+
+		std::memcpy(&timestamps, CMSG_DATA(message), sizeof(timestamps));
+
+		if (timestamps.ts[0].tv_sec) rx_timestamp = int64_t(timestamps.ts[0].tv_sec) * 1000000000 + timestamps.ts[0].tv_nsec; //ts[0] is the software timestamp
+	}
+
+	BIO_write(rx_bio, rx_buffer.data(), static_cast<int>(bytes));
+
+	return true;
+}
+
+bodyDecoder::bodyDecoder()
+{
+	//15 + 32 detects either a gzip or a zlib header
+	if (inflateInit2(&stream, 15 + 32) != Z_OK) throw exceptions::exception("Failed to initialize zlib.");
+}
+
+bodyDecoder::~bodyDecoder()
+{
+	inflateEnd(&stream);
+}
+
+void bodyDecoder::reset(const std::string* content_encoding)
+{
+	decoding = content_encoding && (content_encoding->find("gzip") != std::string::npos || content_encoding->find("deflate") != std::string::npos);
+	finished = false;
+
+	if (decoding) inflateReset(&stream);
+}
+
+void bodyDecoder::append(const char* data, const size_t size, const bodySink& sink)
+{
+	if (!decoding)
+	{
+		sink(data, size);
+
+		return;
+	}
+
+	if (finished) return; //anything after the end of the compressed stream is ignored
+
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+	stream.avail_in = static_cast<uInt>(size);
+
+	while (stream.avail_in)
+	{
+		stream.next_out = reinterpret_cast<Bytef*>(buffer);
+		stream.avail_out = sizeof(buffer);
+
+		int result = inflate(&stream, Z_NO_FLUSH);
+
+		if (stream.avail_out < sizeof(buffer)) sink(buffer, sizeof(buffer) - stream.avail_out);
+
+		if (result == Z_STREAM_END) { finished = true; return; }
+		if (result != Z_OK && result != Z_BUF_ERROR) throw exceptions::exception("Failed to decompress a response body.");
+		if (result == Z_BUF_ERROR && stream.avail_out) return; //no progress is possible until more input arrives
+	}
+}
+
+asyncHttpClient::asyncHttpClient(eventLoop& loop, tlsContext& tls_context, const std::string& Host, const time_t Timeout, const std::string& Port)
+	: connection(loop, tls_context),
+	host(Host),
+	port(Port),
+	timeout(static_cast<double>(Timeout))
+{}
+
+asyncHttpClient::~asyncHttpClient() {}
+
+task<void> asyncHttpClient::fill()
+{
+	char buffer[16384];
+
+	size_t bytes = co_await connection.readSome(buffer, sizeof(buffer), timeout);
+
+	if (!bytes) throw connectionLost();
+
+	input.append(buffer, bytes);
+}
+
+task<void> asyncHttpClient::readLine(std::string& line)
+{
+	size_t end = std::string::npos;
+
+	while ((end = input.find("\r\n")) == std::string::npos) co_await fill();
+
+	line.assign(input, 0, end);
+	input.erase(0, end + 2);
+}
+
+task<void> asyncHttpClient::readBody(const bodySink& sink, size_t size)
+{
+	//decode the bytes as they arrive instead of waiting for the whole body
+	while (size)
+	{
+		if (!input.size()) co_await fill();
+
+		const size_t bytes = std::min(size, input.size());
+
+		decoder.append(input.data(), bytes, sink);
+		input.erase(0, bytes);
+
+		encoded_bytes += bytes;
+		size -= bytes;
+	}
+}
+
+task<void> asyncHttpClient::readResponse(http::httpResponse& response, bodyStream* body_stream)
+{
+	std::string line;
+
+	//status line - HTTP/1.1 200 OK
+	co_await readLine(line);
+
+	size_t code_start = line.find(' ');
+
+	if (code_start == std::string::npos || line.compare(0, 5, "HTTP/")) throw exceptions::exception("Received an invalid status line : " + line);
+
+	response.status_code = std::atoi(line.c_str() + code_start + 1);
+
+	size_t message_start = line.find(' ', code_start + 1);
+
+	response.status_message = (message_start == std::string::npos) ? "" : line.substr(message_start + 1);
+
+	//header fields
+	while (true)
+	{
+		co_await readLine(line);
+
+		if (line.empty()) break;
+
+		size_t colon = line.find(':');
+
+		if (colon == std::string::npos) continue;
+
+		size_t value_start = line.find_first_not_of(" \t", colon + 1);
+
+		response.fields[line.substr(0, colon)] = (value_start == std::string::npos) ? "" : line.substr(value_start);
+	}
+
+	response.message.clear();
+
+	decoder.reset(findHeaderField(response, "content-encoding"));
+
+	//only successful bodies are streamed - the messages of errors are kept in the response
+	if (response.status_code != 200) body_stream = nullptr;
+
+	if (body_stream) body_stream->begin();
+
+	const bodySink sink = body_stream ? body_stream->append : bodySink([&](const char* data, const size_t size) { response.message.append(data, size); });
+
+	const std::string* transfer_encoding = findHeaderField(response, "transfer-encoding");
+	const std::string* content_length = findHeaderField(response, "content-length");
+
+	if (transfer_encoding && transfer_encoding->find("chunked") != std::string::npos)
+	{
+		while (true)
+		{
+			co_await readLine(line);
+
+			size_t chunk_size = std::strtoul(line.c_str(), nullptr, 16);
+
+			if (!chunk_size) break;
+
+			co_await readBody(sink, chunk_size);
+			co_await readLine(line); //CRLF after each chunk
+		}
+
+		//trailer fields end with an empty line
+		do { co_await readLine(line); } while (!line.empty());
+	}
+	else if (content_length) co_await readBody(sink, std::strtoul(content_length->c_str(), nullptr, 10));
+	else
+	{
+		//the body ends when the server closes the connection
+		while (true)
+		{
+			decoder.append(input.data(), input.size(), sink);
+
+			encoded_bytes += input.size();
+			input.clear();
+
+			try { co_await fill(); }
+			catch (const connectionLost&) { break; }
+		}
+
+		connection.close();
+	}
+
+	const std::string* connection_field = findHeaderField(response, "connection");
+
+	if (connection_field && (*connection_field == "close" || *connection_field == "Close")) connection.close();
+}
+
+task<void> asyncHttpClient::reconnect()
+{
+	connection.close();
+	input.clear();
+
+	co_await connection.connect(host, port, timeout);
+
+	connects++;
+
+	for (const std::string& request : unacknowledged) co_await connection.writeAll(request, timeout);
+}
+
+task<void> asyncHttpClient::send(const dictionary& parameters, const dictionary& headers, const std::string& path)
+{
+	co_await sendRequest(buildGetRequest(host, parameters, headers, path, accept_compression));
+}
+
+task<void> asyncHttpClient::sendRequest(std::string&& request)
+{
+	unacknowledged.push_back(std::move(request));
+
+	try
+	{
+		if (!connection.isOpen())
+		{
+			requests_resent += unacknowledged.size() - 1;
+
+			co_await reconnect(); //also sends the new request
+		}
+		else co_await connection.writeAll(unacknowledged.back(), timeout);
+	}
+	catch (const connectionLost&) { connection.close(); } //receive reconnects and sends the request again
+}
+
+task<void> asyncHttpClient::receive(http::httpResponse& response, bodyStream* body_stream)
+{
+	if (!unacknowledged.size()) throw exceptions::exception("Tried to receive a response without sending a request.");
+
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		bool lost = false;
+
+		response.clear();
+
+		try
+		{
+			//the server closed the connection before answering every request - send the rest of them again
+			if (!connection.isOpen())
+			{
+				requests_resent += unacknowledged.size();
+
+				co_await reconnect();
+			}
+
+			co_await readResponse(response, body_stream);
+		}
+		catch (const connectionLost&) { lost = true; }
+
+		if (!lost)
+		{
+			unacknowledged.pop_front();
+
+			co_return;
+		}
+
+		connection.close();
+
+		if (!resend_requests) break; //the server may have received the requests - they are dropped instead of being sent again
+	}
+
+	if (!resend_requests) unacknowledged.clear();
+
+	throw connectionLost();
+}
+
+task<void> asyncHttpClient::get(const dictionary& parameters, const dictionary& headers, const std::string& path, http::httpResponse& response)
+{
+	co_await send(parameters, headers, path);
+	co_await receive(response);
+}
+
+task<void> asyncHttpClient::request(const std::string& method, const dictionary& parameters, const dictionary& headers, const std::string& path,
+	const std::string& body, http::httpResponse& response)
+{
+	co_await send(method, parameters, headers, path, body);
+	co_await receive(response);
+}
+
+task<void> asyncHttpClient::send(const std::string& method, const dictionary& parameters, const dictionary& headers, const std::string& path, const std::string& body)
+{
+	co_await sendRequest(buildRequest(method, host, parameters, headers, path, body, accept_compression));
+}
+
+restPool::restPool(tlsContext& Tls_context) : tls_context(Tls_context) {}
+
+restPool::hostConnection& restPool::connectionTo(const std::string& host, const time_t timeout)
+{
+	hostConnection& target = hosts[host];
+
+	if (target.client) return target;
+
+	//a host can include a port (localhost:8443) - used to connect to a local stand-in server
+	size_t colon = host.find(':');
+
+	if (colon == std::string::npos) target.client = std::make_unique<asyncHttpClient>(loop, tls_context, host, timeout);
+	else target.client = std::make_unique<asyncHttpClient>(loop, tls_context, host.substr(0, colon), timeout, host.substr(colon + 1));
+
+	return target;
+}
+
+void restPool::request(const std::string& method, const std::string& host, const dictionary& parameters, const dictionary& headers, const std::string& path,
+	const std::string& body, http::httpResponse& response, const time_t timeout)
+{
+	hostConnection& target = connectionTo(host, timeout);
+
+	//a connection the server closed while it was idle is opened again before anything is sent so no request is sent twice ...
+	//... one with a keep-alive request in flight is still in use
+	if (target.busy) reused_requests++;
+	else if (target.client->isOpen())
+	{
+		if (target.client->stillOpen()) reused_requests++;
+		else redials++;
+	}
+
+	target.client->resend_requests = (method == "GET" || method == "DELETE");
+
+	requests++;
+
+	//the pool decides how long its connections stay open
+	const dictionary* request_headers = &headers;
+	dictionary kept_alive;
+
+	auto connection_field = headers.find("Connection");
+
+	if (connection_field != headers.end() && connection_field->second != "keep-alive")
+	{
+		kept_alive = headers;
+		kept_alive.erase("Connection");
+
+		request_headers = &kept_alive;
+	}
+
+	bool received = false;
+
+	loop.spawn(send(target, method, parameters, *request_headers, path, body, response, received));
+
+	//the keep-alive requests of the other hosts are left in flight
+	try { while (!received) loop.runOnce(1000); }
+	catch (...)
+	{
+		target.last_used = clock::now();
+
+		throw;
+	}
+
+	target.last_used = clock::now();
+}
+
+void restPool::keepAlive(const std::string& host, const std::string& path, const dictionary& headers)
+{
+	hostConnection& target = hosts[host];
+
+	target.probe_path = path;
+	target.probe_headers = headers;
+	target.probe_headers.erase("Content-Length");
+}
+
+void restPool::probeIdle()
+{
+	if (loop.activeTasks()) loop.runOnce(0); //handle the responses of the keep-alive requests already sent
+
+	clock::time_point now = clock::now();
+
+	for (auto& pair : hosts)
+	{
+		hostConnection& target = pair.second;
+
+		if (target.busy || target.probe_path.empty() || !target.client || !target.client->isOpen()) continue;
+		if (std::chrono::duration<double>(now - target.last_used).count() < rest_probe_seconds) continue;
+
+		target.busy = true;
+		target.last_used = now;
+
+		probes++;
+
+		loop.spawn(probe(target));
+	}
+}
+
+task<void> restPool::probe(hostConnection& target)
+{
+	//a failed keep-alive request only closes the connection - the next request opens it again
+	try { co_await target.client->get(dictionary(), target.probe_headers, target.probe_path, target.probe_response); }
+	catch (const connectionLost&) {}
+	catch (const std::exception&) {}
+
+	target.busy = false;
+
+	if (target.queued_request) std::exchange(target.queued_request, nullptr).resume();
+}
+
+task<void> restPool::send(hostConnection& target, const std::string& method, const dictionary& parameters, const dictionary& headers, const std::string& path,
+	const std::string& body, http::httpResponse& response, bool& received)
+{
+	//sent right away - the server answers the keep-alive request in front of it first and the probe task reads that response
+	co_await target.client->send(method, parameters, headers, path, body);
+	co_await probeAwaiter{ target };
+
+	//the connection was lost while the keep-alive request was answered and this request was dropped with it (see resend_requests)
+	if (!target.client->unanswered()) throw connectionLost();
+
+	//a keep-alive request that gave up on its response is still in front of this one - its response is read first
+	if (target.client->unanswered() > 1) co_await target.client->receive(target.probe_response);
+
+	co_await target.client->receive(response);
+
+	received = true;
+}
+
+restPool& sharedRestPool()
+{
+	static restPool pool(sharedTlsContext());
+
+	return pool;
+}
+
+std::string buildQueryString(const dictionary& parameters)
+{
+	static const char hex[] = "0123456789ABCDEF";
+
+	std::string query;
+
+	for (const auto& pair : parameters)
+	{
+		if (pair.second.empty()) continue; //empty parameters such as the first page token are left out
+
+		query += query.empty() ? '?' : '&';
+
+		for (const std::string* text : { &pair.first, &pair.second })
+		{
+			for (const unsigned char c : *text)
+			{
+				if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || c == ',' || c == ':') query += static_cast<char>(c);
+				else
+				{
+					query += '%';
+					query += hex[c >> 4];
+					query += hex[c & 15];
+				}
+			}
+
+			if (text == &pair.first) query += '=';
+		}
+	}
+
+	return query;
+}
+
+std::string buildGetRequest(const std::string& host, const dictionary& parameters, const dictionary& headers, const std::string& path, const bool accept_compression)
+{
+	return buildRequest("GET", host, parameters, headers, path, "", accept_compression);
+}
+
+std::string buildRequest(const std::string& method, const std::string& host, const dictionary& parameters, const dictionary& headers, const std::string& path,
+	const std::string& body, const bool accept_compression)
+{
+	std::string request = method + " " + path + buildQueryString(parameters) + " HTTP/1.1\r\nHost: " + host + "\r\n";
+
+	for (const auto& pair : headers) request += pair.first + ": " + pair.second + "\r\n";
+
+	if (accept_compression) request += "Accept-Encoding: gzip, deflate\r\n";
+	if (body.size() && headers.find("Content-Length") == headers.end()) request += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+
+	request += "\r\n";
+	request += body;
+
+	return request;
+}
+
+#endif
@@ -0,0 +1,301 @@
+
+/*
+A minimal HTTP/1.1 client over TLS for the async runtime in asyncUtils.h.
+
+Each asyncHttpClient owns one keep-alive connection to one host. get() is a task that sends a request and parses the
+response (status line, header fields, and a body delimited by Content-Length, chunked transfer encoding, or the end of
+the connection) into an http::httpResponse so the responses can be handled exactly like the ones of http::httpClient.
+
+Requests can be pipelined - send() writes a request without waiting for the responses of the requests before it and
+receive() reads the responses in the order the requests were sent. The requests whose responses were not received yet
+are kept, so if the server closes the connection (after a Connection: close response, or because a keep-alive
+connection timed out) the client reconnects and sends all of them again. get() is a send() followed by a receive().
+
+Requests advertise Accept-Encoding: gzip, deflate (unless accept_compression is false) and compressed bodies are
+inflated with zlib as they are received - chunk by chunk - so the response message always holds the decoded body.
+A bodyStream can be passed to receive() to get the decoded body of a successful (200) response as it arrives instead.
+
+If the connection is lost twice in a row while waiting for a response, receive() throws connectionLost.
+Timeouts throw exceptions::exception like the non-blocking http clients do.
+
+The TLS context keeps the last session negotiated with each host so new connections resume it (an abbreviated
+handshake without the certificate exchange) and counts the full and resumed handshakes and the time they took.
+
+restPool keeps one persistent connection per host for the one-off REST requests (calendar, account, assets, snapshots,
+and orders) on its own event loop - a Connection: close header of the caller is left out. A connection the server closed while it was idle is opened again before the next
+request is sent, and idle connections can be kept open with keep-alive probes (see probeIdle). A request to a host whose
+keep-alive probe is still waiting for its response is sent right away behind it on the same connection, and request()
+only runs the event loop until its own response arrives. Requests that are not
+idempotent (POST, PATCH) are never sent twice - if the connection is lost while waiting for their response,
+connectionLost is thrown because the server may or may not have received them.
+*/
+
+#ifndef ASYNC_HTTP_UTILS_H
+#define ASYNC_HTTP_UTILS_H
+
+#include "asyncUtils.h"
+
+#ifdef __linux__
+
+#include "jsonUtils.h"
+#include "httpUtils.h"
+#include "exceptUtils.h"
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <zlib.h>
+
+#include <string>
+#include <functional>
+#include <coroutine>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+
+struct connectionLost {}; //thrown when the connection closes before a full response is received
+
+const int keepalive_idle_seconds = 30; //idle time before the kernel starts sending TCP keepalive probes on a connection
+const int keepalive_interval_seconds = 10; //time between two TCP keepalive probes
+const int keepalive_probe_count = 3; //unanswered TCP keepalive probes before the connection is dropped
+
+const double rest_probe_seconds = 20.0; //idle time before restPool sends a keep-alive request - below the common 60 second server idle timeouts
+
+struct handshakeCounts
+{
+	size_t handshakes = 0; //number of full handshakes
+	size_t resumed_handshakes = 0; //number of handshakes that resumed a session
+	double handshake_seconds = 0.0; //total time of the full handshakes
+	double resumed_handshake_seconds = 0.0; //total time of the resumed handshakes
+};
+
+//client side TLS context that verifies server certificates with the system's certificate store - the sessions and the counts are ...
+//... locked since the startup opens the websockets on another thread with the same context
+class tlsContext
+{
+public:
+	tlsContext();
+	~tlsContext();
+
+	tlsContext(const tlsContext&) = delete;
+	tlsContext& operator=(const tlsContext&) = delete;
+
+	SSL_CTX* get() const { return context; }
+
+	void trustCertificate(const std::string&); //also trust the certificates in a PEM file - used to connect to a local stand-in server
+
+	void resumeSession(SSL*, const std::string&) const; //set the last session negotiated with host:port on a connection (if there is one)
+	void storeSession(const std::string&, SSL_SESSION*); //keep a session for host:port - takes over the reference
+
+	void recordHandshake(const bool, const double); //resumed, seconds from the start of the connection to the end of the handshake
+
+	handshakeCounts counts() const;
+
+private:
+	SSL_CTX* context = nullptr;
+
+	mutable std::mutex mutex; //of the sessions and the counts
+
+	std::unordered_map<std::string, SSL_SESSION*> sessions; //host:port -> last session
+
+	handshakeCounts handshake_counts;
+};
+
+tlsContext& sharedTlsContext(); //the context shared by every async http client
+
+class asyncTlsConnection
+{
+public:
+	asyncTlsConnection(eventLoop&, tlsContext&);
+	~asyncTlsConnection();
+
+	asyncTlsConnection(const asyncTlsConnection&) = delete;
+	asyncTlsConnection& operator=(const asyncTlsConnection&) = delete;
+
+	task<void> connect(const std::string&, const std::string&, const double); //host, port, timeout in seconds
+	task<void> writeAll(const std::string&, const double);
+	task<size_t> readSome(char*, const size_t, const double); //returns 0 when the server closed the connection
+	size_t readAvailable(char*, const size_t); //read the bytes that already arrived without waiting - returns 0 if there are none, throws connectionLost if the server closed the connection
+
+	void close();
+
+	bool isOpen() const { return ssl != nullptr; }
+	bool stillOpen(); //false if the server closed the connection while it was idle - the connection is closed as well
+
+	//read the socket with recvmsg from now on so every read carries the kernel's software receive timestamp - false if the kernel refused
+	//only readAvailable can read the connection afterwards (the websockets only use readAvailable once they are open)
+	bool enableRxTimestamps();
+
+	int64_t rx_timestamp = 0; //kernel receive time (nanoseconds since the epoch) of the newest bytes read from the socket - 0 if unknown
+
+private:
+	eventLoop& loop;
+	tlsContext& tls_context;
+
+	int fd = -1;
+	SSL* ssl = nullptr;
+
+	std::string session_key; //host:port - the key of the session in the TLS context
+
+	BIO* rx_bio = nullptr; //the memory BIO OpenSSL reads from once receive timestamps are enabled - owned by ssl
+	std::vector<char> rx_buffer; //the socket is read into this buffer and then written to rx_bio
+
+	bool pumpSocket(); //read the socket into rx_bio - false if nothing arrived, throws connectionLost if the server closed the connection
+
+	task<void> waitFor(const int, const double); //wait for the socket as requested by an SSL_ERROR_WANT_* code
+};
+
+typedef std::function<void(const char*, const size_t)> bodySink; //receives the next decoded bytes of a body
+
+struct bodyStream //receives the decoded body of a successful response while it arrives instead of the response message
+{
+	std::function<void()> begin; //called before the first bytes of the body - again if the connection was lost and the response is received again
+	bodySink append;
+};
+
+class bodyDecoder //inflates gzip or deflate encoded bodies as they are received
+{
+public:
+	bodyDecoder();
+	~bodyDecoder();
+
+	bodyDecoder(const bodyDecoder&) = delete;
+	bodyDecoder& operator=(const bodyDecoder&) = delete;
+
+	void reset(const std::string*); //start a new body with the given Content-Encoding field - nullptr if the body is not encoded
+	void append(const char*, const size_t, const bodySink&); //decode the next bytes of the body and pass them to a sink
+
+private:
+	z_stream stream{};
+
+	char buffer[65536]; //decoded bytes are inflated here and then passed on
+
+	bool decoding = false; //false if the bytes are appended as they are
+	bool finished = false; //true once the end of the compressed stream was reached
+};
+
+class asyncHttpClient
+{
+public:
+	asyncHttpClient(eventLoop&, tlsContext&, const std::string&, const time_t, const std::string& = "443"); //host, timeout in seconds, port
+	~asyncHttpClient();
+
+	asyncHttpClient(const asyncHttpClient&) = delete;
+	asyncHttpClient& operator=(const asyncHttpClient&) = delete;
+
+	task<void> get(const dictionary&, const dictionary&, const std::string&, http::httpResponse&); //parameters, headers, path, response
+
+	//send any request and wait for its response - method, parameters, headers, path, body, response
+	task<void> request(const std::string&, const dictionary&, const dictionary&, const std::string&, const std::string&, http::httpResponse&);
+
+	task<void> send(const dictionary&, const dictionary&, const std::string&); //send a request without waiting for a response - parameters, headers, path
+	task<void> send(const std::string&, const dictionary&, const dictionary&, const std::string&, const std::string&); //any request - method, parameters, headers, path, body
+	task<void> receive(http::httpResponse&, bodyStream* = nullptr); //receive the response of the oldest request that was not answered yet
+
+	size_t unanswered() const { return unacknowledged.size(); } //number of requests sent without a response yet
+
+	bool isOpen() const { return connection.isOpen(); }
+	bool stillOpen() { return connection.stillOpen(); } //see asyncTlsConnection::stillOpen
+
+	size_t connects = 0; //number of times a connection was opened
+	size_t requests_resent = 0; //number of requests sent again after a reconnect
+	size_t encoded_bytes = 0; //total size of the bodies as they were received - before they were decoded
+
+	bool accept_compression = true; //ask the server for gzip or deflate encoded bodies
+	bool resend_requests = true; //send the unanswered requests again if the connection is lost while waiting for a response
+
+private:
+	asyncTlsConnection connection;
+
+	std::string host;
+	std::string port;
+	double timeout;
+
+	bodyDecoder decoder;
+
+	std::string input; //bytes received but not parsed yet
+
+	std::deque<std::string> unacknowledged; //requests sent without a response yet - oldest first
+
+	task<void> fill(); //read more bytes into the input buffer - throws connectionLost if the server closed the connection
+	task<void> readLine(std::string&); //read up to and including the next CRLF - the line is returned without it
+	task<void> readBody(const bodySink&, size_t); //decode exactly the given number of body bytes and pass them to a sink
+	task<void> readResponse(http::httpResponse&, bodyStream*);
+	task<void> reconnect(); //open a new connection and send every unanswered request again
+	task<void> sendRequest(std::string&&); //send a request that was already built
+};
+
+class restPool //one persistent connection per host for the REST requests
+{
+public:
+	restPool(tlsContext&);
+
+	restPool(const restPool&) = delete;
+	restPool& operator=(const restPool&) = delete;
+
+	//send a request and wait for its response - method, host (with an optional :port), parameters, headers, path, body, response, timeout in seconds
+	void request(const std::string&, const std::string&, const dictionary&, const dictionary&, const std::string&, const std::string&, http::httpResponse&, const time_t);
+
+	//keep the connection to a host open with a GET of the given path whenever it was idle for rest_probe_seconds - host, path, headers
+	void keepAlive(const std::string&, const std::string&, const dictionary&);
+
+	void probeIdle(); //send the keep-alive requests that are due and handle their responses without blocking - call when the bot is not busy
+
+	size_t requests = 0; //requests sent through the pool
+	size_t reused_requests = 0; //requests sent on a connection that was already open - each one saved a handshake
+	size_t redials = 0; //connections the server closed while they were idle - opened again before the next request
+	size_t probes = 0; //keep-alive requests sent
+
+private:
+	typedef std::chrono::steady_clock clock;
+
+	struct hostConnection
+	{
+		std::unique_ptr<asyncHttpClient> client;
+
+		clock::time_point last_used;
+
+		bool busy = false; //true while a keep-alive request is waiting for its response
+		std::coroutine_handle<> queued_request; //a request sent behind the keep-alive request - resumed once that one was answered
+
+		std::string probe_path; //empty if the connection is not kept alive
+		dictionary probe_headers;
+		http::httpResponse probe_response;
+	};
+
+	eventLoop loop;
+	tlsContext& tls_context;
+
+	std::unordered_map<std::string, hostConnection> hosts;
+
+	struct probeAwaiter //resumed once the keep-alive request of the connection was answered
+	{
+		hostConnection& target;
+
+		bool await_ready() const noexcept { return !target.busy; }
+		void await_suspend(std::coroutine_handle<> handle) { target.queued_request = handle; }
+		void await_resume() const noexcept {}
+	};
+
+	hostConnection& connectionTo(const std::string&, const time_t);
+
+	//send a request behind the keep-alive request of the connection if there is one and receive its response - sets the flag once it was received
+	task<void> send(hostConnection&, const std::string&, const dictionary&, const dictionary&, const std::string&, const std::string&, http::httpResponse&, bool&);
+	task<void> probe(hostConnection&);
+};
+
+restPool& sharedRestPool(); //the pool shared by every REST request
+
+std::string buildQueryString(const dictionary&); //percent encode the parameters - empty if there are none
+std::string buildGetRequest(const std::string&, const dictionary&, const dictionary&, const std::string&, const bool = false); //host, parameters, headers, path, accept compression
+
+//method, host, parameters, headers, path, body, accept compression - Content-Length is added for a body unless the headers have it
+std::string buildRequest(const std::string&, const std::string&, const dictionary&, const dictionary&, const std::string&, const std::string&, const bool = false);
+
+#endif
+
+#endif
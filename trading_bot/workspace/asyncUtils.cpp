@@ -0,0 +1,206 @@
+
+#include "asyncUtils.h"
+
+#ifdef __linux__
+
+#include "exceptUtils.h"
+
+#include <cerrno>
+#include <string>
+
+eventLoop::eventLoop()
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (epoll_fd < 0) throw exceptions::exception("Failed to create an epoll instance.");
+}
+
+eventLoop::~eventLoop()
+{
+	spawned.clear(); //destroy the suspended tasks before the loop they are waiting on
+
+	if (epoll_fd >= 0) ::close(epoll_fd);
+}
+
+void eventLoop::spawn(task<void>&& new_task)
+{
+	spawned.push_back(std::move(new_task));
+	spawned.back().start();
+}
+
+bool eventLoop::runOnce(const int timeout_milliseconds)
+{
+	reap();
+
+	if (!spawned.size()) return false;
+
+	int wait_milliseconds = timeout_milliseconds;
+
+	//don't sleep past the next timer
+	if (timers.size())
+	{
+		auto until_next_timer = std::chrono::duration_cast<std::chrono::milliseconds>(timers.top().deadline - clock::now()).count() + 1;
+
+		if (until_next_timer < 0) until_next_timer = 0;
+		if (until_next_timer < wait_milliseconds) wait_milliseconds = static_cast<int>(until_next_timer);
+	}
+
+	epoll_event events[64];
+
+	int num_events = epoll_wait(epoll_fd, events, 64, wait_milliseconds);
+
+	if (num_events < 0 && errno != EINTR) throw exceptions::exception("epoll_wait failed with errno " + std::to_string(errno) + ".");
+
+	if (num_events > 0) wakeups++;
+
+	for (int i = 0; i < num_events; i++)
+	{
+		const int fd = events[i].data.fd;
+		const uint32_t ready = events[i].events;
+
+		auto waiter = waiters.find(fd);
+
+		if (waiter == waiters.end()) continue;
+
+		std::coroutine_handle<> reader;
+		std::coroutine_handle<> writer;
+
+		//errors and hangups wake both sides - the next read or write reports what happened
+		if (ready & (EPOLLIN | EPOLLERR | EPOLLHUP)) reader = std::exchange(waiter->second.reader, nullptr);
+		if (ready & (EPOLLOUT | EPOLLERR | EPOLLHUP)) writer = std::exchange(waiter->second.writer, nullptr);
+
+		updateInterest(fd);
+
+		//resuming can add or remove waiters so the iterator is not used after this point
+		if (reader) reader.resume();
+		if (writer) writer.resume();
+	}
+
+	fireTimers();
+	reap();
+
+	return spawned.size() > 0;
+}
+
+void eventLoop::forget(const int fd)
+{
+	auto waiter = waiters.find(fd);
+
+	if (waiter == waiters.end()) return;
+
+	if (waiter->second.registered_events) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+	waiters.erase(waiter);
+}
+
+void eventLoop::watch(const int fd, const bool write, std::coroutine_handle<> handle, const clock::time_point deadline, bool* timed_out)
+{
+	fdWaiters& waiter = waiters[fd];
+
+	const uint64_t generation = next_generation++;
+
+	if (write)
+	{
+		waiter.writer = handle;
+		waiter.writer_generation = generation;
+		waiter.writer_timed_out = timed_out;
+	}
+	else
+	{
+		waiter.reader = handle;
+		waiter.reader_generation = generation;
+		waiter.reader_timed_out = timed_out;
+	}
+
+	updateInterest(fd);
+
+	addTimer(deadline, handle, fd, write, generation, timed_out);
+}
+
+void eventLoop::addTimer(const clock::time_point deadline, std::coroutine_handle<> handle, const int fd, const bool write, const uint64_t generation, bool* timed_out)
+{
+	timers.push(timer{ deadline, handle, fd, write, generation, timed_out });
+}
+
+void eventLoop::updateInterest(const int fd)
+{
+	fdWaiters& waiter = waiters[fd];
+
+	uint32_t interest = 0;
+
+	if (waiter.reader) interest |= EPOLLIN;
+	if (waiter.writer) interest |= EPOLLOUT;
+
+	if (interest == waiter.registered_events) return;
+
+	epoll_event event{};
+
+	event.events = interest;
+	event.data.fd = fd;
+
+	//nothing is waiting on the socket - remove it so hangups don't wake the loop up over and over
+	if (!interest) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+	else if (!waiter.registered_events) epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+	else epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+
+	waiter.registered_events = interest;
+}
+
+void eventLoop::fireTimers()
+{
+	const clock::time_point now = clock::now();
+
+	while (timers.size() && timers.top().deadline <= now)
+	{
+		timer expired = timers.top();
+
+		timers.pop();
+
+		if (expired.fd < 0) //sleep
+		{
+			expired.handle.resume();
+
+			continue;
+		}
+
+		auto waiter = waiters.find(expired.fd);
+
+		if (waiter == waiters.end()) continue;
+
+		//skip the timers of waits that already finished
+		if (expired.write)
+		{
+			if (!waiter->second.writer || waiter->second.writer_generation != expired.generation) continue;
+
+			waiter->second.writer = nullptr;
+		}
+		else
+		{
+			if (!waiter->second.reader || waiter->second.reader_generation != expired.generation) continue;
+
+			waiter->second.reader = nullptr;
+		}
+
+		updateInterest(expired.fd);
+
+		*expired.timed_out = true;
+
+		expired.handle.resume();
+	}
+}
+
+void eventLoop::reap()
+{
+	for (auto spawned_task = spawned.begin(); spawned_task != spawned.end();)
+	{
+		if (!spawned_task->done()) { spawned_task++; continue; }
+
+		task<void> finished = std::move(*spawned_task);
+
+		spawned_task = spawned.erase(spawned_task);
+
+		finished.rethrow();
+	}
+}
+
+#endif
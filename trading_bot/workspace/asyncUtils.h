@@ -0,0 +1,236 @@
+
+/*
+A single threaded async runtime built on epoll and C++20 coroutines.
+
+A task is a lazily started coroutine that can be awaited by another task or spawned on an event loop. Tasks suspend on ...
+	readable(fd, timeout) / writable(fd, timeout) - resumed when epoll reports the socket ready or the timeout expires
+	sleepFor(seconds) - resumed by the loop's timer heap
+... so a paginated request can be written as a straight-line sequence of co_await expressions, and only sockets that are
+ready are serviced. runOnce waits in epoll_wait (no busy polling) for at most the given time or until the next timer.
+
+Exceptions thrown by a spawned task are rethrown by runOnce.
+Linux only - other platforms poll every client with the non-blocking http clients instead (see barUtils.h).
+*/
+
+#ifndef ASYNC_UTILS_H
+#define ASYNC_UTILS_H
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <unordered_map>
+#include <optional>
+#include <utility>
+#include <chrono>
+#include <vector>
+#include <queue>
+#include <list>
+
+template<typename T>
+class task;
+
+template<typename T>
+struct taskPromiseBase
+{
+	std::coroutine_handle<> continuation; //the coroutine awaiting this task - resumed when this task finishes
+	std::exception_ptr exception;
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+
+	struct finalAwaiter
+	{
+		bool await_ready() noexcept { return false; }
+
+		template<typename promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<promise> handle) noexcept
+		{
+			if (handle.promise().continuation) return handle.promise().continuation;
+
+			return std::noop_coroutine();
+		}
+
+		void await_resume() noexcept {}
+	};
+
+	finalAwaiter final_suspend() noexcept { return {}; }
+
+	void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template<typename T>
+struct taskPromise : taskPromiseBase<T>
+{
+	std::optional<T> value;
+
+	task<T> get_return_object();
+
+	void return_value(T Value) { value = std::move(Value); }
+};
+
+template<>
+struct taskPromise<void> : taskPromiseBase<void>
+{
+	task<void> get_return_object();
+
+	void return_void() {}
+};
+
+template<typename T = void>
+class task
+{
+public:
+	typedef taskPromise<T> promise_type;
+
+	task() {}
+	explicit task(std::coroutine_handle<promise_type> Handle) : handle(Handle) {}
+
+	task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	task& operator=(task&& other) noexcept { if (this != &other) { destroy(); handle = std::exchange(other.handle, nullptr); } return *this; }
+
+	task(const task&) = delete;
+	task& operator=(const task&) = delete;
+
+	~task() { destroy(); }
+
+	bool done() const { return !handle || handle.done(); }
+
+	void start() { if (handle && !handle.done()) handle.resume(); } //run until the first suspension - used by the event loop for spawned tasks
+
+	void rethrow() const { if (handle && handle.promise().exception) std::rethrow_exception(handle.promise().exception); }
+
+	//awaiting a task starts it and resumes the awaiting coroutine once it finishes
+	bool await_ready() const noexcept { return !handle || handle.done(); }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+	{
+		handle.promise().continuation = awaiting;
+
+		return handle;
+	}
+
+	T await_resume()
+	{
+		rethrow();
+
+		if constexpr (!std::is_void_v<T>) return std::move(*handle.promise().value);
+	}
+
+private:
+	std::coroutine_handle<promise_type> handle;
+
+	void destroy() { if (handle) handle.destroy(); handle = nullptr; }
+};
+
+template<typename T>
+task<T> taskPromise<T>::get_return_object() { return task<T>(std::coroutine_handle<taskPromise<T>>::from_promise(*this)); }
+
+inline task<void> taskPromise<void>::get_return_object() { return task<void>(std::coroutine_handle<taskPromise<void>>::from_promise(*this)); }
+
+class eventLoop
+{
+public:
+	typedef std::chrono::steady_clock clock;
+
+	eventLoop();
+	~eventLoop();
+
+	eventLoop(const eventLoop&) = delete;
+	eventLoop& operator=(const eventLoop&) = delete;
+
+	void spawn(task<void>&&); //start a task and keep it alive until it finishes
+
+	//wait for events for at most the given number of milliseconds and resume the tasks that are ready
+	//returns false once every spawned task has finished
+	bool runOnce(const int);
+
+	size_t activeTasks() const { return spawned.size(); }
+
+	void forget(const int); //stop watching a socket - must be called before it is closed
+
+	struct fdAwaiter //resumed when the socket is ready or the timeout expires - returns false on timeout
+	{
+		eventLoop& loop;
+		int fd;
+		bool write;
+		clock::time_point deadline;
+		bool timed_out = false;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle) { loop.watch(fd, write, handle, deadline, &timed_out); }
+		bool await_resume() const noexcept { return !timed_out; }
+	};
+
+	struct sleepAwaiter
+	{
+		eventLoop& loop;
+		clock::time_point deadline;
+
+		bool await_ready() const noexcept { return clock::now() >= deadline; }
+		void await_suspend(std::coroutine_handle<> handle) { loop.addTimer(deadline, handle, -1, false, 0, nullptr); }
+		void await_resume() const noexcept {}
+	};
+
+	fdAwaiter readable(const int fd, const double timeout) { return fdAwaiter{ *this, fd, false, deadlineAfter(timeout) }; }
+	fdAwaiter writable(const int fd, const double timeout) { return fdAwaiter{ *this, fd, true, deadlineAfter(timeout) }; }
+
+	sleepAwaiter sleepFor(const double seconds) { return sleepAwaiter{ *this, deadlineAfter(seconds) }; }
+
+	size_t wakeups = 0; //number of times epoll_wait returned with at least one event
+
+private:
+	struct fdWaiters
+	{
+		std::coroutine_handle<> reader;
+		std::coroutine_handle<> writer;
+
+		uint64_t reader_generation = 0;
+		uint64_t writer_generation = 0;
+
+		bool* reader_timed_out = nullptr;
+		bool* writer_timed_out = nullptr;
+
+		uint32_t registered_events = 0; //events epoll is currently watching for - 0 if the socket is not registered
+	};
+
+	struct timer
+	{
+		clock::time_point deadline;
+		std::coroutine_handle<> handle;
+
+		int fd; //-1 for sleeps, otherwise the socket whose wait times out
+		bool write;
+		uint64_t generation; //the wait this timer belongs to - stale if the socket became ready first
+		bool* timed_out;
+
+		bool operator>(const timer& other) const { return deadline > other.deadline; }
+	};
+
+	int epoll_fd = -1;
+
+	uint64_t next_generation = 1;
+
+	std::unordered_map<int, fdWaiters> waiters;
+	std::priority_queue<timer, std::vector<timer>, std::greater<timer>> timers;
+	std::list<task<void>> spawned;
+
+	static clock::time_point deadlineAfter(const double seconds)
+	{
+		return clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+	}
+
+	void watch(const int, const bool, std::coroutine_handle<>, const clock::time_point, bool*);
+	void addTimer(const clock::time_point, std::coroutine_handle<>, const int, const bool, const uint64_t, bool*);
+	void updateInterest(const int);
+
+	void fireTimers();
+	void reap(); //remove the spawned tasks that finished - rethrows their exceptions
+};
+
+#endif
+
+#endif
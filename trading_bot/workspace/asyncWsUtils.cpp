@@ -0,0 +1,319 @@
+#include "asyncWsUtils.h"
+
+#ifdef USE_ASYNC_WEBSOCKETS
+
+#include "rateUtils.h"
+
+#include <openssl/sha.h>
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cctype>
+#include <ctime>
+
+const std::string websocket_guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"; //appended to the key of the upgrade request (RFC 6455)
+
+//the value of the Sec-WebSocket-Accept field the server has to send back for a key
+std::string websocketAccept(const std::string& key)
+{
+	unsigned char digest[SHA_DIGEST_LENGTH];
+	unsigned char encoded[4 * ((SHA_DIGEST_LENGTH + 2) / 3) + 1];
+
+	const std::string text = key + websocket_guid;
+
+	SHA1(reinterpret_cast<const unsigned char*>(text.data()), text.size(), digest);
+
+	int size = EVP_EncodeBlock(encoded, digest, SHA_DIGEST_LENGTH);
+
+	return std::string(reinterpret_cast<const char*>(encoded), size);
+}
+
+asyncWebsocket::asyncWebsocket(const SSLContextWrapper&, const std::string& Host, const bool, const bool, const time_t Timeout)
+	: connection(loop, sharedTlsContext()),
+	host(Host),
+	port("443"),
+	timeout(static_cast<double>(Timeout)),
+	mask_generator(std::random_device()())
+{
+	size_t colon = host.find(':');
+
+	if (colon != std::string::npos)
+	{
+		port = host.substr(colon + 1);
+		host.erase(colon);
+	}
+}
+
+void asyncWebsocket::reInit()
+{
+	connection.close();
+
+	input.clear();
+	fragments.clear();
+
+	handled = 0;
+
+	last_timing = frameTiming();
+}
+
+void asyncWebsocket::lost()
+{
+	connection.close();
+
+	throw SSLNoReturn();
+}
+
+void asyncWebsocket::run(task<void>&& work)
+{
+	loop.spawn(std::move(work));
+
+	try { while (loop.runOnce(1000)) continue; }
+	catch (const connectionLost&) { lost(); }
+}
+
+void asyncWebsocket::open(const dictionary& headers, const std::string& path, http::httpResponse& response)
+{
+	reInit();
+
+	run(upgrade(headers, path, response));
+
+#ifdef USE_RX_TIMESTAMPS
+	//frames that arrived with the response were already read without timestamps
+	connection.enableRxTimestamps();
+#endif
+}
+
+task<void> asyncWebsocket::upgrade(const dictionary& headers, const std::string& path, http::httpResponse& response)
+{
+	const std::string host_field = (port == "443") ? host : host + ":" + port;
+	const std::string request = buildRequest("GET", host_field, dictionary(), headers, path, "");
+
+	co_await connection.connect(host, port, timeout);
+	co_await connection.writeAll(request, timeout);
+
+	size_t end;
+
+	while ((end = input.find("\r\n\r\n")) == std::string::npos)
+	{
+		size_t bytes = co_await connection.readSome(buffer, sizeof(buffer), timeout);
+
+		if (!bytes) throw connectionLost();
+
+		input.append(buffer, bytes);
+	}
+
+	//status line - HTTP/1.1 101 Switching Protocols
+	size_t line_end = input.find("\r\n");
+	size_t code_start = input.find(' ');
+
+	if (code_start == std::string::npos || code_start > line_end || input.compare(0, 5, "HTTP/")) throw exceptions::exception("Received an invalid status line : " + input.substr(0, line_end));
+
+	response.status_code = std::atoi(input.c_str() + code_start + 1);
+
+	size_t message_start = input.find(' ', code_start + 1);
+
+	response.status_message = (message_start == std::string::npos || message_start > line_end) ? "" : input.substr(message_start + 1, line_end - message_start - 1);
+
+	//header fields
+	while (line_end < end)
+	{
+		size_t line_start = line_end + 2;
+
+		line_end = input.find("\r\n", line_start);
+
+		size_t colon = input.find(':', line_start);
+
+		if (colon == std::string::npos || colon > line_end) continue;
+
+		size_t value_start = std::min(input.find_first_not_of(" \t", colon + 1), line_end);
+
+		response.fields[input.substr(line_start, colon - line_start)] = input.substr(value_start, line_end - value_start);
+	}
+
+	response.message.clear();
+
+	handled = end + 4; //the first frames can follow the response right away
+
+	if (response.status_code != 101) co_return;
+
+	//the key field is matched without its case - the bot sends Sec-Websocket-Key
+	for (const auto& pair : headers)
+	{
+		std::string name = pair.first;
+
+		std::transform(name.begin(), name.end(), name.begin(), [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		if (name != "sec-websocket-key") continue;
+
+		const std::string* accept = findHeaderField(response, "sec-websocket-accept");
+
+		if (!accept || *accept != websocketAccept(pair.second)) throw exceptions::exception("The server did not accept the websocket key.");
+	}
+}
+
+bool asyncWebsocket::recv(std::string& message)
+{
+	if (nextMessage(message)) return returnMessage();
+
+	input.erase(0, handled); //only the start of a frame is left
+	handled = 0;
+
+	//read what already arrived without waiting
+	while (true)
+	{
+		size_t bytes = 0;
+
+		try { bytes = connection.readAvailable(buffer, sizeof(buffer)); }
+		catch (const connectionLost&) { lost(); }
+
+		if (!bytes) return false;
+
+		input.append(buffer, bytes);
+
+		if (nextMessage(message)) return returnMessage();
+	}
+}
+
+bool asyncWebsocket::returnMessage()
+{
+#ifdef USE_RX_TIMESTAMPS
+	timespec now;
+
+	clock_gettime(CLOCK_REALTIME, &now); //the kernel stamps with the realtime clock
+
+	last_timing.kernel = connection.rx_timestamp;
+	last_timing.returned = int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+#endif
+
+	return true;
+}
+
+bool asyncWebsocket::nextMessage(std::string& message)
+{
+	while (true)
+	{
+		const size_t available = input.size() - handled;
+
+		if (available < 2) return false;
+
+		const unsigned char* frame = reinterpret_cast<const unsigned char*>(input.data() + handled);
+
+		const bool final_frame = frame[0] & 0x80;
+		const int opcode = frame[0] & 0x0F;
+		const bool masked = frame[1] & 0x80;
+
+		uint64_t size = frame[1] & 0x7F;
+		size_t header_size = 2;
+
+		if (size == 126)
+		{
+			if (available < 4) return false;
+
+			size = (uint64_t(frame[2]) << 8) | frame[3];
+			header_size = 4;
+		}
+		else if (size == 127)
+		{
+			if (available < 10) return false;
+
+			size = 0;
+
+			for (int i = 2; i < 10; i++) size = (size << 8) | frame[i];
+
+			header_size = 10;
+		}
+
+		const size_t mask_start = header_size;
+
+		if (masked) header_size += 4; //servers don't mask their frames but nothing forbids it
+
+		if (available < header_size || available - header_size < size) return false;
+
+		char* payload = input.data() + handled + header_size;
+
+		if (masked)
+		{
+			const char* mask = input.data() + handled + mask_start;
+
+			for (size_t i = 0; i < size; i++) payload[i] ^= mask[i & 3];
+		}
+
+		handled += header_size + size;
+
+		switch (opcode)
+		{
+			case 0x9: { writeFrame(0xA, payload, size); break; } //ping - answered with a pong that carries the same payload
+			case 0xA: break; //pong
+			case 0x8: //close - echo the status code and give up the connection
+			{
+				writeFrame(0x8, payload, std::min<size_t>(size, 2));
+				lost();
+			}
+			case 0x0: //continuation of a fragmented message
+			{
+				fragments.append(payload, size);
+
+				if (!final_frame) break;
+
+				message.swap(fragments);
+				fragments.clear();
+
+				return true;
+			}
+			default: //text or binary
+			{
+				if (!final_frame)
+				{
+					fragments.assign(payload, size);
+
+					break;
+				}
+
+				message.assign(payload, size);
+
+				return true;
+			}
+		}
+	}
+}
+
+void asyncWebsocket::send(const std::string& message, const int frame_type)
+{
+	writeFrame(frame_type & 0x0F, message.data(), message.size()); //only the opcode is taken from the frame type - the message is never fragmented
+}
+
+void asyncWebsocket::writeFrame(const int opcode, const char* payload, const size_t size)
+{
+	std::string frame;
+
+	frame.reserve(size + 14);
+
+	frame += static_cast<char>(0x80 | opcode);
+
+	//every frame sent by a client is masked
+	if (size < 126) frame += static_cast<char>(0x80 | size);
+	else if (size <= 0xFFFF)
+	{
+		frame += static_cast<char>(0x80 | 126);
+		frame += static_cast<char>(size >> 8);
+		frame += static_cast<char>(size & 0xFF);
+	}
+	else
+	{
+		frame += static_cast<char>(0x80 | 127);
+
+		for (int shift = 56; shift >= 0; shift -= 8) frame += static_cast<char>((uint64_t(size) >> shift) & 0xFF);
+	}
+
+	const uint32_t key = mask_generator();
+	const char mask[4] = { char(key >> 24), char(key >> 16), char(key >> 8), char(key) };
+
+	frame.append(mask, 4);
+
+	for (size_t i = 0; i < size; i++) frame += static_cast<char>(payload[i] ^ mask[i & 3]);
+
+	run(connection.writeAll(frame, timeout));
+}
+
+#endif
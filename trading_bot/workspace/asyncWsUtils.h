@@ -0,0 +1,101 @@
+
+/*
+A websocket client (RFC 6455) on the TLS connections of asyncHttpUtils.h with the interface of the websocket of wsUtils.h.
+
+open() connects, sends the upgrade request with the given header fields, and reads the response - a 101 response is
+only accepted if its Sec-WebSocket-Accept field matches the Sec-WebSocket-Key that was sent. recv() never blocks - it
+returns true once a whole message was received (fragmented messages are joined) and answers pings on the way. send()
+masks the message and writes it as a single frame. A close frame or a lost connection throws SSLNoReturn like the
+websocket of wsUtils.h does.
+
+The host can include a port (localhost:8443) and certificates are verified with the shared TLS context (see
+tlsContext::trustCertificate) so the bot can be pointed at a local stand-in server - see stand_in_server.py and
+startupBenchmark.cpp.
+
+With USE_RX_TIMESTAMPS the connection is read with the kernel's software receive timestamps once it is open and
+lastTiming() tells when the message last returned by recv() was received by the kernel and when it was returned - see
+latencyUtils.h for the delays computed from them.
+
+botWebsocket is the websocket used by the bot - this client with USE_ASYNC_WEBSOCKETS (off by default, always on in
+startup_benchmark), the websocket of wsUtils.h otherwise.
+*/
+
+#ifndef ASYNC_WS_UTILS_H
+#define ASYNC_WS_UTILS_H
+
+#ifdef __linux__
+//#define USE_ASYNC_WEBSOCKETS //open the data and account websockets with the async runtime instead of the websockets of wsUtils.h
+//#define USE_RX_TIMESTAMPS //read the websockets with SO_TIMESTAMPING receive timestamps and report the delays of their messages (needs USE_ASYNC_WEBSOCKETS)
+#endif
+
+#include "wsUtils.h"
+#include "httpUtils.h"
+#include "socketUtils.h"
+#include "exceptUtils.h"
+#include "latencyUtils.h"
+
+#ifdef USE_ASYNC_WEBSOCKETS
+
+#include "asyncUtils.h"
+#include "asyncHttpUtils.h"
+
+#include <string>
+#include <random>
+#include <ctime>
+
+class asyncWebsocket
+{
+public:
+	//the context and the flags are unused and only kept for the interface of websocket - context, host (with an optional :port), flags, timeout
+	asyncWebsocket(const SSLContextWrapper&, const std::string&, const bool, const bool, const time_t);
+
+	asyncWebsocket(const asyncWebsocket&) = delete;
+	asyncWebsocket& operator=(const asyncWebsocket&) = delete;
+
+	void reInit(); //close the connection - the next open() connects again
+	void open(const dictionary&, const std::string&, http::httpResponse&); //connect and upgrade the connection - header fields, path, response
+
+	bool recv(std::string&); //true if a whole message was received - never waits
+	void send(const std::string&, const int); //send a message in one frame - message, frame type (WS_TEXT_FRAME)
+
+	const frameTiming& lastTiming() const { return last_timing; } //only set with USE_RX_TIMESTAMPS
+
+private:
+	eventLoop loop;
+	asyncTlsConnection connection;
+
+	std::string host;
+	std::string port;
+	double timeout;
+
+	std::string input; //bytes received but not handled yet
+	size_t handled = 0; //bytes at the front of the input that were already handled
+
+	std::string fragments; //the payload of a fragmented message received so far
+
+	char buffer[16384]; //the size of the largest TLS record
+
+	std::mt19937 mask_generator;
+
+	frameTiming last_timing;
+
+	bool returnMessage(); //stamp the message that is about to be returned - always true
+
+	void run(task<void>&&); //run a task on the loop until it is done - a lost connection throws SSLNoReturn
+	task<void> upgrade(const dictionary&, const std::string&, http::httpResponse&);
+
+	bool nextMessage(std::string&); //take the next whole message out of the input - false if it was not fully received yet
+	void writeFrame(const int, const char*, const size_t); //opcode, payload, payload size
+
+	[[noreturn]] void lost();
+};
+
+typedef asyncWebsocket botWebsocket;
+
+#else
+
+typedef websocket botWebsocket;
+
+#endif
+
+#endif
@@ -0,0 +1,298 @@
+
+#include "barUtils.h"
+
+void barBatches::reset(const std::vector<std::string>& Tickers, const std::vector<std::string>& Start_dates)
+{
+	tickers = Tickers;
+	start_dates = Start_dates;
+
+	completed.assign(tickers.size(), false);
+
+	positions.clear();
+	positions.reserve(tickers.size());
+
+	for (size_t position = 0; position < tickers.size(); position++) positions[tickers[position]] = position;
+
+	//pack consecutive symbols with the same start date into batches
+	batch_starts.clear();
+
+	for (size_t position = 0; position < tickers.size(); position++)
+	{
+		if (!batch_starts.size() || position - batch_starts.back() >= static_cast<size_t>(max_symbols_per_request)) batch_starts.push_back(position);
+		else if (start_dates.size() && start_dates[position] != start_dates[batch_starts.back()]) batch_starts.push_back(position);
+	}
+
+	batch_starts.push_back(tickers.size());
+
+	last_positions.assign(size(), no_position);
+}
+
+void barBatches::setParameters(const size_t batch, dictionary& parameters) const
+{
+	size_t batch_start = batch_starts[batch];
+	size_t batch_end = batch_starts[batch + 1];
+
+	std::string symbol_list = tickers[batch_start];
+
+	for (size_t position = batch_start + 1; position < batch_end; position++) symbol_list += "," + tickers[position];
+
+	parameters["symbols"] = symbol_list;
+	parameters["page_token"] = "";
+
+	if (start_dates.size()) parameters["start"] = start_dates[batch_start];
+}
+
+bool barBatches::finishPage(const barPageStream& stream, dictionary& parameters) const
+{
+	if (!stream.complete()) throw exceptions::exception("Received an incomplete page of bars.");
+
+	if (!stream.nextPageToken().size()) return true;
+
+	parameters["page_token"] = stream.nextPageToken();
+
+	return false;
+}
+
+barClientPool::barClientPool(const SSLContextWrapper& SSL_context_wrapper, requestScheduler& Scheduler, const dictionary& parameters, const dictionary& headers,
+	time_t Timeout, const std::string& Host)
+	: ssl_context_wrapper(const_cast<SSLContextWrapper&>(SSL_context_wrapper)),
+	scheduler(Scheduler),
+	base_parameters(parameters),
+	base_headers(headers),
+	timeout(Timeout),
+	host(Host)
+{}
+
+barClientPool::~barClientPool() {}
+
+void barClientPool::start(const std::vector<std::string>& tickers, const std::vector<std::string>& start_dates)
+{
+	batches.reset(tickers, start_dates);
+
+	next_batch = 0;
+
+	//create multiple http clients with non-blocking I/O to retrieve data - the scheduler decides how many of them can send requests at once
+	const int num_clients = (static_cast<size_t>(max_clients) > batches.size()) ? static_cast<int>(batches.size()) : max_clients; //number of http clients to use for asynchronous data retrieval
+
+	data_clients.clear();
+	responses.clear();
+	client_parameters.clear();
+	client_headers.clear();
+	current_batches.clear();
+	retired.clear();
+	queued.clear();
+
+	client_parameters.reserve(num_clients);
+	current_batches.reserve(num_clients);
+	client_headers.reserve(num_clients);
+	data_clients.reserve(num_clients);
+	responses.reserve(num_clients);
+
+	for (int i = 0; i < num_clients; i++)
+	{
+		data_clients.push_back(http::httpClient(ssl_context_wrapper, host, false, timeout));
+		responses.push_back(http::httpResponse());
+
+		client_parameters.push_back(base_parameters);
+		client_headers.push_back(base_headers);
+		current_batches.push_back(0);
+		retired.push_back(false);
+		queued.push_back(false);
+
+		responses[i].clear();
+
+		data_clients[i].reConnect(); //connect to the host
+
+		nextBatch(i);
+	}
+
+	active_clients = num_clients;
+
+	scheduler.setMaxInFlight(num_clients);
+
+	sendQueuedRequests();
+}
+
+void barClientPool::queueRequest(const int i)
+{
+	queued[i] = true;
+}
+
+void barClientPool::sendQueuedRequests()
+{
+	for (int i = 0; i < static_cast<int>(data_clients.size()); i++)
+	{
+		if (!queued[i] || retired[i]) continue;
+		if (!scheduler.canSend()) return;
+
+		data_clients[i].get(client_parameters[i], client_headers[i], "/v2/stocks/bars"); //prepare the get request
+
+		scheduler.onSend();
+
+		queued[i] = false;
+
+		requests_sent++;
+	}
+}
+
+bool barClientPool::nextBatch(const int i)
+{
+	if (next_batch >= batches.size()) return false;
+
+	batches.setParameters(next_batch, client_parameters[i]);
+
+	current_batches[i] = next_batch;
+
+	next_batch++;
+
+	queueRequest(i);
+
+	return true;
+}
+
+#ifdef USE_ASYNC_RUNTIME
+
+asyncBarClientPool::asyncBarClientPool(const SSLContextWrapper&, requestScheduler& Scheduler, const dictionary& parameters, const dictionary& headers,
+	time_t Timeout, const std::string& Host)
+	: scheduler(Scheduler),
+	base_parameters(parameters),
+	base_headers(headers),
+	timeout(Timeout),
+	host(Host)
+{}
+
+asyncBarClientPool::~asyncBarClientPool() {}
+
+void asyncBarClientPool::start(const std::vector<std::string>& tickers, const std::vector<std::string>& start_dates)
+{
+	batches.reset(tickers, start_dates);
+
+	next_batch = 0;
+
+	const int num_clients = (static_cast<size_t>(max_clients) > batches.size()) ? static_cast<int>(batches.size()) : max_clients; //number of http clients to use for asynchronous data retrieval
+
+	data_clients.clear();
+	data_clients.reserve(num_clients);
+
+	scheduler.setMaxInFlight(num_clients * max_pipelined_requests);
+
+	size_t colon = host.find(':'); //a local stand-in server is reached on another port
+
+	for (int i = 0; i < num_clients; i++)
+	{
+		if (colon == std::string::npos) data_clients.push_back(std::make_unique<asyncHttpClient>(loop, sharedTlsContext(), host, timeout));
+		else data_clients.push_back(std::make_unique<asyncHttpClient>(loop, sharedTlsContext(), host.substr(0, colon), timeout, host.substr(colon + 1)));
+
+		loop.spawn(fetchBatches(i));
+	}
+}
+
+task<void> asyncBarClientPool::waitForScheduler()
+{
+	while (!scheduler.canSend()) co_await loop.sleepFor(0.002);
+}
+
+task<void> asyncBarClientPool::fetchBatches(const int i)
+{
+	asyncHttpClient& client = *data_clients[i];
+
+	std::deque<pageRequest> sent; //pages requested on this client - answered in the order they were sent
+	std::vector<pageRequest> ready; //pages that can be requested once the pipeline has room
+
+	http::httpResponse response;
+
+	//the page at the front of the pipeline is parsed while its body arrives
+	barPageStream page_stream;
+	bodyStream body_stream;
+
+	body_stream.begin = [&]() { page_stream.restartPage(); };
+	body_stream.append = [&](const char* data, const size_t size)
+	{
+		bytes_received += size;
+
+		batches.streamPage(sent.front().batch, page_stream, data, size, page_handler, completion_handler);
+	};
+
+	page_stream.startPage();
+
+	int lost_connections = 0; //connections lost in a row
+
+	while (true)
+	{
+		//fill the pipeline with the next pages of the batches in progress and then with new batches
+		while (sent.size() < static_cast<size_t>(max_pipelined_requests))
+		{
+			if (!ready.size())
+			{
+				if (next_batch >= batches.size()) break;
+
+				ready.push_back(pageRequest{ next_batch, base_parameters });
+				batches.setParameters(next_batch, ready.back().parameters);
+
+				next_batch++;
+			}
+
+			//only wait for the scheduler if nothing is on the way - otherwise receive the responses in the meantime
+			if (sent.size() && !scheduler.canSend()) break;
+
+			co_await waitForScheduler();
+
+			scheduler.onSend();
+			requests_sent++;
+
+			sent.push_back(std::move(ready.back()));
+			ready.pop_back();
+
+			co_await client.send(sent.back().parameters, base_headers, "/v2/stocks/bars");
+		}
+
+		if (!sent.size()) break; //every batch was fetched
+
+		bool lost = false;
+
+		//the client sends the unanswered requests again when it reconnects so they stay in flight
+		try { co_await client.receive(response, &body_stream); }
+		catch (const connectionLost&) { lost = true; }
+
+		if (lost)
+		{
+			if (++lost_connections >= max_lost_connections) throw exceptions::exception("Lost the connection to the data server too many times.");
+
+			continue;
+		}
+
+		lost_connections = 0;
+
+		pageRequest page = std::move(sent.front());
+
+		sent.pop_front();
+
+		if (response.status_code == 429) //back off and request the same page again
+		{
+			scheduler.onRateLimited(response);
+
+			ready.push_back(std::move(page));
+
+			continue;
+		}
+
+		scheduler.onResponse(response);
+
+		if (response.status_code != 200)
+		{
+			throw exceptions::exception("Received an unexpected status code : " + std::to_string(response.status_code)\
+				+ " - with the following message : " + response.status_message);
+		}
+
+		bool last_page = batches.finishPage(page_stream, page.parameters);
+
+		page_stream.startPage();
+
+		if (last_page) batches.completeBatch(page.batch, completion_handler);
+		else ready.push_back(std::move(page)); //request the next page
+	}
+
+	requests_sent += client.requests_resent;
+}
+
+#endif
@@ -0,0 +1,348 @@
+
+/*
+Pools of http clients that request historical bars from /v2/stocks/bars for batches of symbols.
+
+Instead of one request per symbol, up to max_symbols_per_request symbols (that share the same start date) are packed into
+one request with a comma separated symbols parameter. The limit parameter applies to the total number of bars on a page
+so a batch is paginated as a whole - a symbol's bars can be split across pages.
+
+Each page is parsed in a single pass (jsonStreamUtils.h) and every bar is passed to a page handler with the position of
+its symbol as soon as the bar is parsed - the async pool parses each body while it is being received. A symbol is passed
+to a completion handler once no more of its bars can arrive - when the bars of another symbol of its batch follow its
+bars (the bars of each symbol are contiguous) or when the last page of its batch is received.
+
+Requests are not sent directly - each request waits until the request scheduler allows it.
+Rate limited (429) responses are sent again once the scheduler stops backing off.
+
+There are two pools with the same interface - barPool is the one used by the bot
+	asyncBarClientPool runs one coroutine per client on the epoll event loop of asyncUtils.h - each batch is fetched by a ...
+	... straight-line sequence of co_await expressions and only the sockets that are ready are serviced (Linux only)
+	... each client pipelines the pages of up to max_pipelined_requests batches on its keep-alive connection so the
+	... round trip time no longer bounds the number of pages a connection can receive
+	barClientPool polls every non-blocking http client in turn (every other platform)
+*/
+
+#ifndef BAR_UTILS_H
+#define BAR_UTILS_H
+
+#ifdef __linux__
+#define USE_ASYNC_RUNTIME //fetch historical bars with the epoll and coroutine runtime - comment out to poll every client instead
+#endif
+
+#include "arrayUtils.h"
+#include "jsonUtils.h"
+#include "jsonStreamUtils.h"
+#include "httpUtils.h"
+#include "socketUtils.h"
+#include "exceptUtils.h"
+#include "rateUtils.h"
+
+#ifdef USE_ASYNC_RUNTIME
+
+#include "asyncUtils.h"
+#include "asyncHttpUtils.h"
+
+#include <memory>
+#include <deque>
+
+#endif
+
+#include <unordered_map>
+#include <functional>
+#include <string>
+#include <vector>
+#include <ctime>
+
+//this bot can use up to 64 non-blocking clients  to gather data before it starts trading (it can use more but improvement in speed quickly diminishes)
+//the request scheduler decides how many of them have a request in flight so that Alpaca's API rate limit is not exceeded ...
+//... (10000 per minute for unlimited accounts and 200 per minute otherwise)
+
+const int max_clients = 20; //maximum number of http clients used to gather data asynchronously
+const int max_symbols_per_request = 100; //maximum number of symbols packed into one historical bar request - keeps the request line reasonably short
+const int max_lost_connections = 5; //number of times in a row an async client can fail to get a response before giving up
+const int max_pipelined_requests = 4; //number of requests an async client can send before receiving their responses (HTTP/1.1 pipelining) - 1 turns pipelining off
+
+class barBatches //packs symbols into batches and demultiplexes the pages of each batch
+{
+public:
+	//pack the symbols into batches - an empty vector of start dates uses the start parameter for every symbol
+	void reset(const std::vector<std::string>&, const std::vector<std::string>&);
+
+	size_t size() const { return batch_starts.size() - 1; } //number of batches
+
+	void setParameters(const size_t, dictionary&) const; //set the symbols and start date of a batch and clear the page token
+
+	//parse the next bytes of a page of a batch - each bar is passed to the page handler with the position of its symbol ...
+	//... and the symbols that can't receive more bars are passed to the completion handler
+	void streamPage(const size_t, barPageStream&, const char*, const size_t, auto&, auto&);
+
+	//check that the page was complete - returns true if this was the last page of the batch ...
+	//... otherwise the page token of the next page is set in the parameters
+	bool finishPage(const barPageStream&, dictionary&) const;
+
+	bool processPage(const size_t, barPageStream&, const std::string&, dictionary&, auto&, auto&); //parse a whole page - returns the same as finishPage
+
+	void completeBatch(const size_t, auto&); //complete the symbols of a batch that were not completed yet
+
+private:
+	std::vector<std::string> tickers;
+	std::vector<std::string> start_dates;
+
+	std::unordered_map<std::string, size_t> positions; //position of each ticker in the tickers vector
+
+	std::vector<size_t> batch_starts; //position of the first symbol of each batch - the last element is the number of symbols
+	std::vector<size_t> last_positions; //position of the symbol whose bars were received last in each batch - no_position if none were received
+
+	std::vector<char> completed; //completed[position] is true if the symbol was passed to the completion handler
+
+	static constexpr size_t no_position = static_cast<size_t>(-1);
+};
+
+void barBatches::streamPage(const size_t batch, barPageStream& stream, const char* data, const size_t size, auto& page_handler, auto& completion_handler)
+{
+	size_t& last_position = last_positions[batch];
+
+	auto routeBar = [&](const std::string& ticker, const jsonFields& bar)
+	{
+		//the bars of the previous symbol are usually followed by the bars of the same one
+		if (last_position == no_position || tickers[last_position] != ticker)
+		{
+			auto position = positions.find(ticker);
+
+			if (position == positions.end()) return;
+			if (position->second < batch_starts[batch] || position->second >= batch_starts[batch + 1]) return; //not requested in this batch
+
+			//the bars of each symbol are contiguous so the previous symbol is complete
+			if (last_position != no_position && !completed[last_position])
+			{
+				completed[last_position] = true;
+				completion_handler(last_position);
+			}
+
+			last_position = position->second;
+		}
+
+		page_handler(last_position, bar);
+	};
+
+	stream.feed(data, size, routeBar);
+}
+
+bool barBatches::processPage(const size_t batch, barPageStream& stream, const std::string& message, dictionary& parameters, auto& page_handler, auto& completion_handler)
+{
+	stream.startPage();
+
+	streamPage(batch, stream, message.data(), message.size(), page_handler, completion_handler);
+
+	return finishPage(stream, parameters);
+}
+
+void barBatches::completeBatch(const size_t batch, auto& completion_handler)
+{
+	for (size_t position = batch_starts[batch]; position < batch_starts[batch + 1]; position++)
+	{
+		if (completed[position]) continue;
+
+		completed[position] = true;
+		completion_handler(position);
+	}
+}
+
+class barClientPool
+{
+public:
+	barClientPool(const SSLContextWrapper&, requestScheduler&, const dictionary&, const dictionary&, time_t, const std::string& = "data.alpaca.markets"); //context, scheduler, parameters, headers, timeout, host
+	~barClientPool();
+
+	//pack the symbols into batches and send the first requests - an empty vector of start dates uses the start parameter for every symbol
+	void start(const std::vector<std::string>&, const std::vector<std::string>&);
+
+	//receive responses on each client once - returns false when the bars of every symbol have been received
+	//page_handler(position, bar) is called with the fields (jsonFields) of each bar of the symbol at that position of the tickers vector
+	//completion_handler(position) is called once all of the bars of that symbol have been passed to the page handler
+	//the wait time is only used by the async pool
+	bool poll(auto&, auto&, const int = 0);
+
+	size_t requests_sent = 0; //number of requests sent, including pages and retries
+	size_t bytes_received = 0; //total size of the bodies of the responses received
+
+private:
+	SSLContextWrapper& ssl_context_wrapper;
+	requestScheduler& scheduler;
+
+	barBatches batches;
+	size_t next_batch = 0; //index of the next batch to request
+
+	barPageStream page_stream; //responses are parsed one at a time
+
+	dictionary base_parameters;
+	dictionary base_headers;
+
+	time_t timeout;
+
+	std::string host;
+
+	std::vector<http::httpClient> data_clients;
+	std::vector<http::httpResponse> responses;
+	std::vector<dictionary> client_parameters;
+	std::vector<dictionary> client_headers;
+	std::vector<size_t> current_batches; //the batch each client is currently requesting
+
+	//checking out of a static array is much faster than doing so out of a vector
+	array<bool, max_clients> retired; //retired[i] is true if data_clients[i] is done being used to gather data
+	array<bool, max_clients> queued; //queued[i] is true if data_clients[i] has a request waiting for the scheduler
+
+	int active_clients = 0; //number of http clients that are still retrieving data
+
+	void queueRequest(const int); //queue the get request of the current page of a client
+	void sendQueuedRequests(); //send the queued requests the scheduler allows
+	bool nextBatch(const int); //assign the next batch to a client - returns false if there are no batches left
+};
+
+bool barClientPool::poll(auto& page_handler, auto& completion_handler, const int)
+{
+	http::status current_status; //current status of the current response being received
+
+	sendQueuedRequests();
+
+	for (int i = 0; i < static_cast<int>(data_clients.size()); i++)
+	{
+		if (retired[i]) continue; //if we are no longer using this client then move on to the next one
+		if (queued[i]) continue; //nothing to receive until the request is sent
+
+		http::httpClient& current_client = data_clients[i];
+		http::httpResponse& current_response = responses[i];
+
+		try { current_status = current_client.recvResponse(current_response); }
+		catch (const SSLNoReturn&) //the connection was closed
+		{
+			scheduler.onFailure();
+
+			current_response.clear();
+
+			current_client.reConnect(); //reconnect to the host
+			queueRequest(i);
+
+			continue;
+		}
+
+		if (current_status == http::status::TIMED_OUT) throw exceptions::exception("Timed out while retrieving stock data.");
+		if (current_status != http::status::RECEIVED_RESPONSE) continue;
+
+		if (current_response.status_code == 429) //back off and send the same request again
+		{
+			scheduler.onRateLimited(current_response);
+
+			current_response.clear();
+
+			queueRequest(i);
+
+			continue;
+		}
+
+		scheduler.onResponse(current_response);
+
+		if (current_response.status_code != 200)
+		{
+			throw exceptions::exception("Received an unexpected status code : " + std::to_string(current_response.status_code)\
+				+ " - with the following message : " + current_response.status_message);
+		}
+
+		bytes_received += current_response.message.size();
+
+		if (batches.processPage(current_batches[i], page_stream, current_response.message, client_parameters[i], page_handler, completion_handler))
+		{
+			//complete the rest of the batch and send get request for the next batch
+			batches.completeBatch(current_batches[i], completion_handler);
+
+			current_response.clear();
+
+			if (!nextBatch(i))
+			{
+				active_clients--;
+				retired[i] = true;
+			}
+		}
+		else
+		{
+			current_response.clear();
+
+			queueRequest(i);
+		}
+	}
+
+	return active_clients > 0;
+}
+
+#ifdef USE_ASYNC_RUNTIME
+
+class asyncBarClientPool
+{
+public:
+	asyncBarClientPool(const SSLContextWrapper&, requestScheduler&, const dictionary&, const dictionary&, time_t, const std::string& = "data.alpaca.markets"); //context, scheduler, parameters, headers, timeout, host
+	~asyncBarClientPool();
+
+	//pack the symbols into batches and start one fetching task per client - an empty vector of start dates uses the start parameter for every symbol
+	void start(const std::vector<std::string>&, const std::vector<std::string>&);
+
+	//wait for at most the given number of milliseconds and handle the responses that arrived - returns false when the bars of every symbol have been received
+	//page_handler(position, bar) is called with the fields (jsonFields) of each bar of the symbol at that position of the tickers vector
+	//completion_handler(position) is called once all of the bars of that symbol have been passed to the page handler
+	bool poll(auto&, auto&, const int = 10);
+
+	size_t requests_sent = 0; //number of requests sent, including pages and retries
+	size_t bytes_received = 0; //total size of the bodies of the responses received
+
+private:
+	requestScheduler& scheduler;
+
+	barBatches batches;
+	size_t next_batch = 0; //index of the next batch to request
+
+	dictionary base_parameters;
+	dictionary base_headers;
+
+	time_t timeout;
+
+	std::string host; //can include a port (localhost:8443)
+
+	eventLoop loop;
+
+	std::vector<std::unique_ptr<asyncHttpClient>> data_clients;
+
+	struct pageRequest //a page of a batch that a client has requested or is about to request
+	{
+		size_t batch;
+		dictionary parameters;
+	};
+
+	//set by poll for the tasks it resumes
+	std::function<void(const size_t, const jsonFields&)> page_handler;
+	std::function<void(const size_t)> completion_handler;
+
+	task<void> fetchBatches(const int); //fetch batches on one client until there are none left
+	task<void> waitForScheduler(); //wait until the scheduler allows another request
+};
+
+bool asyncBarClientPool::poll(auto& Page_handler, auto& Completion_handler, const int wait_milliseconds)
+{
+	page_handler = [&](const size_t position, const jsonFields& bar) { Page_handler(position, bar); };
+	completion_handler = [&](const size_t position) { Completion_handler(position); };
+
+	bool running = loop.runOnce(wait_milliseconds);
+
+	page_handler = nullptr;
+	completion_handler = nullptr;
+
+	return running;
+}
+
+typedef asyncBarClientPool barPool;
+
+#else
+
+typedef barClientPool barPool;
+
+#endif
+
+#endif
@@ -0,0 +1,157 @@
+/*
+The network with the weights compiled into the executable.
+
+model_converter writes the packed layers of model_weights.json and the scales of scaler_info.json to a header of constexpr
+arrays (MLModel::saveModelHeader - CMake writes modelConstants.h with it, see MODEL_CONSTANT_WEIGHTS). constantLayers turns
+them into the layers of a simpleNeuralNet - simpleNeuralNet<modelTopology, constantLayers<modelTopology, constant_model_weights>>
+runs the same forward pass as the runtime network but every length, offset, and weight address is a constant so the kernels
+of all seven layers are unrolled and inlined into one function instead of being called through dense_kernels with their lengths.
+
+The AVX-512 kernel does the same operations in the same order as the runtime AVX-512 kernel (the outputs are identical) and
+the portable kernel the same as the portable one. The AVX-512 kernel is used if the CPU supports it. The weights can only be
+changed by building again, so the bot only predicts with them when it is built with USE_CONSTANT_MODEL (MLModel::useConstantModel,
+the BOT_CONSTANT_MODEL option of CMake) - model_benchmark compares the two networks.
+*/
+
+#ifndef CONSTANT_MODEL_UTILS_H
+#define CONSTANT_MODEL_UTILS_H
+
+#include "modelUtils.h"
+
+#ifdef USE_SIMD_KERNELS
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef USE_SIMD_KERNELS
+inline const bool constant_avx512 = []() { __builtin_cpu_init(); return __builtin_cpu_supports("avx512f") != 0; }(); //the kernel of the constant layers
+#else
+inline const bool constant_avx512 = false;
+#endif
+
+//the portable dense kernel with its lengths and weights known at compile time
+template<size_t input_length, size_t output_length, const float* packed, size_t offset>
+inline void constantPortableKernel(const float* input, float* output, const float slope)
+{
+    constexpr size_t stride = paddedLength(output_length);
+
+    const float* weights = packed + offset;
+    const float* biases = weights + input_length * stride;
+
+    for (size_t block = 0; block < output_length; block += 16)
+    {
+        float sums[16];
+
+        for (int i = 0; i < 16; i++) sums[i] = biases[block + i];
+
+        for (size_t input_index = 0; input_index < input_length; input_index++)
+        {
+            const float x = input[input_index];
+
+            for (int i = 0; i < 16; i++) sums[i] += weights[input_index * stride + block + i] * x;
+        }
+
+        for (int i = 0; i < 16; i++) sums[i] = std::max(sums[i], slope * sums[i]);
+
+        std::memcpy(output + block, sums, std::min<size_t>(output_length - block, 16) * sizeof(float));
+    }
+}
+
+#ifdef USE_SIMD_KERNELS
+//the AVX-512 dense kernel with its lengths and weights known at compile time - 16 outputs at a time, the even and odd inputs are summed separately
+template<size_t input_length, size_t output_length, const float* packed, size_t offset>
+__attribute__((target("avx512f"))) inline void constantAvx512Kernel(const float* input, float* output, const float slope)
+{
+    constexpr size_t stride = paddedLength(output_length);
+
+    const float* weights = packed + offset;
+    const float* biases = weights + input_length * stride;
+
+    const __m512 slopes = _mm512_set1_ps(slope);
+
+#pragma GCC unroll 4
+    for (size_t block = 0; block < stride; block += 16)
+    {
+        __m512 even = _mm512_load_ps(biases + block);
+        __m512 odd = _mm512_setzero_ps();
+
+#pragma GCC unroll 32
+        for (size_t input_index = 0; input_index + 1 < input_length; input_index += 2)
+        {
+            even = _mm512_fmadd_ps(_mm512_set1_ps(input[input_index]), _mm512_load_ps(weights + input_index * stride + block), even);
+            odd = _mm512_fmadd_ps(_mm512_set1_ps(input[input_index + 1]), _mm512_load_ps(weights + (input_index + 1) * stride + block), odd);
+        }
+
+        if constexpr (input_length % 2) even = _mm512_fmadd_ps(_mm512_set1_ps(input[input_length - 1]), _mm512_load_ps(weights + (input_length - 1) * stride + block), even);
+
+        __m512 sum = _mm512_add_ps(even, odd);
+
+        sum = _mm512_max_ps(sum, _mm512_mul_ps(sum, slopes));
+
+        const size_t valid = std::min<size_t>(output_length - block, 16);
+
+        _mm512_mask_storeu_ps(output + block, __mmask16(valid == 16 ? 0xFFFF : (1U << valid) - 1), sum);
+    }
+}
+#endif
+
+//a dense layer whose weights and biases are the packed layer at offset floats into packed (the layout of denseLayer::pack)
+template<size_t input_length, size_t output_length, void(*activation_function)(float(&output)[output_length]), const float* packed, size_t offset>
+class constantDenseLayer
+{
+public:
+    alignas(64) float output[output_length] = {};
+
+    inline void operator()(const float(&input)[input_length])
+    {
+        //the leaky relu (or no activation function) is applied by the kernel - any other activation function runs on the outputs afterwards
+        constexpr float slope = fused_activation ? denseLayer<input_length, output_length, activation_function>::slope : 1.0F;
+
+#ifdef USE_SIMD_KERNELS
+        if (constant_avx512) constantAvx512Kernel<input_length, output_length, packed, offset>(input, output, slope);
+        else constantPortableKernel<input_length, output_length, packed, offset>(input, output, slope);
+#else
+        constantPortableKernel<input_length, output_length, packed, offset>(input, output, slope);
+#endif
+
+        if constexpr (!fused_activation) activation_function(output);
+    }
+
+    float weight(const size_t input_index, const size_t output_index) const { return packed[offset + output_index + input_index * paddedLength(output_length)]; }
+    float bias(const size_t output_index) const { return packed[offset + input_length * paddedLength(output_length) + output_index]; }
+
+    static constexpr bool fused_activation = denseLayer<input_length, output_length, activation_function>::fused_activation;
+};
+
+//the layers of a simpleNeuralNet of a topology with the packed layers of a constant array (see MLModel::saveModelHeader)
+template<class net_topology, const float* packed>
+struct constantLayers
+{
+    template<size_t i>
+    static constexpr size_t offset() { return packedLength<net_topology>(std::make_index_sequence<i>()); }
+
+    template<size_t i>
+    using layer = constantDenseLayer<net_topology::template layerInputLength<i>(), net_topology::template layer<i>::output_length,
+        net_topology::template layer<i>::activation_function, packed, offset<i>()>;
+};
+
+#ifdef USE_SIMD_KERNELS
+//the forward pass with every layer and kernel inlined into one AVX-512 function
+template<class network>
+__attribute__((target("avx512f"), flatten)) void avx512ConstantLogits(network& net, float(&input)[network::input_length]) { net.logits(input); }
+#endif
+
+//the logits of a network of constant layers - written to net.outputLayer().output
+template<class network>
+inline void constantLogits(network& net, float(&input)[network::input_length])
+{
+#ifdef USE_SIMD_KERNELS
+    if (constant_avx512) return avx512ConstantLogits(net, input);
+#endif
+
+    net.logits(input);
+}
+
+#endif
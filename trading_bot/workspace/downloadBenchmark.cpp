@@ -0,0 +1,281 @@
+// downloadBenchmark.cpp : Measures how long it takes (wall time and CPU time) to download pages of historical bars
+// with the async http clients - once without compression and once with gzip - from a local stand-in server
+// (stand_in_server.py). Linux only.
+//
+// usage : download_benchmark <port> <certificate> [pages = 400] [clients = 8] [symbols per request = 100] [bars per page = 10000]
+//         download_benchmark pools <port> <certificate> [symbols = 2000] [bars per page = 10000]
+//
+// The pools mode fetches the daily bars of the same symbols with the polling pool (barClientPool) and with the async pool
+// (asyncBarClientPool) of barUtils.h, the way the bot does before it starts trading, and parses every page. The stand-in
+// server gives each symbol --bars-per-symbol bars. The polling clients (httpUtils.h) don't use the shared TLS context, so
+// the certificate also has to be trusted by their SSL context.
+
+
+#include "asyncHttpUtils.h"
+#include "barUtils.h"
+#include "exceptUtils.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <vector>
+
+const int pipelined_requests = 4;
+const int unlimited_requests_per_minute = 1000000; //the stand-in server only rate limits with --rate-limit
+
+struct downloadResult
+{
+    double wall_seconds = 0.0;
+    double cpu_seconds = 0.0; //user and system time of the whole process
+
+    size_t pages = 0;
+    size_t encoded_bytes = 0; //body bytes received
+    size_t decoded_bytes = 0; //body bytes after decompression
+
+    size_t bars = 0; //bars parsed - only counted by the pools
+};
+
+double cpuSeconds()
+{
+    rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+task<void> downloadPages(asyncHttpClient& client, const dictionary& parameters, const dictionary& headers, const size_t pages, downloadResult& result)
+{
+    http::httpResponse response;
+
+    size_t sent = 0;
+
+    while (result.pages < pages || client.unanswered())
+    {
+        //keep the pipeline full
+        while (sent < pages && client.unanswered() < static_cast<size_t>(pipelined_requests))
+        {
+            co_await client.send(parameters, headers, "/v2/stocks/bars");
+
+            sent++;
+        }
+
+        co_await client.receive(response);
+
+        if (response.status_code != 200) throw exceptions::exception("Received an unexpected status code : " + std::to_string(response.status_code));
+
+        result.pages++;
+        result.decoded_bytes += response.message.size();
+    }
+}
+
+downloadResult download(const std::string& port, const size_t pages, const int num_clients, const dictionary& parameters, const bool accept_compression)
+{
+    eventLoop loop;
+    dictionary headers;
+
+    headers["User-Agent"] = "c++20-requests";
+    headers["Connection"] = "keep-alive";
+
+    std::vector<std::unique_ptr<asyncHttpClient>> clients;
+    std::vector<downloadResult> results(num_clients);
+
+    const double cpu_start = cpuSeconds();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < num_clients; i++)
+    {
+        clients.push_back(std::make_unique<asyncHttpClient>(loop, sharedTlsContext(), "localhost", 30, port));
+        clients.back()->accept_compression = accept_compression;
+
+        //split the pages evenly between the clients
+        loop.spawn(downloadPages(*clients.back(), parameters, headers, pages / num_clients + (static_cast<size_t>(i) < pages % num_clients), results[i]));
+    }
+
+    while (loop.runOnce(100)) continue;
+
+    downloadResult total;
+
+    total.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    total.cpu_seconds = cpuSeconds() - cpu_start;
+
+    for (int i = 0; i < num_clients; i++)
+    {
+        total.pages += results[i].pages;
+        total.decoded_bytes += results[i].decoded_bytes;
+        total.encoded_bytes += clients[i]->encoded_bytes;
+    }
+
+    return total;
+}
+
+//fetch the bars of every symbol with one of the bar client pools - the pages are parsed like the bot parses them
+template <typename pool>
+downloadResult fetch(const SSLContextWrapper& ssl_context, const std::string& port, const std::vector<std::string>& tickers, const dictionary& parameters)
+{
+    requestScheduler scheduler(unlimited_requests_per_minute, max_clients);
+    dictionary headers;
+
+    headers["User-Agent"] = "c++20-requests";
+    headers["Connection"] = "keep-alive";
+
+    downloadResult total;
+
+    auto countBar = [&](const size_t, const jsonFields&) { total.bars++; };
+    auto completeSymbol = [](const size_t) {};
+
+    const double cpu_start = cpuSeconds();
+    const auto start = std::chrono::steady_clock::now();
+
+    pool bar_clients(ssl_context, scheduler, parameters, headers, 30, "localhost:" + port);
+
+    bar_clients.start(tickers, {});
+
+    while (bar_clients.poll(countBar, completeSymbol)) continue;
+
+    total.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    total.cpu_seconds = cpuSeconds() - cpu_start;
+
+    total.pages = bar_clients.requests_sent;
+    total.decoded_bytes = bar_clients.bytes_received;
+
+    return total;
+}
+
+void printPoolResult(const std::string& name, const downloadResult& result)
+{
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed;
+    std::cout << std::setw(8) << result.pages << " pages";
+    std::cout << std::setw(11) << result.bars << " bars";
+    std::cout << std::setw(10) << std::setprecision(1) << result.decoded_bytes / 1048576.0 << " MB parsed";
+    std::cout << std::setw(9) << std::setprecision(3) << result.wall_seconds << " s wall";
+    std::cout << std::setw(9) << std::setprecision(3) << result.cpu_seconds << " s cpu" << std::endl;
+}
+
+//the polling pool against the async pool on the same symbols
+int comparePools(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        std::cout << "usage : download_benchmark pools <port> <certificate> [symbols = 2000] [bars per page = 10000]" << std::endl;
+
+        return 1;
+    }
+
+    const std::string port = argv[2];
+    const size_t num_symbols = (argc > 4) ? std::stoul(argv[4]) : 2000;
+
+    dictionary parameters;
+
+    parameters["timeframe"] = "1Day";
+    parameters["limit"] = (argc > 5) ? argv[5] : "10000";
+    parameters["adjustment"] = "all";
+    parameters["feed"] = "sip";
+
+    std::vector<std::string> tickers;
+
+    for (size_t i = 0; i < num_symbols; i++) tickers.push_back("S" + std::to_string(i));
+
+    SSLContextWrapper ssl_context; //destructor must be called after all sockets are closed
+
+    try
+    {
+        sharedTlsContext().trustCertificate(argv[3]);
+
+        //warm up the server's page cache with one batch
+        const std::vector<std::string> first_batch(tickers.begin(), tickers.begin() + std::min<size_t>(tickers.size(), max_symbols_per_request));
+
+        fetch<barClientPool>(ssl_context, port, first_batch, parameters);
+        fetch<asyncBarClientPool>(ssl_context, port, first_batch, parameters);
+
+        printPoolResult("polling", fetch<barClientPool>(ssl_context, port, tickers, parameters));
+        printPoolResult("async", fetch<asyncBarClientPool>(ssl_context, port, tickers, parameters));
+    }
+    catch (const exceptions::exception& exception)
+    {
+        std::cout << "Exception caught : " << exception.what() << std::endl;
+
+        return 1;
+    }
+    catch (const SSLNoReturn&)
+    {
+        std::cout << "Lost the connection to the stand-in server." << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+void printResult(const std::string& name, const downloadResult& result)
+{
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed;
+    std::cout << std::setw(8) << result.pages << " pages";
+    std::cout << std::setw(10) << std::setprecision(1) << result.encoded_bytes / 1048576.0 << " MB received";
+    std::cout << std::setw(10) << std::setprecision(1) << result.decoded_bytes / 1048576.0 << " MB decoded";
+    std::cout << std::setw(9) << std::setprecision(3) << result.wall_seconds << " s wall";
+    std::cout << std::setw(9) << std::setprecision(3) << result.cpu_seconds << " s cpu" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && std::string(argv[1]) == "pools") return comparePools(argc, argv);
+
+    if (argc < 3)
+    {
+        std::cout << "usage : download_benchmark <port> <certificate> [pages = 400] [clients = 8] [symbols per request = 100] [bars per page = 10000]" << std::endl;
+        std::cout << "        download_benchmark pools <port> <certificate> [symbols = 2000] [bars per page = 10000]" << std::endl;
+
+        return 1;
+    }
+
+    const std::string port = argv[1];
+    const size_t pages = (argc > 3) ? std::stoul(argv[3]) : 400;
+    const int num_clients = (argc > 4) ? std::stoi(argv[4]) : 8;
+    const int symbols_per_request = (argc > 5) ? std::stoi(argv[5]) : 100;
+
+    dictionary parameters;
+
+    parameters["timeframe"] = "1Day";
+    parameters["limit"] = (argc > 6) ? argv[6] : "10000";
+    parameters["adjustment"] = "all";
+    parameters["feed"] = "sip";
+
+    //every page requests the same batch of symbols so both passes download exactly the same bytes
+    std::string symbols = "S0";
+
+    for (int i = 1; i < symbols_per_request; i++) symbols += ",S" + std::to_string(i);
+
+    parameters["symbols"] = symbols;
+
+    try
+    {
+        sharedTlsContext().trustCertificate(argv[2]);
+
+        //warm up the server's page cache in both modes
+        download(port, static_cast<size_t>(num_clients), num_clients, parameters, false);
+        download(port, static_cast<size_t>(num_clients), num_clients, parameters, true);
+
+        printResult("identity", download(port, pages, num_clients, parameters, false));
+        printResult("gzip", download(port, pages, num_clients, parameters, true));
+    }
+    catch (const exceptions::exception& exception)
+    {
+        std::cout << "Exception caught : " << exception.what() << std::endl;
+
+        return 1;
+    }
+    catch (const connectionLost&)
+    {
+        std::cout << "Lost the connection to the stand-in server." << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
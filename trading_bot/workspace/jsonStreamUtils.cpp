@@ -0,0 +1,46 @@
+
+#include "jsonStreamUtils.h"
+
+void jsonFields::addKey(const std::string_view key)
+{
+	if (count == pairs.size()) pairs.emplace_back();
+
+	pairs[count].first.assign(key);
+	pairs[count].second.clear(); //values nested in objects or arrays are skipped so they stay empty
+
+	count++;
+}
+
+void jsonStreamLexer::reset()
+{
+	state = lexerState::BETWEEN_TOKENS;
+
+	token.clear();
+	containers.clear();
+
+	expecting_key = false;
+	string_is_key = false;
+	started = false;
+
+	literal_start = nullptr;
+}
+
+void barPageStream::startPage()
+{
+	bars_passed = 0;
+
+	restartPage();
+}
+
+void barPageStream::restartPage()
+{
+	lexer.reset();
+
+	top_key.clear();
+	ticker.clear();
+	next_page_token.clear();
+
+	fields.clear();
+
+	bars_seen = 0;
+}
@@ -0,0 +1,397 @@
+
+/*
+Single-pass json parsing of REST responses that can be fed as the body arrives.
+
+jsonStreamLexer tokenizes json one chunk at a time (a token can be split across chunks) and reports each key, value,
+and opening or closing bracket to a handler along with its depth. Strings are passed without their quotes and, like
+JSONParser, escape sequences are kept as they are.
+
+Three parsers are built on top of it
+	barPageStream parses pages of /v2/stocks/bars - each bar is passed to a handler with its ticker and its fields as ...
+	... soon as the closing bracket of the bar is received, and next_page_token is picked up on the way
+	snapshotStream parses /v2/stocks/snapshots - each part of a snapshot (dailyBar, minuteBar, ...) is passed to a handler ...
+	... with its ticker, its name, and its fields
+	jsonArrayStream parses a json array of flat objects into a container like JSONArrayParser does (used for /v2/assets)
+
+Values nested inside the objects (such as the attributes array of an asset) are skipped.
+*/
+
+#ifndef JSON_STREAM_UTILS_H
+#define JSON_STREAM_UTILS_H
+
+#include "exceptUtils.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+class jsonFields //the key : value pairs of a flat json object - the strings are reused from object to object
+{
+public:
+	size_t size() const { return count; }
+
+	const std::string& key(const size_t i) const { return pairs[i].first; }
+	const std::string& value(const size_t i) const { return pairs[i].second; }
+
+	void clear() { count = 0; }
+
+	void addKey(const std::string_view); //add a field without a value
+	void setValue(const std::string_view value) { pairs[count - 1].second.assign(value); } //set the value of the last field
+
+private:
+	std::vector<std::pair<std::string, std::string>> pairs;
+	size_t count = 0;
+};
+
+//pass each field of an object to an update function like the ones used by JSONArrayParser
+template <typename T, void(*update)(T&, const std::string&, const std::string&)>
+void applyFields(const jsonFields& fields, T& info)
+{
+	for (size_t i = 0; i < fields.size(); i++) update(info, fields.key(i), fields.value(i));
+}
+
+class jsonStreamLexer
+{
+public:
+	void reset(); //start a new json document
+
+	//tokenize the next bytes of the document - the handler needs the following methods (depth is the number of open brackets)
+	//	onOpen(depth, bracket) after a bracket was opened, onClose(depth, bracket) before it is closed
+	//	onKey(depth, key) and onValue(depth, value, is_string) for the keys and values of the innermost object or array ...
+	//	... as string views that are only valid during the call
+	void feed(const char*, const size_t, auto&);
+
+	bool complete() const { return started && !containers.size() && state == lexerState::BETWEEN_TOKENS; } //true once the document was closed
+
+private:
+	enum class lexerState { BETWEEN_TOKENS, STRING, ESCAPE, LITERAL };
+
+	lexerState state = lexerState::BETWEEN_TOKENS;
+
+	std::string token; //the string or literal being read - kept across chunks
+	std::vector<char> containers; //the brackets that are open
+
+	bool expecting_key = false; //true if the next string in the innermost object is a key
+	bool string_is_key = false;
+	bool started = false; //true once the first bracket was opened
+
+	const char* literal_start = nullptr; //first character of the literal being read if it is in the current chunk
+};
+
+void jsonStreamLexer::feed(const char* data, const size_t size, auto& handler)
+{
+	const char* c = data;
+	const char* end = data + size;
+
+	while (c < end)
+	{
+		switch (state)
+		{
+			case lexerState::STRING:
+			{
+				//scan up to the closing quote or the next escape sequence at once
+				const char* start = c;
+
+				while (c < end && *c != '"' && *c != '\\') c++;
+
+				if (c == end || *c == '\\' || token.size()) token.append(start, c - start); //only strings split across chunks or escape sequences are copied
+
+				if (c == end) break;
+
+				if (*c == '\\')
+				{
+					token += '\\';
+					state = lexerState::ESCAPE;
+				}
+				else
+				{
+					state = lexerState::BETWEEN_TOKENS;
+
+					std::string_view text = token.size() ? std::string_view(token) : std::string_view(start, c - start);
+
+					if (string_is_key) handler.onKey(static_cast<int>(containers.size()), text);
+					else handler.onValue(static_cast<int>(containers.size()), text, true);
+
+					token.clear();
+				}
+
+				c++;
+
+				break;
+			}
+			case lexerState::ESCAPE:
+			{
+				token += *(c++);
+				state = lexerState::STRING;
+
+				break;
+			}
+			case lexerState::LITERAL:
+			{
+				//numbers, true, false, and null - the literal started one character before the scan if it isn't split across chunks
+				const char* start = c;
+
+				while (c < end && *c != ',' && *c != '}' && *c != ']' && *c != ' ' && *c != '\n' && *c != '\r' && *c != '\t') c++;
+
+				if (c == end || !literal_start) token.append(literal_start ? literal_start : start, c - (literal_start ? literal_start : start));
+
+				if (c == end) { literal_start = nullptr; break; }
+
+				state = lexerState::BETWEEN_TOKENS;
+
+				handler.onValue(static_cast<int>(containers.size()), literal_start ? std::string_view(literal_start, c - literal_start) : std::string_view(token), false);
+
+				token.clear();
+
+				break; //the character that ended the literal is handled next
+			}
+			case lexerState::BETWEEN_TOKENS:
+			{
+				switch (*c)
+				{
+					case ' ': case '\n': case '\r': case '\t': break;
+					case '{':
+					case '[':
+					{
+						containers.push_back(*c);
+
+						expecting_key = (*c == '{');
+						started = true;
+
+						handler.onOpen(static_cast<int>(containers.size()), *c);
+
+						break;
+					}
+					case '}':
+					case ']':
+					{
+						if (!containers.size() || containers.back() != (*c == '}' ? '{' : '[')) throw exceptions::exception("Received malformed json.");
+
+						handler.onClose(static_cast<int>(containers.size()), *c);
+
+						containers.pop_back();
+
+						expecting_key = false;
+
+						break;
+					}
+					case ',':
+					{
+						expecting_key = (containers.size() && containers.back() == '{');
+
+						break;
+					}
+					case ':':
+					{
+						expecting_key = false;
+
+						break;
+					}
+					case '"':
+					{
+						string_is_key = expecting_key;
+						state = lexerState::STRING;
+
+						break;
+					}
+					default:
+					{
+						literal_start = c;
+						state = lexerState::LITERAL;
+
+						break;
+					}
+				}
+
+				c++;
+
+				break;
+			}
+		}
+	}
+}
+
+class barPageStream
+{
+public:
+	void startPage(); //start parsing a new page
+	void restartPage(); //start the same page again after the connection was lost - the bars that were already passed on are skipped
+
+	//parse the next bytes of the page - bar_handler(ticker, fields) is called for each bar that was not passed on yet
+	void feed(const char*, const size_t, auto&);
+
+	bool complete() const { return lexer.complete(); }
+
+	const std::string& nextPageToken() const { return next_page_token; } //empty if this is the last page
+
+private:
+	jsonStreamLexer lexer;
+
+	std::string top_key; //the current key of the outermost object
+	std::string ticker; //the ticker of the bars being parsed
+	std::string next_page_token;
+
+	jsonFields fields; //the fields of the bar being parsed
+
+	size_t bars_seen = 0; //bars parsed during this attempt at the page
+	size_t bars_passed = 0; //bars passed to the handler over every attempt at the page
+
+	template <typename handlerType>
+	struct events
+	{
+		barPageStream& stream;
+		handlerType& bar_handler;
+
+		void onOpen(const int, const char);
+		void onClose(const int, const char);
+		void onKey(const int, const std::string_view);
+		void onValue(const int, const std::string_view, const bool);
+	};
+};
+
+//{"bars":{"AAPL":[{"c":...,"t":...},...],...},"next_page_token":...} - the bars of a ticker are objects at depth 4
+
+template <typename handlerType>
+void barPageStream::events<handlerType>::onOpen(const int depth, const char bracket)
+{
+	if (depth == 4 && bracket == '{') stream.fields.clear();
+}
+
+template <typename handlerType>
+void barPageStream::events<handlerType>::onClose(const int depth, const char bracket)
+{
+	if (depth != 4 || bracket != '}' || stream.top_key != "bars") return;
+
+	if (++stream.bars_seen <= stream.bars_passed) return; //already passed on before the connection was lost
+
+	stream.bars_passed++;
+
+	bar_handler(stream.ticker, stream.fields);
+}
+
+template <typename handlerType>
+void barPageStream::events<handlerType>::onKey(const int depth, const std::string_view key)
+{
+	if (depth == 1) stream.top_key.assign(key);
+	else if (depth == 2) stream.ticker.assign(key);
+	else if (depth == 4) stream.fields.addKey(key);
+}
+
+template <typename handlerType>
+void barPageStream::events<handlerType>::onValue(const int depth, const std::string_view value, const bool is_string)
+{
+	if (depth == 4 && stream.fields.size()) stream.fields.setValue(value);
+	else if (depth == 1 && stream.top_key == "next_page_token") stream.next_page_token.assign(is_string ? value : std::string_view());
+}
+
+void barPageStream::feed(const char* data, const size_t size, auto& bar_handler)
+{
+	events<std::remove_reference_t<decltype(bar_handler)>> handler{ *this, bar_handler };
+
+	lexer.feed(data, size, handler);
+}
+
+class snapshotStream
+{
+public:
+	void reset() { lexer.reset(); } //start a new response
+
+	//parse the next bytes of the response - part_handler(ticker, part, fields) is called for each part of each snapshot
+	void feed(const char*, const size_t, auto&);
+
+	bool complete() const { return lexer.complete(); }
+
+private:
+	jsonStreamLexer lexer;
+
+	std::string ticker; //the ticker of the snapshot being parsed
+	std::string part; //the name of the part being parsed
+
+	jsonFields fields; //the fields of the part being parsed
+
+	template <typename handlerType>
+	struct events
+	{
+		snapshotStream& stream;
+		handlerType& part_handler;
+
+		void onOpen(const int depth, const char bracket) { if (depth == 3 && bracket == '{') stream.fields.clear(); }
+		void onClose(const int depth, const char bracket) { if (depth == 3 && bracket == '}') part_handler(stream.ticker, stream.part, stream.fields); }
+		void onKey(const int, const std::string_view);
+		void onValue(const int depth, const std::string_view value, const bool) { if (depth == 3 && stream.fields.size()) stream.fields.setValue(value); }
+	};
+};
+
+//{"AAPL":{"dailyBar":{"c":...,"v":...},"minuteBar":{...},...},...} - the fields of each part are at depth 3
+
+template <typename handlerType>
+void snapshotStream::events<handlerType>::onKey(const int depth, const std::string_view key)
+{
+	if (depth == 1) stream.ticker.assign(key);
+	else if (depth == 2) stream.part.assign(key);
+	else if (depth == 3) stream.fields.addKey(key);
+}
+
+void snapshotStream::feed(const char* data, const size_t size, auto& part_handler)
+{
+	events<std::remove_reference_t<decltype(part_handler)>> handler{ *this, part_handler };
+
+	lexer.feed(data, size, handler);
+}
+
+template <typename T, typename C, void(*update)(T&, const std::string&, const std::string&), void(*append)(const T&, C&)>
+class jsonArrayStream //[{...},{...},...] - a drop in replacement for JSONArrayParser that only parses the text once
+{
+public:
+	void parseJSONArray(const std::string&, C&); //parse a whole array
+
+	void reset(); //start a new array
+	void feed(const char*, const size_t, C&); //parse the next bytes of the array
+
+	T& get_info() { return info; } //the last object that was parsed
+
+private:
+	jsonStreamLexer lexer;
+
+	T info;
+	std::string key;
+	std::string value;
+
+	struct events
+	{
+		jsonArrayStream& stream;
+		C& container;
+
+		void onOpen(const int depth, const char bracket) { if (depth == 2 && bracket == '{') stream.info = T(); }
+		void onClose(const int depth, const char bracket) { if (depth == 2 && bracket == '}') append(stream.info, container); }
+		void onKey(const int depth, const std::string_view key) { if (depth == 2) stream.key.assign(key); }
+		void onValue(const int depth, const std::string_view value, const bool) { if (depth == 2) { stream.value.assign(value); update(stream.info, stream.key, stream.value); } }
+	};
+};
+
+template <typename T, typename C, void(*update)(T&, const std::string&, const std::string&), void(*append)(const T&, C&)>
+void jsonArrayStream<T, C, update, append>::reset()
+{
+	lexer.reset();
+}
+
+template <typename T, typename C, void(*update)(T&, const std::string&, const std::string&), void(*append)(const T&, C&)>
+void jsonArrayStream<T, C, update, append>::feed(const char* data, const size_t size, C& container)
+{
+	events handler{ *this, container };
+
+	lexer.feed(data, size, handler);
+}
+
+template <typename T, typename C, void(*update)(T&, const std::string&, const std::string&), void(*append)(const T&, C&)>
+void jsonArrayStream<T, C, update, append>::parseJSONArray(const std::string& json, C& container)
+{
+	reset();
+	feed(json.data(), json.size(), container);
+
+	if (!lexer.complete()) throw exceptions::exception("Received an incomplete json array.");
+}
+
+#endif
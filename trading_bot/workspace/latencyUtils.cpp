@@ -0,0 +1,153 @@
+#include "latencyUtils.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <cmath>
+
+//days since 1970-01-01 of a date of the proleptic Gregorian calendar
+int64_t daysFromCivil(int64_t year, const int64_t month, const int64_t day)
+{
+	year -= month <= 2;
+
+	const int64_t era = (year >= 0 ? year : year - 399) / 400;
+	const int64_t year_of_era = year - era * 400;
+	const int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	const int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+	return era * 146097 + day_of_era - 719468;
+}
+
+int64_t parseTimestamp(const std::string& text, const size_t position)
+{
+	if (position + 20 > text.size()) return 0;
+
+	const char* c = text.data() + position;
+
+	auto digits = [&](const int start, const int count)
+	{
+		int64_t value = 0;
+
+		for (int i = start; i < start + count; i++)
+		{
+			if (c[i] < '0' || c[i] > '9') return int64_t(-1);
+
+			value = value * 10 + (c[i] - '0');
+		}
+
+		return value;
+	};
+
+	const int64_t year = digits(0, 4), month = digits(5, 2), day = digits(8, 2);
+	const int64_t hours = digits(11, 2), minutes = digits(14, 2), seconds = digits(17, 2);
+
+	if (year < 0 || month < 1 || day < 1 || hours < 0 || minutes < 0 || seconds < 0) return 0;
+
+	int64_t nanoseconds = 0;
+	size_t i = position + 19;
+
+	//up to nine decimal places
+	if (text[i] == '.')
+	{
+		int64_t scale = 100000000;
+
+		for (i++; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++, scale /= 10) nanoseconds += (text[i] - '0') * scale;
+	}
+
+	return ((daysFromCivil(year, month, day) * 24 + hours) * 60 * 60 + minutes * 60 + seconds) * 1000000000 + nanoseconds;
+}
+
+int64_t lastSipTimestamp(const std::string& message)
+{
+	//trades and quotes look like {"T":"t","S":"AAPL",...,"t":"2024-01-02T14:30:00.123456789Z",...} and the newest one is usually the last
+	const size_t timestamp = message.rfind("\"t\":\"");
+
+	if (timestamp == std::string::npos) return 0;
+
+	const size_t type = message.rfind("\"T\":\"", timestamp);
+
+	if (type == std::string::npos || message.find('{', type) < timestamp) return 0; //the type has to be in the same object
+	if (message[type + 5] != 't' && message[type + 5] != 'q') return 0;
+
+	return parseTimestamp(message, timestamp + 5);
+}
+
+void delayHistogram::add(const double microseconds)
+{
+	const double delay = microseconds > 0.0 ? microseconds : 0.0;
+
+	int bucket = delay < 1.0 ? 0 : std::ilogb(delay) + 1;
+
+	if (bucket >= bucket_count) bucket = bucket_count - 1;
+
+	buckets[bucket]++;
+	samples++;
+
+	sum += delay;
+
+	if (delay > largest) largest = delay;
+}
+
+void delayHistogram::clear()
+{
+	*this = delayHistogram();
+}
+
+double delayHistogram::percentile(const double fraction) const
+{
+	if (!samples) return 0.0;
+
+	const double rank = fraction * samples;
+
+	size_t counted = 0;
+
+	for (int i = 0; i < bucket_count; i++)
+	{
+		counted += buckets[i];
+
+		if (counted >= rank && counted) return std::min(std::ldexp(1.0, i), largest);
+	}
+
+	return largest;
+}
+
+std::string delayHistogram::summary() const
+{
+	std::ostringstream text;
+
+	text << samples << " MESSAGES - MEAN " << mean() << " US - P50 < " << percentile(0.5) << " US - P99 < " << percentile(0.99) << " US - MAX " << max() << " US";
+
+	return text.str();
+}
+
+void streamDelays::record(const frameTiming& timing, const std::string& message)
+{
+	if (!timing.kernel)
+	{
+		untimed++;
+
+		return;
+	}
+
+	kernel_to_bot.add((timing.returned - timing.kernel) / 1000.0);
+
+	const int64_t sip = lastSipTimestamp(message);
+
+	if (sip) sip_to_kernel.add((timing.kernel - sip) / 1000.0);
+}
+
+void streamDelays::clear()
+{
+	kernel_to_bot.clear();
+	sip_to_kernel.clear();
+
+	untimed = 0;
+}
+
+void streamDelays::print(const std::string& name) const
+{
+	std::cout << name << " KERNEL TO BOT : " << kernel_to_bot.summary() << std::endl;
+
+	if (sip_to_kernel.count()) std::cout << name << " SIP TO KERNEL : " << sip_to_kernel.summary() << std::endl;
+	if (untimed) std::cout << name << " : " << untimed << " MESSAGES WITHOUT A KERNEL TIMESTAMP" << std::endl;
+}
@@ -0,0 +1,70 @@
+
+/*
+Delays of the websocket messages measured with the kernel's receive timestamps (see USE_RX_TIMESTAMPS in asyncWsUtils.h).
+
+For every message
+	kernel to bot - from the kernel receiving the newest bytes read when the message was completed to recv() returning ...
+	... it : the time spent in the socket buffer, in the TLS and websocket buffers, and waiting for the bot's loop
+	sip to kernel - from the SIP timestamp of the last trade or quote of a data message to the kernel receiving the ...
+	... message : the time spent in Alpaca's feed and on the network (bar messages don't count - their timestamp is ...
+	... the start of the bar)
+
+Several messages that arrive in one read share its timestamp so the kernel to bot delay is a lower bound for all but
+the last of them. The sip to kernel delay includes the offset between the local clock and the SIP's clock.
+
+delayHistogram counts the delays in power of two buckets of microseconds so recording a delay never allocates.
+*/
+
+#ifndef LATENCY_UTILS_H
+#define LATENCY_UTILS_H
+
+#include <cstdint>
+#include <string>
+
+struct frameTiming //when the message last returned by a websocket was received - nanoseconds since the epoch
+{
+	int64_t kernel = 0; //0 if unknown
+	int64_t returned = 0;
+};
+
+int64_t parseTimestamp(const std::string&, const size_t); //nanoseconds since the epoch of an RFC 3339 UTC timestamp (2024-01-02T14:30:00.123456789Z) at a position - 0 if it is invalid
+int64_t lastSipTimestamp(const std::string&); //SIP timestamp of the last object of a data message if it is a trade or a quote - 0 otherwise
+
+class delayHistogram
+{
+public:
+	void add(const double); //delay in microseconds - negative delays (clock offsets) are counted as 0
+	void clear();
+
+	size_t count() const { return samples; }
+	double mean() const { return samples ? sum / samples : 0.0; }
+	double max() const { return largest; }
+	double percentile(const double) const; //upper bound of the bucket that holds the percentile (0 to 1) in microseconds
+
+	std::string summary() const; //count, mean, p50, p99, and max
+
+private:
+	static const int bucket_count = 40; //the last bucket holds everything above 2^38 microseconds (~3 days)
+
+	size_t buckets[bucket_count] = {}; //bucket i counts the delays below 2^i microseconds that are not in bucket i - 1
+	size_t samples = 0;
+
+	double sum = 0.0;
+	double largest = 0.0;
+};
+
+class streamDelays //the delays of the messages of one websocket
+{
+public:
+	void record(const frameTiming&, const std::string&); //timing and message of the last message received
+	void clear();
+
+	void print(const std::string&) const; //name of the websocket
+
+	delayHistogram kernel_to_bot;
+	delayHistogram sip_to_kernel;
+
+	size_t untimed = 0; //messages without a kernel timestamp (received before the timestamps were enabled, or the kernel refused)
+};
+
+#endif
@@ -0,0 +1,81 @@
+
+#include "mmapUtils.h"
+
+mappedFile::mappedFile() {}
+mappedFile::~mappedFile() { close(); }
+
+#ifdef _WIN32
+
+bool mappedFile::open(const std::string& file_path)
+{
+	close();
+
+	file_handle = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file_handle == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER large_size;
+
+	if (!GetFileSizeEx(file_handle, &large_size) || large_size.QuadPart == 0) { close(); return false; }
+
+	mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mapping_handle == nullptr) { close(); return false; }
+
+	file_data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+
+	if (file_data == nullptr) { close(); return false; }
+
+	file_size = static_cast<size_t>(large_size.QuadPart);
+
+	return true;
+}
+
+void mappedFile::close()
+{
+	if (file_data != nullptr) UnmapViewOfFile(file_data);
+	if (mapping_handle != nullptr) CloseHandle(mapping_handle);
+	if (file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+
+	file_data = nullptr;
+	file_size = 0;
+
+	mapping_handle = nullptr;
+	file_handle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool mappedFile::open(const std::string& file_path)
+{
+	close();
+
+	file_descriptor = ::open(file_path.c_str(), O_RDONLY);
+
+	if (file_descriptor < 0) return false;
+
+	struct stat file_info;
+
+	if (fstat(file_descriptor, &file_info) != 0 || file_info.st_size == 0) { close(); return false; }
+
+	void* mapping = mmap(nullptr, static_cast<size_t>(file_info.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+
+	if (mapping == MAP_FAILED) { close(); return false; }
+
+	file_data = static_cast<const char*>(mapping);
+	file_size = static_cast<size_t>(file_info.st_size);
+
+	return true;
+}
+
+void mappedFile::close()
+{
+	if (file_data != nullptr) munmap(const_cast<char*>(file_data), file_size);
+	if (file_descriptor >= 0) ::close(file_descriptor);
+
+	file_data = nullptr;
+	file_size = 0;
+	file_descriptor = -1;
+}
+
+#endif
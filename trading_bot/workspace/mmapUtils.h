@@ -0,0 +1,55 @@
+
+/*
+A read-only memory mapped file.
+
+Used for the binary files the bot writes ahead of time (such as the daily feature snapshot) so that they
+can be read at startup without copying or parsing them.
+*/
+
+#ifndef MMAP_UTILS_H
+#define MMAP_UTILS_H
+
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+#else
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif
+
+class mappedFile
+{
+public:
+	mappedFile();
+	~mappedFile();
+
+	mappedFile(const mappedFile&) = delete;
+	mappedFile& operator=(const mappedFile&) = delete;
+
+	bool open(const std::string&); //returns false if the file does not exist or cannot be mapped
+	void close();
+
+	const char* data() const { return file_data; }
+	size_t size() const { return file_size; }
+
+private:
+	const char* file_data = nullptr;
+	size_t file_size = 0;
+
+#ifdef _WIN32
+	HANDLE file_handle = INVALID_HANDLE_VALUE;
+	HANDLE mapping_handle = nullptr;
+#else
+	int file_descriptor = -1;
+#endif
+};
+
+#endif
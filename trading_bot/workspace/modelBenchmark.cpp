@@ -0,0 +1,871 @@
+// modelBenchmark.cpp : Measures the latency of the neural network of the model and checks that the optimized dense layer
+// kernels give the same outputs as the network did before its weights were packed. It also bounds the error of the
+// normalization kernels (polynomial logarithm) and of the probability from the logits against std::log and the softmax.
+// With the calibration data written by retrain_model.py, it checks every kernel against the golden vectors of the keras
+// model (its probabilities on training inputs), then quantizes the network and compares it to the float network on the held
+// out transitions (accuracy report) and in latency. It exits with 1 if any check fails.
+//
+// usage : model_benchmark <model weights> <model scales> [predictions = 1000000] [calibration data]
+//
+// With 0 predictions it only checks the golden vectors of the calibration data and exits with 1 if there are none or if a
+// probability is above its tolerance (the model_golden_vectors test of CMake).
+//
+// The inputs are drawn from the training distribution of every feature (standard normal after the log transform and the
+// scaling, clipped to 3 standard deviations like the inlier ranges of the bot). Every kernel the CPU supports is measured,
+// on its own and in batches of 1 to max_batch_size predictions (MLModel::predict with several sets of features). The
+// normalization is also checked on a sweep of every feature over its inlier range (the training range of the model). Single
+// predictions are also timed one at a time with every cache evicted before each one (the first trade after a quiet period).
+//
+// Built with USE_CONSTANT_MODEL (the model_constants target of CMake), it also checks the network with the weights compiled
+// in (modelConstants.h, see constantModelUtils.h) against the network loaded at runtime and compares their latencies.
+
+
+#include "modelUtils.h"
+#include "exceptUtils.h"
+
+#ifdef USE_CONSTANT_MODEL
+#include "constantModelUtils.h"
+#include "modelConstants.h" //written by model_converter from the model files of the build (MODEL_CONSTANT_WEIGHTS)
+
+static_assert(constant_model_packed_length == simpleNeuralNet<modelTopology>::packed_length, "modelConstants.h was written for another topology");
+
+typedef simpleNeuralNet<modelTopology, constantLayers<modelTopology, constant_model_weights>> constantNeuralNet;
+#endif
+
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <cmath>
+#include <cfloat>
+
+const size_t input_sets = 4096; //the benchmark cycles through this many inputs (256 kB) so the inputs are not always in the first level cache
+
+//largest difference allowed between the outputs (probabilities) of the kernels and of the reference network - the kernels sum in another order ...
+//... (and the SIMD kernels with fused multiply-adds) so the outputs differ by the rounding errors of seven layers
+const float output_tolerance = 32.0F * FLT_EPSILON;
+
+//largest difference allowed between the inputs of the network normalized by the kernels and by std::log in double precision - the logarithms ...
+//... of the largest features (~20) are only known to ~2 microunits in float, which the scaling can enlarge
+const float input_tolerance = 1e-5F;
+
+//largest difference allowed between the probabilities of MLModel::predict and of the softmax of the network fed with the inputs of std::log
+const float probability_tolerance = 1e-5F;
+
+const size_t sweep_steps = 100001; //values of each feature in the sweep of the inlier ranges
+
+//largest difference allowed between each probability of the network and of the keras model on the golden vectors - tensorflow sums in another order
+const float golden_network_tolerance = 1e-5F;
+
+//largest difference allowed between each probability of MLModel::predict on the features of the golden vectors and of the keras model - the ...
+//... normalization kernels add their error (input_tolerance) to the inputs, which the network can enlarge
+const float golden_prediction_tolerance = 1e-4F;
+
+const size_t cold_predictions = 256; //single predictions timed one at a time with and without evicting the caches
+const size_t eviction_bytes = 64 << 20; //written before each cold prediction - larger than the last level cache
+
+//the dense layer as it was before its weights were packed - the weights are read with the stride of the output length
+template<size_t input_length, size_t output_length, void(*activation_function)(float(&output)[output_length])>
+class referenceLayer
+{
+public:
+    float output[output_length] = {};
+
+    inline void operator()(float(&input)[input_length])
+    {
+        float sum;
+
+        int input_index;
+
+        for (int output_index = 0; output_index < output_length; output_index++)
+        {
+            sum = biases[output_index];
+
+            for (input_index = 0; input_index < input_length - input_length % 8; input_index += 8)
+            {
+                sum += weights[output_index + input_index * output_length] * input[input_index] \
+                    + weights[output_index + (input_index + 1) * output_length] * input[input_index + 1] \
+                    + weights[output_index + (input_index + 2) * output_length] * input[input_index + 2] \
+                    + weights[output_index + (input_index + 3) * output_length] * input[input_index + 3] \
+                    + weights[output_index + (input_index + 4) * output_length] * input[input_index + 4] \
+                    + weights[output_index + (input_index + 5) * output_length] * input[input_index + 5] \
+                    + weights[output_index + (input_index + 6) * output_length] * input[input_index + 6] \
+                    + weights[output_index + (input_index + 7) * output_length] * input[input_index + 7];
+            }
+
+            for (; input_index < input_length; input_index++)
+            {
+                sum += weights[output_index + input_index * output_length] * input[input_index];
+            }
+
+            output[output_index] = sum;
+        }
+
+        activation_function(output);
+    }
+
+    void setWeights(const weightArray& weight_array, const weightArray& bias_array)
+    {
+        for (int i = 0; i < input_length * output_length; i++) { weights[i] = weight_array[i]; }
+        for (int i = 0; i < output_length; i++) { biases[i] = bias_array[i]; }
+    }
+
+private:
+    float weights[input_length * output_length];
+    float biases[output_length];
+};
+
+//the network with the layers as they were before their weights were packed - the forward pass is written out from the topology without the fold of simpleNeuralNet
+template<class net_topology>
+class referenceNeuralNet
+{
+public:
+    static constexpr size_t input_length = net_topology::input_length;
+    static constexpr size_t output_length = net_topology::output_length;
+    static constexpr size_t layer_count = net_topology::layer_count;
+
+    template<size_t i>
+    using layerType = referenceLayer<net_topology::template layerInputLength<i>(), net_topology::template layer<i>::output_length, net_topology::template layer<i>::activation_function>;
+
+    float output[output_length] = {};
+
+    inline void operator()(float(&input)[input_length])
+    {
+        run<0>(input);
+
+        const auto& logits = std::get<layer_count - 1>(layers).output;
+
+        for (size_t i = 0; i < output_length; i++) output[i] = logits[i];
+
+        softmax(output);
+    }
+
+    void setWeights(const weightContainer& weights) { setWeights(weights, std::make_index_sequence<layer_count>()); }
+
+private:
+    template<size_t... i>
+    static std::tuple<layerType<i>...> layerTuple(std::index_sequence<i...>);
+
+    decltype(layerTuple(std::make_index_sequence<layer_count>())) layers;
+
+    template<size_t i, size_t length>
+    inline void run(float(&input)[length])
+    {
+        auto& layer = std::get<i>(layers);
+
+        layer(input);
+
+        if constexpr (net_topology::template layer<i>::skip_layer != no_skip)
+        {
+            const auto& skipped = std::get<net_topology::template layer<i>::skip_layer>(layers).output;
+
+            for (size_t k = 0; k < net_topology::template layer<i>::output_length; k++) layer.output[k] += skipped[k];
+        }
+
+        if constexpr (i + 1 < layer_count) run<i + 1>(layer.output);
+    }
+
+    template<size_t... i>
+    void setWeights(const weightContainer& weights, std::index_sequence<i...>) { (std::get<i>(layers).setWeights(weights[i][0], weights[i][1]), ...); }
+};
+
+typedef float inputSet[MLModel::input_length];
+
+//the normalization as it was before the kernels - std::log in double precision and a division by the std
+void referenceNormalize(const MLModel& model, const inputSet& features, inputSet& inputs)
+{
+    for (size_t i = 0; i < MLModel::input_length; i++)
+    {
+        if (i == 0 || i == 2) inputs[i] = (features[i] - model.means[i]) / model.stds[i]; //time of day and n
+        else inputs[i] = (std::log(1e-9 + features[i]) - model.means[i]) / model.stds[i];
+    }
+}
+
+//the probability of a +1 transition as it was before the output stage - the softmax of all the logits
+float referencePredict(MLModel& model, const inputSet& features)
+{
+    referenceNormalize(model, features, model.input);
+
+    model.neural_net(model.input);
+
+    return model.neural_net.output[2];
+}
+
+//the class with the largest probability - -1, 0, or +1
+int predictedTransition(const float(&probabilities)[MLModel::output_length])
+{
+    return static_cast<int>(std::max_element(probabilities, probabilities + MLModel::output_length) - probabilities) - 1;
+}
+
+//the quantized network against the float network on the held out transitions of the calibration data
+void reportQuantization(MLModel& model, const calibrationSet& calibration)
+{
+    const size_t rows = calibration.holdout_inputs.size();
+
+    if (!rows)
+    {
+        std::cout << "THE CALIBRATION DATA HAS NO HELD OUT TRANSITIONS" << std::endl;
+
+        return;
+    }
+
+    float input[MLModel::input_length];
+    float float_probabilities[MLModel::output_length], quantized_probabilities[MLModel::output_length];
+
+    double largest_difference = 0.0, difference_sum = 0.0, float_log_loss = 0.0, quantized_log_loss = 0.0;
+    size_t agreements = 0, float_hits = 0, quantized_hits = 0, large_differences = 0;
+
+    for (size_t row = 0; row < rows; row++)
+    {
+        std::copy(calibration.holdout_inputs[row].begin(), calibration.holdout_inputs[row].end(), input);
+
+        model.neural_net.logits(input);
+        model.quantized_net.logits(input);
+
+        std::copy(std::begin(model.neural_net.outputLayer().output), std::end(model.neural_net.outputLayer().output), float_probabilities);
+        std::copy(std::begin(model.quantized_net.outputLayer().output), std::end(model.quantized_net.outputLayer().output), quantized_probabilities);
+
+        softmax(float_probabilities);
+        softmax(quantized_probabilities);
+
+        const double difference = std::fabs(float_probabilities[2] - quantized_probabilities[2]); //only the probability of a +1 transition is used by the bot
+
+        largest_difference = std::max(largest_difference, difference);
+        difference_sum += difference;
+
+        if (difference > 0.01) large_differences++;
+
+        const int transition = calibration.holdout_transitions[row];
+
+        agreements += predictedTransition(float_probabilities) == predictedTransition(quantized_probabilities);
+        float_hits += predictedTransition(float_probabilities) == transition;
+        quantized_hits += predictedTransition(quantized_probabilities) == transition;
+
+        float_log_loss -= std::log(1e-7 + float_probabilities[transition + 1]);
+        quantized_log_loss -= std::log(1e-7 + quantized_probabilities[transition + 1]);
+    }
+
+    std::cout << "HELD OUT TRANSITIONS : " << rows << std::endl;
+    std::cout << "    +1 PROBABILITY DIFFERENCE : MEAN " << difference_sum / rows << " - MAX " << largest_difference;
+    std::cout << " - " << 100.0 * large_differences / rows << "% ABOVE 0.01" << std::endl;
+    std::cout << "    SAME PREDICTED TRANSITION : " << 100.0 * agreements / rows << "%" << std::endl;
+    std::cout << "    ACCURACY : FLOAT " << 100.0 * float_hits / rows << "% - QUANTIZED " << 100.0 * quantized_hits / rows << "%" << std::endl;
+    std::cout << "    LOG LOSS : FLOAT " << float_log_loss / rows << " - QUANTIZED " << quantized_log_loss / rows << std::endl;
+}
+
+//mean time of one call in nanoseconds - every result is added to the checksum so no call can be skipped
+template<typename function>
+double timeCalls(function call, const size_t calls, double& checksum)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < calls; i++) checksum += call(i);
+
+    auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(stop - start).count() / calls;
+}
+
+//mean time of one call in nanoseconds - every output is added to the checksum so no call can be skipped
+template<typename network>
+double timeNetwork(network& net, std::vector<inputSet>& inputs, const size_t calls, double& checksum)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < calls; i++)
+    {
+        net(inputs[i % inputs.size()]);
+
+        checksum += net.output[2];
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(stop - start).count() / calls;
+}
+
+//the features that normalize to these inputs - the inverse of the log transform and the scaling of MLModel::predict
+void rawFeatures(const MLModel& model, const inputSet& inputs, inputSet& features)
+{
+    for (size_t i = 0; i < MLModel::input_length; i++)
+    {
+        const float scaled = inputs[i] * model.stds[i] + model.means[i];
+
+        features[i] = (i == 0 || i == 2) ? scaled : std::exp(scaled) - 1e-9F; //time of day and n are not log transformed
+    }
+}
+
+//mean time of one batch of predictions in nanoseconds - the batches go through the sets of features in order
+double timeBatches(MLModel& model, std::vector<inputSet>& features, const size_t batch_size, const size_t batches, double& checksum)
+{
+    float probabilities[max_batch_size];
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < batches; i++)
+    {
+        model.predict(&features[(i * batch_size) % (features.size() - batch_size + 1)], probabilities, batch_size);
+
+        checksum += probabilities[batch_size - 1];
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(stop - start).count() / batches;
+}
+
+//the daily inputs of every set of features with the current kernels
+void precomputeDailyInputs(const MLModel& model, const std::vector<inputSet>& features, std::vector<dailyInputs>& daily)
+{
+    daily.resize(features.size());
+
+    for (size_t i = 0; i < features.size(); i++)
+    {
+        const inputSet& f = features[i];
+
+        model.precompute(daily[i], f[3], f[5], f[8], f[9], f[12], f[14], f[15]);
+    }
+}
+
+//timeBatches with the daily inputs of every set of features
+double timeDailyBatches(MLModel& model, std::vector<inputSet>& features, const std::vector<dailyInputs>& daily, const size_t batch_size, const size_t batches, double& checksum)
+{
+    float probabilities[max_batch_size];
+    const dailyInputs* daily_pointers[max_batch_size];
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < batches; i++)
+    {
+        const size_t first = (i * batch_size) % (features.size() - batch_size + 1);
+
+        for (size_t row = 0; row < batch_size; row++) daily_pointers[row] = &daily[first + row];
+
+        model.predict(daily_pointers, &features[first], probabilities, batch_size);
+
+        checksum += probabilities[batch_size - 1];
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(stop - start).count() / batches;
+}
+
+//every kernel against the probabilities of the keras model on the golden vectors - the network fed with the inputs of retrain_model.py and ...
+//... MLModel::predict with the features before the log transform and the scaling - returns false if a probability is above its tolerance
+bool checkGoldenVectors(MLModel& model, const calibrationSet& calibration, const std::vector<denseKernels>& kernels)
+{
+    const size_t rows = calibration.golden_inputs.size();
+
+    if (!rows)
+    {
+        std::cout << "THE CALIBRATION DATA HAS NO GOLDEN VECTORS (WRITTEN BY retrain_model.py)" << std::endl;
+
+        return true;
+    }
+
+    std::cout << std::defaultfloat << std::setprecision(6) << "GOLDEN VECTORS OF THE KERAS MODEL : " << rows << " (LARGEST DIFFERENCE OF THE PROBABILITIES OF -1, 0, AND +1 TRANSITIONS)" << std::endl;
+
+    bool conforming = true;
+
+    for (const denseKernels& kernel : kernels)
+    {
+        dense_kernels = kernel;
+
+        float network_differences[MLModel::output_length] = {}, prediction_differences[MLModel::output_length] = {};
+        size_t agreements = 0;
+
+        inputSet input, features;
+        float probabilities[MLModel::output_length];
+
+        for (size_t row = 0; row < rows; row++)
+        {
+            const std::array<float, MLModel::output_length>& golden = calibration.golden_probabilities[row];
+
+            std::copy(calibration.golden_inputs[row].begin(), calibration.golden_inputs[row].end(), input);
+
+            model.neural_net.logits(input);
+
+            std::copy(std::begin(model.neural_net.outputLayer().output), std::end(model.neural_net.outputLayer().output), probabilities);
+
+            softmax(probabilities);
+
+            for (size_t i = 0; i < MLModel::output_length; i++) network_differences[i] = std::max(network_differences[i], std::fabs(probabilities[i] - golden[i]));
+
+            agreements += predictedTransition(probabilities) == static_cast<int>(std::max_element(golden.begin(), golden.end()) - golden.begin()) - 1;
+
+            std::copy(calibration.golden_features[row].begin(), calibration.golden_features[row].end(), features);
+
+            model.predict(features);
+
+            std::copy(std::begin(model.neural_net.outputLayer().output), std::end(model.neural_net.outputLayer().output), probabilities);
+
+            softmax(probabilities);
+
+            for (size_t i = 0; i < MLModel::output_length; i++) prediction_differences[i] = std::max(prediction_differences[i], std::fabs(probabilities[i] - golden[i]));
+        }
+
+        for (size_t i = 0; i < MLModel::output_length; i++)
+        {
+            conforming = conforming && network_differences[i] <= golden_network_tolerance && prediction_differences[i] <= golden_prediction_tolerance;
+        }
+
+        std::cout << std::setw(8) << kernel.name << " : NETWORK";
+
+        for (const float difference : network_differences) std::cout << " " << difference << (difference <= golden_network_tolerance ? "" : " (ABOVE THE TOLERANCE)");
+
+        std::cout << " - PREDICTION";
+
+        for (const float difference : prediction_differences) std::cout << " " << difference << (difference <= golden_prediction_tolerance ? "" : " (ABOVE THE TOLERANCE)");
+
+        std::cout << " - SAME PREDICTED TRANSITION " << 100.0 * agreements / rows << "%" << std::endl;
+    }
+
+    std::cout << std::fixed;
+
+    return conforming;
+}
+
+//mean time of single predictions timed one at a time - the caches are evicted before each one if cold is true
+double timeSinglePredictions(MLModel& model, const std::vector<inputSet>& features, std::vector<unsigned char>& eviction, const bool cold, double& checksum)
+{
+    double nanoseconds = 0.0;
+
+    for (size_t i = 0; i < cold_predictions; i++)
+    {
+        if (cold) for (size_t byte = 0; byte < eviction.size(); byte += 64) eviction[byte]++;
+
+        auto start = std::chrono::steady_clock::now();
+
+        checksum += model.predict(features[(i * 97) % features.size()]);
+
+        auto stop = std::chrono::steady_clock::now();
+
+        nanoseconds += std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+
+    return nanoseconds / cold_predictions;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage : model_benchmark <model weights> <model scales> [predictions = 1000000] [calibration data]" << std::endl;
+
+        return 1;
+    }
+
+    const size_t calls = (argc > 3) ? std::stoul(argv[3]) : 1000000;
+
+    try
+    {
+        MLModel model;
+
+        model.loadWeights(argv[1]);
+        model.loadScales(argv[2]);
+
+        referenceNeuralNet<modelTopology> reference;
+
+        reference.setWeights(readWeights(argv[1]));
+
+        std::mt19937 generator(42);
+        std::normal_distribution<float> distribution(0.0F, 1.0F);
+
+        std::vector<inputSet> inputs(input_sets);
+
+        for (auto& input : inputs) for (auto& value : input) value = std::clamp(distribution(generator), -3.0F, 3.0F);
+
+        std::vector<inputSet> features(input_sets);
+
+        for (size_t i = 0; i < input_sets; i++) rawFeatures(model, inputs[i], features[i]);
+
+        //every feature from 3 stds below to 3 stds above its mean (the inlier ranges) at once
+        std::vector<inputSet> sweep(sweep_steps);
+
+        for (size_t step = 0; step < sweep_steps; step++)
+        {
+            inputSet scaled;
+
+            for (auto& value : scaled) value = -3.0F + 6.0F * step / (sweep_steps - 1);
+
+            rawFeatures(model, scaled, sweep[step]);
+        }
+
+        std::vector<denseKernels> kernels = { portable_kernels };
+
+#ifdef USE_SIMD_KERNELS
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) kernels.push_back(avx2_kernels);
+        if (__builtin_cpu_supports("avx512f")) kernels.push_back(avx512_kernels);
+#endif
+
+        const denseKernels chosen_kernels = dense_kernels;
+
+        //only the golden vectors - no timing
+        if (!calls)
+        {
+            if (argc < 5) throw exceptions::exception("The golden vectors are in the calibration data - pass it after the number of predictions.");
+
+            const calibrationSet calibration = readCalibration(argv[4]);
+
+            if (calibration.golden_inputs.empty())
+            {
+                std::cout << "THE CALIBRATION DATA HAS NO GOLDEN VECTORS - RUN retrain_model.py AGAIN" << std::endl;
+
+                return 1;
+            }
+
+            return checkGoldenVectors(model, calibration, kernels) ? 0 : 1;
+        }
+
+        std::cout << "CHOSEN KERNELS : " << chosen_kernels.name << std::endl;
+
+        bool conforming = true;
+
+        std::vector<dailyInputs> daily;
+
+        //outputs
+        for (const denseKernels& kernel : kernels)
+        {
+            dense_kernels = kernel;
+
+            float largest_difference = 0.0F;
+
+            for (auto& input : inputs)
+            {
+                reference(input);
+                model.neural_net(input);
+
+                for (size_t i = 0; i < MLModel::output_length; i++) largest_difference = std::max(largest_difference, std::fabs(reference.output[i] - model.neural_net.output[i]));
+            }
+
+            //every set of features is predicted once on its own and once in a batch of max_batch_size
+            float largest_batch_difference = 0.0F;
+
+            float probabilities[max_batch_size];
+
+            for (size_t first = 0; first + max_batch_size <= input_sets; first += max_batch_size)
+            {
+                model.predict(&features[first], probabilities, max_batch_size);
+
+                for (size_t row = 0; row < max_batch_size; row++) largest_batch_difference = std::max(largest_batch_difference, std::fabs(probabilities[row] - model.predict(features[first + row])));
+            }
+
+            //the daily features through the pre-activation of the daily inputs - on their own and in batches
+            float largest_daily_difference = 0.0F;
+
+            const dailyInputs* daily_pointers[max_batch_size];
+
+            precomputeDailyInputs(model, features, daily);
+
+            for (size_t first = 0; first + max_batch_size <= input_sets; first += max_batch_size)
+            {
+                for (size_t row = 0; row < max_batch_size; row++) daily_pointers[row] = &daily[first + row];
+
+                model.predict(daily_pointers, &features[first], probabilities, max_batch_size);
+
+                for (size_t row = 0; row < max_batch_size; row++)
+                {
+                    const float probability = model.predict(features[first + row]);
+
+                    largest_daily_difference = std::max(largest_daily_difference, std::fabs(model.predict(daily[first + row], features[first + row]) - probability));
+                    largest_daily_difference = std::max(largest_daily_difference, std::fabs(probabilities[row] - probability));
+                }
+            }
+
+            //normalization - the largest difference of each feature over the training distribution and the sweep
+            float input_differences[MLModel::input_length] = {};
+
+            inputSet kernel_inputs, reference_inputs;
+
+            for (const std::vector<inputSet>* feature_sets : { &features, &sweep })
+            {
+                for (auto& feature_set : *feature_sets)
+                {
+                    kernel.normalize(feature_set, model.means, model.inverse_stds, kernel_inputs);
+                    referenceNormalize(model, feature_set, reference_inputs);
+
+                    for (size_t i = 0; i < MLModel::input_length; i++) input_differences[i] = std::max(input_differences[i], std::fabs(kernel_inputs[i] - reference_inputs[i]));
+                }
+            }
+
+            const size_t worst_feature = std::max_element(input_differences, input_differences + MLModel::input_length) - input_differences;
+            const float largest_input_difference = input_differences[worst_feature];
+
+            //probability of a +1 transition - the fast normalization and output stage against std::log and the softmax
+            float largest_probability_difference = 0.0F;
+
+            for (const std::vector<inputSet>* feature_sets : { &features, &sweep })
+            {
+                for (auto& feature_set : *feature_sets)
+                {
+                    const float reference_probability = referencePredict(model, feature_set);
+
+                    largest_probability_difference = std::max(largest_probability_difference, std::fabs(model.predict(feature_set) - reference_probability));
+                }
+            }
+
+            conforming = conforming && largest_difference <= output_tolerance && largest_batch_difference <= output_tolerance && largest_daily_difference <= output_tolerance;
+            conforming = conforming && largest_input_difference <= input_tolerance && largest_probability_difference <= probability_tolerance;
+
+            std::cout << std::setw(8) << kernel.name << " : LARGEST OUTPUT DIFFERENCE " << largest_difference << " (" << largest_difference / FLT_EPSILON << " EPSILON)";
+            std::cout << (largest_difference <= output_tolerance ? "" : " - ABOVE THE TOLERANCE") << std::endl;
+            std::cout << std::setw(8) << kernel.name << " : LARGEST DIFFERENCE OF THE BATCHES " << largest_batch_difference << " (" << largest_batch_difference / FLT_EPSILON << " EPSILON)";
+            std::cout << (largest_batch_difference <= output_tolerance ? "" : " - ABOVE THE TOLERANCE") << std::endl;
+            std::cout << std::setw(8) << kernel.name << " : LARGEST DIFFERENCE WITH THE DAILY INPUTS " << largest_daily_difference << " (" << largest_daily_difference / FLT_EPSILON << " EPSILON)";
+            std::cout << (largest_daily_difference <= output_tolerance ? "" : " - ABOVE THE TOLERANCE") << std::endl;
+            std::cout << std::setw(8) << kernel.name << " : LARGEST NORMALIZED INPUT DIFFERENCE " << largest_input_difference << " (FEATURE " << worst_feature << ")";
+            std::cout << (largest_input_difference <= input_tolerance ? "" : " - ABOVE THE TOLERANCE") << std::endl;
+            std::cout << std::setw(8) << kernel.name << " : LARGEST PROBABILITY DIFFERENCE " << largest_probability_difference;
+            std::cout << (largest_probability_difference <= probability_tolerance ? "" : " - ABOVE THE TOLERANCE") << std::endl;
+        }
+
+        //latency
+        double checksum = 0.0;
+
+        timeNetwork(reference, inputs, calls / 10, checksum); //warm up
+
+        const double reference_ns = timeNetwork(reference, inputs, calls, checksum);
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "   before : " << reference_ns << " NS PER CALL" << std::endl;
+
+        for (const denseKernels& kernel : kernels)
+        {
+            dense_kernels = kernel;
+
+            timeNetwork(model.neural_net, inputs, calls / 10, checksum);
+
+            const double kernel_ns = timeNetwork(model.neural_net, inputs, calls, checksum);
+
+            std::cout << std::setw(8) << kernel.name << " : " << kernel_ns << " NS PER CALL (" << reference_ns / kernel_ns << "X)" << std::endl;
+        }
+
+        //stages of a prediction - normalization, output stage, and the whole prediction before and after the kernels of the stages
+        {
+            inputSet normalized;
+
+            const float(&logits)[MLModel::output_length] = model.neural_net.outputLayer().output;
+
+            auto reference_normalization = [&](const size_t i) { referenceNormalize(model, features[i % input_sets], normalized); return normalized[15]; };
+            auto reference_output = [&](const size_t i) { float probabilities[MLModel::output_length] = { logits[0], logits[1], logits[2] + i % 2 };
+                softmax(probabilities); return probabilities[2]; };
+
+            model.neural_net.logits(inputs[0]);
+
+            timeCalls(reference_normalization, calls / 10, checksum);
+
+            const double reference_normalization_ns = timeCalls(reference_normalization, calls, checksum);
+            const double reference_output_ns = timeCalls(reference_output, calls, checksum);
+
+            std::cout << "NORMALIZATION : std::log " << reference_normalization_ns << " NS - OUTPUT : softmax " << reference_output_ns << " NS" << std::endl;
+
+            for (const denseKernels& kernel : kernels)
+            {
+                dense_kernels = kernel;
+
+                auto normalization = [&](const size_t i) { kernel.normalize(features[i % input_sets], model.means, model.inverse_stds, normalized); return normalized[15]; };
+                auto output = [&](const size_t i) { const float shifted[MLModel::output_length] = { logits[0], logits[1], logits[2] + i % 2 };
+                    return positiveTransitionProbability(shifted); };
+                auto before = [&](const size_t i) { return referencePredict(model, features[i % input_sets]); };
+                auto after = [&](const size_t i) { return model.predict(features[i % input_sets]); };
+                auto with_daily_inputs = [&](const size_t i) { return model.predict(daily[i % input_sets], features[i % input_sets]); };
+
+                precomputeDailyInputs(model, features, daily);
+
+                timeCalls(normalization, calls / 10, checksum);
+
+                const double normalization_ns = timeCalls(normalization, calls, checksum);
+                const double output_ns = timeCalls(output, calls, checksum);
+
+                timeCalls(before, calls / 10, checksum);
+
+                const double before_ns = timeCalls(before, calls, checksum);
+                const double after_ns = timeCalls(after, calls, checksum);
+                const double daily_ns = timeCalls(with_daily_inputs, calls, checksum);
+
+                std::cout << std::setw(8) << kernel.name << " : NORMALIZATION " << normalization_ns << " NS (" << reference_normalization_ns / normalization_ns << "X) - OUTPUT ";
+                std::cout << output_ns << " NS (" << reference_output_ns / output_ns << "X) - PREDICTION " << before_ns << " NS BEFORE, " << after_ns << " NS AFTER, ";
+                std::cout << daily_ns << " NS WITH THE DAILY INPUTS (" << after_ns / daily_ns << "X)" << std::endl;
+            }
+        }
+
+        //caches - the same features every time, the input sets, and single predictions after the caches were evicted (the model is ~38 kB)
+        {
+            dense_kernels = chosen_kernels;
+
+            std::vector<unsigned char> eviction(eviction_bytes);
+
+            auto one_input = [&](const size_t) { return model.predict(features[0]); };
+            auto all_inputs = [&](const size_t i) { return model.predict(features[i % input_sets]); };
+
+            timeCalls(one_input, calls / 10, checksum);
+
+            const double one_input_ns = timeCalls(one_input, calls, checksum);
+            const double all_inputs_ns = timeCalls(all_inputs, calls, checksum);
+
+            timeSinglePredictions(model, features, eviction, false, checksum);
+
+            const double warm_ns = timeSinglePredictions(model, features, eviction, false, checksum);
+            const double cold_ns = timeSinglePredictions(model, features, eviction, true, checksum);
+
+            for (size_t byte = 0; byte < eviction.size(); byte += 4096) checksum += eviction[byte];
+
+            std::cout << "CACHES (" << chosen_kernels.name << ") : ONE INPUT " << one_input_ns << " NS - " << input_sets << " INPUTS " << all_inputs_ns << " NS (";
+            std::cout << 1e3 / all_inputs_ns << "M PREDICTIONS PER SECOND) - TIMED ONE AT A TIME " << warm_ns << " NS WARM, " << cold_ns << " NS COLD (";
+            std::cout << cold_ns / warm_ns << "X, " << (eviction_bytes >> 20) << " MB WRITTEN BEFORE EACH)" << std::endl;
+        }
+
+#ifdef USE_CONSTANT_MODEL
+        //the network with the weights compiled in against the network loaded at runtime - both with the chosen kernels
+        {
+            dense_kernels = chosen_kernels;
+
+            static constantNeuralNet constant_net;
+
+            const float(&constant_logits)[MLModel::output_length] = constant_net.outputLayer().output;
+            const float(&runtime_logits)[MLModel::output_length] = model.neural_net.outputLayer().output;
+
+            float largest_difference = 0.0F;
+
+            for (auto& input : inputs)
+            {
+                model.neural_net.logits(input);
+                constantLogits(constant_net, input);
+
+                for (size_t i = 0; i < MLModel::output_length; i++) largest_difference = std::max(largest_difference, std::abs(constant_logits[i] - runtime_logits[i]));
+            }
+
+            bool same_scales = true;
+
+            for (size_t i = 0; i < MLModel::input_length; i++)
+            {
+                same_scales = same_scales && constant_model_means[i] == model.means[i] && constant_model_stds[i] == model.stds[i] && constant_model_inverse_stds[i] == model.inverse_stds[i];
+            }
+
+            conforming = conforming && largest_difference <= output_tolerance && same_scales;
+
+            std::cout << std::setprecision(6) << "CONSTANT WEIGHTS : LARGEST LOGIT DIFFERENCE " << largest_difference << " (" << largest_difference / FLT_EPSILON << " EPSILON)";
+            std::cout << (largest_difference <= output_tolerance ? "" : " - ABOVE THE TOLERANCE") << (same_scales ? "" : " - THE SCALES DIFFER (modelConstants.h IS OUT OF DATE)") << std::endl;
+
+            inputSet normalized;
+
+            auto runtime_network = [&](const size_t i) { model.neural_net.logits(inputs[i % input_sets]); return runtime_logits[2]; };
+            auto constant_network = [&](const size_t i) { constantLogits(constant_net, inputs[i % input_sets]); return constant_logits[2]; };
+            auto runtime_prediction = [&](const size_t i) { return model.predict(features[i % input_sets]); };
+            auto constant_prediction = [&](const size_t i) {
+                chosen_kernels.normalize(features[i % input_sets], constant_model_means, constant_model_inverse_stds, normalized);
+                constantLogits(constant_net, normalized);
+                return positiveTransitionProbability(constant_logits); };
+
+            timeCalls(runtime_network, calls / 10, checksum);
+
+            const double runtime_network_ns = timeCalls(runtime_network, calls, checksum);
+
+            timeCalls(constant_network, calls / 10, checksum);
+
+            const double constant_network_ns = timeCalls(constant_network, calls, checksum);
+            const double runtime_prediction_ns = timeCalls(runtime_prediction, calls, checksum);
+            const double constant_prediction_ns = timeCalls(constant_prediction, calls, checksum);
+
+            std::cout << std::setprecision(1) << "CONSTANT WEIGHTS (" << (constant_avx512 ? "avx512" : "portable") << ") : NETWORK " << constant_network_ns << " NS AGAINST ";
+            std::cout << runtime_network_ns << " NS LOADED AT RUNTIME (" << runtime_network_ns - constant_network_ns << " NS) - PREDICTION " << constant_prediction_ns;
+            std::cout << " NS AGAINST " << runtime_prediction_ns << " NS (" << runtime_prediction_ns - constant_prediction_ns << " NS)" << std::endl;
+        }
+#endif
+
+        //batches - the latency of a batch is the time until its last prediction is known
+        for (const denseKernels& kernel : kernels)
+        {
+            dense_kernels = kernel;
+
+            std::cout << kernel.name << " PREDICTIONS (NORMALIZATION INCLUDED)" << std::endl;
+
+            double single_ns = 0.0;
+
+            precomputeDailyInputs(model, features, daily);
+
+            for (size_t batch_size = 1; batch_size <= max_batch_size; batch_size *= 2)
+            {
+                const size_t batches = calls / batch_size;
+
+                timeBatches(model, features, batch_size, batches / 10, checksum);
+
+                const double batch_ns = timeBatches(model, features, batch_size, batches, checksum);
+                const double daily_batch_ns = timeDailyBatches(model, features, daily, batch_size, batches, checksum);
+
+                if (batch_size == 1) single_ns = batch_ns;
+
+                std::cout << "    BATCHES OF " << std::setw(2) << batch_size << " : " << std::setw(7) << batch_ns << " NS PER BATCH - " << std::setw(6) << batch_ns / batch_size;
+                std::cout << " NS PER PREDICTION - " << batch_size * single_ns / batch_ns << "X THE THROUGHPUT OF SINGLE PREDICTIONS (" << 1e3 * batch_size / batch_ns << "M PER SECOND) - " << std::setw(6) << daily_batch_ns / batch_size;
+                std::cout << " NS PER PREDICTION WITH THE DAILY INPUTS" << std::endl;
+            }
+        }
+
+        dense_kernels = chosen_kernels;
+
+        //golden vectors and quantized network - the accuracy report uses the chosen kernels
+        if (argc > 4)
+        {
+            const calibrationSet calibration = readCalibration(argv[4]);
+
+            conforming = checkGoldenVectors(model, calibration, kernels) && conforming;
+
+            dense_kernels = chosen_kernels;
+
+            MLModel quantized_model = model;
+
+            quantized_model.loadCalibration(argv[4]);
+
+            std::cout << std::setprecision(6) << "QUANTIZED WITH " << calibration.calibration_inputs.size() << " CALIBRATION INPUTS" << std::endl;
+
+            reportQuantization(quantized_model, calibration);
+
+            std::vector<quantizedKernel> quantized_kernels = { portable_quantized_kernel };
+
+#ifdef USE_SIMD_KERNELS
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vnni")) quantized_kernels.push_back(vnni_quantized_kernel);
+#endif
+
+            const quantizedKernel chosen_quantized_kernel = quantized_kernel;
+
+            auto float_prediction = [&](const size_t i) { return model.predict(features[i % input_sets]); };
+
+            timeCalls(float_prediction, calls / 10, checksum);
+
+            const double float_ns = timeCalls(float_prediction, calls, checksum);
+
+            std::cout << std::setprecision(1) << "PREDICTION (NORMALIZATION INCLUDED) : FLOAT (" << dense_kernels.name << ") " << float_ns << " NS" << std::endl;
+
+            for (const quantizedKernel& kernel : quantized_kernels)
+            {
+                quantized_kernel = kernel;
+
+                auto quantized_prediction = [&](const size_t i) { return quantized_model.predict(features[i % input_sets]); };
+
+                timeCalls(quantized_prediction, calls / 10, checksum);
+
+                const double quantized_ns = timeCalls(quantized_prediction, calls, checksum);
+
+                std::cout << std::setw(8) << kernel.name << " : QUANTIZED " << quantized_ns << " NS (" << float_ns / quantized_ns << "X)" << std::endl;
+            }
+
+            quantized_kernel = chosen_quantized_kernel;
+        }
+
+        std::cout << "CHECKSUM " << checksum << std::endl;
+
+        if (!conforming) return 1;
+    }
+    catch (const std::runtime_error& runtime_error) { std::cout << "Runtime Error caught : " << runtime_error.what() << std::endl; return 1; }
+    catch (const exceptions::exception& exception) { std::cout << "Exception caught : " << exception.what() << std::endl; return 1; }
+    catch (const std::exception& exception) { std::cout << "Base Exception caught : " << exception.what() << std::endl; return 1; }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+// modelConverter.cpp : Writes the binary model file the bot memory maps at startup (see USE_MODEL_FILE in tradingBot.h) from
+// the json files written by retrain_model.py. Run it again whenever the model is retrained.
+//
+// usage : model_converter <model weights> <model scales> <model file> [loads = 1000]
+//
+// If the model file ends with .h, the weights and scales are written as constexpr arrays instead (see constantModelUtils.h -
+// the model_constants target of CMake writes modelConstants.h this way).
+//
+// It reads the model file back, checks that it gives the same probabilities as the json files on random features (bit for
+// bit - the weights are copied, not converted again), and prints the time of both ways of loading the model.
+
+
+#include "modelUtils.h"
+#include "exceptUtils.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+
+const size_t checked_predictions = 4096;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        std::cout << "usage : model_converter <model weights> <model scales> <model file> [loads = 1000]" << std::endl;
+
+        return 1;
+    }
+
+    const size_t loads = (argc > 4) ? std::max<size_t>(std::stoul(argv[4]), 1) : 1000;
+
+    try
+    {
+        MLModel json_model;
+
+        auto start = std::chrono::steady_clock::now();
+
+        json_model.loadWeights(argv[1]);
+        json_model.loadScales(argv[2]);
+
+        auto stop = std::chrono::steady_clock::now();
+
+        const std::string output_path = argv[3];
+
+        if (output_path.size() > 2 && output_path.compare(output_path.size() - 2, 2, ".h") == 0)
+        {
+            json_model.saveModelHeader(output_path);
+
+            std::cout << "WROTE " << output_path << std::endl;
+
+            return 0;
+        }
+
+        const double json_microseconds = std::chrono::duration<double, std::micro>(stop - start).count();
+
+        json_model.saveModelFile(argv[3]);
+
+        MLModel file_model;
+
+        start = std::chrono::steady_clock::now();
+
+        for (size_t load = 0; load < loads; load++)
+        {
+            if (!file_model.loadModelFile(argv[3])) throw exceptions::exception("The model file that was just written is invalid.");
+        }
+
+        stop = std::chrono::steady_clock::now();
+
+        const double file_microseconds = std::chrono::duration<double, std::micro>(stop - start).count() / loads;
+
+        //features drawn from the training distribution of every feature
+        std::mt19937 generator(42);
+        std::normal_distribution<float> distribution(0.0F, 1.0F);
+
+        size_t mismatches = 0;
+
+        for (size_t prediction = 0; prediction < checked_predictions; prediction++)
+        {
+            float features[MLModel::input_length];
+
+            for (size_t i = 0; i < MLModel::input_length; i++)
+            {
+                const float value = json_model.means[i] + json_model.stds[i] * std::clamp(distribution(generator), -3.0F, 3.0F);
+
+                features[i] = (i == 0 || i == 2) ? value : std::exp(value) - 1e-9F; //time_of_day and n are not log transformed
+            }
+
+            const float json_probability = json_model.predict(features);
+            const float file_probability = file_model.predict(features);
+
+            if (std::memcmp(&json_probability, &file_probability, sizeof(float))) mismatches++;
+        }
+
+        if (std::memcmp(&json_model.ranges, &file_model.ranges, sizeof(inlierRanges))) mismatches++;
+
+        std::cout << "WROTE " << argv[3] << std::endl;
+        std::cout << "JSON FILES LOADED IN " << json_microseconds << " US" << std::endl;
+        std::cout << "MODEL FILE LOADED IN " << file_microseconds << " US (MEAN OF " << loads << " LOADS)" << std::endl;
+
+        if (mismatches)
+        {
+            std::cout << mismatches << " OF " << checked_predictions << " PREDICTIONS (OR THE INLIER RANGES) DIFFER FROM THE JSON FILES" << std::endl;
+
+            return 1;
+        }
+
+        std::cout << "THE MODEL FILE GIVES THE SAME " << checked_predictions << " PREDICTIONS AS THE JSON FILES" << std::endl;
+    }
+    catch (const std::runtime_error& runtime_error) { std::cout << "Runtime Error caught : " << runtime_error.what() << std::endl; return 1; }
+    catch (const exceptions::exception& exception) { std::cout << "Exception caught : " << exception.what() << std::endl; return 1; }
+    catch (const std::exception& exception) { std::cout << "Base Exception caught : " << exception.what() << std::endl; return 1; }
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "modelSwapUtils.h"
+
+#include <iostream>
+#include <cmath>
+
+//true if every weight and scale of the model is finite and it predicts a probability at the mean of every feature
+bool validModel(MLModel& model)
+{
+	std::vector<float> packed(model.neural_net.packed_length);
+
+	model.neural_net.pack(packed.data());
+
+	for (const float weight : packed) { if (!std::isfinite(weight)) return false; }
+
+	float features[MLModel::input_length];
+
+	for (size_t i = 0; i < MLModel::input_length; i++)
+	{
+		if (!std::isfinite(model.means[i]) || !std::isfinite(model.inverse_stds[i]) || !(model.stds[i] > 0.0F)) return false;
+
+		features[i] = (i == 0 || i == 2) ? model.means[i] : std::exp(model.means[i]) - 1e-9F; //time_of_day and n are not log transformed
+	}
+
+	const float probability = model.predict(features);
+
+	return probability >= 0.0F && probability <= 1.0F;
+}
+
+modelHolder::modelHolder()
+{
+	models[0] = std::make_unique<MLModel>();
+	models[1] = std::make_unique<MLModel>();
+}
+
+modelHolder::~modelHolder()
+{
+	stop();
+}
+
+//the daily inputs of every symbol computed with a model
+void precomputeDailyInputs(const MLModel& model, const std::vector<dailyFeatures>& symbol_features, std::vector<dailyInputs>& inputs)
+{
+	inputs.resize(symbol_features.size());
+
+	for (size_t i = 0; i < symbol_features.size(); i++)
+	{
+		const dailyFeatures& features = symbol_features[i];
+
+		model.precompute(inputs[i], features.mean, features.std, features.average_volume, features.previous_days_close, features.pmdx, features.ppdx, features.lambda);
+	}
+}
+
+void modelHolder::precompute(const std::vector<dailyFeatures>& features)
+{
+	symbol_features = features;
+
+	precomputeDailyInputs(active(), symbol_features, daily_inputs[active_index.load(std::memory_order_relaxed)]);
+}
+
+void modelHolder::watch(const std::string& File_path, const std::string& Calibration_path)
+{
+	stop();
+
+	file_path = File_path;
+	calibration_path = Calibration_path;
+
+	std::error_code error;
+
+	last_write_time = std::filesystem::last_write_time(file_path, error); //the version the bot started with (if any) is not loaded again
+
+	if (error) last_write_time = std::filesystem::file_time_type::min();
+
+	stopping = false;
+
+	worker = std::thread(&modelHolder::run, this);
+}
+
+void modelHolder::stop()
+{
+	stopping = true;
+
+	if (worker.joinable()) worker.join();
+}
+
+MLModel& modelHolder::swap()
+{
+	const int new_index = active_index.load(std::memory_order_relaxed) ^ 1;
+
+	active_index.store(new_index, std::memory_order_relaxed);
+
+	//the old active model is only handed to the thread once the data loop switched to the new one
+	standby_state.store(standby_free, std::memory_order_release);
+
+	return *models[new_index];
+}
+
+void modelHolder::run()
+{
+	while (!stopping)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(model_poll_milliseconds));
+
+		if (standby_state.load(std::memory_order_acquire) != standby_free) continue;
+
+		std::error_code error;
+
+		const std::filesystem::file_time_type write_time = std::filesystem::last_write_time(file_path, error);
+
+		if (error || write_time == last_write_time) continue;
+
+		last_write_time = write_time;
+
+		const int standby_index = active_index.load(std::memory_order_relaxed) ^ 1;
+
+		if (load(*models[standby_index], daily_inputs[standby_index]))
+		{
+			std::cout << "LOADED A NEW MODEL FROM " << file_path << " - IT IS SWAPPED IN BETWEEN MESSAGES" << std::endl;
+
+			standby_state.store(standby_ready, std::memory_order_release);
+		}
+		else std::cout << "THE NEW MODEL FILE " << file_path << " IS INVALID - KEEPING THE CURRENT MODEL" << std::endl;
+	}
+}
+
+bool modelHolder::load(MLModel& model, std::vector<dailyInputs>& inputs)
+{
+	if (!model.loadModelFile(file_path)) return false;
+
+	model.quantized = false;
+
+	if (!calibration_path.empty())
+	{
+		try { model.loadCalibration(calibration_path); }
+		catch (const exceptions::exception&) { return false; }
+		catch (const std::exception&) { return false; }
+	}
+
+	if (!validModel(model)) return false;
+
+	precomputeDailyInputs(model, symbol_features, inputs);
+
+	return true;
+}
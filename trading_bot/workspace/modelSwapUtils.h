@@ -0,0 +1,98 @@
+/*
+Swap in a retrained model while the bot is running.
+
+modelHolder keeps two models - the bot predicts with the active one (symbolData::model points to it) while a background
+thread watches the model file written by model_converter (see USE_MODEL_SWAP in tradingBot.h). Each model has the daily
+inputs of every symbol left to trade (see USE_DAILY_INPUTS) next to it since they depend on its weights and scales - a
+symbol finds its own by the index it was given at startup. When the model file is replaced the thread
+	loads it into the standby model (the header and checksum checks of MLModel::loadModelFile)
+	quantizes it with the calibration data if the bot uses the quantized network
+	checks that every weight and scale is finite and that it predicts a probability at the mean of every feature
+	precomputes the daily inputs of every symbol with it (only once precompute() was called - see USE_DAILY_INPUTS)
+and marks it as ready. The data loop calls swap() between messages once ready() returns true. The swap only makes the
+standby model and its daily inputs the active ones, so it takes the same time for any number of symbols. The thread never
+touches the active model and only loads the standby one after the data loop handed it back, so nothing is locked.
+
+A model file that fails to load or to validate is reported and the active model is kept. It is only tried again once the
+file is replaced. The symbols watched today keep the daily inlier ranges of the model loaded at startup.
+*/
+
+#ifndef MODEL_SWAP_UTILS_H
+#define MODEL_SWAP_UTILS_H
+
+#include "modelUtils.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <filesystem>
+
+const int model_poll_milliseconds = 500; //how often the model file is checked for a new version
+
+struct dailyFeatures //the features of a symbol that MLModel::precompute reads
+{
+	float mean = 0.0F;
+	float std = 0.0F;
+	float average_volume = 0.0F;
+	float previous_days_close = 0.0F;
+	float pmdx = 0.0F;
+	float ppdx = 0.0F;
+	float lambda = 0.0F;
+};
+
+class modelHolder
+{
+public:
+	modelHolder();
+	~modelHolder(); //stops the thread
+
+	modelHolder(const modelHolder&) = delete;
+	modelHolder& operator=(const modelHolder&) = delete;
+
+	MLModel& active() { return *models[active_index.load(std::memory_order_relaxed)]; }
+
+	//compute the daily inputs of the symbols with the active model - call it once the model is loaded and before watch()
+	void precompute(const std::vector<dailyFeatures>&);
+
+	//start watching a model file - the calibration data of the quantized network (empty for the float network)
+	void watch(const std::string&, const std::string&);
+	void stop();
+
+	bool ready() const { return standby_state.load(std::memory_order_acquire) == standby_ready; } //a new model is waiting to be swapped in
+
+	//make the standby model the active one - call it from the data loop once ready() returns true
+	MLModel& swap();
+
+	const dailyInputs* activeDailyInputs() const { return daily_inputs[active_index.load(std::memory_order_relaxed)].data(); } //the daily inputs of the symbols computed with the active model
+
+private:
+	static const int standby_free = 0; //the thread may load the standby model
+	static const int standby_ready = 1; //the standby model is waiting for swap()
+
+	std::unique_ptr<MLModel> models[2]; //the active and the standby model (~38 kB each)
+	std::vector<dailyInputs> daily_inputs[2];
+
+	//only written by the data loop (swap) - the thread reads it once standby_state is free, and the release and acquire of that ...
+	//... handshake order the write before the read, so relaxed loads and stores are enough
+	std::atomic<int> active_index{ 0 };
+
+	std::atomic<int> standby_state{ standby_free };
+	std::atomic<bool> stopping{ false };
+
+	std::thread worker;
+
+	std::string file_path;
+	std::string calibration_path;
+
+	std::vector<dailyFeatures> symbol_features; //in the order of the daily inputs
+
+	std::filesystem::file_time_type last_write_time; //of the last version of the file that was tried
+
+	void run(); //the body of the thread
+	bool load(MLModel&, std::vector<dailyInputs>&); //returns false if the model file is invalid
+};
+
+#endif
@@ -1,5 +1,611 @@
 
 #include "modelUtils.h"
+#include "snapshotUtils.h" //fnv1a
+#include "mmapUtils.h"
+
+#ifdef USE_SIMD_KERNELS
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <bit>
+#include <cstdio>
+
+#ifdef USE_MODEL_SHAPES
+#include "modelShapes.h" //written by CMake from model_weights.json
+
+static_assert(model_layer_count == modelTopology::layer_count, "model_weights.json does not have as many dense layers as modelTopology.");
+static_assert(modelTopology::matches(model_layer_shapes), "The shapes of the weights of model_weights.json do not match modelTopology.");
+#endif
+
+#ifdef USE_CONSTANT_MODEL
+#include "constantModelUtils.h"
+#include "modelConstants.h" //written by model_converter from the model files of the build (MODEL_CONSTANT_WEIGHTS)
+
+static_assert(constant_model_packed_length == simpleNeuralNet<modelTopology>::packed_length, "modelConstants.h was written for another topology");
+
+static thread_local simpleNeuralNet<modelTopology, constantLayers<modelTopology, constant_model_weights>> constant_net; //only holds the outputs of the layers
+#endif
+
+void portableDenseKernel(const float* weights, const float* biases, const float* input, float* output, const size_t input_length, const size_t output_length,
+    const float slope)
+{
+    const size_t stride = paddedLength(output_length);
+
+    //16 outputs at a time - the inner loops have a fixed length and no stride so the compiler can vectorize them for any target
+    for (size_t block = 0; block < output_length; block += 16)
+    {
+        float sums[16];
+
+        for (int i = 0; i < 16; i++) sums[i] = biases[block + i];
+
+        const float* row = weights + block;
+
+        for (size_t input_index = 0; input_index < input_length; input_index++, row += stride)
+        {
+            const float x = input[input_index];
+
+            for (int i = 0; i < 16; i++) sums[i] += row[i] * x;
+        }
+
+        for (int i = 0; i < 16; i++) sums[i] = std::max(sums[i], slope * sums[i]);
+
+        std::memcpy(output + block, sums, std::min<size_t>(output_length - block, 16) * sizeof(float));
+    }
+}
+
+//one input at a time - without explicit vector registers the compiler keeps the sums of several inputs in memory, which is slower
+void portableDenseBatchKernel(const float* weights, const float* biases, const float* inputs, float* outputs, const size_t rows, const size_t input_length,
+    const size_t output_length, const float slope, const size_t bias_stride)
+{
+    for (size_t row = 0; row < rows; row++)
+    {
+        portableDenseKernel(weights, biases + row * bias_stride, inputs + row * input_length, outputs + row * output_length, input_length, output_length, slope);
+    }
+}
+
+//coefficients of the polynomial of cephes' logf - ln(1 + z) = z - z^2 / 2 + z^3 * P(z) for 1 + z in [sqrt(0.5), sqrt(2))
+const float log_polynomial[9] = { 7.0376836292E-2F, -1.1514610310E-1F, 1.1676998740E-1F, -1.2420140846E-1F, 1.4249322787E-1F, -1.6668057665E-1F,
+    2.0000714765E-1F, -2.4999993993E-1F, 3.3333331174E-1F };
+
+const float ln2_high = 0.693359375F; //ln(2) split in two so k * ln2_high is exact for the exponents of a float
+const float ln2_low = -2.12194440E-4F;
+
+const int32_t sqrt_half_bits = 0x3F3504F3; //bits of sqrt(0.5) - subtracting them from the bits of a positive normal x gives the exponent k of x = 2^k * m with m in [sqrt(0.5), sqrt(2))
+
+//the same steps as the SIMD kernels in loops of a fixed length over all the features, so the compiler can vectorize them for any target - every ...
+//... feature goes through the logarithm and the features that are not log transformed are selected afterwards
+void portableNormalizeKernel(const float* features, const float* means, const float* inverse_stds, float* inputs)
+{
+    float k[normalized_length], z[normalized_length], z2[normalized_length], polynomial[normalized_length];
+
+    for (size_t i = 0; i < normalized_length; i++)
+    {
+        const int32_t bits = std::bit_cast<int32_t>(features[i] + 1e-9F);
+        const int32_t exponent = (bits - sqrt_half_bits) >> 23;
+
+        k[i] = static_cast<float>(exponent);
+        z[i] = std::bit_cast<float>(bits - exponent * (1 << 23)) - 1.0F;
+        z2[i] = z[i] * z[i];
+        polynomial[i] = log_polynomial[0];
+    }
+
+    for (int j = 1; j < 9; j++) for (size_t i = 0; i < normalized_length; i++) polynomial[i] = polynomial[i] * z[i] + log_polynomial[j];
+
+    for (size_t i = 0; i < normalized_length; i++)
+    {
+        float x = k[i] * ln2_high + (z[i] + (polynomial[i] * z[i] * z2[i] + k[i] * ln2_low - 0.5F * z2[i]));
+
+        if (!(features[i] + 1e-9F > 0.0F)) x = std::numeric_limits<float>::quiet_NaN();
+        if (!(log_transformed_features >> i & 1)) x = features[i];
+
+        inputs[i] = (x - means[i]) * inverse_stds[i];
+    }
+}
+
+//the quantized inputs of a layer - padded to a whole group of four (the weights of the padding are 0)
+void quantizeInput(const float* input, uint8_t* quantized, const size_t input_length, const float inverse_input_scale, const float zero_point)
+{
+    for (size_t i = 0; i < input_length; i++)
+    {
+        const float scaled = std::max(0.0F, std::min(255.0F, input[i] * inverse_input_scale + zero_point));
+
+        quantized[i] = static_cast<uint8_t>(std::nearbyint(scaled));
+    }
+
+    for (size_t i = input_length; i % 4; i++) quantized[i] = 0;
+}
+
+//16 outputs at a time like the float kernel - the sums are exact so every kernel gives the same outputs
+void portableQuantizedKernel(const int8_t* weights, const int32_t* corrections, const float* scales, const float* biases, const float* input, float* output,
+    const size_t input_length, const size_t output_length, const float inverse_input_scale, const float zero_point, const float slope, const float* residual)
+{
+    const size_t stride = paddedLength(output_length) * 4;
+
+    uint8_t quantized[max_quantized_input_length];
+
+    quantizeInput(input, quantized, input_length, inverse_input_scale, zero_point);
+
+    for (size_t block = 0; block < output_length; block += 16)
+    {
+        int32_t sums[16];
+
+        for (int i = 0; i < 16; i++) sums[i] = corrections[block + i];
+
+        const int8_t* group = weights + block * 4;
+
+        for (size_t input_index = 0; input_index < input_length; input_index += 4, group += stride)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                sums[i] += quantized[input_index] * group[i * 4] + quantized[input_index + 1] * group[i * 4 + 1] \
+                    + quantized[input_index + 2] * group[i * 4 + 2] + quantized[input_index + 3] * group[i * 4 + 3];
+            }
+        }
+
+        float outputs[16];
+
+        for (int i = 0; i < 16; i++)
+        {
+            const float y = static_cast<float>(sums[i]) * scales[block + i] + biases[block + i];
+
+            outputs[i] = std::max(y, slope * y);
+        }
+
+        if (residual) for (size_t i = 0; i < std::min<size_t>(output_length - block, 16); i++) outputs[i] += residual[block + i];
+
+        std::memcpy(output + block, outputs, std::min<size_t>(output_length - block, 16) * sizeof(float));
+    }
+}
+
+#ifdef USE_SIMD_KERNELS
+
+//16 outputs at a time in two registers - the even and odd inputs are summed separately so four multiply-adds are independent of each other
+__attribute__((target("avx2,fma")))
+void avx2DenseKernel(const float* weights, const float* biases, const float* input, float* output, const size_t input_length, const size_t output_length,
+    const float slope)
+{
+    const size_t stride = paddedLength(output_length);
+    const __m256 slopes = _mm256_set1_ps(slope);
+
+    for (size_t block = 0; block < output_length; block += 16)
+    {
+        __m256 even0 = _mm256_load_ps(biases + block);
+        __m256 even1 = _mm256_load_ps(biases + block + 8);
+        __m256 odd0 = _mm256_setzero_ps();
+        __m256 odd1 = _mm256_setzero_ps();
+
+        const float* row = weights + block;
+
+        size_t input_index = 0;
+
+        for (; input_index + 1 < input_length; input_index += 2, row += 2 * stride)
+        {
+            const __m256 x_even = _mm256_broadcast_ss(input + input_index);
+            const __m256 x_odd = _mm256_broadcast_ss(input + input_index + 1);
+
+            even0 = _mm256_fmadd_ps(x_even, _mm256_load_ps(row), even0);
+            even1 = _mm256_fmadd_ps(x_even, _mm256_load_ps(row + 8), even1);
+            odd0 = _mm256_fmadd_ps(x_odd, _mm256_load_ps(row + stride), odd0);
+            odd1 = _mm256_fmadd_ps(x_odd, _mm256_load_ps(row + stride + 8), odd1);
+        }
+
+        if (input_index < input_length)
+        {
+            const __m256 x = _mm256_broadcast_ss(input + input_index);
+
+            even0 = _mm256_fmadd_ps(x, _mm256_load_ps(row), even0);
+            even1 = _mm256_fmadd_ps(x, _mm256_load_ps(row + 8), even1);
+        }
+
+        __m256 sum0 = _mm256_add_ps(even0, odd0);
+        __m256 sum1 = _mm256_add_ps(even1, odd1);
+
+        sum0 = _mm256_max_ps(sum0, _mm256_mul_ps(sum0, slopes));
+        sum1 = _mm256_max_ps(sum1, _mm256_mul_ps(sum1, slopes));
+
+        if (block + 16 <= output_length)
+        {
+            _mm256_storeu_ps(output + block, sum0);
+            _mm256_storeu_ps(output + block + 8, sum1);
+        }
+        else //the last outputs of a layer whose length is not a multiple of 16
+        {
+            alignas(32) float sums[16];
+
+            _mm256_store_ps(sums, sum0);
+            _mm256_store_ps(sums + 8, sum1);
+
+            std::memcpy(output + block, sums, (output_length - block) * sizeof(float));
+        }
+    }
+}
+
+//four inputs and 16 outputs at a time in eight registers - the other inputs go through the single kernel
+__attribute__((target("avx2,fma")))
+void avx2DenseBatchKernel(const float* weights, const float* biases, const float* inputs, float* outputs, const size_t rows, const size_t input_length,
+    const size_t output_length, const float slope, const size_t bias_stride)
+{
+    const size_t stride = paddedLength(output_length);
+    const __m256 slopes = _mm256_set1_ps(slope);
+
+    size_t row = 0;
+
+    for (; row + 4 <= rows; row += 4)
+    {
+        const float* input = inputs + row * input_length;
+        float* output = outputs + row * output_length;
+
+        for (size_t block = 0; block < output_length; block += 16)
+        {
+            const float* row_biases = biases + row * bias_stride + block;
+
+            __m256 sum00 = _mm256_load_ps(row_biases), sum01 = _mm256_load_ps(row_biases + 8);
+            __m256 sum10 = _mm256_load_ps(row_biases + bias_stride), sum11 = _mm256_load_ps(row_biases + bias_stride + 8);
+            __m256 sum20 = _mm256_load_ps(row_biases + 2 * bias_stride), sum21 = _mm256_load_ps(row_biases + 2 * bias_stride + 8);
+            __m256 sum30 = _mm256_load_ps(row_biases + 3 * bias_stride), sum31 = _mm256_load_ps(row_biases + 3 * bias_stride + 8);
+
+            const float* weight_row = weights + block;
+
+            for (size_t input_index = 0; input_index < input_length; input_index++, weight_row += stride)
+            {
+                const __m256 weights0 = _mm256_load_ps(weight_row);
+                const __m256 weights1 = _mm256_load_ps(weight_row + 8);
+
+                const __m256 x0 = _mm256_broadcast_ss(input + input_index);
+                const __m256 x1 = _mm256_broadcast_ss(input + input_length + input_index);
+                const __m256 x2 = _mm256_broadcast_ss(input + 2 * input_length + input_index);
+                const __m256 x3 = _mm256_broadcast_ss(input + 3 * input_length + input_index);
+
+                sum00 = _mm256_fmadd_ps(x0, weights0, sum00); sum01 = _mm256_fmadd_ps(x0, weights1, sum01);
+                sum10 = _mm256_fmadd_ps(x1, weights0, sum10); sum11 = _mm256_fmadd_ps(x1, weights1, sum11);
+                sum20 = _mm256_fmadd_ps(x2, weights0, sum20); sum21 = _mm256_fmadd_ps(x2, weights1, sum21);
+                sum30 = _mm256_fmadd_ps(x3, weights0, sum30); sum31 = _mm256_fmadd_ps(x3, weights1, sum31);
+            }
+
+            alignas(32) float results[4][16];
+
+            _mm256_store_ps(results[0], _mm256_max_ps(sum00, _mm256_mul_ps(sum00, slopes)));
+            _mm256_store_ps(results[0] + 8, _mm256_max_ps(sum01, _mm256_mul_ps(sum01, slopes)));
+            _mm256_store_ps(results[1], _mm256_max_ps(sum10, _mm256_mul_ps(sum10, slopes)));
+            _mm256_store_ps(results[1] + 8, _mm256_max_ps(sum11, _mm256_mul_ps(sum11, slopes)));
+            _mm256_store_ps(results[2], _mm256_max_ps(sum20, _mm256_mul_ps(sum20, slopes)));
+            _mm256_store_ps(results[2] + 8, _mm256_max_ps(sum21, _mm256_mul_ps(sum21, slopes)));
+            _mm256_store_ps(results[3], _mm256_max_ps(sum30, _mm256_mul_ps(sum30, slopes)));
+            _mm256_store_ps(results[3] + 8, _mm256_max_ps(sum31, _mm256_mul_ps(sum31, slopes)));
+
+            if (block + 16 <= output_length) for (int r = 0; r < 4; r++) std::memcpy(output + r * output_length + block, results[r], 16 * sizeof(float));
+            else for (int r = 0; r < 4; r++) std::memcpy(output + r * output_length + block, results[r], (output_length - block) * sizeof(float));
+        }
+    }
+
+    for (; row < rows; row++) avx2DenseKernel(weights, biases + row * bias_stride, inputs + row * input_length, outputs + row * output_length, input_length, output_length, slope);
+}
+
+//32 outputs at a time in two registers (16 in one for the last block) - the even and odd inputs are summed separately
+__attribute__((target("avx512f")))
+void avx512DenseKernel(const float* weights, const float* biases, const float* input, float* output, const size_t input_length, const size_t output_length,
+    const float slope)
+{
+    const size_t stride = paddedLength(output_length);
+    const __m512 slopes = _mm512_set1_ps(slope);
+
+    size_t block = 0;
+
+    for (; block + 32 <= stride; block += 32)
+    {
+        __m512 even0 = _mm512_load_ps(biases + block);
+        __m512 even1 = _mm512_load_ps(biases + block + 16);
+        __m512 odd0 = _mm512_setzero_ps();
+        __m512 odd1 = _mm512_setzero_ps();
+
+        const float* row = weights + block;
+
+        size_t input_index = 0;
+
+        for (; input_index + 1 < input_length; input_index += 2, row += 2 * stride)
+        {
+            const __m512 x_even = _mm512_set1_ps(input[input_index]);
+            const __m512 x_odd = _mm512_set1_ps(input[input_index + 1]);
+
+            even0 = _mm512_fmadd_ps(x_even, _mm512_load_ps(row), even0);
+            even1 = _mm512_fmadd_ps(x_even, _mm512_load_ps(row + 16), even1);
+            odd0 = _mm512_fmadd_ps(x_odd, _mm512_load_ps(row + stride), odd0);
+            odd1 = _mm512_fmadd_ps(x_odd, _mm512_load_ps(row + stride + 16), odd1);
+        }
+
+        if (input_index < input_length)
+        {
+            const __m512 x = _mm512_set1_ps(input[input_index]);
+
+            even0 = _mm512_fmadd_ps(x, _mm512_load_ps(row), even0);
+            even1 = _mm512_fmadd_ps(x, _mm512_load_ps(row + 16), even1);
+        }
+
+        __m512 sum0 = _mm512_add_ps(even0, odd0);
+        __m512 sum1 = _mm512_add_ps(even1, odd1);
+
+        sum0 = _mm512_max_ps(sum0, _mm512_mul_ps(sum0, slopes));
+        sum1 = _mm512_max_ps(sum1, _mm512_mul_ps(sum1, slopes));
+
+        //the padding is only written if it is part of the output
+        const size_t valid = std::min<size_t>(output_length - std::min(output_length, block), 32);
+
+        _mm512_mask_storeu_ps(output + block, __mmask16(valid >= 16 ? 0xFFFF : (1U << valid) - 1), sum0);
+        _mm512_mask_storeu_ps(output + block + 16, __mmask16(valid >= 32 ? 0xFFFF : valid <= 16 ? 0 : (1U << (valid - 16)) - 1), sum1);
+    }
+
+    if (block < stride)
+    {
+        __m512 even = _mm512_load_ps(biases + block);
+        __m512 odd = _mm512_setzero_ps();
+
+        const float* row = weights + block;
+
+        size_t input_index = 0;
+
+        for (; input_index + 1 < input_length; input_index += 2, row += 2 * stride)
+        {
+            even = _mm512_fmadd_ps(_mm512_set1_ps(input[input_index]), _mm512_load_ps(row), even);
+            odd = _mm512_fmadd_ps(_mm512_set1_ps(input[input_index + 1]), _mm512_load_ps(row + stride), odd);
+        }
+
+        if (input_index < input_length) even = _mm512_fmadd_ps(_mm512_set1_ps(input[input_index]), _mm512_load_ps(row), even);
+
+        __m512 sum = _mm512_add_ps(even, odd);
+
+        sum = _mm512_max_ps(sum, _mm512_mul_ps(sum, slopes));
+
+        const size_t valid = output_length - block;
+
+        _mm512_mask_storeu_ps(output + block, __mmask16(valid >= 16 ? 0xFFFF : (1U << valid) - 1), sum);
+    }
+}
+
+//four inputs and 16 outputs at a time in four registers - the other inputs go through the single kernel
+__attribute__((target("avx512f")))
+void avx512DenseBatchKernel(const float* weights, const float* biases, const float* inputs, float* outputs, const size_t rows, const size_t input_length,
+    const size_t output_length, const float slope, const size_t bias_stride)
+{
+    const size_t stride = paddedLength(output_length);
+    const __m512 slopes = _mm512_set1_ps(slope);
+
+    size_t row = 0;
+
+    for (; row + 4 <= rows; row += 4)
+    {
+        const float* input = inputs + row * input_length;
+        float* output = outputs + row * output_length;
+
+        for (size_t block = 0; block < output_length; block += 16)
+        {
+            const float* row_biases = biases + row * bias_stride + block;
+
+            __m512 sum0 = _mm512_load_ps(row_biases);
+            __m512 sum1 = _mm512_load_ps(row_biases + bias_stride);
+            __m512 sum2 = _mm512_load_ps(row_biases + 2 * bias_stride);
+            __m512 sum3 = _mm512_load_ps(row_biases + 3 * bias_stride);
+
+            const float* weight_row = weights + block;
+
+            for (size_t input_index = 0; input_index < input_length; input_index++, weight_row += stride)
+            {
+                const __m512 row_weights = _mm512_load_ps(weight_row);
+
+                sum0 = _mm512_fmadd_ps(_mm512_set1_ps(input[input_index]), row_weights, sum0);
+                sum1 = _mm512_fmadd_ps(_mm512_set1_ps(input[input_length + input_index]), row_weights, sum1);
+                sum2 = _mm512_fmadd_ps(_mm512_set1_ps(input[2 * input_length + input_index]), row_weights, sum2);
+                sum3 = _mm512_fmadd_ps(_mm512_set1_ps(input[3 * input_length + input_index]), row_weights, sum3);
+            }
+
+            const size_t valid = std::min<size_t>(output_length - block, 16);
+            const __mmask16 mask = __mmask16(valid == 16 ? 0xFFFF : (1U << valid) - 1);
+
+            _mm512_mask_storeu_ps(output + block, mask, _mm512_max_ps(sum0, _mm512_mul_ps(sum0, slopes)));
+            _mm512_mask_storeu_ps(output + output_length + block, mask, _mm512_max_ps(sum1, _mm512_mul_ps(sum1, slopes)));
+            _mm512_mask_storeu_ps(output + 2 * output_length + block, mask, _mm512_max_ps(sum2, _mm512_mul_ps(sum2, slopes)));
+            _mm512_mask_storeu_ps(output + 3 * output_length + block, mask, _mm512_max_ps(sum3, _mm512_mul_ps(sum3, slopes)));
+        }
+    }
+
+    for (; row < rows; row++) avx512DenseKernel(weights, biases + row * bias_stride, inputs + row * input_length, outputs + row * output_length, input_length, output_length, slope);
+}
+
+//the logarithm of the portable kernel on 8 floats
+__attribute__((target("avx2,fma")))
+inline __m256 avx2Log(const __m256 x)
+{
+    const __m256i bits = _mm256_castps_si256(x);
+    const __m256i exponent = _mm256_srai_epi32(_mm256_sub_epi32(bits, _mm256_set1_epi32(sqrt_half_bits)), 23);
+
+    const __m256 k = _mm256_cvtepi32_ps(exponent);
+    const __m256 z = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_sub_epi32(bits, _mm256_slli_epi32(exponent, 23))), _mm256_set1_ps(1.0F));
+    const __m256 z2 = _mm256_mul_ps(z, z);
+
+    __m256 polynomial = _mm256_set1_ps(log_polynomial[0]);
+
+    for (int i = 1; i < 9; i++) polynomial = _mm256_fmadd_ps(polynomial, z, _mm256_set1_ps(log_polynomial[i]));
+
+    __m256 y = _mm256_mul_ps(_mm256_mul_ps(polynomial, z), z2);
+
+    y = _mm256_fmadd_ps(k, _mm256_set1_ps(ln2_low), y);
+    y = _mm256_fmadd_ps(z2, _mm256_set1_ps(-0.5F), y);
+
+    const __m256 logarithm = _mm256_fmadd_ps(k, _mm256_set1_ps(ln2_high), _mm256_add_ps(z, y));
+
+    return _mm256_blendv_ps(_mm256_set1_ps(std::numeric_limits<float>::quiet_NaN()), logarithm, _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ));
+}
+
+//the features in two registers - the blends keep the features that are not log transformed
+__attribute__((target("avx2,fma")))
+void avx2NormalizeKernel(const float* features, const float* means, const float* inverse_stds, float* inputs)
+{
+    const __m256 offset = _mm256_set1_ps(1e-9F);
+
+    const __m256 x0 = _mm256_loadu_ps(features);
+    const __m256 x1 = _mm256_loadu_ps(features + 8);
+
+    const __m256 transformed0 = _mm256_blend_ps(x0, avx2Log(_mm256_add_ps(x0, offset)), log_transformed_features & 0xFF);
+    const __m256 transformed1 = _mm256_blend_ps(x1, avx2Log(_mm256_add_ps(x1, offset)), log_transformed_features >> 8 & 0xFF);
+
+    _mm256_storeu_ps(inputs, _mm256_mul_ps(_mm256_sub_ps(transformed0, _mm256_loadu_ps(means)), _mm256_loadu_ps(inverse_stds)));
+    _mm256_storeu_ps(inputs + 8, _mm256_mul_ps(_mm256_sub_ps(transformed1, _mm256_loadu_ps(means + 8)), _mm256_loadu_ps(inverse_stds + 8)));
+}
+
+//the logarithm of the portable kernel on 16 floats
+__attribute__((target("avx512f")))
+inline __m512 avx512Log(const __m512 x)
+{
+    const __m512i bits = _mm512_castps_si512(x);
+    const __m512i exponent = _mm512_srai_epi32(_mm512_sub_epi32(bits, _mm512_set1_epi32(sqrt_half_bits)), 23);
+
+    const __m512 k = _mm512_cvtepi32_ps(exponent);
+    const __m512 z = _mm512_sub_ps(_mm512_castsi512_ps(_mm512_sub_epi32(bits, _mm512_slli_epi32(exponent, 23))), _mm512_set1_ps(1.0F));
+    const __m512 z2 = _mm512_mul_ps(z, z);
+
+    __m512 polynomial = _mm512_set1_ps(log_polynomial[0]);
+
+    for (int i = 1; i < 9; i++) polynomial = _mm512_fmadd_ps(polynomial, z, _mm512_set1_ps(log_polynomial[i]));
+
+    __m512 y = _mm512_mul_ps(_mm512_mul_ps(polynomial, z), z2);
+
+    y = _mm512_fmadd_ps(k, _mm512_set1_ps(ln2_low), y);
+    y = _mm512_fmadd_ps(z2, _mm512_set1_ps(-0.5F), y);
+
+    const __m512 logarithm = _mm512_fmadd_ps(k, _mm512_set1_ps(ln2_high), _mm512_add_ps(z, y));
+
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ), _mm512_set1_ps(std::numeric_limits<float>::quiet_NaN()), logarithm);
+}
+
+//all the features in one register
+__attribute__((target("avx512f")))
+void avx512NormalizeKernel(const float* features, const float* means, const float* inverse_stds, float* inputs)
+{
+    const __m512 x = _mm512_loadu_ps(features);
+    const __m512 transformed = _mm512_mask_blend_ps(__mmask16(log_transformed_features), x, avx512Log(_mm512_add_ps(x, _mm512_set1_ps(1e-9F))));
+
+    _mm512_storeu_ps(inputs, _mm512_mul_ps(_mm512_sub_ps(transformed, _mm512_loadu_ps(means)), _mm512_loadu_ps(inverse_stds)));
+}
+
+//the four quantized inputs from input_index in every 32 bit element
+__attribute__((target("avx512f")))
+inline __m512i broadcastGroup(const __m512i* quantized, const size_t input_index)
+{
+    return _mm512_permutexvar_epi32(_mm512_set1_epi32(static_cast<int>(input_index % 16 / 4)), quantized[input_index / 16]);
+}
+
+//16 outputs and four inputs per instruction - the quantized inputs stay in registers (16 bytes per register) and each group of four is ...
+//... broadcast from them, and the even and odd groups are summed separately so two dot products are independent of each other
+__attribute__((target("avx512f,avx512vnni")))
+void vnniQuantizedKernel(const int8_t* weights, const int32_t* corrections, const float* scales, const float* biases, const float* input, float* output,
+    const size_t input_length, const size_t output_length, const float inverse_input_scale, const float zero_point, const float slope, const float* residual)
+{
+    const size_t stride = paddedLength(output_length) * 4;
+
+    alignas(64) __m512i quantized[max_quantized_input_length / 16];
+
+    const __m512 inverse_scale = _mm512_set1_ps(inverse_input_scale);
+    const __m512 zero_points = _mm512_set1_ps(zero_point);
+
+    //the rounded inputs are clamped at 0 and the conversion to bytes saturates them at 255 - the inputs past the end of the layer are 0 (their weights are 0 too)
+    for (size_t i = 0; i < input_length; i += 16)
+    {
+        const size_t valid = std::min<size_t>(input_length - i, 16);
+        const __mmask16 mask = __mmask16(valid == 16 ? 0xFFFF : (1U << valid) - 1);
+
+        const __m512 x = valid == 16 ? _mm512_loadu_ps(input + i) : _mm512_maskz_loadu_ps(mask, input + i);
+        const __m512i rounded = _mm512_max_epi32(_mm512_maskz_cvtps_epi32(mask, _mm512_fmadd_ps(x, inverse_scale, zero_points)), _mm512_setzero_si512());
+
+        quantized[i / 16] = _mm512_castsi128_si512(_mm512_cvtusepi32_epi8(rounded));
+    }
+
+    const __m512 slopes = _mm512_set1_ps(slope);
+
+    for (size_t block = 0; block < output_length; block += 16)
+    {
+        __m512i even = _mm512_load_si512(corrections + block);
+        __m512i odd = _mm512_setzero_si512();
+
+        const int8_t* group_weights = weights + block * 4;
+
+        size_t input_index = 0;
+
+        for (; input_index + 4 < input_length; input_index += 8, group_weights += 2 * stride)
+        {
+            even = _mm512_dpbusd_epi32(even, broadcastGroup(quantized, input_index), _mm512_load_si512(group_weights));
+            odd = _mm512_dpbusd_epi32(odd, broadcastGroup(quantized, input_index + 4), _mm512_load_si512(group_weights + stride));
+        }
+
+        if (input_index < input_length) even = _mm512_dpbusd_epi32(even, broadcastGroup(quantized, input_index), _mm512_load_si512(group_weights));
+
+        __m512 y = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_add_epi32(even, odd)), _mm512_load_ps(scales + block), _mm512_load_ps(biases + block));
+
+        y = _mm512_max_ps(y, _mm512_mul_ps(y, slopes));
+
+        //whole blocks are stored without a mask so the next layer's loads of them can be forwarded from the store
+        const size_t valid = std::min<size_t>(output_length - block, 16);
+
+        if (valid == 16)
+        {
+            if (residual) y = _mm512_add_ps(y, _mm512_loadu_ps(residual + block));
+
+            _mm512_storeu_ps(output + block, y);
+        }
+        else
+        {
+            const __mmask16 mask = __mmask16((1U << valid) - 1);
+
+            if (residual) y = _mm512_add_ps(y, _mm512_maskz_loadu_ps(mask, residual + block));
+
+            _mm512_mask_storeu_ps(output + block, mask, y);
+        }
+    }
+}
+
+#endif
+
+const denseKernels portable_kernels = { "portable", portableDenseKernel, portableDenseBatchKernel, portableNormalizeKernel };
+
+#ifdef USE_SIMD_KERNELS
+const denseKernels avx2_kernels = { "avx2", avx2DenseKernel, avx2DenseBatchKernel, avx2NormalizeKernel };
+const denseKernels avx512_kernels = { "avx512", avx512DenseKernel, avx512DenseBatchKernel, avx512NormalizeKernel };
+#endif
+
+denseKernels chooseDenseKernels()
+{
+#ifdef USE_SIMD_KERNELS
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")) return avx512_kernels;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return avx2_kernels;
+#endif
+
+    return portable_kernels;
+}
+
+denseKernels dense_kernels = chooseDenseKernels();
+
+const quantizedKernel portable_quantized_kernel = { "portable", portableQuantizedKernel };
+
+#ifdef USE_SIMD_KERNELS
+const quantizedKernel vnni_quantized_kernel = { "vnni", vnniQuantizedKernel };
+#endif
+
+quantizedKernel chooseQuantizedKernel()
+{
+#ifdef USE_SIMD_KERNELS
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vnni")) return vnni_quantized_kernel;
+#endif
+
+    return portable_quantized_kernel;
+}
+
+quantizedKernel quantized_kernel = chooseQuantizedKernel();
 
 void appendWeights(const std::string& weight_string, layerWeightContainer& layer_weights)
 {
@@ -59,6 +665,7 @@ void assignScale(const feature& current_feature, auto& min_bound, auto& max_boun
 
     model.means[index] = current_feature.mean;
     model.stds[index] = current_feature.std;
+    model.inverse_stds[index] = 1.0F / current_feature.std;
 }
 
 void assignLogScale(const feature& current_feature, auto& min_bound, auto& max_bound, const size_t index, MLModel& model)
@@ -70,6 +677,7 @@ void assignLogScale(const feature& current_feature, auto& min_bound, auto& max_b
 
     model.means[index] = current_feature.mean;
     model.stds[index] = current_feature.std;
+    model.inverse_stds[index] = 1.0F / current_feature.std;
 }
 
 void setInputScale(const feature& current_feature, MLModel& model)
@@ -114,6 +722,71 @@ void setInputScale(const feature& current_feature, MLModel& model)
     else throw exceptions::exception("Received an unknown input parameter.");
 }
 
+struct calibrationRow
+{
+    std::string set;
+    std::array<float, normalized_length> inputs = {};
+    std::array<float, normalized_length> features = {}; //golden rows only
+    std::array<float, 3> probabilities = {}; //golden rows only
+
+    size_t input_count = 0;
+    size_t feature_count = 0;
+    size_t probability_count = 0;
+    int transition = 0;
+};
+
+//the comma separated floats of a json array - returns their number
+template<size_t length>
+size_t readFloats(const std::string& value, std::array<float, length>& floats)
+{
+    std::string current_float;
+    size_t count = 0;
+
+    for (const char c : value + ',')
+    {
+        if (c == ',')
+        {
+            if (count == length) throw exceptions::exception("Received a calibration row with too many values.");
+
+            floats[count++] = std::stof(current_float);
+            current_float.clear();
+        }
+        else if (c != ' ') current_float += c;
+    }
+
+    return count;
+}
+
+void loadCalibrationRow(calibrationRow& row, const std::string& key, const std::string& value)
+{
+    if (key == "set") row.set = value;
+    else if (key == "transition") row.transition = std::stoi(value);
+    else if (key == "inputs") row.input_count = readFloats(value, row.inputs);
+    else if (key == "features") row.feature_count = readFloats(value, row.features);
+    else if (key == "probabilities") row.probability_count = readFloats(value, row.probabilities);
+}
+
+void appendCalibrationRow(const calibrationRow& row, calibrationSet& calibration)
+{
+    if (row.input_count != normalized_length) throw exceptions::exception("Received a calibration input with too few features.");
+
+    if (row.set == "calibration") calibration.calibration_inputs.push_back(row.inputs);
+    else if (row.set == "holdout")
+    {
+        calibration.holdout_inputs.push_back(row.inputs);
+        calibration.holdout_transitions.push_back(row.transition);
+    }
+    else if (row.set == "golden")
+    {
+        if (row.feature_count != normalized_length || row.probability_count != 3) throw exceptions::exception("Received an incomplete golden vector.");
+
+        calibration.golden_inputs.push_back(row.inputs);
+        calibration.golden_features.push_back(row.features);
+        calibration.golden_probabilities.push_back(row.probabilities);
+    }
+    else throw exceptions::exception("Received an unknown calibration set.");
+}
+
 void loadInputScale(feature& current_feature, const std::string& key, const std::string& value)
 {
     if (key == "feature name") current_feature.name = value;
@@ -124,7 +797,7 @@ void loadInputScale(feature& current_feature, const std::string& key, const std:
 MLModel::MLModel() {}
 MLModel::~MLModel() {}
 
-void MLModel::loadWeights(const std::string& file_path)
+weightContainer readWeights(const std::string& file_path)
 {
     std::ifstream file(file_path); //input file stream
 
@@ -142,15 +815,66 @@ void MLModel::loadWeights(const std::string& file_path)
 
     layerParser.parseJSONArray(content, model_weights);
 
-    if (model_weights.size() != 7) throw exceptions::exception("Received an unexpected number of layers.");
+    if (model_weights.size() != modelTopology::layer_count) throw exceptions::exception("Received an unexpected number of layers.");
 
-    neural_net.layer0.setWeights(model_weights[0][0], model_weights[0][1]);
-    neural_net.layer1.setWeights(model_weights[1][0], model_weights[1][1]);
-    neural_net.layer2.setWeights(model_weights[2][0], model_weights[2][1]);
-    neural_net.layer3.setWeights(model_weights[3][0], model_weights[3][1]);
-    neural_net.layer4.setWeights(model_weights[4][0], model_weights[4][1]);
-    neural_net.layer5.setWeights(model_weights[5][0], model_weights[5][1]);
-    neural_net.layer6.setWeights(model_weights[6][0], model_weights[6][1]);
+    return model_weights;
+}
+
+void MLModel::loadWeights(const std::string& file_path)
+{
+    weightContainer model_weights = readWeights(file_path);
+
+    neural_net.setWeights(model_weights);
+
+    splitFirstLayer();
+}
+
+void MLModel::splitFirstLayer()
+{
+    const auto& first_layer = neural_net.layer<0>();
+    const size_t stride = paddedLength(first_layer_length);
+
+    size_t daily_row = 0, intraday_row = 0;
+
+    for (size_t feature_index = 0; feature_index < input_length; feature_index++)
+    {
+        float* row = (daily_features >> feature_index) & 1 ? daily_weights + stride * daily_row++ : intraday_weights + stride * intraday_row++;
+
+        for (size_t output_index = 0; output_index < first_layer_length; output_index++) row[output_index] = first_layer.weight(feature_index, output_index);
+    }
+
+    for (size_t output_index = 0; output_index < first_layer_length; output_index++) first_layer_biases[output_index] = first_layer.bias(output_index);
+}
+
+calibrationSet readCalibration(const std::string& file_path)
+{
+    std::ifstream file(file_path); //input file stream
+
+    if (!file.is_open()) throw exceptions::exception("Failed open the file : " + file_path);
+
+    std::string line;
+    std::string content; //write the json here
+
+    while (std::getline(file, line)) content += line;
+
+    file.close();
+
+    JSONArrayParser<calibrationRow, calibrationSet, loadCalibrationRow, appendCalibrationRow> rowParser;
+    calibrationSet calibration;
+
+    rowParser.parseJSONArray(content, calibration);
+
+    return calibration;
+}
+
+void MLModel::loadCalibration(const std::string& file_path)
+{
+    const calibrationSet calibration = readCalibration(file_path);
+
+    if (calibration.calibration_inputs.empty()) throw exceptions::exception("Received no calibration inputs.");
+
+    quantized_net.quantize(neural_net, calibration.calibration_inputs);
+    quantized = true;
 }
 
 void MLModel::loadScales(const std::string& file_path)
@@ -171,27 +895,378 @@ void MLModel::loadScales(const std::string& file_path)
     layerParser.parseJSONArray(content, *this);
 }
 
+//every field of the inlier ranges in the order they are written to the model file - one at a time so the file does not depend on the padding of inlierRanges
+template<typename rangesType, typename function>
+constexpr void forEachRange(rangesType& ranges, function&& field)
+{
+    field(ranges.rolling_period);
+    field(ranges.rolling_period_min_trades);
+    field(ranges.rolling_period_max_trades);
+    field(ranges.rolling_volume_min);
+    field(ranges.rolling_volume_max);
+    field(ranges.lookback_period);
+    field(ranges.std_max);
+    field(ranges.number_of_bins);
+    field(ranges.min_completed_trading_days);
+    field(ranges.average_volume_period);
+    field(ranges.min_previous_days_closing_price);
+    field(ranges.max_previous_days_closing_price);
+    field(ranges.min_average_volume);
+    field(ranges.max_average_volume);
+    field(ranges.min_mean);
+    field(ranges.max_mean);
+    field(ranges.min_std);
+    field(ranges.max_std);
+    field(ranges.min_lambda);
+    field(ranges.max_lambda);
+    field(ranges.min_dp);
+    field(ranges.max_dp);
+    field(ranges.min_dt);
+    field(ranges.max_dt);
+    field(ranges.min_n);
+    field(ranges.max_n);
+    field(ranges.min_vsum);
+    field(ranges.max_vsum);
+    field(ranges.min_rvol);
+    field(ranges.max_rvol);
+    field(ranges.min_time_of_day);
+    field(ranges.max_time_of_day);
+    field(ranges.min_pmdx);
+    field(ranges.max_pmdx);
+    field(ranges.min_ppdx);
+    field(ranges.max_ppdx);
+    field(ranges.min_size);
+    field(ranges.max_size);
+}
+
+constexpr size_t rangesFileSize()
+{
+    inlierRanges ranges;
+    size_t size = 0;
+
+    forEachRange(ranges, [&](const auto& value) { size += sizeof(value); });
+
+    return size;
+}
+
+//the packed layers, the means, stds, and inverse stds of the features, and the inlier ranges
+const size_t model_payload_size = sizeof(float) * (simpleNeuralNet<modelTopology>::packed_length + 3 * normalized_length) + rangesFileSize();
+
+static_assert(sizeof(inlierRanges) == 256, "The inlier ranges changed - add the new fields to forEachRange and increment model_file_version.");
+
+template<size_t... i>
+uint64_t topologyChecksum(std::index_sequence<i...>)
+{
+    const int64_t layers[][3] = { { int64_t(modelTopology::layerInputLength<i>()), int64_t(modelTopology::layer<i>::output_length), modelTopology::layer<i>::skip_layer }... };
+
+    return fnv1a(layers, sizeof(layers), fnv1a(&model_file_version, sizeof(model_file_version)));
+}
+
+bool MLModel::loadModelFile(const std::string& file_path)
+{
+    mappedFile file;
+
+    if (!file.open(file_path)) return false;
+    if (file.size() < sizeof(modelFileHeader)) return false;
+
+    const modelFileHeader* header = reinterpret_cast<const modelFileHeader*>(file.data());
+
+    if (std::memcmp(header->magic, model_file_magic, sizeof(model_file_magic))) return false;
+    if (header->version != model_file_version) return false;
+    if (header->layer_count != modelTopology::layer_count) return false;
+    if (header->topology_checksum != topologyChecksum(std::make_index_sequence<modelTopology::layer_count>())) return false;
+    if (header->payload_size != model_payload_size || file.size() != sizeof(modelFileHeader) + model_payload_size) return false;
+
+    const char* payload = file.data() + sizeof(modelFileHeader);
+
+    if (fnv1a(payload, model_payload_size) != header->payload_checksum) return false;
+
+    const float* packed = reinterpret_cast<const float*>(payload);
+
+    neural_net.unpack(packed);
+    packed += neural_net.packed_length;
+
+    std::copy(packed, packed + input_length, means);
+    std::copy(packed + input_length, packed + 2 * input_length, stds);
+    std::copy(packed + 2 * input_length, packed + 3 * input_length, inverse_stds);
+
+    const char* ranges_data = reinterpret_cast<const char*>(packed + 3 * input_length);
+
+    forEachRange(ranges, [&](auto& value)
+    {
+        std::memcpy(&value, ranges_data, sizeof(value));
+        ranges_data += sizeof(value);
+    });
+
+    splitFirstLayer();
+
+    return true;
+}
+
+void MLModel::saveModelFile(const std::string& file_path) const
+{
+    std::vector<char> payload(model_payload_size);
+    std::vector<float> packed(neural_net.packed_length + 3 * input_length);
+
+    neural_net.pack(packed.data());
+
+    std::copy(means, means + input_length, packed.begin() + neural_net.packed_length);
+    std::copy(stds, stds + input_length, packed.begin() + neural_net.packed_length + input_length);
+    std::copy(inverse_stds, inverse_stds + input_length, packed.begin() + neural_net.packed_length + 2 * input_length);
+
+    std::memcpy(payload.data(), packed.data(), packed.size() * sizeof(float));
+    char* ranges_data = payload.data() + packed.size() * sizeof(float);
+
+    forEachRange(ranges, [&](const auto& value)
+    {
+        std::memcpy(ranges_data, &value, sizeof(value));
+        ranges_data += sizeof(value);
+    });
+
+    modelFileHeader header;
+
+    std::memcpy(header.magic, model_file_magic, sizeof(model_file_magic));
+
+    header.layer_count = modelTopology::layer_count;
+    header.topology_checksum = topologyChecksum(std::make_index_sequence<modelTopology::layer_count>());
+    header.payload_size = model_payload_size;
+    header.payload_checksum = fnv1a(payload.data(), payload.size());
+
+    //write to a temporary file first so the bot never maps a partially written model
+    const std::string temporary_path = file_path + ".tmp";
+
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open()) throw exceptions::exception("Failed to open the file : " + temporary_path);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(payload.data(), payload.size());
+    file.close();
+
+    if (!file) throw exceptions::exception("Failed to write the file : " + temporary_path);
+
+    std::remove(file_path.c_str()); //rename does not overwrite existing files on Windows
+
+    if (std::rename(temporary_path.c_str(), file_path.c_str())) throw exceptions::exception("Failed to replace the file : " + file_path);
+}
+
+void MLModel::saveModelHeader(const std::string& file_path) const
+{
+    std::vector<float> packed(neural_net.packed_length);
+
+    neural_net.pack(packed.data());
+
+    std::ofstream file(file_path, std::ios::trunc);
+
+    if (!file.is_open()) throw exceptions::exception("Failed to open the file : " + file_path);
+
+    //hexadecimal literals so every float is written exactly
+    auto writeArray = [&](const char* name, const float* values, const size_t count)
+    {
+        file << "alignas(64) constexpr float " << name << "[" << std::dec << count << "] = {" << std::hexfloat;
+
+        for (size_t i = 0; i < count; i++) file << (i % 8 ? " " : "\n    ") << values[i] << (i + 1 < count ? "," : "");
+
+        file << "\n};\n\n" << std::defaultfloat;
+    };
+
+    file << "//written by model_converter - the packed layers of modelTopology and the scales of its features (see constantModelUtils.h)\n\n";
+    file << "#include <cstddef>\n\n";
+    file << "const size_t constant_model_packed_length = " << packed.size() << ";\n\n";
+
+    writeArray("constant_model_weights", packed.data(), packed.size());
+    writeArray("constant_model_means", means, input_length);
+    writeArray("constant_model_stds", stds, input_length);
+    writeArray("constant_model_inverse_stds", inverse_stds, input_length);
+
+    file.close();
+
+    if (!file) throw exceptions::exception("Failed to write the file : " + file_path);
+}
+
+#ifdef USE_CONSTANT_MODEL
+bool MLModel::useConstantModel()
+{
+    bool same_scales = true;
+
+    for (size_t i = 0; i < input_length; i++)
+    {
+        same_scales = same_scales && constant_model_means[i] == means[i] && constant_model_stds[i] == stds[i] && constant_model_inverse_stds[i] == inverse_stds[i];
+    }
+
+    std::copy(std::begin(constant_model_means), std::end(constant_model_means), means);
+    std::copy(std::begin(constant_model_stds), std::end(constant_model_stds), stds);
+    std::copy(std::begin(constant_model_inverse_stds), std::end(constant_model_inverse_stds), inverse_stds);
+
+    constant = true;
+    quantized = false;
+
+    return same_scales;
+}
+#endif
+
 float MLModel::predict(float time_of_day, float relative_volume, float n, float mean, float dp, float std, float dt, float vsum, float average_volume,
     float previous_days_close, float rolling_csum, float rolling_vsum, float pmdx, float size, float ppdx, float lambda)
 {
-    input[0] = (time_of_day - means[0]) / stds[0]; //time of day
-    input[1] = (std::log(1e-9 + relative_volume) - means[1]) / stds[1]; //relative volume
-    input[2] = (n - means[2]) / stds[2]; //n
-    input[3] = (std::log(1e-9 + mean) - means[3]) / stds[3]; //mean
-    input[4] = (std::log(1e-9 + dp) - means[4]) / stds[4]; //dp
-    input[5] = (std::log(1e-9 + std) - means[5]) / stds[5]; //std
-    input[6] = (std::log(1e-9 + dt) - means[6]) / stds[6]; //dt
-    input[7] = (std::log(1e-9 + vsum) - means[7]) / stds[7]; //vsum
-    input[8] = (std::log(1e-9 + average_volume) - means[8]) / stds[8]; //average_volume
-    input[9] = (std::log(1e-9 + previous_days_close) - means[9]) / stds[9]; //previous_days_close
-    input[10] = (std::log(1e-9 + rolling_csum) - means[10]) / stds[10]; //rolling_csum
-    input[11] = (std::log(1e-9 + rolling_vsum) - means[11]) / stds[11]; //rolling_vsum
-    input[12] = (std::log(1e-9 + pmdx) - means[12]) / stds[12]; //p(-dx)
-    input[13] = (std::log(1e-9 + size) - means[13]) / stds[13]; //size
-    input[14] = (std::log(1e-9 + ppdx) - means[14]) / stds[14]; //p(+dx)
-    input[15] = (std::log(1e-9 + lambda) - means[15]) / stds[15]; //lambda
-
-    neural_net(input);
-
-    return neural_net.output[2]; //first, second, and third elements are the probabilities of -1, 0, and +1 transitions respectively
+    const float features[input_length] = { time_of_day, relative_volume, n, mean, dp, std, dt, vsum, average_volume, previous_days_close, rolling_csum, rolling_vsum,
+        pmdx, size, ppdx, lambda };
+
+    return predict(features);
+}
+
+float MLModel::predict(const float(&features)[input_length])
+{
+    normalize(features, input);
+
+#ifdef USE_CONSTANT_MODEL
+    if (constant)
+    {
+        constantLogits(constant_net, input);
+
+        return positiveTransitionProbability(constant_net.outputLayer().output);
+    }
+#endif
+
+    //the logits are those of -1, 0, and +1 transitions
+    if (quantized)
+    {
+        quantized_net.logits(input);
+
+        return positiveTransitionProbability(quantized_net.outputLayer().output);
+    }
+
+    neural_net.logits(input);
+
+    return positiveTransitionProbability(neural_net.outputLayer().output);
+}
+
+void MLModel::predict(const float(*features)[input_length], float* probabilities, const size_t count)
+{
+    //the quantized network and the network compiled in have no batch kernel
+    if (quantized || constant)
+    {
+        for (size_t i = 0; i < count; i++) probabilities[i] = predict(features[i]);
+
+        return;
+    }
+
+    for (size_t first = 0; first < count; first += max_batch_size)
+    {
+        const size_t rows = std::min(count - first, max_batch_size);
+
+        for (size_t row = 0; row < rows; row++) normalize(features[first + row], batch_input[row]);
+
+        neural_net(batch_input, rows);
+
+        for (size_t row = 0; row < rows; row++) probabilities[first + row] = positiveTransitionProbability(neural_net.outputLayer().batch_output[row]);
+    }
+}
+
+//indices of the features whose bit is set (or not set) in a mask, in order
+template<size_t count>
+constexpr std::array<uint8_t, count> featureIndices(const unsigned mask, const bool set)
+{
+    std::array<uint8_t, count> indices = {};
+
+    size_t i = 0;
+
+    for (unsigned feature_index = 0; feature_index < normalized_length; feature_index++)
+    {
+        if (((mask >> feature_index) & 1) == set) indices[i++] = static_cast<uint8_t>(feature_index);
+    }
+
+    return indices;
+}
+
+constexpr std::array<uint8_t, daily_feature_count> daily_indices = featureIndices<daily_feature_count>(daily_features, true);
+constexpr std::array<uint8_t, intraday_feature_count> intraday_indices = featureIndices<intraday_feature_count>(daily_features, false);
+
+//the normalized inputs of the features that change during the day - a fixed list of copies
+inline void gatherIntradayInputs(const float(&normalized)[normalized_length], float(&intraday)[intraday_feature_count])
+{
+    for (size_t i = 0; i < intraday_feature_count; i++) intraday[i] = normalized[intraday_indices[i]];
+}
+
+//the normalized inputs with the daily inputs of a symbol put back in their places
+inline void scatterDailyInputs(const dailyInputs& daily, float(&normalized)[normalized_length])
+{
+    for (size_t i = 0; i < daily_feature_count; i++) normalized[daily_indices[i]] = daily.inputs[i];
+}
+
+void MLModel::precompute(dailyInputs& daily, float mean, float std, float average_volume, float previous_days_close, float pmdx, float ppdx, float lambda) const
+{
+    //the other features are placeholders that are not used
+    const float features[input_length] = { 1.0F, 1.0F, 1.0F, mean, 1.0F, std, 1.0F, 1.0F, average_volume, previous_days_close, 1.0F, 1.0F, pmdx, 1.0F, ppdx, lambda };
+
+    alignas(64) float normalized[input_length];
+
+    normalize(features, normalized);
+
+    for (size_t i = 0; i < daily_feature_count; i++) daily.inputs[i] = normalized[daily_indices[i]];
+
+    //no activation function - the rest of the first layer is added to the pre-activation first
+    dense_kernels.single(daily_weights, first_layer_biases, daily.inputs, daily.pre_activation, daily_feature_count, first_layer_length, 1.0F);
+}
+
+float MLModel::predict(const dailyInputs& daily, const float(&features)[input_length])
+{
+    normalize(features, input);
+
+    if (quantized)
+    {
+        scatterDailyInputs(daily, input);
+
+        quantized_net.logits(input);
+
+        return positiveTransitionProbability(quantized_net.outputLayer().output);
+    }
+
+    gatherIntradayInputs(input, intraday_input);
+
+    auto& first_layer = neural_net.layer<0>();
+
+    //the pre-activation of the daily features takes the place of the biases
+    dense_kernels.single(intraday_weights, daily.pre_activation, intraday_input, first_layer.output, intraday_feature_count, first_layer_length, first_layer.slope);
+
+    neural_net.logitsAfter<0>();
+
+    return positiveTransitionProbability(neural_net.outputLayer().output);
+}
+
+void MLModel::predict(const dailyInputs* const* daily, const float(*features)[input_length], float* probabilities, const size_t count)
+{
+    if (quantized)
+    {
+        for (size_t i = 0; i < count; i++) probabilities[i] = predict(*daily[i], features[i]);
+
+        return;
+    }
+
+    auto& first_layer = neural_net.layer<0>();
+
+    for (size_t first = 0; first < count; first += max_batch_size)
+    {
+        const size_t rows = std::min(count - first, max_batch_size);
+
+        for (size_t row = 0; row < rows; row++)
+        {
+            normalize(features[first + row], batch_input[row]);
+            gatherIntradayInputs(batch_input[row], intraday_batch_input[row]);
+
+            std::memcpy(batch_pre_activations[row], daily[first + row]->pre_activation, sizeof(batch_pre_activations[row]));
+        }
+
+        //every row starts from the pre-activation of its symbol
+        dense_kernels.batch(intraday_weights, batch_pre_activations[0], intraday_batch_input[0], first_layer.batch_output[0], rows, intraday_feature_count, first_layer_length,
+            first_layer.slope, paddedLength(first_layer_length));
+
+        neural_net.logitsAfter<0>(rows);
+
+        for (size_t row = 0; row < rows; row++) probabilities[first + row] = positiveTransitionProbability(neural_net.outputLayer().batch_output[row]);
+    }
+}
+
+void MLModel::normalize(const float(&features)[input_length], float(&normalized)[input_length]) const
+{
+    dense_kernels.normalize(features, means, inverse_stds, normalized);
 }
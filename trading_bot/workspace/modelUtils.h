@@ -1,17 +1,22 @@
-
 /*
-A predictive model that consists of the following ...
-a minimalistic implementation of a MLP (feed foward neural network) that is used to predict transitions
-the outlier conditions for all the input variables
-
-model weights and min/max outlier values are saved as separate json files
-this allows the model to be periodically retrianed without having to re-build the bot
-
-include "model_weights.json" and "outlier_values.json" in the same root directory as the executable
-
-The model only uses stack memory so the architecture cannot be changed - only the weights ...
-... can be changed by retraining the model with tensorflow and saving the weights in the json ...
-... format specified in the notebook used to make the model.
+The neural network that predicts the price level transitions and the inlier ranges of its features.
+
+The weights (model_weights.json), the scales of the features and the inlier ranges (scaler_info.json) are written by
+retrain_model.py, so the model can be retrained without building the bot again. modelTopology fixes the architecture at
+compile time (the dense layers with their output lengths, activation functions, and residual connections) and
+simpleNeuralNet generates the layers and the forward pass from it - every buffer is a member of the network, which
+MLModel holds by value (the bot allocates its models once at startup, see modelHolder). CMake checks the shapes of
+model_weights.json against modelTopology (modelShapes.h).
+
+The dense layers keep their weights packed by input, each row padded to 16 floats and aligned to 64 bytes. A dense kernel
+(AVX2, AVX-512, or portable - chosen once from CPUID) adds the biases and applies the leaky relu in the same pass, and a
+kernel of the same instruction set log transforms and scales all 16 features at once. Only the logits are computed and
+predict returns the probability of a +1 transition. Built on the float network are
+    quantizedNeuralNet - 8 bit weights and activations calibrated with calibration_data.json (MLModel::loadCalibration)
+    dailyInputs - the daily features of a symbol run through their rows of the first layer once (MLModel::precompute)
+    the model file - the packed layers, scales, and inlier ranges written by model_converter and memory mapped at startup ...
+    ... (MLModel::loadModelFile) - only used if its version, topology checksum, size, and payload checksum are valid
+    the constant network - the weights compiled in with USE_CONSTANT_MODEL (see constantModelUtils.h)
 */
 
 #ifndef MODEL_UTILS_H
@@ -21,14 +26,25 @@ The model only uses stack memory so the architecture cannot be changed - only th
 #include "jsonUtils.h"
 
 #include <stdexcept>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
+#include <array>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <bit>
 #include <cmath>
+#include <cstdint>
 
 #include <random>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define USE_SIMD_KERNELS //use the AVX2 or AVX-512 dense layer kernels (and the AVX-512 VNNI quantized kernel) if the CPU supports them - comment out to always use the portable kernels
+#endif
+
 inline float godSays() //see if the bot can manage orders and positions when it randomly decides to buy & sell stocks
 {
     std::mt19937 generator(std::random_device{}());
@@ -74,117 +90,549 @@ inline void softmax(float(&output)[output_length])
     }
 }
 
+//no activation function - the outputs of the layer are the logits
+template<size_t output_length>
+inline void linear(float(&output)[output_length]) {}
+
+//the probability of a +1 transition (the third element of the softmax) from the logits of the -1, 0, and +1 transitions
+inline float positiveTransitionProbability(const float(&logits)[3])
+{
+    const float sum = 1.0F + std::exp(logits[0] - logits[2]) + std::exp(logits[1] - logits[2]);
+
+    return std::isfinite(sum) ? 1.0F / sum : 0.0F;
+}
+
+constexpr size_t paddedLength(const size_t length) { return (length + 15) & ~size_t(15); } //rows of packed weights are padded to a multiple of 16 floats (one AVX-512 register)
+
+const size_t max_batch_size = 16; //largest number of inputs a network runs at once
+
+/*
+output = max(sum, slope * sum) where sum = biases + input * weights - a slope of 0.1 is the leaky relu and a slope of 1 leaves the sums as they are
+the weights are packed by input with rows of paddedLength(output length) floats, the weights and biases are aligned to 64 bytes, and only ...
+... output length outputs are written
+a batch kernel does the same for several inputs (rows of input length floats) at once and writes rows of output length floats - the ...
+... weights loaded for one input are used for up to four of them - the biases of row r start at biases + r * bias stride (a stride of 0 ...
+... shares them, a stride of paddedLength(output length) gives every row its own aligned biases)
+*/
+/*
+inputs = (feature - mean) * inverse std where feature = ln(feature + 1e-9) if its bit is set in log_transformed_features
+the logarithm is a polynomial within ~1e-6 of std::log for features up to 1e10 (about one float epsilon of ln(1e10)) - it is NaN if feature + 1e-9 is not positive
+*/
+const size_t normalized_length = 16; //number of features of the model (MLModel::input_length)
+constexpr unsigned log_transformed_features = 0xFFFA; //all but the time of day (0) and n (2)
+
+typedef void(*normalizeKernel)(const float*, const float*, const float*, float*); //features, means, inverse stds, inputs - normalized_length of each
+
+typedef void(*denseKernel)(const float*, const float*, const float*, float*, const size_t, const size_t, const float); //weights, biases, input, output, input length, output length, slope
+typedef void(*denseBatchKernel)(const float*, const float*, const float*, float*, const size_t, const size_t, const size_t, const float, const size_t); //weights, biases, inputs, outputs, rows, input length, output length, slope, bias stride
+
+struct denseKernels //the kernels of one instruction set
+{
+    const char* name;
+
+    denseKernel single;
+    denseBatchKernel batch;
+    normalizeKernel normalize;
+};
+
+extern const denseKernels portable_kernels;
+
+#ifdef USE_SIMD_KERNELS
+extern const denseKernels avx2_kernels;
+extern const denseKernels avx512_kernels;
+#endif
+
+extern denseKernels dense_kernels; //chosen from CPUID at startup - only the model benchmark changes them
+
 template<size_t input_length, size_t output_length, void(*activation_function)(float(&output)[output_length])>
 class denseLayer
 {
 public:
     denseLayer()
     {
-        for (int i = 0; i < output_length * input_length; i++) weights[i] = 0.0F;
-        for (int i = 0; i < output_length; i++) biases[i] = 0.0F;
+        for (int i = 0; i < input_length * padded_length; i++) weights[i] = 0.0F;
+        for (int i = 0; i < padded_length; i++) biases[i] = 0.0F;
         for (int i = 0; i < output_length; i++) output[i] = 0.0F;
     }
 
     ~denseLayer() {}
 
-    float output[output_length];
+    alignas(64) float output[output_length];
 
     inline void operator()(float(&input)[input_length])
     {
         //skipped check - input.size() == input_length should be true
 
-        float sum;
+        //the leaky relu (or no activation function) is applied by the kernel - any other activation function runs on the outputs afterwards
+        if constexpr (fused_activation) dense_kernels.single(weights, biases, input, output, input_length, output_length, slope);
+        else
+        {
+            dense_kernels.single(weights, biases, input, output, input_length, output_length, 1.0F);
+
+            activation_function(output);
+        }
+    }
 
-        int input_index;
+    alignas(64) float batch_output[max_batch_size][output_length];
 
-        for (int output_index = 0; output_index < output_length; output_index++)
+    inline void operator()(float(&inputs)[max_batch_size][input_length], const size_t rows) //the first rows of inputs - the outputs are written to batch_output
+    {
+        if constexpr (fused_activation) dense_kernels.batch(weights, biases, inputs[0], batch_output[0], rows, input_length, output_length, slope, 0);
+        else
         {
-            sum = biases[output_index];
+            dense_kernels.batch(weights, biases, inputs[0], batch_output[0], rows, input_length, output_length, 1.0F, 0);
 
-            //for (input_index = 0; input_index < input_length; input_index++)  += weights[output_index * input_length + input_index] * input[input_index];
-            
-            /*
-            loop unrolling greatly reduces the number of assignment operations and loop overhead
-            doing the following instead of the commented line above reduces computation time by 50%
-            */
+            for (size_t row = 0; row < rows; row++) activation_function(batch_output[row]);
+        }
+    }
 
-            for (input_index = 0; input_index < input_length - input_length % 8; input_index += 8)
-            {
-                sum += weights[output_index + input_index * output_length] * input[input_index] \
-                    + weights[output_index + (input_index + 1) * output_length] * input[input_index + 1] \
-                    + weights[output_index + (input_index + 2) * output_length] * input[input_index + 2] \
-                    + weights[output_index + (input_index + 3) * output_length] * input[input_index + 3] \
-                    + weights[output_index + (input_index + 4) * output_length] * input[input_index + 4] \
-                    + weights[output_index + (input_index + 5) * output_length] * input[input_index + 5] \
-                    + weights[output_index + (input_index + 6) * output_length] * input[input_index + 6] \
-                    + weights[output_index + (input_index + 7) * output_length] * input[input_index + 7];
-            }
+    float weight(const size_t input_index, const size_t output_index) const { return weights[output_index + input_index * padded_length]; }
+    float bias(const size_t output_index) const { return biases[output_index]; }
 
-            for (; input_index < input_length; input_index++)
-            {
-                sum += weights[output_index + input_index * output_length] * input[input_index];
-            }
+    //the padded weights followed by the padded biases - the layout of the layer in the model file (see MLModel::saveModelFile)
+    static constexpr size_t packed_length = (input_length + 1) * paddedLength(output_length);
 
-            output[output_index] = sum;
-        }
+    void pack(float* packed) const
+    {
+        std::copy(std::begin(weights), std::end(weights), packed);
+        std::copy(std::begin(biases), std::end(biases), packed + input_length * padded_length);
+    }
 
-        activation_function(output);
+    void unpack(const float* packed)
+    {
+        std::copy(packed, packed + input_length * padded_length, weights);
+        std::copy(packed + input_length * padded_length, packed + packed_length, biases);
     }
 
+    static constexpr bool fused_activation = activation_function == leaky_relu<output_length> || activation_function == linear<output_length>;
+    static constexpr float slope = activation_function == leaky_relu<output_length> ? 0.1F : 1.0F;
+
     void setWeights(weightArray& weight_array, weightArray& bias_array)
     {
         if (weight_array.size() != input_length * output_length) throw std::runtime_error("Input and/or output dimensions do not match layer dimensions.");
         if (bias_array.size() != output_length) throw std::runtime_error("Output dimension does not match layer dimensions.");
 
-        for (int i = 0; i < input_length * output_length; i++) { weights[i] = weight_array[i]; }
+        //tensorflow saves the weights by input - weight_array[output_index + input_index * output_length]
+        for (int input_index = 0; input_index < input_length; input_index++)
+        {
+            for (int output_index = 0; output_index < output_length; output_index++)
+            {
+                weights[output_index + input_index * padded_length] = weight_array[output_index + input_index * output_length];
+            }
+        }
+
         for (int i = 0; i < output_length; i++) { biases[i] = bias_array[i]; }
     }
 
 private:
+    static constexpr size_t padded_length = paddedLength(output_length);
 
-    float weights[input_length * output_length];
-    float biases[output_length];
+    alignas(64) float weights[input_length * padded_length]; //the padding stays 0
+    alignas(64) float biases[padded_length];
+};
+
+const int no_skip = -1;
+
+//one dense layer of a topology - if skip is the index of an earlier layer, its outputs are added to the outputs of this layer after the activation function (a residual connection)
+template<size_t outputs, void(*activation)(float(&output)[outputs]), int skip = no_skip>
+struct dense
+{
+    static constexpr size_t output_length = outputs;
+    static constexpr void(*activation_function)(float(&output)[outputs]) = activation;
+    static constexpr int skip_layer = skip;
 };
 
-template<size_t input_length, size_t output_length>
+template<size_t input_length, size_t output_length, void(*activation_function)(float(&output)[output_length])>
+class quantizedDenseLayer;
+
+//the layers of a network in order - the input length of every layer is the output length of the one before it
+template<size_t inputs, class... layers>
+struct topology
+{
+    static constexpr size_t input_length = inputs;
+    static constexpr size_t layer_count = sizeof...(layers);
+
+    template<size_t i>
+    using layer = std::tuple_element_t<i, std::tuple<layers...>>;
+
+    static constexpr size_t output_length = layer<layer_count - 1>::output_length;
+
+    template<size_t i>
+    static constexpr size_t layerInputLength()
+    {
+        if constexpr (i == 0) return input_length;
+        else return layer<i - 1>::output_length;
+    }
+
+    template<size_t i>
+    using floatLayer = denseLayer<layerInputLength<i>(), layer<i>::output_length, layer<i>::activation_function>;
+
+    template<size_t i>
+    using quantizedLayer = quantizedDenseLayer<layerInputLength<i>(), layer<i>::output_length, layer<i>::activation_function>;
+
+    //true if the input and output lengths of every layer are the ones in shapes - the shapes of the weights of model_weights.json
+    template<size_t count>
+    static constexpr bool matches(const size_t(&shapes)[count][2])
+    {
+        if constexpr (count != layer_count) return false;
+        else return matchesShapes(shapes, std::make_index_sequence<layer_count>());
+    }
+
+private:
+    template<size_t... i>
+    static constexpr bool matchesShapes(const size_t(&shapes)[layer_count][2], std::index_sequence<i...>)
+    {
+        return ((shapes[i][0] == layerInputLength<i>() && shapes[i][1] == layer<i>::output_length) && ...);
+    }
+
+    template<size_t i>
+    static constexpr bool validSkip()
+    {
+        constexpr int skip = layer<i>::skip_layer;
+
+        if constexpr (skip == no_skip) return true;
+        else if constexpr (skip < 0 || skip >= static_cast<int>(i)) return false;
+        else return layer<skip>::output_length == layer<i>::output_length;
+    }
+
+    template<size_t... i>
+    static constexpr bool validSkips(std::index_sequence<i...>) { return (validSkip<i>() && ...); }
+
+    static_assert(layer_count > 0, "A topology needs at least one layer.");
+    static_assert(validSkips(std::make_index_sequence<layer_count>()), "The skip of a layer has to be an earlier layer with as many outputs.");
+};
+
+//the packed lengths of the float layers of a topology added up
+template<class net_topology, size_t... i>
+constexpr size_t packedLength(std::index_sequence<i...>) { return (size_t(0) + ... + net_topology::template floatLayer<i>::packed_length); }
+
+//the layers of a simpleNeuralNet whose weights are set at runtime (setWeights or unpack)
+template<class net_topology>
+struct runtimeLayers
+{
+    template<size_t i>
+    using layer = typename net_topology::template floatLayer<i>;
+};
+
+//a feed forward network of dense layers generated from a topology - every size is known at compile time and every buffer is a member
+template<class net_topology, class layer_types = runtimeLayers<net_topology>>
 class simpleNeuralNet
 {
 public:
+    static constexpr size_t input_length = net_topology::input_length;
+    static constexpr size_t output_length = net_topology::output_length;
+    static constexpr size_t layer_count = net_topology::layer_count;
+
     simpleNeuralNet() { for (int i = 0; i < output_length; i++) output[i] = 0.0F; }
     ~simpleNeuralNet() {}
 
     float output[output_length];
 
-    inline void operator()(float(&input)[input_length])
+    inline void operator()(float(&input)[input_length]) //the probabilities of the transitions are written to output
+    {
+        logits(input);
+
+        for (int i = 0; i < output_length; i++) output[i] = outputLayer().output[i];
+
+        softmax(output);
+    }
+
+    inline void logits(float(&input)[input_length]) //the logits of the transitions are written to outputLayer().output
+    {
+        layer<0>()(input);
+        logitsAfter<0>();
+    }
+
+    //the first rows of inputs - the logits are written to outputLayer().batch_output
+    inline void operator()(float(&inputs)[max_batch_size][input_length], const size_t rows)
+    {
+        layer<0>()(inputs, rows);
+        logitsAfter<0>(rows);
+    }
+
+    //the rest of the forward pass once the output of layer last was written some other way (see MLModel::precompute)
+    template<size_t last>
+    inline void logitsAfter() { steps<last + 1>(std::make_index_sequence<layer_count - last - 1>()); }
+
+    template<size_t last>
+    inline void logitsAfter(const size_t rows) { steps<last + 1>(rows, std::make_index_sequence<layer_count - last - 1>()); }
+
+    template<size_t i>
+    typename layer_types::template layer<i>& layer() { return std::get<i>(layers); }
+
+    template<size_t i>
+    const typename layer_types::template layer<i>& layer() const { return std::get<i>(layers); }
+
+    typename layer_types::template layer<layer_count - 1>& outputLayer() { return layer<layer_count - 1>(); }
+
+    //the weights and biases of every layer in the order they are saved by tensorflow
+    void setWeights(weightContainer& weights)
+    {
+        if (weights.size() != layer_count) throw exceptions::exception("Received an unexpected number of layers.");
+
+        setWeights(weights, std::make_index_sequence<layer_count>());
+    }
+
+    //the packed layers one after the other
+    static constexpr size_t packed_length = packedLength<net_topology>(std::make_index_sequence<layer_count>());
+
+    void pack(float* packed) const { pack(packed, std::make_index_sequence<layer_count>()); }
+    void unpack(const float* packed) { unpack(packed, std::make_index_sequence<layer_count>()); }
+
+private:
+    template<size_t... i>
+    static std::tuple<typename layer_types::template layer<i>...> layerTuple(std::index_sequence<i...>);
+
+    decltype(layerTuple(std::make_index_sequence<layer_count>())) layers;
+
+    template<size_t first, size_t... i>
+    inline void steps(std::index_sequence<i...>) { (step<first + i>(), ...); }
+
+    template<size_t i>
+    inline void step()
+    {
+        layer<i>()(layer<i - 1>().output);
+
+        constexpr int skip = net_topology::template layer<i>::skip_layer;
+
+        if constexpr (skip != no_skip)
+        {
+            for (size_t k = 0; k < net_topology::template layer<i>::output_length; k++) layer<i>().output[k] += layer<skip>().output[k];
+        }
+    }
+
+    template<size_t first, size_t... i>
+    inline void steps(const size_t rows, std::index_sequence<i...>) { (step<first + i>(rows), ...); }
+
+    template<size_t i>
+    inline void step(const size_t rows)
+    {
+        layer<i>()(layer<i - 1>().batch_output, rows);
+
+        constexpr int skip = net_topology::template layer<i>::skip_layer;
+
+        if constexpr (skip != no_skip)
+        {
+            for (size_t row = 0; row < rows; row++)
+            {
+                for (size_t k = 0; k < net_topology::template layer<i>::output_length; k++) layer<i>().batch_output[row][k] += layer<skip>().batch_output[row][k];
+            }
+        }
+    }
+
+    template<size_t... i>
+    void setWeights(weightContainer& weights, std::index_sequence<i...>) { (layer<i>().setWeights(weights[i][0], weights[i][1]), ...); }
+
+    template<size_t... i>
+    void pack(float* packed, std::index_sequence<i...>) const { ((layer<i>().pack(packed), packed += net_topology::template floatLayer<i>::packed_length), ...); }
+
+    template<size_t... i>
+    void unpack(const float* packed, std::index_sequence<i...>) { ((layer<i>().unpack(packed), packed += net_topology::template floatLayer<i>::packed_length), ...); }
+};
+
+/*
+output = max(y, slope * y) + residual where y = (corrections + sum of quantized input * weights) * scales + biases and the quantized ...
+... input is round(input * inverse input scale + zero point) clamped to [0, 255] (an unsigned byte) - the residual is output length ...
+... floats added after the activation (the residual adds of the network) or nullptr
+the weights are int8 packed in groups of four inputs - weights[(group * paddedLength(output length) + output index) * 4 + input index % 4] - ...
+... and aligned to 64 bytes like the corrections, scales, and biases
+*/
+const size_t max_quantized_input_length = 64; //longest input of a quantized layer
+const float calibration_clip = 0.001F; //share of the calibration inputs of a layer left out of its range at each end - the rare extremes would make the steps of all the other inputs coarser
+
+typedef void(*quantizedDenseKernel)(const int8_t*, const int32_t*, const float*, const float*, const float*, float*, const size_t, const size_t, const float,
+    const float, const float, const float*); //weights, corrections, scales, biases, input, output, input length, output length, inverse input scale, zero point, slope, residual
+
+struct quantizedKernel
+{
+    const char* name;
+
+    quantizedDenseKernel kernel;
+};
+
+extern const quantizedKernel portable_quantized_kernel;
+
+#ifdef USE_SIMD_KERNELS
+extern const quantizedKernel vnni_quantized_kernel;
+#endif
+
+extern quantizedKernel quantized_kernel; //chosen from CPUID at startup - only the model benchmark changes it
+
+template<size_t input_length, size_t output_length, void(*activation_function)(float(&output)[output_length])>
+class quantizedDenseLayer
+{
+public:
+    static_assert(activation_function == leaky_relu<output_length> || activation_function == linear<output_length>, "A quantized layer only applies the leaky relu or no activation function.");
+    static_assert(input_length <= max_quantized_input_length, "The input of the layer is too long.");
+
+    alignas(64) float output[output_length] = {};
+
+    inline void operator()(const float(&input)[input_length])
+    {
+        quantized_kernel.kernel(weights, corrections, scales, biases, input, output, input_length, output_length, inverse_input_scale, zero_point, slope, nullptr);
+    }
+
+    inline void operator()(const float(&input)[input_length], const float(&residual)[output_length]) //the residual is added to the outputs by the kernel
+    {
+        quantized_kernel.kernel(weights, corrections, scales, biases, input, output, input_length, output_length, inverse_input_scale, zero_point, slope, residual);
+    }
+
+    //every output gets the scale that maps its largest weight to 127
+    void setWeights(const denseLayer<input_length, output_length, activation_function>& float_layer)
     {
-        int i;
+        for (size_t output_index = 0; output_index < output_length; output_index++)
+        {
+            float largest_weight = 0.0F;
+
+            for (size_t input_index = 0; input_index < input_length; input_index++) largest_weight = std::max(largest_weight, std::fabs(float_layer.weight(input_index, output_index)));
+
+            weight_scales[output_index] = largest_weight > 0.0F ? largest_weight / 127.0F : 1.0F;
+
+            weight_sums[output_index] = 0;
+
+            for (size_t input_index = 0; input_index < input_length; input_index++)
+            {
+                const float quantized_weight = std::round(float_layer.weight(input_index, output_index) / weight_scales[output_index]);
+                const int8_t weight = static_cast<int8_t>(std::max(-127.0F, std::min(127.0F, quantized_weight)));
 
-        layer0(input);
-        layer1(layer0.output);
-        layer2(layer1.output);
-        layer3(layer2.output);
+                weights[((input_index / 4) * padded_length + output_index) * 4 + input_index % 4] = weight;
+                weight_sums[output_index] += weight;
+            }
+
+            biases[output_index] = float_layer.bias(output_index);
+        }
 
-        for (i = 0; i < 16; i++) layer3.output[i] += layer1.output[i];
+        setInputRange(lowest_input, highest_input);
+    }
 
-        layer4(layer3.output);
-        layer5(layer4.output);
+    //the scale and zero point that map the range of inputs to [0, 255] - the range is widened to include 0 so an input of 0 stays exact
+    void setInputRange(const float lowest, const float highest)
+    {
+        lowest_input = std::min(lowest, 0.0F);
+        highest_input = std::max(highest, 0.0F);
 
-        for (i = 0; i < 16; i++) layer5.output[i] += layer3.output[i];
+        const float input_scale = highest_input > lowest_input ? (highest_input - lowest_input) / 255.0F : 1.0F;
 
-        layer6(layer5.output);
+        inverse_input_scale = 1.0F / input_scale;
+        zero_point = std::round(-lowest_input * inverse_input_scale);
 
-        for (i = 0; i < output_length; i++) output[i] = layer6.output[i];
+        for (size_t output_index = 0; output_index < output_length; output_index++)
+        {
+            corrections[output_index] = -static_cast<int32_t>(zero_point) * weight_sums[output_index];
+            scales[output_index] = input_scale * weight_scales[output_index];
+        }
     }
 
-    denseLayer<input_length, 32, leaky_relu<32>> layer0;
-    denseLayer<32, 16, leaky_relu<16>> layer1;
-    denseLayer<16, 32, leaky_relu<32>> layer2;
-    denseLayer<32, 16, leaky_relu<16>> layer3;
-    denseLayer<16, 32, leaky_relu<32>> layer4;
-    denseLayer<32, 16, leaky_relu<16>> layer5;
-    denseLayer<16, output_length, softmax<output_length>> layer6;
+private:
+    static constexpr size_t padded_length = paddedLength(output_length);
+    static constexpr size_t padded_input_length = (input_length + 3) & ~size_t(3);
+    static constexpr float slope = activation_function == leaky_relu<output_length> ? 0.1F : 1.0F;
+
+    alignas(64) int8_t weights[padded_input_length * padded_length] = {}; //the padding stays 0
+    alignas(64) int32_t corrections[padded_length] = {}; //-zero point * the sum of the weights of each output
+    alignas(64) float scales[padded_length] = {}; //input scale * weight scale of each output
+    alignas(64) float biases[padded_length] = {};
+
+    float weight_scales[padded_length] = {};
+    int32_t weight_sums[padded_length] = {};
+
+    float lowest_input = -1.0F, highest_input = 1.0F;
+    float inverse_input_scale = 1.0F;
+    float zero_point = 0.0F;
 };
 
+template<class net_topology>
+class quantizedNeuralNet //the int8 version of simpleNeuralNet
+{
+public:
+    static constexpr size_t input_length = net_topology::input_length;
+    static constexpr size_t layer_count = net_topology::layer_count;
+
+    inline void logits(const float(&input)[input_length]) { forward(input, std::make_index_sequence<layer_count>()); } //the logits of the transitions are written to outputLayer().output
+
+    template<size_t i>
+    typename net_topology::template quantizedLayer<i>& layer() { return std::get<i>(layers); }
+
+    typename net_topology::template quantizedLayer<layer_count - 1>& outputLayer() { return layer<layer_count - 1>(); }
+
+    //quantize the weights of the float network and set the input range of every layer from the inputs the float network gives it on the calibration inputs
+    void quantize(simpleNeuralNet<net_topology>& net, const std::vector<std::array<float, input_length>>& calibration_inputs)
+    {
+        setWeights(net, std::make_index_sequence<layer_count>());
+
+        std::vector<float> layer_inputs[layer_count];
+
+        float input[input_length];
+
+        for (const auto& calibration_input : calibration_inputs)
+        {
+            for (size_t i = 0; i < input_length; i++) input[i] = calibration_input[i];
+
+            net.logits(input); //the skips are added in place so every layer holds the input of the next one
+
+            recordInputs(net, input, layer_inputs, std::make_index_sequence<layer_count>());
+        }
+
+        float lowest[layer_count], highest[layer_count];
+
+        for (size_t layer_index = 0; layer_index < layer_count; layer_index++)
+        {
+            std::vector<float>& values = layer_inputs[layer_index];
+
+            const size_t low_rank = static_cast<size_t>(calibration_clip * (values.size() - 1));
+            const size_t high_rank = values.size() - 1 - low_rank;
+
+            std::nth_element(values.begin(), values.begin() + low_rank, values.end());
+            lowest[layer_index] = values[low_rank];
+
+            std::nth_element(values.begin(), values.begin() + high_rank, values.end());
+            highest[layer_index] = values[high_rank];
+        }
+
+        setInputRanges(lowest, highest, std::make_index_sequence<layer_count>());
+    }
+
+private:
+    template<size_t... i>
+    static std::tuple<typename net_topology::template quantizedLayer<i>...> layerTuple(std::index_sequence<i...>);
+
+    decltype(layerTuple(std::make_index_sequence<layer_count>())) layers;
+
+    template<size_t... i>
+    inline void forward(const float(&input)[input_length], std::index_sequence<i...>) { (step<i>(input), ...); }
+
+    template<size_t i>
+    inline void step(const float(&input)[input_length]) //the skips are added by the kernel
+    {
+        constexpr int skip = net_topology::template layer<i>::skip_layer;
+
+        if constexpr (i == 0) layer<0>()(input);
+        else if constexpr (skip == no_skip) layer<i>()(layer<i - 1>().output);
+        else layer<i>()(layer<i - 1>().output, layer<skip>().output);
+    }
+
+    template<size_t... i>
+    void setWeights(const simpleNeuralNet<net_topology>& net, std::index_sequence<i...>) { (layer<i>().setWeights(net.template layer<i>()), ...); }
+
+    template<size_t i>
+    static const auto& layerInput(const simpleNeuralNet<net_topology>& net, const float(&input)[input_length])
+    {
+        if constexpr (i == 0) return input;
+        else return net.template layer<i - 1>().output;
+    }
+
+    template<size_t... i>
+    static void recordInputs(const simpleNeuralNet<net_topology>& net, const float(&input)[input_length], std::vector<float>(&layer_inputs)[layer_count], std::index_sequence<i...>)
+    {
+        (layer_inputs[i].insert(layer_inputs[i].end(), std::begin(layerInput<i>(net, input)), std::end(layerInput<i>(net, input))), ...);
+    }
+
+    template<size_t... i>
+    void setInputRanges(const float(&lowest)[layer_count], const float(&highest)[layer_count], std::index_sequence<i...>) { (layer<i>().setInputRange(lowest[i], highest[i]), ...); }
+};
+
+weightContainer readWeights(const std::string&); //the weights and biases of each dense layer in a json file of model weights - in the order they are saved by tensorflow
+
 struct inlierRanges //contains the min & maximum allowed values for each input parameter
 {
     long long rolling_period = 2000000000LL; //rolling period in nanoseconds
@@ -246,6 +694,20 @@ struct inlierRanges //contains the min & maximum allowed values for each input p
     int max_size = 999999999; //minimum number of shares exchanged in the last filtered trade
 };
 
+struct calibrationSet //inputs of the network (log transformed and scaled features) written by retrain_model.py
+{
+    std::vector<std::array<float, normalized_length>> calibration_inputs; //training inputs that set the input scales of the quantized network
+    std::vector<std::array<float, normalized_length>> holdout_inputs; //inputs of transitions that were kept out of the training
+    std::vector<int> holdout_transitions; //-1, 0, or +1
+
+    //golden vectors - training inputs, their features before the log transform and the scaling, and the probabilities of the keras model
+    std::vector<std::array<float, normalized_length>> golden_inputs;
+    std::vector<std::array<float, normalized_length>> golden_features;
+    std::vector<std::array<float, 3>> golden_probabilities; //of -1, 0, and +1 transitions
+};
+
+calibrationSet readCalibration(const std::string&); //the calibration, held out, and golden inputs in a json file written by retrain_model.py
+
 struct feature
 {
     std::string name;
@@ -254,27 +716,116 @@ struct feature
     float std = 0.0;
 };
 
+//the network retrain_model.py trains - change it with construct_and_train_nn (CMake checks the shapes against model_weights.json)
+typedef topology<16,
+    dense<32, leaky_relu<32>>,
+    dense<16, leaky_relu<16>>,
+    dense<32, leaky_relu<32>>,
+    dense<16, leaky_relu<16>, 1>,
+    dense<32, leaky_relu<32>>,
+    dense<16, leaky_relu<16>, 3>,
+    dense<3, linear<3>>> modelTopology;
+
+constexpr unsigned daily_features = 0xD328; //mean (3), std (5), average_volume (8), previous_days_close (9), p(-dx) (12), p(+dx) (14), and lambda (15) are fixed for the day
+constexpr size_t daily_feature_count = std::popcount(daily_features);
+constexpr size_t intraday_feature_count = normalized_length - daily_feature_count;
+
+constexpr size_t first_layer_length = modelTopology::layer<0>::output_length;
+
+//the part of the first layer that only depends on the daily features of a symbol - set once a day by MLModel::precompute
+struct dailyInputs
+{
+    alignas(64) float pre_activation[paddedLength(first_layer_length)] = {}; //biases of the first layer + the weights of the daily features * their inputs
+    float inputs[daily_feature_count] = {}; //normalized daily features in the order of the features - the quantized network takes the whole input
+};
+
+const uint32_t model_file_version = 2; //increment whenever the layout of the header or the payload changes
+
+const char model_file_magic[8] = { 'Q', 'P', 'L', 'M', 'O', 'D', 'E', 'L' };
+
+struct modelFileHeader
+{
+    char magic[8];
+
+    uint32_t version = model_file_version;
+    uint32_t layer_count = 0;
+
+    uint64_t topology_checksum = 0; //checksum of the input length, output length, and skip of every layer
+    uint64_t payload_size = 0; //bytes that follow the header
+    uint64_t payload_checksum = 0;
+    uint64_t reserved = 0;
+};
+
+static_assert(sizeof(modelFileHeader) == 48, "The model file header layout changed - increment model_file_version.");
+
 class MLModel //a class that contains the neural network used to make predictions and the ranges for each input feature
 {
 public:
-    static const size_t input_length = 16;
-    static const size_t output_length = 3;
+    static const size_t input_length = modelTopology::input_length;
+    static const size_t output_length = modelTopology::output_length;
 
     MLModel();
     ~MLModel();
     
     void loadWeights(const std::string&);
     void loadScales(const std::string&);
+    void loadCalibration(const std::string&); //quantize the network with the calibration inputs of a json file - call it after loadWeights
+
+    //the weights, scales, and inlier ranges of a binary model file - returns false if the file is missing, corrupted, or written for another topology
+    bool loadModelFile(const std::string&);
+    void saveModelFile(const std::string&) const; //call it after loadWeights and loadScales
+    void saveModelHeader(const std::string&) const; //the packed layers and the scales as constexpr arrays of a header (see constantModelUtils.h)
+
+#ifdef USE_CONSTANT_MODEL
+    //predict with the network and the scales of modelConstants.h (see constantModelUtils.h) - the inlier ranges still come from loadScales
+    //returns false if the scales differ from the ones loaded before (modelConstants.h was written for another model)
+    bool useConstantModel();
+#endif
 
     //calculate the probability of a positive transition
     float predict(float, float, float, float, float, float, float, float, float, float, float, float, float, float, float, float);
+    float predict(const float(&)[input_length]); //the features in the order of the arguments above
+
+    //calculate the probabilities of a positive transition for several sets of features at once - features, probabilities, number of sets
+    void predict(const float(*)[input_length], float*, const size_t);
+
+    //the daily inputs of a symbol - mean, std, average_volume, previous_days_close, pmdx, ppdx, lambda (call it again after loadWeights or loadScales)
+    void precompute(dailyInputs&, float, float, float, float, float, float, float) const;
+
+    //the same predictions with the daily inputs of the symbol - the daily features are not read and only the other ones go through the first layer
+    float predict(const dailyInputs&, const float(&)[input_length]);
+    void predict(const dailyInputs* const*, const float(*)[input_length], float*, const size_t); //daily inputs of each set, features, probabilities, number of sets
 
-    simpleNeuralNet<input_length, output_length> neural_net;
+    simpleNeuralNet<modelTopology> neural_net;
+    quantizedNeuralNet<modelTopology> quantized_net;
     inlierRanges ranges;
 
+    bool quantized = false; //true if predict uses quantized_net
+    bool constant = false; //true if predict uses the network with the weights compiled in (USE_CONSTANT_MODEL) - the predictions with daily inputs do not
+
     float input[input_length];
+    float batch_input[max_batch_size][input_length];
     float means[input_length];
     float stds[input_length];
+    float inverse_stds[input_length];
+
+private:
+    //the rows of the weights of the first layer split by feature - a dense kernel runs each part like a layer of its own
+    alignas(64) float daily_weights[daily_feature_count * paddedLength(first_layer_length)] = {};
+    alignas(64) float intraday_weights[intraday_feature_count * paddedLength(first_layer_length)] = {};
+    alignas(64) float first_layer_biases[paddedLength(first_layer_length)] = {};
+
+    alignas(64) float intraday_input[intraday_feature_count];
+    alignas(64) float intraday_batch_input[max_batch_size][intraday_feature_count];
+    alignas(64) float batch_pre_activations[max_batch_size][paddedLength(first_layer_length)];
+
+    void splitFirstLayer(); //copy the weights of the first layer into daily_weights and intraday_weights
+
+    static_assert(input_length == normalized_length, "The normalization kernels are written for 16 features.");
+    static_assert(output_length == 3, "The probability of a +1 transition is taken from the logits of the -1, 0, and +1 transitions.");
+    static_assert(modelTopology::floatLayer<0>::fused_activation, "The first layer has to be one whose activation function the kernels apply.");
+
+    void normalize(const float(&)[input_length], float(&)[input_length]) const; //log transform and scale the features - features, inputs of the network
 };
 
 #endif
@@ -0,0 +1,616 @@
+
+#include "qplUtils.h"
+
+template<typename T>
+inline void writeValue(std::ofstream& file, const T& value)
+{
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+inline void readValue(std::ifstream& file, T& value)
+{
+	file.read(reinterpret_cast<char*>(&value), sizeof(T));
+
+	if (!file) throw exceptions::exception("Unexpected end of the accumulator file.");
+}
+
+inline void writeString(std::ofstream& file, const std::string& string)
+{
+	writeValue(file, static_cast<uint32_t>(string.size()));
+	file.write(string.data(), string.size());
+}
+
+inline void readString(std::ifstream& file, std::string& string)
+{
+	uint32_t size = 0;
+
+	readValue(file, size);
+
+	if (size > 64) throw exceptions::exception("Received an unexpected string length from the accumulator file.");
+
+	string.resize(size);
+	file.read(string.data(), size);
+
+	if (!file) throw exceptions::exception("Unexpected end of the accumulator file.");
+}
+
+qplAccumulator::qplAccumulator() {}
+qplAccumulator::~qplAccumulator() {}
+
+void qplAccumulator::reset(const inlierRanges& ranges)
+{
+	last_t.clear();
+
+	last_close = 0.0;
+	last_volume = 0;
+	bar_count = 0;
+
+	lookback_period = ranges.lookback_period;
+	average_volume_period = ranges.average_volume_period;
+	number_of_bins = static_cast<int>(ranges.number_of_bins);
+
+	returns.clear();
+	volumes.clear();
+	sorted_returns.clear();
+
+	sorted_returns.reserve(lookback_period);
+
+	volume_sum = 0;
+
+	valid_count = 0;
+	valid_sum = 0.0;
+
+	shifted_sum = 0.0;
+	shifted_square_sum = 0.0;
+
+	histogram_min = 0.0;
+	histogram_max = 0.0;
+
+	bins.clear();
+}
+
+void qplAccumulator::push(const std::string& t, const double c, const long long v)
+{
+	if (bar_count) //the first bar has no previous close to calculate a return with
+	{
+		double r = (last_close > 0.0) ? c / last_close : -1.0; //any value with -1.0 will not be used to calculate the statistics
+
+		returns.push_back(r);
+		addReturn(r);
+
+		if (returns.size() > lookback_period)
+		{
+			removeReturn(returns.front());
+			returns.pop_front();
+		}
+	}
+
+	volumes.push_back(v);
+	volume_sum += v;
+
+	if (volumes.size() > average_volume_period)
+	{
+		volume_sum -= volumes.front();
+		volumes.pop_front();
+	}
+
+	last_t = t;
+	last_close = c;
+	last_volume = v;
+
+	bar_count++;
+}
+
+void qplAccumulator::addReturn(const double r)
+{
+	if (r == -1.0) return;
+
+	valid_count++;
+	valid_sum += r - 1.0;
+
+	if (r < 0.0) return;
+
+	shifted_sum += r - 1.0;
+	shifted_square_sum += (r - 1.0) * (r - 1.0);
+
+	sorted_returns.insert(std::upper_bound(sorted_returns.begin(), sorted_returns.end(), r), r);
+
+	//only the bin counts change if the inlier range stays the same
+	if (bins.size() && r >= histogram_min && r <= histogram_max) bins[binIndex(r)]++;
+}
+
+void qplAccumulator::removeReturn(const double r)
+{
+	if (r == -1.0) return;
+
+	valid_count--;
+	valid_sum -= r - 1.0;
+
+	if (r < 0.0) return;
+
+	shifted_sum -= r - 1.0;
+	shifted_square_sum -= (r - 1.0) * (r - 1.0);
+
+	auto position = std::lower_bound(sorted_returns.begin(), sorted_returns.end(), r);
+
+	if (position != sorted_returns.end() && *position == r) sorted_returns.erase(position);
+
+	if (bins.size() && r >= histogram_min && r <= histogram_max) bins[binIndex(r)]--;
+}
+
+bool qplAccumulator::computeFeatures(dailyFeatureRecord& record, const inlierRanges& ranges)
+{
+	record.is_an_outlier = 1; //if all inlier conditions are met this will be set to 0
+
+	if (bar_count < ranges.min_completed_trading_days) return false;
+
+	//check that the previous day's closing price is not an outlier
+	if (last_close < ranges.min_previous_days_closing_price || last_close > ranges.max_previous_days_closing_price) return false;
+
+	record.previous_days_close = last_close;
+
+	double average_volume = static_cast<double>(volume_sum) / average_volume_period;
+
+	//check that the average volume is not an outlier
+	if (average_volume < ranges.min_average_volume || average_volume > ranges.max_average_volume) return false;
+
+	record.average_volume = average_volume;
+
+	if (!valid_count) return false;
+
+	double mean = 1.0 + valid_sum / valid_count;
+
+	//check that the mean is not an outlier
+	if (mean < ranges.min_mean || mean > ranges.max_mean) return false;
+
+	record.mean = mean;
+
+	//sum of (r - mean)^2 over the non-negative returns, expanded around the shift of 1.0
+	double shift = mean - 1.0;
+	double variance = (shifted_square_sum - 2.0 * shift * shifted_sum + sorted_returns.size() * shift * shift) / valid_count;
+
+	if (variance < 0.0) variance = 0.0;
+
+	//check that the standard deviation is not an outlier
+	if (variance < ranges.min_std * ranges.min_std || variance > ranges.max_std * ranges.max_std) return false;
+
+	//find the inliers - the returns that are within STD_MAX standard deviations from the mean
+	double max_square_distance = variance * ranges.std_max * ranges.std_max;
+	double max_distance = std::sqrt(max_square_distance);
+
+	auto isAnInlier = [&](const double r) { return (r - mean) * (r - mean) <= max_square_distance; };
+
+	auto first = std::lower_bound(sorted_returns.begin(), sorted_returns.end(), mean - max_distance);
+	auto last = std::upper_bound(first, sorted_returns.end(), mean + max_distance);
+
+	//the square root can move the bounds by a rounding error so step over the boundary elements with the exact condition
+	while (first != sorted_returns.begin() && isAnInlier(*(first - 1))) first--;
+	while (first != last && !isAnInlier(*first)) first++;
+	while (last != sorted_returns.end() && isAnInlier(*last)) last++;
+	while (last != first && !isAnInlier(*(last - 1))) last--;
+
+	int total_count = static_cast<int>(last - first);
+
+	if (!total_count) return false;
+
+	double r_min = *first;
+	double r_max = *(last - 1);
+
+	if (r_max <= r_min || r_min < 0.0) return false;
+
+	double std = std::sqrt(variance);
+
+	record.std = std;
+
+	//rebuild the histogram if the inlier range changed since the bins were last counted
+	if (r_min != histogram_min || r_max != histogram_max || bins.size() != number_of_bins)
+	{
+		histogram_min = r_min;
+		histogram_max = r_max;
+
+		bins.assign(number_of_bins, 0);
+
+		for (auto r = first; r != last; r++) bins[binIndex(*r)]++;
+
+		histogram_rebuilds++;
+	}
+
+	double r_scale = (ranges.number_of_bins - 1.0) / (r_max - r_min); //bin width per unit return
+	double dr = 2.0 * std * ranges.std_max / ranges.number_of_bins; //assumes that NUMBER_OF_BINS != 0
+
+	int drp1 = static_cast<int>(r_scale * (mean + dr - r_min)); //index of the bin at mean + dr
+	int drm1 = static_cast<int>(r_scale * (mean - dr - r_min)); //index of the bin at mean - dr
+
+	int pp_partial_count = (drp1 >= 0 && drp1 < number_of_bins) ? bins[drp1] : 0;
+	int pm_partial_count = (drm1 >= 0 && drm1 < number_of_bins) ? bins[drm1] : 0;
+
+	double pp = static_cast<double>(pp_partial_count) / static_cast<double>(total_count); //p(mean+dr)
+	double pm = static_cast<double>(pm_partial_count) / static_cast<double>(total_count); //p(mean-dr)
+
+	if (pp < ranges.min_ppdx || pp > ranges.max_ppdx || pm < ranges.min_pmdx || pm > ranges.max_pmdx) return false;
+
+	double rps = (mean + dr) * (mean + dr);
+	double rms = (mean - dr) * (mean - dr);
+
+	double l_denominator = rps * rps * pp - rms * rms * pm;
+
+	record.pp = pp;
+	record.pm = pm;
+
+	//if the denominator for lambda is zero then lambda can't be calculated
+	if (!l_denominator) return false;
+
+	double l = (rms * pm - rps * pp) / l_denominator;
+
+	if (l < 0.0) l = -l; //absolute value of lambda
+
+	//check that lambda is not an outlier
+	if (l < ranges.min_lambda || l > ranges.max_lambda) return false;
+
+	//calculate ground state energy E0
+	double C0 = -K0(0.0) * l;
+	double C1 = std::sqrt(0.25 * C0 * C0 - 1.0 / 27.0);
+
+	record.l = l;
+	record.E0 = std::cbrt(-0.5 * C0 + C1) + std::cbrt(-0.5 * C0 - C1);
+
+	if (record.E0 == 0.0) return false;
+
+	//the stock satisfies the inlier conditions that only depend on daily data
+	record.is_an_outlier = 0;
+
+	return true;
+}
+
+std::vector<qplConfiguration> parseQplConfigurations(const std::string& text)
+{
+	std::vector<qplConfiguration> configurations;
+
+	size_t start = 0;
+
+	while (start < text.size())
+	{
+		size_t end = text.find(',', start);
+
+		if (end == std::string::npos) end = text.size();
+
+		qplConfiguration configuration;
+		char extra = '\0';
+
+		if (std::sscanf(text.substr(start, end - start).c_str(), "%d:%d:%lf%c", &configuration.lookback_period, &configuration.number_of_bins,
+			&configuration.std_max, &extra) != 3)
+		{
+			throw exceptions::exception("Invalid qpl configuration : " + text.substr(start, end - start) + " - expecting lookback:bins:std_max.");
+		}
+
+		if (configuration.lookback_period < 2 || configuration.number_of_bins < 2 || configuration.std_max <= 0.0)
+		{
+			throw exceptions::exception("Invalid qpl configuration : " + text.substr(start, end - start) + " - every value must be positive.");
+		}
+
+		configurations.push_back(configuration);
+
+		start = end + 1;
+	}
+
+	if (!configurations.size()) throw exceptions::exception("No qpl configurations were given.");
+
+	return configurations;
+}
+
+void computeQplFeatures(const std::vector<double>& returns, const std::vector<qplConfiguration>& configurations, const inlierRanges& ranges, qplFeatures* features)
+{
+	//running count and sum of the valid returns from the newest one back - the same order computeDailyFeatures adds them in
+	std::vector<int> valid_counts(returns.size() + 1, 0);
+	std::vector<double> valid_sums(returns.size() + 1, 0.0);
+
+	for (size_t i = 0; i < returns.size(); i++)
+	{
+		valid_counts[i + 1] = valid_counts[i];
+		valid_sums[i + 1] = valid_sums[i];
+
+		if (returns[i] >= 0.0)
+		{
+			valid_counts[i + 1]++;
+			valid_sums[i + 1] += returns[i];
+		}
+	}
+
+	for (size_t c = 0; c < configurations.size(); c++)
+	{
+		const qplConfiguration& configuration = configurations[c];
+		qplFeatures& feature = features[c];
+
+		const size_t lookback_period = (static_cast<size_t>(configuration.lookback_period) > returns.size()) ? returns.size() : configuration.lookback_period;
+		const double number_of_bins = configuration.number_of_bins;
+		const double std_max = configuration.std_max;
+
+		int total_count = valid_counts[lookback_period];
+
+		if (!total_count) continue;
+
+		double mean = valid_sums[lookback_period] / total_count;
+
+		//check that the mean is not an outlier
+		if (mean < ranges.min_mean || mean > ranges.max_mean) continue;
+
+		feature.mean = mean;
+
+		double std = 0.0;
+
+		for (size_t i = 0; i < lookback_period; i++)
+		{
+			if (returns[i] >= 0.0) std += (returns[i] - mean) * (returns[i] - mean);
+		}
+
+		std /= total_count;
+
+		//check that the standard deviation is not an outlier
+		if (std < ranges.min_std * ranges.min_std || std > ranges.max_std * ranges.max_std) continue;
+
+		double r_min = 999999999.0;
+		double r_max = -999999999.0;
+
+		total_count = 0; //count the number of inliers
+
+		//find the minimum and maximum returns that are within std_max standard deviations from the mean
+		for (size_t i = 0; i < lookback_period; i++)
+		{
+			if ((returns[i] - mean) * (returns[i] - mean) <= std * std_max * std_max && returns[i] >= 0.0)
+			{
+				total_count++;
+
+				if (returns[i] < r_min) r_min = returns[i];
+				if (returns[i] > r_max) r_max = returns[i];
+			}
+		}
+
+		if (r_max <= r_min || !total_count || r_min < 0.0) continue;
+
+		std = std::sqrt(std);
+
+		feature.std = std;
+
+		double r_scale = (number_of_bins - 1.0) / (r_max - r_min); //bin width per unit return
+		double dr = 2.0 * std * std_max / number_of_bins;
+
+		int drp1 = static_cast<int>(r_scale * (mean + dr - r_min)); //index of the bin at mean + dr
+		int drm1 = static_cast<int>(r_scale * (mean - dr - r_min)); //index of the bin at mean - dr
+
+		int pp_partial_count = 0;
+		int pm_partial_count = 0;
+
+		//find the number of returns that have the same bin index as drp1 and drm1
+		for (size_t i = 0; i < lookback_period; i++)
+		{
+			if (returns[i] >= r_min && returns[i] <= r_max)
+			{
+				if (static_cast<int>(r_scale * (returns[i] - r_min)) == drp1) pp_partial_count++;
+				if (static_cast<int>(r_scale * (returns[i] - r_min)) == drm1) pm_partial_count++;
+			}
+		}
+
+		double pp = static_cast<double>(pp_partial_count) / static_cast<double>(total_count); //p(mean+dr)
+		double pm = static_cast<double>(pm_partial_count) / static_cast<double>(total_count); //p(mean-dr)
+
+		if (pp < ranges.min_ppdx || pp > ranges.max_ppdx || pm < ranges.min_pmdx || pm > ranges.max_pmdx) continue;
+
+		double rps = (mean + dr) * (mean + dr);
+		double rms = (mean - dr) * (mean - dr);
+
+		double l_denominator = rps * rps * pp - rms * rms * pm;
+
+		feature.pp = pp;
+		feature.pm = pm;
+
+		//if the denominator for lambda is zero then lambda can't be calculated
+		if (!l_denominator) continue;
+
+		double l = (rms * pm - rps * pp) / l_denominator;
+
+		if (l < 0.0) l = -l; //absolute value of lambda
+
+		//check that lambda is not an outlier
+		if (l < ranges.min_lambda || l > ranges.max_lambda) continue;
+
+		//calculate ground state energy E0
+		double C0 = -K0(0.0) * l;
+		double C1 = std::sqrt(0.25 * C0 * C0 - 1.0 / 27.0);
+
+		feature.l = l;
+		feature.E0 = std::cbrt(-0.5 * C0 + C1) + std::cbrt(-0.5 * C0 - C1);
+
+		if (feature.E0 != 0.0) feature.is_an_outlier = false;
+	}
+}
+
+void saveQplTable(const std::string& file_path, const std::string& session, const std::vector<qplConfiguration>& configurations,
+	const std::vector<std::string>& tickers, const std::vector<qplFeatures>& features)
+{
+	if (features.size() != tickers.size() * configurations.size()) throw exceptions::exception("The qpl table does not match its configurations.");
+
+	std::FILE* file = std::fopen(file_path.c_str(), "w");
+
+	if (!file) throw exceptions::exception("Failed to open the file : " + file_path);
+
+	std::fprintf(file, "# session %s\n", session.c_str());
+
+	for (size_t c = 0; c < configurations.size(); c++)
+	{
+		std::fprintf(file, "# configuration %zu : lookback_period=%d number_of_bins=%d std_max=%.17g\n", c, configurations[c].lookback_period,
+			configurations[c].number_of_bins, configurations[c].std_max);
+	}
+
+	std::fprintf(file, "ticker,configuration,mean,std,pp,pm,l,E0,is_an_outlier\n");
+
+	for (size_t i = 0; i < tickers.size(); i++)
+	{
+		for (size_t c = 0; c < configurations.size(); c++)
+		{
+			const qplFeatures& feature = features[i * configurations.size() + c];
+
+			std::fprintf(file, "%s,%zu,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%d\n", tickers[i].c_str(), c, feature.mean, feature.std, feature.pp,
+				feature.pm, feature.l, feature.E0, feature.is_an_outlier ? 1 : 0);
+		}
+	}
+
+	if (std::fclose(file)) throw exceptions::exception("Failed to write the file : " + file_path);
+}
+
+void qplAccumulator::write(std::ofstream& file) const
+{
+	writeString(file, last_t);
+
+	writeValue(file, last_close);
+	writeValue(file, last_volume);
+	writeValue(file, bar_count);
+
+	writeValue(file, lookback_period);
+	writeValue(file, average_volume_period);
+	writeValue(file, number_of_bins);
+
+	writeValue(file, volume_sum);
+	writeValue(file, valid_count);
+	writeValue(file, valid_sum);
+	writeValue(file, shifted_sum);
+	writeValue(file, shifted_square_sum);
+
+	writeValue(file, histogram_min);
+	writeValue(file, histogram_max);
+
+	writeValue(file, static_cast<uint32_t>(returns.size()));
+	writeValue(file, static_cast<uint32_t>(volumes.size()));
+	writeValue(file, static_cast<uint32_t>(bins.size()));
+
+	for (const double& r : returns) writeValue(file, r);
+	for (const long long& v : volumes) writeValue(file, v);
+	for (const int& count : bins) writeValue(file, count);
+}
+
+void qplAccumulator::read(std::ifstream& file)
+{
+	readString(file, last_t);
+
+	readValue(file, last_close);
+	readValue(file, last_volume);
+	readValue(file, bar_count);
+
+	readValue(file, lookback_period);
+	readValue(file, average_volume_period);
+	readValue(file, number_of_bins);
+
+	readValue(file, volume_sum);
+	readValue(file, valid_count);
+	readValue(file, valid_sum);
+	readValue(file, shifted_sum);
+	readValue(file, shifted_square_sum);
+
+	readValue(file, histogram_min);
+	readValue(file, histogram_max);
+
+	uint32_t num_returns = 0;
+	uint32_t num_volumes = 0;
+	uint32_t num_bins = 0;
+
+	readValue(file, num_returns);
+	readValue(file, num_volumes);
+	readValue(file, num_bins);
+
+	if (num_returns > lookback_period || num_volumes > average_volume_period || (num_bins && num_bins != number_of_bins))
+	{
+		throw exceptions::exception("Received an unexpected window size from the accumulator file.");
+	}
+
+	returns.resize(num_returns);
+	volumes.resize(num_volumes);
+	bins.resize(num_bins);
+
+	for (double& r : returns) readValue(file, r);
+	for (long long& v : volumes) readValue(file, v);
+	for (int& count : bins) readValue(file, count);
+
+	//the sorted returns are not saved - sorting them again is cheap compared to the size they would add to the file
+	sorted_returns.clear();
+	sorted_returns.reserve(lookback_period);
+
+	for (const double& r : returns) { if (r >= 0.0) sorted_returns.push_back(r); }
+
+	std::sort(sorted_returns.begin(), sorted_returns.end());
+}
+
+bool loadQplAccumulators(const std::string& file_path, const uint64_t ranges_checksum, qplAccumulatorContainer& accumulators)
+{
+	accumulators.clear();
+
+	std::ifstream file(file_path, std::ios::binary);
+
+	if (!file.is_open()) return false;
+
+	try
+	{
+		char magic[8];
+		uint32_t version = 0;
+		uint32_t count = 0;
+		uint64_t checksum = 0;
+
+		readValue(file, magic);
+		readValue(file, version);
+		readValue(file, count);
+		readValue(file, checksum);
+
+		if (std::memcmp(magic, qpl_accumulator_magic, sizeof(qpl_accumulator_magic))) return false;
+		if (version != qpl_accumulator_version) return false;
+		if (checksum != ranges_checksum) return false; //the window sizes or the inlier ranges changed
+
+		accumulators.reserve(count);
+
+		std::string ticker;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			readString(file, ticker);
+
+			accumulators[ticker].read(file);
+		}
+	}
+	catch (const exceptions::exception&)
+	{
+		accumulators.clear();
+
+		return false;
+	}
+
+	return true;
+}
+
+void saveQplAccumulators(const std::string& file_path, const uint64_t ranges_checksum, const qplAccumulatorContainer& accumulators)
+{
+	//write to a temporary file first so a crash never leaves a partially written file behind
+	const std::string temporary_path = file_path + ".tmp";
+
+	std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open()) throw exceptions::exception("Failed to open the file : " + temporary_path);
+
+	file.write(qpl_accumulator_magic, sizeof(qpl_accumulator_magic));
+
+	writeValue(file, qpl_accumulator_version);
+	writeValue(file, static_cast<uint32_t>(accumulators.size()));
+	writeValue(file, ranges_checksum);
+
+	for (const auto& pair : accumulators)
+	{
+		writeString(file, pair.first);
+
+		pair.second.write(file);
+	}
+
+	file.close();
+
+	if (!file) throw exceptions::exception("Failed to write the file : " + temporary_path);
+
+	std::remove(file_path.c_str()); //rename does not overwrite existing files on Windows
+
+	if (std::rename(temporary_path.c_str(), file_path.c_str())) throw exceptions::exception("Failed to replace the file : " + file_path);
+}
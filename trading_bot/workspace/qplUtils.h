@@ -0,0 +1,216 @@
+
+/*
+Sliding window accumulators for the daily statistics used in the quantum price level calculations.
+
+The mean, standard deviation, inlier minimum/maximum and the probability density of the daily relative returns are
+computed over the last lookback_period returns. From one day to the next only one return enters that window and one
+leaves it, so instead of recomputing everything from the daily bars, each symbol keeps ...
+	running sums of the returns (shifted by 1.0 to avoid cancellation when computing the variance)
+	a sorted copy of the returns (an order statistics structure used to find the inliers within std_max standard deviations)
+	the bin counts of the histogram over the inlier range
+... which are updated as bars are pushed. The histogram is only rebuilt when the inlier range changes.
+
+The accumulators are saved by the offline snapshot mode so the next snapshot only needs the bars since the last one.
+If an adjustment changes any of the bars that were already pushed then the accumulator has to be rebuilt from the full history.
+
+Compared to computeDailyFeatures (a full recomputation), the mean and standard deviation agree within qpl_accumulator_tolerance
+and lambda and E0 (which amplify those differences) within qpl_derived_tolerance - both relative. The previous day's close,
+average volume, p(+dx) and p(-dx) are identical unless a return lies within that tolerance of an inlier or bin boundary.
+accumulator_check (accumulatorCheck.cpp) checks this with verifyAccumulator on synthetic and recorded daily bars, for both rebuilt
+and extended accumulators.
+
+For research, computeQplTable computes the features of several (lookback period, number of bins, std_max) configurations
+from one pass over a symbol's daily bars. The relative returns and their running sums are calculated once for the longest
+lookback period and every configuration reuses them. Each configuration gives exactly what computeDailyFeatures gives when
+the inlier ranges use that configuration.
+*/
+
+#ifndef QPL_UTILS_H
+#define QPL_UTILS_H
+
+#include "exceptUtils.h"
+#include "modelUtils.h"
+#include "snapshotUtils.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <fstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <cmath>
+#include <cstdio>
+
+#define K0(n) ((1.1924 + 33.2383 * n + 56.2169 * n * n) / (1.0 + 43.6196 * n)) //cubic root is not necessary
+
+const uint32_t qpl_accumulator_version = 1; //increment whenever the layout of the accumulator file changes
+
+const char qpl_accumulator_magic[8] = { 'Q', 'P', 'L', 'A', 'C', 'C', 'U', 'M' };
+
+const double qpl_accumulator_tolerance = 1e-9; //maximum relative difference between the accumulated and fully recomputed mean and std
+const double qpl_derived_tolerance = 1e-6; //maximum relative difference between the accumulated and fully recomputed lambda and E0
+
+class qplAccumulator
+{
+public:
+	qplAccumulator();
+	~qplAccumulator();
+
+	void reset(const inlierRanges&); //clear the window - the sizes of the window and histogram are taken from the inlier ranges
+	void push(const std::string&, const double, const long long); //append the next daily bar (timestamp, closing price, volume)
+
+	//append daily bars that start with the last bar that was pushed
+	//returns false if that bar changed (the history was adjusted) and the accumulator has to be rebuilt
+	template<typename barContainer>
+	bool extend(const barContainer&);
+
+	//calculate the daily features from the current window - returns false if any of them is an outlier
+	bool computeFeatures(dailyFeatureRecord&, const inlierRanges&);
+
+	void write(std::ofstream&) const;
+	void read(std::ifstream&);
+
+	const std::string& lastTimestamp() const { return last_t; }
+
+	size_t histogram_rebuilds = 0; //number of times the histogram had to be rebuilt because the inlier range changed
+
+private:
+	std::string last_t; //timestamp of the last bar pushed
+
+	double last_close = 0.0; //closing price of the last bar pushed
+	long long last_volume = 0; //volume of the last bar pushed
+
+	int bar_count = 0; //number of daily bars pushed since the last reset
+
+	int lookback_period = 0; //maximum number of returns in the window
+	int average_volume_period = 0; //number of volumes used to calculate the average volume
+	int number_of_bins = 0; //number of bins in the histogram
+
+	std::deque<double> returns; //relative returns in the window from oldest to newest - -1.0 if the previous close was not positive
+	std::deque<long long> volumes; //last average_volume_period volumes
+
+	std::vector<double> sorted_returns; //non-negative returns in the window in ascending order
+
+	long long volume_sum = 0; //sum of volumes
+
+	int valid_count = 0; //number of returns with a positive previous close
+	double valid_sum = 0.0; //sum of (r - 1) over returns with a positive previous close
+
+	double shifted_sum = 0.0; //sum of (r - 1) over non-negative returns
+	double shifted_square_sum = 0.0; //sum of (r - 1)^2 over non-negative returns
+
+	double histogram_min = 0.0; //inlier range the bins were counted over
+	double histogram_max = 0.0;
+
+	std::vector<int> bins; //number of returns in each bin of the inlier range
+
+	void addReturn(const double);
+	void removeReturn(const double);
+
+	inline int binIndex(const double r) const
+	{
+		return static_cast<int>((number_of_bins - 1.0) / (histogram_max - histogram_min) * (r - histogram_min));
+	}
+};
+
+template<typename barContainer>
+bool qplAccumulator::extend(const barContainer& daily_bars)
+{
+	if (!daily_bars.size()) return true; //no new bars
+
+	const auto& first_bar = daily_bars[0];
+
+	if (first_bar.t != last_t) return false;
+	if (first_bar.v != last_volume) return false;
+	if (std::abs(first_bar.c - last_close) > qpl_accumulator_tolerance * last_close) return false;
+
+	for (size_t i = 1; i < daily_bars.size(); i++) push(daily_bars[i].t, daily_bars[i].c, daily_bars[i].v);
+
+	return true;
+}
+
+struct qplConfiguration //the parameters of the quantum price level calculation that can be varied
+{
+	int lookback_period = 1024; //number of past daily closing prices included in the qpl calculations
+	int number_of_bins = 51; //number of segments the probability distribution is divided into
+	double std_max = 3.0; //maximum number of standard deviations that a closing price can be from the mean in order to be used for the calculation
+};
+
+struct qplFeatures //the daily features of one symbol for one configuration
+{
+	double mean = 0.0;
+	double std = 0.0;
+	double pp = 0.0;
+	double pm = 0.0;
+	double l = 0.0;
+	double E0 = 0.0;
+
+	bool is_an_outlier = true;
+};
+
+//parse configurations formatted as lookback:bins:std_max and separated by commas - such as 1024:51:3.0,512:41:2.5
+std::vector<qplConfiguration> parseQplConfigurations(const std::string&);
+
+//calculate the features of each configuration from the relative returns (newest first, -1.0 if the previous close was not positive)
+void computeQplFeatures(const std::vector<double>&, const std::vector<qplConfiguration>&, const inlierRanges&, qplFeatures*);
+
+//calculate the features of each configuration from one pass over the daily bars - the features of every configuration are ...
+//... outliers if the previous close or average volume is one
+template<typename barContainer>
+void computeQplTable(const barContainer&, const std::vector<qplConfiguration>&, const inlierRanges&, std::vector<double>&, qplFeatures*);
+
+template<typename barContainer>
+void computeQplTable(const barContainer& daily_bars, const std::vector<qplConfiguration>& configurations, const inlierRanges& ranges,
+	std::vector<double>& returns, qplFeatures* features)
+{
+	for (size_t i = 0; i < configurations.size(); i++) features[i] = qplFeatures();
+
+	if (daily_bars.size() < static_cast<size_t>(ranges.min_completed_trading_days) || !daily_bars.size()) return;
+
+	const auto* bar_ptr = &daily_bars.back();
+
+	//check that the previous day's closing price is not an outlier
+	if (bar_ptr->c < ranges.min_previous_days_closing_price || bar_ptr->c > ranges.max_previous_days_closing_price) return;
+
+	double average_volume = 0.0;
+
+	//assumes MIN_COMPLETED_TRADING_DAYS >= AVERAGE_VOLUME_PERIOD
+	for (; bar_ptr > &daily_bars.back() - ranges.average_volume_period; bar_ptr--) average_volume += bar_ptr->v;
+
+	average_volume /= ranges.average_volume_period;
+
+	//check that the average volume is not an outlier
+	if (average_volume < ranges.min_average_volume || average_volume > ranges.max_average_volume) return;
+
+	//calculate the relative returns once for the longest lookback period
+	size_t num_returns = 0;
+
+	for (const qplConfiguration& configuration : configurations)
+	{
+		if (static_cast<size_t>(configuration.lookback_period) > num_returns) num_returns = configuration.lookback_period;
+	}
+
+	if (num_returns > daily_bars.size() - 1) num_returns = daily_bars.size() - 1;
+
+	returns.clear();
+
+	for (bar_ptr = &daily_bars.back(); returns.size() < num_returns; bar_ptr--)
+	{
+		if ((bar_ptr - 1)->c > 0.0) returns.push_back(bar_ptr->c / (bar_ptr - 1)->c);
+		else returns.push_back(-1.0); //minimum should be 0.0, any value with -1.0 will not be used to calculate std
+	}
+
+	computeQplFeatures(returns, configurations, ranges, features);
+}
+
+//write the features of each symbol and configuration to a csv file - one row per symbol and configuration
+void saveQplTable(const std::string&, const std::string&, const std::vector<qplConfiguration>&, const std::vector<std::string>&, const std::vector<qplFeatures>&);
+
+typedef std::unordered_map<std::string, qplAccumulator> qplAccumulatorContainer;
+
+//load the accumulators saved by the last snapshot - returns false if the file is missing, corrupted, or was made with different inlier ranges
+bool loadQplAccumulators(const std::string&, const uint64_t, qplAccumulatorContainer&);
+void saveQplAccumulators(const std::string&, const uint64_t, const qplAccumulatorContainer&);
+
+#endif
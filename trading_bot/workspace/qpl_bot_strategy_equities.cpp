@@ -47,8 +47,27 @@ double promptFloatInput(const char* message)
     }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    //run with --build-snapshot after the close (or overnight) to precompute the daily features used at the start of the next trading day
+    bool build_snapshot = (argc > 1 && std::string(argv[1]) == "--build-snapshot");
+
+    //run with --qpl-table lookback:bins:std_max,... to compute the daily features of several qpl configurations from one history fetch
+    bool build_qpl_table = (argc > 2 && std::string(argv[1]) == "--qpl-table");
+
+    std::vector<qplConfiguration> qpl_configurations;
+
+    if (build_qpl_table)
+    {
+        try { qpl_configurations = parseQplConfigurations(argv[2]); }
+        catch (const exceptions::exception& exception)
+        {
+            std::cout << "Exception caught : " << exception.what() << std::endl;
+
+            return 1;
+        }
+    }
+
     std::string text_input;
     std::string account_endpoint = "paper-api.alpaca.markets";
     std::string trade_update_stream = "paper-api.alpaca.markets";
@@ -63,8 +82,16 @@ int main()
     //ask the user for the parameters
     do
     {
-        risk_per_trade = promptFloatInput("Enter the amount of cash (in USD) you want to risk per trade : ");
-        allocated_buying_power = promptFloatInput("Enter the amount of cash (in USD) you want to allow this bot to use : ");
+        if (build_snapshot || build_qpl_table) //the offline modes do not trade
+        {
+            risk_per_trade = 0.0;
+            allocated_buying_power = 0.0;
+        }
+        else
+        {
+            risk_per_trade = promptFloatInput("Enter the amount of cash (in USD) you want to risk per trade : ");
+            allocated_buying_power = promptFloatInput("Enter the amount of cash (in USD) you want to allow this bot to use : ");
+        }
 
         std::cout << std::endl;
         std::cout << "Enter your Alpaca api key : ";
@@ -92,7 +119,9 @@ int main()
     }
     while (text_input != "continue");
 
-    if (account_endpoint == "api.alpaca.markets") std::cout << "This bot will trade LIVE." << std::endl << std::endl;
+    if (build_snapshot) std::cout << "This bot will only compute the daily features for the next trading day." << std::endl << std::endl;
+    else if (build_qpl_table) std::cout << "This bot will only compute the daily features of " << qpl_configurations.size() << " qpl configurations." << std::endl << std::endl;
+    else if (account_endpoint == "api.alpaca.markets") std::cout << "This bot will trade LIVE." << std::endl << std::endl;
     else std::cout << "This bot will trade on PAPER." << std::endl << std::endl;
 
 #ifdef _WIN32
@@ -107,7 +136,12 @@ int main()
     {
         tradingBot bot(ssl_context, account_endpoint, trade_update_stream, alpaca_api_key, alpaca_secret_key, allocated_buying_power, risk_per_trade);
 
-        try { bot.start(); }
+        try
+        {
+            if (build_snapshot) bot.buildSnapshot();
+            else if (build_qpl_table) bot.buildQplTable(qpl_configurations);
+            else bot.start();
+        }
         catch (const std::runtime_error& runtime_error) { throw runtime_error; }
         catch (const exceptions::exception& exception) { throw exception; }
         catch (const SSLNoReturn& no_return) { throw no_return; }
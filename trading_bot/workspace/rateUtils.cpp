@@ -0,0 +1,167 @@
+
+#include "rateUtils.h"
+
+requestScheduler::requestScheduler(const int Requests_per_minute, const int Max_requests_in_flight)
+	: requests_per_minute(Requests_per_minute),
+	tokens(0.0),
+	capacity(0.0),
+	max_requests_in_flight(Max_requests_in_flight),
+	last_refill(clock::now()),
+	blocked_until(clock::now())
+{
+	//allow a burst of a tenth of the budget so the first requests don't wait for tokens
+	capacity = std::max(1.0, requests_per_minute / 10.0);
+	tokens = capacity;
+
+	requests_in_flight_window = std::min<double>(initial_requests_in_flight, max_requests_in_flight);
+}
+
+requestScheduler::~requestScheduler() {}
+
+void requestScheduler::refill()
+{
+	clock::time_point now = clock::now();
+
+	tokens += std::chrono::duration<double>(now - last_refill).count() * requests_per_minute / 60.0;
+
+	if (tokens > capacity) tokens = capacity;
+
+	last_refill = now;
+}
+
+bool requestScheduler::canSend()
+{
+	if (requests_in_flight >= static_cast<int>(requests_in_flight_window)) return false;
+	if (clock::now() < blocked_until) return false;
+
+	refill();
+
+	return tokens >= 1.0;
+}
+
+void requestScheduler::onSend()
+{
+	tokens -= 1.0;
+	requests_in_flight++;
+}
+
+void requestScheduler::onResponse(const http::httpResponse& response)
+{
+	if (requests_in_flight > 0) requests_in_flight--;
+
+	consecutive_rate_limits = 0;
+
+	//additive increase - one more request in flight per window of successful responses
+	requests_in_flight_window += 1.0 / requests_in_flight_window;
+
+	if (requests_in_flight_window > max_requests_in_flight) requests_in_flight_window = max_requests_in_flight;
+
+	readRateLimitHeaders(response, false);
+}
+
+void requestScheduler::onRateLimited(const http::httpResponse& response)
+{
+	if (requests_in_flight > 0) requests_in_flight--;
+
+	rate_limited_responses++;
+	consecutive_rate_limits++;
+
+	//multiplicative decrease
+	requests_in_flight_window = std::max<double>(min_requests_in_flight, requests_in_flight_window / 2.0);
+
+	tokens = 0.0;
+
+	//wait for as long as the response says, otherwise back off exponentially
+	const std::string* retry_after = findHeaderField(response, "retry-after");
+
+	if (retry_after)
+	{
+		try { blockFor(std::stod(*retry_after)); return; }
+		catch (const std::exception&) {}
+	}
+
+	readRateLimitHeaders(response, true);
+
+	if (clock::now() >= blocked_until) blockFor(min_backoff_seconds * (1 << std::min(consecutive_rate_limits - 1, 7)));
+}
+
+void requestScheduler::onFailure()
+{
+	if (requests_in_flight > 0) requests_in_flight--;
+}
+
+void requestScheduler::setMaxInFlight(const int Max_requests_in_flight)
+{
+	max_requests_in_flight = std::max(min_requests_in_flight, Max_requests_in_flight);
+
+	if (requests_in_flight_window > max_requests_in_flight) requests_in_flight_window = max_requests_in_flight;
+}
+
+void requestScheduler::readRateLimitHeaders(const http::httpResponse& response, const bool rate_limited)
+{
+	try
+	{
+		const std::string* limit = findHeaderField(response, "x-ratelimit-limit");
+
+		if (limit)
+		{
+			double new_requests_per_minute = std::stod(*limit);
+
+			if (new_requests_per_minute > 0.0 && new_requests_per_minute != requests_per_minute)
+			{
+				requests_per_minute = new_requests_per_minute;
+				capacity = std::max(1.0, requests_per_minute / 10.0);
+			}
+		}
+
+		const std::string* remaining = findHeaderField(response, "x-ratelimit-remaining");
+
+		if (remaining)
+		{
+			//the requests in flight have not been counted by the server yet
+			double remaining_requests = std::stod(*remaining) - requests_in_flight;
+
+			if (remaining_requests < tokens) tokens = std::max(0.0, remaining_requests);
+
+			if (remaining_requests > 0.0 && !rate_limited) return;
+		}
+		else if (!rate_limited) return;
+
+		//the budget is used up - wait until it resets
+		const std::string* reset = findHeaderField(response, "x-ratelimit-reset");
+
+		if (reset)
+		{
+			double seconds_until_reset = std::stod(*reset) - static_cast<double>(time(nullptr));
+
+			if (seconds_until_reset > 0.0) blockFor(std::min(seconds_until_reset, max_backoff_seconds));
+		}
+	}
+	catch (const std::exception&) {} //ignore malformed headers
+}
+
+void requestScheduler::blockFor(const double seconds)
+{
+	clock::time_point until = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(std::min(seconds, max_backoff_seconds)));
+
+	if (until > blocked_until) blocked_until = until;
+}
+
+const std::string* findHeaderField(const http::httpResponse& response, const std::string& lowercase_name)
+{
+	for (const auto& pair : response.fields)
+	{
+		if (pair.first.size() != lowercase_name.size()) continue;
+
+		bool match = true;
+
+		for (size_t i = 0; i < lowercase_name.size() && match; i++)
+		{
+			match = std::tolower(static_cast<unsigned char>(pair.first[i])) == lowercase_name[i];
+		}
+
+		if (match) return &pair.second;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,77 @@
+
+/*
+A request scheduler that keeps the data clients as close to the Alpaca API rate limit as possible without exceeding it.
+
+	a token bucket tracks the per-minute budget - a request can only be sent if a token is available
+	the rate limit headers of each response (X-RateLimit-Limit, X-RateLimit-Remaining, X-RateLimit-Reset) correct the bucket
+	the number of requests in flight grows by one per window of successful responses and is halved by a 429 response (AIMD)
+	a 429 response blocks every request until the limit resets (or Retry-After, or an exponential backoff if neither is given) ...
+	... and the request is sent again instead of shutting the bot down
+
+The scheduler does not send anything itself - the bar client pool asks it before sending each request and reports each response.
+*/
+
+#ifndef RATE_UTILS_H
+#define RATE_UTILS_H
+
+#include "httpUtils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <ctime>
+
+const int default_requests_per_minute = 200; //Alpaca's limit for free accounts - the rate limit headers raise it for unlimited accounts (10000 per minute)
+const int min_requests_in_flight = 1;
+const int initial_requests_in_flight = 4;
+
+const double min_backoff_seconds = 0.5; //first backoff after a 429 response without any rate limit headers
+const double max_backoff_seconds = 60.0; //the limit is per minute so waiting longer never helps
+
+class requestScheduler
+{
+public:
+	requestScheduler(const int, const int); //requests per minute, maximum number of requests in flight
+	~requestScheduler();
+
+	bool canSend(); //true if a token is available, the number of requests in flight is below the window, and the scheduler is not backing off
+	void onSend(); //a request was sent - takes a token
+
+	void onResponse(const http::httpResponse&); //a response other than 429 was received
+	void onRateLimited(const http::httpResponse&); //a 429 response was received - the request has to be sent again
+	void onFailure(); //a request was lost (the connection closed) and will be sent again
+
+	void setMaxInFlight(const int); //the window never grows beyond this - the number of clients that can send requests
+
+	int window() const { return static_cast<int>(requests_in_flight_window); }
+	int inFlight() const { return requests_in_flight; }
+
+	size_t rate_limited_responses = 0; //number of 429 responses received
+
+private:
+	typedef std::chrono::steady_clock clock;
+
+	double requests_per_minute;
+	double tokens; //requests that can be sent right now
+	double capacity; //maximum number of tokens - allows short bursts
+
+	int max_requests_in_flight;
+	int requests_in_flight = 0;
+	double requests_in_flight_window = initial_requests_in_flight; //increases by 1 / window per successful response
+
+	int consecutive_rate_limits = 0; //429 responses since the last successful response - doubles the backoff each time
+
+	clock::time_point last_refill;
+	clock::time_point blocked_until;
+
+	void refill();
+	void readRateLimitHeaders(const http::httpResponse&, const bool);
+
+	void blockFor(const double); //stop sending requests for the given number of seconds
+};
+
+//find a header field without regard to case - returns nullptr if the field is missing
+const std::string* findHeaderField(const http::httpResponse&, const std::string&);
+
+#endif
@@ -0,0 +1,89 @@
+
+#include "snapshotUtils.h"
+
+inline bool compareRecords(const dailyFeatureRecord& left, const dailyFeatureRecord& right)
+{
+	return std::strncmp(left.ticker, right.ticker, sizeof(left.ticker)) < 0;
+}
+
+dailySnapshot::dailySnapshot() {}
+dailySnapshot::~dailySnapshot() {}
+
+bool dailySnapshot::load(const std::string& file_path, const std::string& session, const uint64_t ranges_checksum)
+{
+	records = nullptr;
+	record_count = 0;
+
+	if (!file.open(file_path)) return false;
+	if (file.size() < sizeof(dailySnapshotHeader)) return false;
+
+	const dailySnapshotHeader* header = reinterpret_cast<const dailySnapshotHeader*>(file.data());
+
+	if (std::memcmp(header->magic, daily_snapshot_magic, sizeof(daily_snapshot_magic))) return false;
+	if (header->version != daily_snapshot_version) return false;
+	if (file.size() != sizeof(dailySnapshotHeader) + header->record_count * sizeof(dailyFeatureRecord)) return false;
+
+	//the snapshot is stale if it was computed with different inlier ranges or does not include the last completed trading session
+	if (header->ranges_checksum != ranges_checksum) return false;
+	if (std::strncmp(header->session, session.c_str(), sizeof(header->session))) return false;
+
+	const dailyFeatureRecord* first_record = reinterpret_cast<const dailyFeatureRecord*>(file.data() + sizeof(dailySnapshotHeader));
+
+	if (fnv1a(first_record, header->record_count * sizeof(dailyFeatureRecord)) != header->records_checksum) return false;
+
+	records = first_record;
+	record_count = header->record_count;
+
+	return true;
+}
+
+const dailyFeatureRecord* dailySnapshot::find(const std::string& ticker) const
+{
+	if (ticker.size() >= sizeof(dailyFeatureRecord::ticker)) return nullptr;
+
+	dailyFeatureRecord key;
+
+	std::memset(key.ticker, 0, sizeof(key.ticker));
+	std::memcpy(key.ticker, ticker.c_str(), ticker.size());
+
+	const dailyFeatureRecord* record = std::lower_bound(records, records + record_count, key, compareRecords);
+
+	if (record == records + record_count) return nullptr;
+	if (compareRecords(key, *record)) return nullptr;
+
+	return record;
+}
+
+void saveDailySnapshot(const std::string& file_path, const std::string& session, const uint64_t ranges_checksum, std::vector<dailyFeatureRecord>& records)
+{
+	if (session.size() >= sizeof(dailySnapshotHeader::session)) throw exceptions::exception("Invalid snapshot session : " + session);
+
+	std::sort(records.begin(), records.end(), compareRecords);
+
+	dailySnapshotHeader header;
+
+	std::memcpy(header.magic, daily_snapshot_magic, sizeof(daily_snapshot_magic));
+	std::memset(header.session, 0, sizeof(header.session));
+	std::memcpy(header.session, session.c_str(), session.size());
+
+	header.record_count = static_cast<uint32_t>(records.size());
+	header.ranges_checksum = ranges_checksum;
+	header.records_checksum = fnv1a(records.data(), records.size() * sizeof(dailyFeatureRecord));
+
+	//write to a temporary file first so a live start never maps a partially written snapshot
+	const std::string temporary_path = file_path + ".tmp";
+
+	std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open()) throw exceptions::exception("Failed to open the file : " + temporary_path);
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(dailyFeatureRecord));
+	file.close();
+
+	if (!file) throw exceptions::exception("Failed to write the file : " + temporary_path);
+
+	std::remove(file_path.c_str()); //rename does not overwrite existing files on Windows
+
+	if (std::rename(temporary_path.c_str(), file_path.c_str())) throw exceptions::exception("Failed to replace the file : " + file_path);
+}
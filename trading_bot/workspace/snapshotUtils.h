@@ -0,0 +1,100 @@
+
+/*
+A versioned binary snapshot of the daily features of every symbol in the universe.
+
+All of the features that only depend on daily data are fixed once the previous day's closing prices are known
+so they can be computed after the close (or overnight) and loaded at startup instead of being computed during the
+time critical window right before the market opens.
+
+layout : one dailySnapshotHeader followed by record_count dailyFeatureRecords sorted by ticker
+
+a snapshot is only used if its version matches, its checksums are valid, it was computed with the same inlier ranges
+the model is currently using, and its session is the last completed trading session - otherwise it is considered stale
+*/
+
+#ifndef SNAPSHOT_UTILS_H
+#define SNAPSHOT_UTILS_H
+
+#include "exceptUtils.h"
+#include "mmapUtils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+const uint32_t daily_snapshot_version = 1; //increment whenever the layout of the header or the records changes
+
+const char daily_snapshot_magic[8] = { 'Q', 'P', 'L', 'S', 'N', 'A', 'P', '\0' };
+
+//64-bit FNV-1a hash - used as a checksum for snapshot files
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+	const unsigned char* byte = static_cast<const unsigned char*>(data);
+
+	for (size_t i = 0; i < size; i++) { hash ^= byte[i]; hash *= 1099511628211ULL; }
+
+	return hash;
+}
+
+struct dailySnapshotHeader
+{
+	char magic[8];
+
+	uint32_t version = daily_snapshot_version;
+	uint32_t record_count = 0;
+
+	uint64_t ranges_checksum = 0; //checksum of the inlier ranges used to compute the features
+	uint64_t records_checksum = 0; //checksum of all of the records that follow the header
+
+	char session[16]; //date of the last completed trading session included in the features - YYYY-MM-DD
+};
+
+struct dailyFeatureRecord
+{
+	char ticker[16]; //null terminated ticker symbol
+
+	double previous_days_close = 0.0;
+	double average_volume = 0.0;
+	double mean = 0.0;
+	double std = 0.0;
+	double pp = 0.0;
+	double pm = 0.0;
+	double l = 0.0;
+	double E0 = 0.0;
+
+	uint32_t is_an_outlier = 1;
+	uint32_t reserved = 0;
+};
+
+static_assert(sizeof(dailySnapshotHeader) == 48, "The snapshot header layout changed - increment daily_snapshot_version.");
+static_assert(sizeof(dailyFeatureRecord) == 88, "The snapshot record layout changed - increment daily_snapshot_version.");
+
+class dailySnapshot //a memory mapped snapshot of daily features
+{
+public:
+	dailySnapshot();
+	~dailySnapshot();
+
+	//map the snapshot at the given path - returns false if the snapshot is missing, corrupted, or stale
+	bool load(const std::string&, const std::string&, const uint64_t);
+
+	//returns nullptr if there is no record for the ticker
+	const dailyFeatureRecord* find(const std::string&) const;
+
+	size_t size() const { return record_count; }
+
+private:
+	mappedFile file;
+
+	const dailyFeatureRecord* records = nullptr;
+	size_t record_count = 0;
+};
+
+//write a snapshot to the given path - the records are sorted by ticker before they are written
+void saveDailySnapshot(const std::string&, const std::string&, const uint64_t, std::vector<dailyFeatureRecord>&);
+
+#endif
@@ -0,0 +1,510 @@
+# A local HTTPS and websocket stand-in for the Alpaca endpoints the bot uses during its startup. It is used to benchmark
+# the data clients (download_benchmark) and the whole startup (startup_benchmark) offline.
+#
+# REST endpoints (on one port)
+#   /v2/calendar, /v2/clock, /v2/account, /v2/assets (--symbols assets with capital letter tickers)
+#   /v2/stocks/bars - 1Day bars on every weekday and 1Min bars of today between the start and end parameters, paginated by
+#   the limit parameter (capped by --page-limit) - requests without a start parameter get --bars-per-symbol bars per symbol
+#   /v2/stocks/snapshots - the daily bar and the latest minute bar of today
+# Websocket endpoints (same port)
+#   /v2/sip - the data stream : authenticates with the key header fields, confirms subscriptions, and sends a bar update for
+#   every subscribed symbol each --bar-seconds seconds (at the minute boundaries by default)
+#   /stream - the account stream : authorization and trade_updates listening messages
+#
+# Everything is generated (deterministic per symbol and date) unless --recorded is given : a recorded body is served for a
+# path if the directory has <path>.json (v2/account.json) or <path>/*.json files (v2/stocks/bars/0001.json, ...) - the
+# files of a directory are served in turn regardless of the request.
+#
+# Bodies are gzip encoded when the request accepts gzip unless --no-gzip is given, and are sent with chunked transfer
+# encoding when --chunked is given. --latency-ms delays every REST response and websocket reply. --rate-limit answers
+# with 429 once that many REST requests were received in the last minute, and every response carries the
+# X-RateLimit-Limit, X-RateLimit-Remaining, and X-RateLimit-Reset header fields Alpaca sends.
+#
+# Generate a self-signed certificate for localhost once :
+#   openssl req -x509 -newkey rsa:2048 -nodes -keyout key.pem -out cert.pem -days 365 -subj /CN=localhost -addext subjectAltName=DNS:localhost
+#
+# Then run :
+#   python3 stand_in_server.py --port 8443 --cert cert.pem --key key.pem
+
+import http.server
+import socketserver
+import collections
+import itertools
+import threading
+import argparse
+import datetime
+import zoneinfo
+import hashlib
+import base64
+import random
+import select
+import struct
+import string
+import json
+import gzip
+import math
+import time
+import ssl
+import os
+
+from urllib.parse import urlparse, parse_qs
+
+parser = argparse.ArgumentParser()
+
+parser.add_argument('--port', type=int, default=8443)
+parser.add_argument('--cert', default='cert.pem')
+parser.add_argument('--key', default='key.pem')
+parser.add_argument('--symbols', type=int, default=1000) # number of assets
+parser.add_argument('--bars-per-symbol', type=int, default=2000) # number of bars generated for each symbol of a request without a start date
+parser.add_argument('--page-limit', type=int, default=10000) # largest number of bars on a page whatever the limit parameter is
+parser.add_argument('--latency-ms', type=float, default=0.0) # delay before each response is sent
+parser.add_argument('--rate-limit', type=int, default=0) # REST requests allowed per minute - 0 for no limit
+parser.add_argument('--bar-seconds', type=float, default=60.0) # time between two rounds of bar updates on the data stream
+parser.add_argument('--recorded', default='') # directory of recorded bodies to serve instead of generated ones
+parser.add_argument('--no-gzip', action='store_true') # never compress the bodies
+parser.add_argument('--chunked', action='store_true') # send the bodies with chunked transfer encoding
+
+args = parser.parse_args()
+
+new_york = zoneinfo.ZoneInfo('America/New_York')
+first_day = datetime.date(2016, 1, 4)
+websocket_guid = '258EAFA5-E914-47DA-95CA-C5AB0DC85B11'
+
+page_cache = {}
+
+def recordedBodies():
+    bodies = {}
+
+    if not args.recorded: return bodies
+
+    for directory, _, names in os.walk(args.recorded):
+        for name in sorted(names):
+            if not name.endswith('.json'): continue
+
+            with open(os.path.join(directory, name), 'rb') as file: body = file.read()
+
+            relative = '/' + os.path.relpath(os.path.join(directory, name), args.recorded).replace(os.sep, '/')
+
+            bodies[relative[:-5]] = [body] # <path>.json
+            bodies.setdefault(os.path.dirname(relative), []).append(body) # <path>/*.json
+
+    return bodies
+
+recorded_bodies = recordedBodies()
+
+def tickers(count):
+    names = []
+
+    for length in (3, 4):
+        for letters in itertools.product(string.ascii_uppercase, repeat=length):
+            if len(names) == count: return names
+
+            names.append(''.join(letters))
+
+    return names
+
+assets = tickers(args.symbols)
+
+def today():
+    return datetime.datetime.now(new_york).date()
+
+def tradingDays(start, end):
+    day = start
+
+    while day <= end:
+        if day.weekday() < 5: yield day
+
+        day += datetime.timedelta(days=1)
+
+def parseDate(text):
+    return datetime.date.fromisoformat(text[:10])
+
+def formatTime(moment):
+    return moment.strftime('%Y-%m-%dT%H:%M:%SZ')
+
+def priceOn(symbol, index):
+    # a smooth trend per symbol with some noise - every bar only depends on its symbol and date so any range can be generated
+    shape = random.Random(symbol)
+    base = shape.uniform(2.0, 300.0)
+    slow = shape.uniform(0.0, 6.3)
+    fast = shape.uniform(0.0, 6.3)
+
+    return base * math.exp(0.4 * math.sin(index / 40.0 + slow) + 0.1 * math.sin(index / 7.0 + fast))
+
+def makeBar(moment, price, rng, volume_mean):
+    open_price = price * (1.0 + rng.gauss(0.0, 0.01))
+    high = max(open_price, price) * (1.0 + abs(rng.gauss(0.0, 0.005)))
+    low = min(open_price, price) * (1.0 - abs(rng.gauss(0.0, 0.005)))
+    volume = int(rng.lognormvariate(volume_mean, 1.0))
+
+    return {'c':round(price, 2), 'h':round(high, 2), 'l':round(low, 2), 'n':volume // 100 + 1, 'o':round(open_price, 2),
+            't':formatTime(moment), 'v':volume, 'vw':round((high + low + price) / 3.0, 4)}
+
+def dailyBar(symbol, day):
+    index = (day - first_day).days
+    rng = random.Random(symbol + day.isoformat())
+
+    return makeBar(datetime.datetime(day.year, day.month, day.day, 4, 0, 0), priceOn(symbol, index), rng, 13.0)
+
+def minuteBar(symbol, moment):
+    index = (moment.date() - first_day).days
+    rng = random.Random(symbol + formatTime(moment))
+
+    return makeBar(moment, priceOn(symbol, index) * (1.0 + 0.002 * math.sin(moment.minute / 9.0)), rng, 8.0)
+
+def lastMinute():
+    now = datetime.datetime.now(datetime.timezone.utc).replace(tzinfo=None)
+
+    return now.replace(second=0, microsecond=0) - datetime.timedelta(minutes=1)
+
+def minuteTimes(start, end):
+    # minute bars from 8am UTC (the pre-market) up to the last complete minute
+    moment = max(start, datetime.datetime.combine(today(), datetime.time(8, 0)))
+    end = min(end, lastMinute())
+    times = []
+
+    while moment <= end:
+        times.append(moment)
+        moment += datetime.timedelta(minutes=1)
+
+    return times
+
+def randomWalkBars(symbol, count): # the bars of a request without a start date (download_benchmark)
+    rng = random.Random(symbol) # the same symbol always gets the same bars
+    price = rng.uniform(2.0, 300.0)
+    bars = []
+
+    for i in range(count):
+        open_price = price
+        price = max(0.5, price * (1.0 + rng.gauss(0.0, 0.02)))
+        high = max(open_price, price) * (1.0 + abs(rng.gauss(0.0, 0.005)))
+        low = min(open_price, price) * (1.0 - abs(rng.gauss(0.0, 0.005)))
+        volume = int(rng.lognormvariate(13.0, 1.0))
+
+        bars.append({'c':round(price, 2), 'h':round(high, 2), 'l':round(low, 2), 'n':volume // 100, 'o':round(open_price, 2),
+                     't':(datetime.datetime(2016, 1, 4, 5, 0, 0) + datetime.timedelta(days=i)).strftime('%Y-%m-%dT%H:%M:%SZ'), 'v':volume, 'vw':round((high + low + price) / 3.0, 4)})
+
+    return bars
+
+def barTimes(query): # every symbol of a request gets bars at the same times - None for a request without a start date
+    if 'start' not in query: return None
+
+    start = query['start'][0]
+    end = query.get('end', [today().isoformat()])[0]
+
+    if query.get('timeframe', ['1Day'])[0] == '1Min':
+        parse = lambda text: datetime.datetime.fromisoformat(text.replace('Z', '')) if 'T' in text else datetime.datetime.fromisoformat(text)
+
+        return [('1Min', moment) for moment in minuteTimes(parse(start), parse(end))]
+
+    return [('1Day', day) for day in tradingDays(max(parseDate(start), first_day), min(parseDate(end), today()))]
+
+def barsOf(symbol, times, first, last):
+    if times is None: return randomWalkBars(symbol, args.bars_per_symbol)[first:last]
+
+    return [minuteBar(symbol, moment) if timeframe == '1Min' else dailyBar(symbol, moment) for timeframe, moment in times[first:last]]
+
+def barPage(query):
+    symbols = [symbol for symbol in query.get('symbols', [''])[0].split(',') if symbol]
+    limit = min(int(query.get('limit', ['1000'])[0]), args.page_limit)
+    offset = int(query.get('page_token', ['0'])[0]) # the page token is the number of bars on the previous pages
+
+    times = barTimes(query)
+    count = args.bars_per_symbol if times is None else len(times) # bars per symbol
+
+    # the batch is paginated as a whole - the bars of each symbol are contiguous
+    page = {}
+    returned = 0
+
+    for i, symbol in enumerate(symbols):
+        position = i * count
+
+        if position + count <= offset or not count: continue
+        if returned >= limit: break
+
+        first = max(0, offset - position)
+        last = min(count, first + limit - returned)
+
+        page[symbol] = barsOf(symbol, times, first, last)
+        returned += last - first
+
+    next_page_token = str(offset + returned) if offset + returned < count * len(symbols) else None
+
+    return {'bars':page, 'next_page_token':next_page_token}
+
+def snapshots(query):
+    symbols = [symbol for symbol in query.get('symbols', [''])[0].split(',') if symbol]
+    latest = lastMinute()
+    day = today()
+    result = {}
+
+    for symbol in symbols:
+        daily = dailyBar(symbol, day)
+        minute = minuteBar(symbol, latest)
+
+        daily['v'] = sum(minuteBar(symbol, moment)['v'] for moment in minuteTimes(datetime.datetime.combine(day, datetime.time(0, 0)), latest))
+
+        result[symbol] = {'dailyBar':daily, 'minuteBar':minute, 'prevDailyBar':dailyBar(symbol, day - datetime.timedelta(days=1)),
+                          'latestTrade':{'t':formatTime(latest), 'p':minute['c'], 's':100, 'x':'V', 'i':1, 'c':['@'], 'z':'A'}}
+
+    return result
+
+def calendar(query):
+    start = parseDate(query.get('start', [today().isoformat()])[0])
+    end = parseDate(query.get('end', [today().isoformat()])[0])
+
+    return [{'date':day.isoformat(), 'open':'09:30', 'close':'16:00', 'session_open':'0400', 'session_close':'2000'} for day in tradingDays(start, end)]
+
+def account():
+    return {'id':'stand-in', 'status':'ACTIVE', 'currency':'USD', 'cash':'100000', 'buying_power':'100000', 'non_marginable_buying_power':'100000',
+            'trading_blocked':False, 'trade_suspended_by_user':False, 'account_blocked':False, 'pattern_day_trader':False}
+
+def assetList():
+    return [{'id':str(i), 'class':'us_equity', 'exchange':('NYSE', 'NASDAQ', 'ARCA')[i % 3] if i % 10 == 9 else ('NYSE', 'NASDAQ')[i % 2],
+             'symbol':ticker, 'name':ticker + ' Inc.', 'status':'active', 'tradable':True, 'marginable':True, 'shortable':True,
+             'easy_to_borrow':True, 'fractionable':True, 'attributes':[]} for i, ticker in enumerate(assets)]
+
+def clock():
+    now = datetime.datetime.now(new_york)
+
+    return {'timestamp':now.isoformat(), 'is_open':True, 'next_open':now.isoformat(), 'next_close':now.isoformat()}
+
+class rateLimiter: # sliding window of one minute
+    def __init__(self, limit):
+        self.limit = limit
+        self.times = collections.deque()
+        self.lock = threading.Lock()
+
+    def admit(self): # returns (admitted, remaining, reset time)
+        now = time.time()
+
+        with self.lock:
+            while self.times and self.times[0] <= now - 60.0: self.times.popleft()
+
+            admitted = not self.limit or len(self.times) < self.limit
+
+            if admitted: self.times.append(now)
+
+            reset = int(self.times[0] + 60.0) if self.times else int(now)
+
+            return admitted, max(0, self.limit - len(self.times)), reset
+
+rate_limiter = rateLimiter(args.rate_limit)
+
+def encodeFrame(opcode, payload):
+    header = bytes([0x80 | opcode])
+
+    if len(payload) < 126: header += bytes([len(payload)])
+    elif len(payload) <= 0xFFFF: header += bytes([126]) + struct.pack('!H', len(payload))
+    else: header += bytes([127]) + struct.pack('!Q', len(payload))
+
+    return header + payload
+
+def takeFrame(buffer): # returns (opcode, payload) and removes the frame from the buffer - None if it was not fully received
+    if len(buffer) < 2: return None
+
+    size = buffer[1] & 0x7F
+    position = 2
+
+    if size == 126:
+        if len(buffer) < 4: return None
+        size = struct.unpack('!H', buffer[2:4])[0]
+        position = 4
+    elif size == 127:
+        if len(buffer) < 10: return None
+        size = struct.unpack('!Q', buffer[2:10])[0]
+        position = 10
+
+    mask = b''
+
+    if buffer[1] & 0x80:
+        mask = buffer[position:position + 4]
+        position += 4
+
+    if len(buffer) < position + size: return None
+
+    payload = bytes(buffer[position:position + size])
+
+    if mask: payload = bytes(byte ^ mask[i & 3] for i, byte in enumerate(payload))
+
+    opcode = buffer[0] & 0x0F
+
+    del buffer[:position + size]
+
+    return opcode, payload
+
+class handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1' # keep-alive and pipelining
+
+    def log_message(self, *arguments): pass
+
+    def delay(self):
+        if args.latency_ms > 0: time.sleep(args.latency_ms / 1000.0)
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        query = parse_qs(url.query)
+
+        if self.headers.get('Upgrade', '').lower() == 'websocket':
+            self.websocket(url.path)
+            return
+
+        admitted, remaining, reset = rate_limiter.admit()
+        limits = {'X-RateLimit-Limit':str(args.rate_limit), 'X-RateLimit-Remaining':str(remaining), 'X-RateLimit-Reset':str(reset)} if args.rate_limit else {}
+
+        if not admitted:
+            self.delay()
+            self.respond(429, b'{"message":"too many requests."}', limits, False)
+            return
+
+        compress = not args.no_gzip and 'gzip' in self.headers.get('Accept-Encoding', '')
+
+        if url.path in recorded_bodies:
+            bodies = recorded_bodies[url.path]
+            body = bodies[self.server.served % len(bodies)]
+            self.server.served += 1
+
+            if compress: body = gzip.compress(body, compresslevel=6)
+        elif url.path == '/v2/stocks/bars':
+            # generating and compressing a page is slow in python - cache them so the server doesn't dominate the timings
+            key = (url.query, compress)
+
+            if key not in page_cache or query.get('timeframe', [''])[0] == '1Min': # today's minute bars keep growing
+                page = json.dumps(barPage(query), separators=(',', ':')).encode()
+                page_cache[key] = gzip.compress(page, compresslevel=6) if compress else page
+
+            body = page_cache[key]
+        else:
+            generators = {'/v2/stocks/snapshots':lambda: snapshots(query), '/v2/calendar':lambda: calendar(query), '/v2/account':account,
+                          '/v2/assets':assetList, '/v2/clock':clock}
+
+            if url.path not in generators:
+                self.send_error(404)
+                return
+
+            body = json.dumps(generators[url.path](), separators=(',', ':')).encode()
+
+            if compress: body = gzip.compress(body, compresslevel=6)
+
+        self.delay()
+        self.respond(200, body, limits, compress)
+
+    def respond(self, status, body, fields, compressed):
+        self.send_response(status)
+        self.send_header('Content-Type', 'application/json; charset=UTF-8')
+
+        for name, value in fields.items(): self.send_header(name, value)
+
+        if compressed: self.send_header('Content-Encoding', 'gzip')
+
+        if args.chunked:
+            self.send_header('Transfer-Encoding', 'chunked')
+            self.end_headers()
+
+            for i in range(0, len(body), 8192):
+                chunk = body[i:i + 8192]
+                self.wfile.write(b'%x\r\n' % len(chunk) + chunk + b'\r\n')
+
+            self.wfile.write(b'0\r\n\r\n')
+        else:
+            self.send_header('Content-Length', str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+    def websocket(self, path):
+        if path not in ('/v2/sip', '/stream'):
+            self.send_error(404)
+            return
+
+        key = self.headers.get('Sec-WebSocket-Key', '')
+        accept = base64.b64encode(hashlib.sha1((key + websocket_guid).encode()).digest()).decode()
+
+        self.delay()
+        self.send_response(101)
+        self.send_header('Upgrade', 'websocket')
+        self.send_header('Connection', 'Upgrade')
+        self.send_header('Sec-WebSocket-Accept', accept)
+        self.end_headers()
+        self.wfile.flush()
+
+        self.close_connection = True
+
+        # the client waits for the response before sending anything so nothing is left in the buffer of rfile
+        connection = self.connection
+        buffer = bytearray()
+        subscribed = {'bars':set(), 'trades':set(), 'quotes':set()}
+        account_stream = (path == '/stream')
+
+        def send(message):
+            self.delay()
+            connection.sendall(encodeFrame(0x2 if account_stream else 0x1, json.dumps(message, separators=(',', ':')).encode()))
+
+        if not account_stream:
+            send([{'T':'success', 'msg':'connected'}])
+
+            if self.headers.get('APCA-API-KEY-ID'): send([{'T':'success', 'msg':'authenticated'}])
+
+        next_round = (math.floor(time.time() / args.bar_seconds) + 1) * args.bar_seconds
+
+        while True:
+            timeout = max(0.0, next_round - time.time())
+
+            if connection.pending() or select.select([connection], [], [], timeout)[0]:
+                data = connection.recv(65536)
+
+                if not data: return
+
+                buffer += data
+
+                while (frame := takeFrame(buffer)) is not None:
+                    opcode, payload = frame
+
+                    if opcode == 0x8:
+                        connection.sendall(encodeFrame(0x8, payload[:2]))
+                        return
+
+                    if opcode == 0x9:
+                        connection.sendall(encodeFrame(0xA, payload))
+                        continue
+
+                    if opcode not in (0x1, 0x2): continue
+
+                    message = json.loads(payload)
+                    action = message.get('action')
+
+                    if account_stream and action in ('auth', 'authenticate'):
+                        send({'stream':'authorization', 'data':{'action':'authenticate', 'status':'authorized'}})
+                    elif account_stream and action == 'listen':
+                        send({'stream':'listening', 'data':{'streams':message.get('data', {}).get('streams', [])}})
+                    elif not account_stream and action == 'auth':
+                        send([{'T':'success', 'msg':'authenticated'}])
+                    elif not account_stream and action == 'subscribe':
+                        for kind in subscribed: subscribed[kind].update(message.get(kind, []))
+
+                        send([{'T':'subscription', 'trades':sorted(subscribed['trades']), 'quotes':sorted(subscribed['quotes']), 'bars':sorted(subscribed['bars']),
+                               'updatedBars':[], 'dailyBars':[], 'statuses':[], 'lulds':[], 'corrections':[], 'cancelErrors':[]}])
+
+            if time.time() >= next_round:
+                next_round += args.bar_seconds
+
+                # the data stream sends several updates per message
+                latest = lastMinute()
+                updates = [dict(minuteBar(symbol, latest), T='b', S=symbol) for symbol in sorted(subscribed['bars'])]
+
+                for i in range(0, len(updates), 500): send(updates[i:i + 500])
+
+class server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+    served = 0
+
+if __name__ == '__main__':
+    stand_in = server(('127.0.0.1', args.port), handler)
+
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(args.cert, args.key)
+
+    stand_in.socket = context.wrap_socket(stand_in.socket, server_side=True)
+
+    print('serving the stand-in endpoints on https://localhost:' + str(args.port))
+
+    stand_in.serve_forever()
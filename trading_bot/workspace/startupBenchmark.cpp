@@ -0,0 +1,59 @@
+// startupBenchmark.cpp : Runs the startup of the bot (calendar, account, assets, daily features, websockets, volume sums,
+// and trade and quote subscriptions) against a local stand-in server (stand_in_server.py) and prints the time spent in
+// each phase. Linux only.
+//
+// usage : startup_benchmark <port> <certificate> <model weights> <model scales> [runs = 1]
+//
+// Every endpoint (REST and websockets) is reached on localhost:<port>. Run it from a directory without a daily snapshot
+// (daily_features.snapshot) to include the daily bars in the timings. The runs after the first one resume the TLS sessions
+// of the first one.
+
+
+#include "tradingBot.h"
+#include "exceptUtils.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 5)
+    {
+        std::cout << "usage : startup_benchmark <port> <certificate> <model weights> <model scales> [runs = 1]" << std::endl;
+
+        return 1;
+    }
+
+    const std::string stand_in = "localhost:" + std::string(argv[1]);
+    const int runs = (argc > 5) ? std::stoi(argv[5]) : 1;
+
+    SSLContextWrapper ssl_context; //destructor must be called after all sockets are closed
+
+    try
+    {
+        sharedTlsContext().trustCertificate(argv[2]);
+
+        for (int run = 1; run <= runs; run++)
+        {
+            std::cout << std::endl << "STARTUP " << run << " OF " << runs << std::endl;
+
+            //the stand-in server accepts any key
+            tradingBot bot(ssl_context, stand_in, stand_in, "stand-in-key", "stand-in-secret", 1000.0, 10.0);
+
+            bot.data_endpoint = stand_in;
+            bot.data_stream = stand_in;
+            bot.weights_path = argv[3];
+            bot.scales_path = argv[4];
+            bot.startup_only = true;
+
+            bot.start();
+        }
+    }
+    catch (const std::runtime_error& runtime_error) { std::cout << "Runtime Error caught : " << runtime_error.what() << std::endl; return 1; }
+    catch (const SSLNoReturn&) { std::cout << "Exception caught : A socket or websocket closed unexpectedly." << std::endl; return 1; }
+    catch (const exceptions::exception& exception) { std::cout << "Exception caught : " << exception.what() << std::endl; return 1; }
+    catch (const std::exception& exception) { std::cout << "Base Exception caught : " << exception.what() << std::endl; return 1; }
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+
+#include "startupUtils.h"
+
+#include <iostream>
+#include <iomanip>
+
+//Alpaca can send several objects in one message - look for any "T" field with the given value
+bool hasMessageType(const std::string& message, const std::string& type)
+{
+	size_t position = 0;
+
+	while ((position = message.find("\"T\"", position)) != std::string::npos)
+	{
+		position += 3;
+
+		while (position < message.size() && (message[position] == ' ' || message[position] == ':')) position++;
+
+		if (message.compare(position, type.size() + 2, "\"" + type + "\"") == 0) return true;
+	}
+
+	return false;
+}
+
+startupStreams::startupStreams(botWebsocket& Data_ws, botWebsocket& Account_ws, const std::string& Api_key, const std::string& Secret_key, const time_t Timeout)
+	: data_ws(Data_ws),
+	account_ws(Account_ws),
+	api_key(Api_key),
+	secret_key(Secret_key),
+	timeout(Timeout)
+{
+}
+
+startupStreams::~startupStreams()
+{
+	stopping = true;
+
+	if (worker.joinable()) worker.join();
+}
+
+void startupStreams::start()
+{
+	started = clock::now();
+
+	worker = std::thread(&startupStreams::run, this);
+}
+
+void startupStreams::subscribeBars(const std::vector<std::string>& tickers)
+{
+	std::lock_guard<std::mutex> lock(queue_mutex);
+
+	queued_tickers.insert(queued_tickers.end(), tickers.begin(), tickers.end());
+}
+
+std::vector<std::string> startupStreams::finish()
+{
+	finishing = true;
+
+	if (worker.joinable()) worker.join();
+
+	if (error) std::rethrow_exception(error);
+
+	return std::move(held_messages);
+}
+
+void startupStreams::run()
+{
+	try
+	{
+		openDataStream();
+
+		data_ready_seconds = std::chrono::duration<double>(clock::now() - started).count();
+
+		//send the subscriptions queued so far before the account websocket handshake
+		size_t confirmations_pending = sendQueuedSubscription() ? 1 : 0;
+
+		clock::time_point last_sent = clock::now();
+
+		openAccountStream();
+
+		account_ready_seconds = std::chrono::duration<double>(clock::now() - started).count();
+
+		std::string message;
+
+		while (!stopping)
+		{
+			bool busy = false;
+
+			if (sendQueuedSubscription())
+			{
+				confirmations_pending++;
+				last_sent = clock::now();
+				busy = true;
+			}
+
+			if (data_ws.recv(message))
+			{
+				busy = true;
+
+				if (hasMessageType(message, "error")) throw exceptions::exception("Error received by the data websocket : " + message);
+				if (hasMessageType(message, "subscription") && confirmations_pending) confirmations_pending--;
+				if (hasMessageType(message, "b")) held_messages.push_back(message);
+			}
+
+			if (confirmations_pending && clock::now() - last_sent > std::chrono::seconds(timeout)) throw exceptions::exception("Could not subscribe to bar updates.");
+
+			if (finishing && !confirmations_pending)
+			{
+				std::lock_guard<std::mutex> lock(queue_mutex);
+
+				if (!queued_tickers.size()) break;
+			}
+
+			if (!busy) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	catch (...) { error = std::current_exception(); }
+}
+
+std::string startupStreams::waitForMessage(botWebsocket& ws)
+{
+	std::string message;
+
+	clock::time_point deadline = clock::now() + std::chrono::seconds(timeout);
+
+	while (!ws.recv(message))
+	{
+		if (stopping) throw exceptions::exception("The startup was stopped.");
+		if (clock::now() > deadline) throw exceptions::exception("Timed out waiting for a websocket message.");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return message;
+}
+
+bool startupStreams::sendQueuedSubscription()
+{
+	std::string symbol_list;
+
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+
+		if (!queued_tickers.size()) return false;
+
+		for (const std::string& ticker : queued_tickers) symbol_list += "\"" + ticker + "\",";
+
+		queued_tickers.clear();
+	}
+
+	symbol_list.pop_back();
+
+	data_ws.send("{\"action\": \"subscribe\", \"bars\": [" + symbol_list + "]}", WS_TEXT_FRAME);
+
+	subscriptions_sent++;
+
+	return true;
+}
+
+void startupStreams::openDataStream()
+{
+	dictionary ws_headers;
+	dictionary response_data;
+
+	http::httpResponse response;
+	JSONParser json_parser;
+
+	ws_headers["APCA-API-KEY-ID"] = api_key;
+	ws_headers["APCA-API-SECRET-KEY"] = secret_key;
+	ws_headers["Upgrade"] = "websocket";
+	ws_headers["Connection"] = "Upgrade";
+	ws_headers["Sec-WebSocket-Version"] = "13";
+	ws_headers["Sec-Websocket-Key"] = generateRandomBase64String(16);
+
+	data_ws.reInit();
+	data_ws.open(ws_headers, "/v2/sip", response);
+
+	if (response.status_code != 101) //should be 101 switching protocols
+	{
+		throw exceptions::exception(std::to_string(response.status_code) + " status code not accounted for.");
+	}
+
+	//the first message should indicate a successful connection
+
+	std::string message = waitForMessage(data_ws);
+
+	json_parser.parseJSON(response_data, message); //expecting a JSON array with one json object
+
+	if (response_data.find("msg") == response_data.end()) throw exceptions::exception("Could not confirm connection for the data websocket.");
+	if (response_data["msg"] != "connected") throw exceptions::exception("Unexpected message received; Expecting \"connected\".");
+	if (response_data.find("T") == response_data.end()) throw exceptions::exception("Could not confirm connection for the data websocket.");
+	if (response_data["T"] != "success") throw exceptions::exception("Connection attempt for the data websocket was unsuccessful.");
+
+	//the second message should indicate successful authentication
+
+	message = waitForMessage(data_ws);
+
+	response_data.clear();
+
+	json_parser.parseJSON(response_data, message); //expecting a JSON array with one json object
+
+	if (response_data.find("msg") == response_data.end()) throw exceptions::exception("Could not verify authentication for the data websocket.");
+	if (response_data["msg"] != "authenticated") throw exceptions::exception("Unexpected message received; Expecting \"authenticated\".");
+	if (response_data.find("T") == response_data.end()) throw exceptions::exception("Could not verify authentication for the data websocket.");
+	if (response_data["T"] != "success") throw exceptions::exception("Authentication attempt for the data websocket was unsuccessful.");
+}
+
+void startupStreams::openAccountStream()
+{
+	dictionary ws_headers;
+	dictionary response_data;
+
+	http::httpResponse response;
+	JSONParser json_parser;
+
+	ws_headers["Upgrade"] = "websocket";
+	ws_headers["Connection"] = "Upgrade";
+	ws_headers["Sec-WebSocket-Version"] = "13";
+	ws_headers["Sec-Websocket-Key"] = generateRandomBase64String(16);
+
+	account_ws.reInit();
+	account_ws.open(ws_headers, "/stream", response);
+
+	if (response.status_code != 101) //should be 101 switching protocols
+	{
+		throw exceptions::exception(std::to_string(response.status_code) + " status code not accounted for.");
+	}
+
+	//send an authorization message to start listening for account updates and wait for confirmation
+	//the response message should indicate a successful authentication
+
+	account_ws.send("{\"action\": \"auth\", \"key\": \"" + api_key + "\", \"secret\": \"" + secret_key + "\"}", WS_TEXT_FRAME);
+
+	std::string message = waitForMessage(account_ws);
+
+	json_parser.parseJSON(response_data, message);
+
+	if (response_data.find("stream") == response_data.end()) throw exceptions::exception("Unknown message received from the account websocket.");
+	if (response_data["stream"] != "authorization") throw exceptions::exception("Unexpected message received from the account websocket.");
+	if (response_data.find("data") == response_data.end()) throw exceptions::exception("Could not confirm authorization for the account websocket.");
+
+	json_parser.parseJSON(response_data, response_data["data"]);
+
+	if (response_data.find("action") == response_data.end()) throw exceptions::exception("Unknown message received from the account websocket.");
+	if (response_data["action"] != "authenticate") throw exceptions::exception("Could not confirm authorization for the account websocket.");
+	if (response_data.find("status") == response_data.end()) throw exceptions::exception("Unknown message received from the account websocket.");
+	if (response_data["status"] != "authorized") throw exceptions::exception("Authorization for the account websocket failed.");
+
+	//send a message to start listening for account updates and wait for confirmation
+	//the second message should indicate an active trade updates stream
+
+	account_ws.send("{\"action\": \"listen\", \"data\": {\"streams\": [\"trade_updates\"]}}", WS_TEXT_FRAME);
+
+	message = waitForMessage(account_ws);
+
+	response_data.clear();
+
+	json_parser.parseJSON(response_data, message);
+
+	if (response_data.find("stream") == response_data.end()) throw exceptions::exception("Unknown message received from the account websocket.");
+	if (response_data["stream"] != "listening") throw exceptions::exception("Unexpected message received from the account websocket.");
+	if (response_data.find("data") == response_data.end()) throw exceptions::exception("Could not subscribe to trade updates for the account websocket.");
+
+	json_parser.parseJSON(response_data, response_data["data"]);
+
+	if (response_data.find("streams") == response_data.end()) throw exceptions::exception("The account websocket is not listening to any streams.");
+	if (response_data["streams"].find("\"trade_updates\"") == std::string::npos) throw exceptions::exception("The account websocket is not listening for trade updates.");
+}
+
+void phaseTimer::mark(const std::string& phase)
+{
+	clock::time_point now = clock::now();
+
+	phases.emplace_back(phase, std::chrono::duration<double>(now - last).count());
+
+	last = now;
+}
+
+void phaseTimer::print() const
+{
+	std::cout << std::fixed << std::setprecision(3);
+
+	for (const std::pair<std::string, double>& phase : phases) std::cout << phase.first << " : " << phase.second << " SECONDS" << std::endl;
+
+	std::cout << "READY TO TRADE " << total() << " SECONDS AFTER THE STARTUP BEGAN" << std::endl;
+
+	std::cout.unsetf(std::ios_base::floatfield);
+	std::cout << std::setprecision(6);
+}
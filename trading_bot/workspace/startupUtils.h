@@ -0,0 +1,119 @@
+
+/*
+Overlap the websocket handshakes with the rest of the startup.
+
+startupStreams opens the data and account websockets on a background thread while the bot requests the account, the
+assets, and the daily history. The thread
+	opens the data websocket and waits for the connected and authenticated messages
+	opens the account websocket, authenticates it, and starts listening for trade updates
+	sends the tickers queued with subscribeBars() as bar subscriptions once the data websocket is authenticated - ...
+	... tickers queued while a subscription is being sent are grouped into the next one
+	holds every bar update it receives so none of them is lost before the symbols are ready to be updated
+
+The startup steps are guaranteed to happen in this order
+	the websockets are only used by the thread until finish() returns and only by the caller afterwards
+	bar subscriptions are only sent after the data websocket was authenticated
+	finish() only returns once every subscription that was queued has been confirmed and the account websocket is ...
+	... listening for trade updates, so no order can be placed before its updates can be received
+	the held bar updates are returned in the order they were received and have to be parsed after the volume sums ...
+	... were initialized (see getSnapshotVolumes) - each bar is then counted once no matter when it was received
+
+Every wait on the thread is limited by the timeout. Errors on the thread are rethrown by finish().
+
+phaseTimer measures the time spent in each phase of the startup.
+*/
+
+#ifndef STARTUP_UTILS_H
+#define STARTUP_UTILS_H
+
+#include "asyncWsUtils.h"
+#include "jsonUtils.h"
+#include "httpUtils.h"
+#include "exceptUtils.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <utility>
+#include <ctime>
+
+bool hasMessageType(const std::string&, const std::string&); //true if a data websocket message contains an object of the given type ("b", "subscription", ...)
+
+class startupStreams
+{
+public:
+	startupStreams(botWebsocket&, botWebsocket&, const std::string&, const std::string&, const time_t); //data websocket, account websocket, api key, secret key, timeout
+	~startupStreams(); //stops the thread if finish() was not called
+
+	startupStreams(const startupStreams&) = delete;
+	startupStreams& operator=(const startupStreams&) = delete;
+
+	void start(); //start opening the websockets
+	void subscribeBars(const std::vector<std::string>&); //queue bar subscriptions for these tickers - can be called before the data websocket is ready
+
+	std::vector<std::string> finish(); //wait until every step is done and return the bar updates received in the meantime
+
+	double data_ready_seconds = 0.0; //time after start() when the data websocket was authenticated
+	double account_ready_seconds = 0.0; //time after start() when the account websocket was listening for trade updates
+
+	size_t subscriptions_sent = 0; //number of bar subscription messages sent
+
+private:
+	typedef std::chrono::steady_clock clock;
+
+	botWebsocket& data_ws;
+	botWebsocket& account_ws;
+
+	std::string api_key;
+	std::string secret_key;
+
+	time_t timeout;
+
+	std::thread worker;
+
+	std::mutex queue_mutex;
+	std::vector<std::string> queued_tickers; //tickers waiting to be subscribed to - guarded by queue_mutex
+
+	std::atomic<bool> finishing{ false }; //set by finish() - the thread stops once every queued subscription is confirmed
+	std::atomic<bool> stopping{ false }; //set by the destructor - the thread stops as soon as possible
+
+	std::exception_ptr error; //the error that stopped the thread
+
+	std::vector<std::string> held_messages; //bar updates received by the thread
+
+	clock::time_point started;
+
+	void run(); //the body of the thread
+
+	void openDataStream();
+	void openAccountStream();
+
+	std::string waitForMessage(botWebsocket&); //wait for the next message - throws if none is received before the timeout
+	bool sendQueuedSubscription(); //returns true if a subscription was sent
+};
+
+class phaseTimer //time spent in each phase of the startup
+{
+public:
+	phaseTimer() : started(clock::now()), last(started) {}
+
+	void mark(const std::string&); //the phase with this name ended now
+
+	double total() const { return std::chrono::duration<double>(last - started).count(); } //seconds from the start to the last mark
+
+	void print() const;
+
+private:
+	typedef std::chrono::steady_clock clock;
+
+	clock::time_point started;
+	clock::time_point last;
+
+	std::vector<std::pair<std::string, double>> phases;
+};
+
+#endif
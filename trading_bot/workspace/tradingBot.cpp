@@ -11,7 +11,8 @@ tradingBot::tradingBot(const SSLContextWrapper& SSL_context_wrapper, const std::
 	allocated_buying_power(Allocated_buying_power),
 	risk_per_trade(Risk_per_trade),
 	ssl_context_wrapper(const_cast<SSLContextWrapper&>(SSL_context_wrapper)),
-	time_proto()
+	time_proto(),
+	request_scheduler(default_requests_per_minute, max_clients)
 {}
 
 inline void sleepFor(time_t sleep_time)
@@ -27,24 +28,138 @@ inline double roundPrice(const double price) //limit prices under 1 USD can have
 }
 
 //perform http get request until it is completed without the socket closing (this happens very rarely)
-inline void getUntil(const SSLContextWrapper& ssl_context_wrapper, http::httpResponse& response, const dictionary& parameters, const dictionary& headers,
+inline void getUntil([[maybe_unused]] const SSLContextWrapper& ssl_context_wrapper, http::httpResponse& response, const dictionary& parameters, const dictionary& headers,
 	const std::string& host, const std::string& path, time_t timeout, int allowed_retries)
 {
 	while (allowed_retries > 0)
 	{
+#ifdef USE_REST_POOL
+		try { sharedRestPool().request("GET", host, parameters, headers, path, "", response, timeout); return; }
+		catch (const connectionLost&)
+		{
+			response.clear();
+			sleepFor(timeout);
+		}
+#else
 		try { http::get(ssl_context_wrapper, response, parameters, headers, host, path, timeout); return; }
 		catch (const SSLNoReturn&)
 		{
 			response.clear();
 			sleepFor(timeout);
 		}
-
+#endif
 		allowed_retries--;
 	}
 
 	throw exceptions::exception(std::string("Http get request failed to complete within ") + std::to_string(allowed_retries) + std::string(" attempts."));
 }
 
+//send an order request - on the persistent connection to the account endpoint when the rest pool is used
+inline void sendOrderRequest([[maybe_unused]] const SSLContextWrapper& ssl_context_wrapper, http::httpResponse& response, const std::string& method, const dictionary& parameters,
+	const dictionary& headers, const std::string& host, const std::string& path, const std::string& body, time_t timeout)
+{
+#ifdef USE_REST_POOL
+	//orders are never sent twice - the server may or may not have received an order whose response was lost
+	try { sharedRestPool().request(method, host, parameters, headers, path, body, response, timeout); }
+	catch (const connectionLost&) { throw exceptions::exception("Lost the connection before receiving the response to " + method + " " + path + "."); }
+#else
+	if (method == "POST") http::post(ssl_context_wrapper, response, parameters, headers, host, path, body, timeout);
+	else if (method == "PATCH") http::patch(ssl_context_wrapper, response, parameters, headers, host, path, body, timeout);
+	else http::del(ssl_context_wrapper, response, parameters, headers, host, path, timeout);
+#endif
+}
+
+//keep the persistent REST connections open while the bot is not busy
+inline void probeRestConnections()
+{
+#ifdef USE_REST_POOL
+	sharedRestPool().probeIdle();
+#endif
+}
+
+//print the number of TLS handshakes and an estimate of the handshake time saved by reused connections and resumed sessions
+inline void printConnectionReport()
+{
+#ifdef USE_REST_POOL
+	const handshakeCounts tls = sharedTlsContext().counts();
+	const restPool& pool = sharedRestPool();
+
+	//the times include the TCP connection - every connection of the bar clients is counted as well
+	double full = tls.handshakes ? tls.handshake_seconds / tls.handshakes : 0.0;
+	double resumed = tls.resumed_handshakes ? tls.resumed_handshake_seconds / tls.resumed_handshakes : full;
+
+	double saved = pool.reused_requests * full + tls.resumed_handshakes * (full - resumed);
+
+	std::cout << tls.handshakes << " FULL TLS HANDSHAKES (~" << full * 1000.0 << " MS EACH) - " << tls.resumed_handshakes << " RESUMED (~" << resumed * 1000.0 << " MS EACH)" << std::endl;
+	std::cout << pool.reused_requests << " OF " << pool.requests << " REST REQUESTS REUSED A CONNECTION - " << pool.redials << " CONNECTIONS OPENED AGAIN - ";
+	std::cout << pool.probes << " KEEP-ALIVE REQUESTS - ~" << saved * 1000.0 << " MS OF HANDSHAKES SAVED" << std::endl;
+#endif
+}
+
+//print the number of crossings the bot scored and the average size of their batches
+inline void printBatchReport([[maybe_unused]] const symbolData& symbol_data)
+{
+#ifdef USE_BATCHED_PREDICTIONS
+	double average = symbol_data.model_calls ? static_cast<double>(symbol_data.scored_crossings) / symbol_data.model_calls : 0.0;
+
+	std::cout << symbol_data.scored_crossings << " CROSSINGS SCORED IN " << symbol_data.model_calls << " BATCHES (" << average << " PER BATCH)" << std::endl;
+#endif
+}
+
+//time between the delay reports while trading
+const time_t delay_report_seconds = 300;
+
+//measure the delays of the message the websocket just returned
+inline void recordDelays([[maybe_unused]] const botWebsocket& ws, [[maybe_unused]] const std::string& message, [[maybe_unused]] streamDelays& delays)
+{
+#ifdef USE_RX_TIMESTAMPS
+	delays.record(ws.lastTiming(), message);
+#endif
+}
+
+//print the delays of the websocket messages received since the last report and start over
+inline void printDelayReport([[maybe_unused]] streamDelays& data_delays, [[maybe_unused]] streamDelays& account_delays)
+{
+#ifdef USE_RX_TIMESTAMPS
+	data_delays.print("DATA WEBSOCKET");
+	account_delays.print("ACCOUNT WEBSOCKET");
+
+	data_delays.clear();
+	account_delays.clear();
+#endif
+}
+
+//swap in the model loaded by the thread of the model holder if there is one - only called while the bot is not busy (between messages)
+inline void swapModel([[maybe_unused]] modelHolder& models, [[maybe_unused]] symbolData& symbol_data)
+{
+#ifdef USE_MODEL_SWAP
+	if (!models.ready()) return;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	symbol_data.model = &models.swap();
+#ifdef USE_DAILY_INPUTS
+	symbol_data.daily_inputs = models.activeDailyInputs(); //computed by the thread with the new model
+#endif
+
+	const auto stop = std::chrono::steady_clock::now();
+
+	std::cout << "SWAPPED IN THE NEW MODEL - THE DATA LOOP WAS HELD FOR " << std::chrono::duration<double, std::micro>(stop - start).count() << " US" << std::endl;
+#endif
+}
+
+//print a delay report if the last one was printed at least delay_report_seconds ago - only called while the bot is not busy
+inline void reportDelays([[maybe_unused]] streamDelays& data_delays, [[maybe_unused]] streamDelays& account_delays, [[maybe_unused]] time_t& next_report)
+{
+#ifdef USE_RX_TIMESTAMPS
+	if (time(nullptr) < next_report) return;
+
+	printDelayReport(data_delays, account_delays);
+
+	next_report = time(nullptr) + delay_report_seconds;
+#endif
+}
+
 void tradingBot::start()
 {
 	try
@@ -71,7 +186,7 @@ void tradingBot::start()
 
 #ifndef TRADE_BOT_DEBUG
 
-			if (time_proto.iso_weekday == 6) //if today is saturday sleep until monday
+			if (time_proto.iso_weekday == 6 && !startup_only) //if today is saturday sleep until monday
 			{
 				std::cout << "SLEEPING UNTIL MONDAY" << std::endl;
 
@@ -83,7 +198,7 @@ void tradingBot::start()
 			}
 
 			//if current time is past 3:50pm EST or today is sunday then sleep until the next day
-			if (time_proto.iso_weekday == 0 || time(nullptr) > time_proto.getSecondsSinceEpoch(0, 15, 50, 0))
+			if ((time_proto.iso_weekday == 0 || time(nullptr) > time_proto.getSecondsSinceEpoch(0, 15, 50, 0)) && !startup_only)
 			{
 				std::cout << "SLEEPING UNTIL TOMORROW" << std::endl;
 
@@ -96,7 +211,7 @@ void tradingBot::start()
 
 			time_t sleep_time = time_proto.getSecondsSinceEpoch(0, data_start_hour, data_start_minute, 0) - time(nullptr); //sleep until starting time of today
 
-			if (sleep_time > 0) sleepFor(sleep_time);
+			if (sleep_time > 0 && !startup_only) sleepFor(sleep_time);
 
 			/*
 			check to see if today is a market holiday
@@ -114,6 +229,8 @@ void tradingBot::start()
 			time_t timeout = 10; //timeout in seconds
 			int allowed_retries = 6; //number of times some requests can be retried
 
+			phaseTimer startup_timer; //time spent in each phase of the startup
+
 			dictionary headers;
 			dictionary parameters;
 
@@ -163,6 +280,27 @@ void tradingBot::start()
 
 				continue;
 			}
+#endif
+			startup_timer.mark("CALENDAR");
+
+			/*
+			open and authenticate the data and account websockets on a background thread while the rest of the startup runs
+				the bar subscriptions are queued as the symbols pass the daily checks - see startupUtils.h for the ordering guarantees
+			*/
+
+			botWebsocket data_ws(ssl_context_wrapper, data_stream, false, false, timeout); //this websocket receives trade and bar updates
+			botWebsocket account_ws(ssl_context_wrapper, trade_update_stream, false, false, timeout); //this websocket receives account updates
+
+			startupStreams streams(data_ws, account_ws, alpaca_api_key, alpaca_secret_key, timeout);
+
+			streams.start();
+
+#ifdef USE_SNAPSHOT_VOLUMES
+			//every bar update is reconciled with the snapshots by its timestamp, so a symbol can be subscribed to as soon as it passes the daily checks
+			const bool subscribe_early = true;
+#else
+			//the minute bar backfill ends one minute before the first bar update, so every symbol has to be subscribed to at once
+			const bool subscribe_early = false;
 #endif
 			/*
 			get the current capital in your alpaca account
@@ -183,422 +321,129 @@ void tradingBot::start()
 			if (non_marginable_buying_power < allocated_buying_power) throw exceptions::exception("Not enough cash to allocate to this bot.");
 			if (allocated_buying_power < risk_per_trade) throw exceptions::exception("Not enough cash to risk on a single trade.");
 
+			startup_timer.mark("ACCOUNT");
+
 			/*
 			get all available stocks to trade
 			*/
 
-			parameters["status"] = "active";
-			parameters["asset_class"] = "us_equity";
-
-			response.clear();
-
-			getUntil(ssl_context_wrapper, response, parameters, headers, account_endpoint, "/v2/assets", timeout, allowed_retries);
-
-			if (response.status_code != 200) throw exceptions::exception(std::to_string(response.status_code) + " status code not accounted for.");
-
 			std::vector<symbol> symbols;
 
-			symbols.reserve(10000);
-
-			//gather all active symbols
-			getAvailableSymbols(symbols, response.message);
-
-			if (!symbols.size()) throw exceptions::exception("No symbols available to trade.");
+			getSymbols(symbols, headers, timeout, allowed_retries);
 
-			size_t num_symbols_left = symbols.size() - 1;
+			startup_timer.mark("ASSETS");
 
 			/*
 			gather daily data and calculate daily features for symbols
+				if the offline snapshot mode already computed them after the last close then load them from the snapshot
+				otherwise gather the daily bars and compute them now
 			*/
 
-			parameters.clear();
-
-			char start_date[11];
-			char yesterday[11];
-
-			time_proto.getPastDate(start_date, past_days);
-			time_proto.getPastDate(yesterday, 1);
-
-			parameters["timeframe"] = "1Day";
-			parameters["start"] = std::string(start_date);
-			parameters["end"] = std::string(yesterday);
-			parameters["limit"] = "10000";
-			parameters["adjustment"] = "all";
-			parameters["feed"] = "sip";
+			std::string last_session = getLastSession(headers, timeout, allowed_retries);
 
 			//the next connection will be reused
 			headers["Connection"] = "keep-alive";
 
-			JSONArrayParser<bar, dailyBarContainer, updateDailyBar, updateDailyData> dailyParser; //used to parse arrays of daily bars
-
-			MLModel model; //contains the MLP and inlier ranges for the inputs
+			modelHolder models; //the model in use and the standby model a retrained model is loaded into while the bot runs (see USE_MODEL_SWAP)
+			MLModel& model = models.active(); //contains the MLP and inlier ranges for the inputs
 			time_t START = time(nullptr);
 
 			//load model ranges and weights here
-			//both of the files must be in the same directory as the executable on Windows (home directory on Mac and Linux - the directory that contains the Desktop folder)
-			model.loadWeights("C:\\Users\\Michael\\Desktop\\qpl_bot_strategy_equities\\x64\\Debug\\model_weights.json");
-			model.loadScales("C:\\Users\\Michael\\Desktop\\qpl_bot_strategy_equities\\x64\\Debug\\scaler_info.json");
-
-			//create multiple http clients with non-blocking I/O to retrieve data - using to many might cause the bot to exceed the api call rate limit
-			const int num_clients = (max_clients > num_symbols_left) ? num_symbols_left : max_clients; //number of http clients to use for asynchronous data retrieval
-
-			std::vector<dailyBarContainer> daily_bars;
-			std::vector<http::httpClient> data_clients;
-			std::vector<http::httpResponse> responses;
-			std::vector<dictionary> client_parameters;
-			std::vector<dictionary> client_headers;
-			std::vector<size_t> current_symbols; //the indices of the symbols that are currently being evaluated
-
-			//checking out of a static array is much faster than doing so out of a vector
-			array<bool, max_clients> retired; //retired[i] is true if data_clients[i] is done being used to gather data
-
-			client_parameters.reserve(num_clients);
-			current_symbols.reserve(num_clients);
-			client_headers.reserve(num_clients);
-			data_clients.reserve(num_clients);
-			daily_bars.reserve(num_clients);
-			responses.reserve(num_clients);
-			
-			int i; //loop index
-
-			for (i = 0; i < num_clients; i++)
-			{
-				data_clients.push_back(http::httpClient(ssl_context_wrapper, "data.alpaca.markets", false, timeout));
-				responses.push_back(http::httpResponse());
-
-				client_parameters.push_back(parameters);
-				client_headers.push_back(headers);
-				retired.push_back(false);
+#if defined(USE_CONSTANT_MODEL)
+			model.loadScales(scales_path); //only the inlier ranges are used - the weights and the scales of the features were compiled in
 
-				client_parameters[i]["symbols"] = symbols[num_symbols_left].ticker;
+			if (!model.useConstantModel()) std::cout << "THE MODEL COMPILED IN WAS NOT TRAINED WITH " << scales_path << " - BUILD THE BOT AGAIN AFTER RETRAINING" << std::endl;
 
-				current_symbols.push_back(num_symbols_left);
-				daily_bars.push_back(dailyBarContainer());
-
-				num_symbols_left--;
-
-				responses[i].clear();
+			std::cout << "USING THE MODEL COMPILED INTO THE BOT" << std::endl;
+#elif defined(USE_MODEL_FILE)
+			if (model.loadModelFile(model_path)) std::cout << "LOADED THE MODEL FROM " << model_path << std::endl;
+			else
+			{
+				std::cout << "NO VALID MODEL FILE FOUND - READING THE JSON FILES (RUN MODEL_CONVERTER TO WRITE " << model_path << ")" << std::endl;
 
-				data_clients[i].reConnect(); //connect to the host
-				data_clients[i].get(client_parameters[i], client_headers[i], "/v2/stocks/bars"); //prepare the get request
+				model.loadWeights(weights_path);
+				model.loadScales(scales_path);
 			}
+#else
+			model.loadWeights(weights_path);
+			model.loadScales(scales_path);
+#endif
+#ifdef USE_QUANTIZED_MODEL
+			model.loadCalibration(calibration_path);
+#endif
 
-			int active_clients = num_clients; //number of http clients that are still retrieving data
-			http::status current_status; //current status of the current response being received
-			bool last_page = false; //true if the last page of the current request has just been fully read
-
-			int lookback_period = 0; //the lookback period for the qpl calculation
-			bar* bar_ptr = nullptr; //bar pointer used to iterate through daily bars
-
-			double average_volume = 0.0; //70-day daily average volume
-
-			double r_min = 0.0; //minimum relative return - for each stock
-			double r_max = 0.0; //maximum relative return - for each stock
-
-			double mean = 0.0; //average relative return - for each stock
-			double std = 0.0; //standard deviation of relative returns - for each stock
-
-			int total_count = 0; //total number of returns used to calculate the mean, std, and probability density
-
-			int pp_partial_count = 0; //number of returns used to calculate the probability density at mean + dr
-			int pm_partial_count = 0; //number of returns used to calculate the probability density at mean - dr
-
-			double r_scale = 0.0; //bin width per unit return
-			double dr = 0.0;
-
-			int drp1 = 0; //index of the bin at mean + dr
-			int drm1 = 0; //index of the bin at mean - dr
-
-			double pm = 0.0; //p(mean - dr)
-			double pp = 0.0; //p(mean + dr)
-
-			double rps = 0.0;
-			double rms = 0.0;
-
-			double C0 = 0.0;
-			double C1 = 0.0;
+			dailySnapshot snapshot;
 
-			double l = 0.0; //lambda
-			double l_numerator = 0.0; //numerator of lambda
-			double l_denominator = 0.0; //denominator of lambda
+			bool subscribed = false; //true once the bar subscription of every symbol left to trade was queued
 
-			//use non-blocking IO to read data from multiple sockets in a single thread
-			while (active_clients > 0)
+			if (snapshot.load(daily_snapshot_path, last_session, dailyRangesChecksum(model.ranges)))
 			{
-				for (i = 0; i < num_clients; i++)
-				{
-					if (retired[i]) continue; //if we are no longer using this client then move on to the next one
-
-					http::httpClient& current_client = data_clients[i];
-					http::httpResponse& current_response = responses[i];
-
-					try { current_status = current_client.recvResponse(current_response); }
-					catch (const SSLNoReturn&) //the connection was closed
-					{
-						current_response.clear();
-
-						current_client.reConnect(); //reconnect to the host
-						current_client.get(client_parameters[i], client_headers[i], "/v2/stocks/bars"); //prepare the get request
-
-						continue;
-					}
-
-					if (current_status == http::status::TIMED_OUT) throw exceptions::exception("Timed out while retrieving stock data.");
-					if (current_status == http::status::RECEIVED_RESPONSE)
-					{
-						if (current_response.status_code == 429)
-						{
-							throw exceptions::exception("Exceeded the Alpaca API Rate limit. Reduce the maximum number of http clients retrieving data.");
-						}
-
-						if (current_response.status_code != 200)
-						{
-							throw exceptions::exception("Received an unexpected status code : " + std::to_string(current_response.status_code)\
-								+ " - with the following message : " + current_response.status_message);
-						}
-
-						response_data.clear();
-						response_data.rehash(4);
-
-						json_parser.parseJSON(response_data, current_response.message);
-
-						symbol& current_symbol = symbols[current_symbols[i]];
-
-						if (response_data.find("bars") != response_data.end())
-						{
-							if (response_data["bars"].size() > 2) //if json exists and is not empty
-							{
-								json_parser.parseJSON(response_data, response_data["bars"]);
-
-								//read data from daily bars and append it somewhere from here
-								dailyParser.parseJSONArray(response_data[current_symbol.ticker], daily_bars[i]);
-
-								if (response_data.find("next_page_token") == response_data.end()) last_page = true;
-								else if (response_data["next_page_token"] == "null") last_page = true;
-								else last_page = false;
-							}
-							else last_page = true;
-						}
-						else last_page = true;
-
-						if (last_page) //compute daily features and send get request for the next stock
-						{
-							//compute daily features here
-							current_symbol.is_an_outlier = true; //if all inlier conditions are met this will be set to false
+				std::cout << "LOADED DAILY FEATURES OF " << snapshot.size() << " SYMBOLS FROM THE SNAPSHOT OF " << last_session << std::endl;
 
-							if (daily_bars[i].size() >= model.ranges.min_completed_trading_days) //I require at least 500 closing prices to calculate the price levels
-							{
-								bar_ptr = &daily_bars[i].back();
-
-								//check that the previous day's closing price is not an outlier
-								if (bar_ptr->c >= model.ranges.min_previous_days_closing_price && bar_ptr->c <= model.ranges.max_previous_days_closing_price)
-								{
-									current_symbol.previous_days_close = bar_ptr->c;
-
-									//calculate the daily average volume
-									average_volume = 0;
-
-									//assumes MIN_COMPLETED_TRADING_DAYS >= AVERAGE_VOLUME_PERIOD
-									for (bar_ptr; bar_ptr > &daily_bars[i].back() - model.ranges.average_volume_period; bar_ptr--) average_volume += bar_ptr->v;
-
-									average_volume /= model.ranges.average_volume_period;
+				for (symbol& Symbol : symbols) applyDailyFeatures(Symbol, snapshot.find(Symbol.ticker));
+			}
+			else
+			{
+				std::cout << "NO UP TO DATE SNAPSHOT FOUND - COMPUTING DAILY FEATURES" << std::endl;
 
-									//check that the average volume is not an outlier
-									if (average_volume >= model.ranges.min_average_volume && average_volume <= model.ranges.max_average_volume)
-									{
-										current_symbol.average_volume = average_volume;
-										lookback_period = (model.ranges.lookback_period > daily_bars[i].size()) ? (daily_bars[i].size() - 1) : model.ranges.lookback_period;
+				char yesterday[11];
+				std::string bar_session; //date of the last daily bar received
 
-										total_count = 0;
-										mean = 0.0;
+				time_proto.getPastDate(yesterday, 1);
 
-										//calculate the relative returns - use the variable c to store them
-										for (bar_ptr = &daily_bars[i].back(); bar_ptr > &daily_bars[i].back() - lookback_period; bar_ptr--)
-										{
-											if ((bar_ptr - 1)->c > 0.0)
-											{
-												bar_ptr->c = bar_ptr->c / (bar_ptr - 1)->c;
-
-												total_count++;
-												mean += bar_ptr->c;
-											}
-											else bar_ptr->c = -1.0; //minimum should be 0.0, any value with -1.0 will not be used to calculate std
-										}
+				auto subscribeInlier = [&](const symbol& Symbol) { if (subscribe_early) streams.subscribeBars({ Symbol.ticker }); };
 
-										if (total_count) mean /= total_count;
+				gatherDailyFeatures(symbols, model.ranges, headers, std::string(yesterday), timeout, bar_session, subscribeInlier);
 
-										//check that the mean is not an outlier
-										if (mean >= model.ranges.min_mean && mean <= model.ranges.max_mean && total_count)
-										{
-											current_symbol.mean = mean;
-											std = 0.0;
-
-											//calculate standard deviation
-											for (bar_ptr = &daily_bars[i].back(); bar_ptr > &daily_bars[i].back() - lookback_period; bar_ptr--)
-											{
-												if (bar_ptr->c >= 0.0) std += (bar_ptr->c - mean) * (bar_ptr->c - mean);
-											}
-
-											std /= total_count;
-
-											//check that the standard deviation is not an outlier
-											if (std >= model.ranges.min_std * model.ranges.min_std && std <= model.ranges.max_std * model.ranges.max_std)
-											{
-												r_min = 999999999.0;
-												r_max = -999999999.0;
-
-												total_count = 0; //count the number of inliers
-
-												//find the minimum and maximum returns that are within STD_MAX standard deviations from the mean
-												for (bar_ptr = &daily_bars[i].back(); bar_ptr > &daily_bars[i].back() - lookback_period; bar_ptr--)
-												{
-													if ((bar_ptr->c - mean) * (bar_ptr->c - mean) <= std * model.ranges.std_max * model.ranges.std_max)
-													{
-														if (bar_ptr->c >= 0.0)
-														{
-															total_count++;
-
-															if (bar_ptr->c < r_min) r_min = bar_ptr->c;
-															if (bar_ptr->c > r_max) r_max = bar_ptr->c;
-														}
-													}
-												}
-
-												//calculate lambda and the ground state energy
-												if (r_max > r_min && total_count && r_min >= 0.0)
-												{
-													std = sqrt(std);
-
-													current_symbol.std = std;
-
-													r_scale = (model.ranges.number_of_bins - 1.0) / (r_max - r_min);
-													dr = 2.0 * std * model.ranges.std_max / model.ranges.number_of_bins; //assumes that NUMBER_OF_BINS != 0
-
-													drp1 = static_cast<int>(r_scale * (mean + dr - r_min));
-													drm1 = static_cast<int>(r_scale * (mean - dr - r_min));
-
-													pp_partial_count = 0;
-													pm_partial_count = 0;
-
-													//find the number of returns that have the same bin index as drp1 and drm1
-													for (bar_ptr = &daily_bars[i].back(); bar_ptr > &daily_bars[i].back() - lookback_period; bar_ptr--)
-													{
-														if (bar_ptr->c >= r_min)
-														{
-															if (bar_ptr->c <= r_max)
-															{
-																if (static_cast<int>(r_scale * (bar_ptr->c - r_min)) == drp1) pp_partial_count++;
-																if (static_cast<int>(r_scale * (bar_ptr->c - r_min)) == drm1) pm_partial_count++;
-															}
-														}
-													}
-
-													pp = static_cast<double>(pp_partial_count) / static_cast<double>(total_count); //p(mean+dr)
-													pm = static_cast<double>(pm_partial_count) / static_cast<double>(total_count); //p(mean-dr)
-
-													if (pp >= model.ranges.min_ppdx && pp <= model.ranges.max_ppdx && pm >= model.ranges.min_pmdx && pm <= model.ranges.max_pmdx)
-													{
-														rps = (mean + dr) * (mean + dr);
-														rms = (mean - dr) * (mean - dr);
-
-														l_denominator = rps * rps * pp - rms * rms * pm;
-
-														current_symbol.pp = pp;
-														current_symbol.pm = pm;
-
-														//if the denominator for lambda is not zero then calculate lambda
-														if (l_denominator)
-														{
-															l_numerator = rms * pm - rps * pp;
-
-															l = l_numerator / l_denominator;
-
-															if (l < 0.0) l = -l; //absolute value of lambda
-
-															//check that lambda is not an outlier
-															if (l >= model.ranges.min_lambda && l <= model.ranges.max_lambda)
-															{
-																//calculate ground state energy E0 - then thats it
-
-																C0 = -K0(0.0) * l;
-																C1 = sqrt(0.25 * C0 * C0 - 1.0 / 27.0);
-
-																current_symbol.l = l;
-																current_symbol.E0 = cbrt(-0.5 * C0 + C1) + cbrt(-0.5 * C0 - C1);
-
-																if (current_symbol.E0 != 0.0)
-																{
-																	//the stock satisfies the inlier conditions that only depend on daily data
-																	current_symbol.is_an_outlier = false;
-
-																	//wait until a specified start trading time to allow trading
-																	current_symbol.trading_permitted = false;
-																}
-															}
-														}
-													}
-												}
-											}
-										}
-									}
-								}
-							}
+				subscribed = subscribe_early;
+			}
 
-							daily_bars[i].clear();
+			startup_timer.mark("DAILY FEATURES");
 
-							client_parameters[i]["page_token"] = "";
+			size_t num_symbols_left = 0; //symbols left to trade
 
-							if (num_symbols_left > 0)
-							{
-								current_symbols[i] = num_symbols_left;
-								client_parameters[i]["symbols"] = symbols[num_symbols_left].ticker;
+			for (symbol& Symbol : symbols) { if (!Symbol.is_an_outlier) num_symbols_left++; }
 
-								num_symbols_left--;
+			if (num_symbols_left <= 0) throw exceptions::exception("No stocks available to trade.");
 
-								current_response.clear();
+#ifdef USE_DAILY_INPUTS
+			std::vector<dailyFeatures> symbol_features; //of the symbols left to trade - a symbol's daily inputs are at its daily_index
 
-								current_client.get(client_parameters[i], client_headers[i], "/v2/stocks/bars"); //prepare the get request
-							}
-							else
-							{
-								active_clients--;
-								retired[i] = true;
-							}
-						}
-						else
-						{
-							client_parameters[i]["page_token"] = response_data["next_page_token"];
+			for (symbol& Symbol : symbols)
+			{
+				if (Symbol.is_an_outlier) continue;
 
-							current_response.clear();
+				Symbol.daily_index = symbol_features.size();
 
-							current_client.get(client_parameters[i], client_headers[i], "/v2/stocks/bars"); //prepare the get request
-						}
-					}
-				}
+				symbol_features.push_back({ float(Symbol.mean), float(Symbol.std), float(Symbol.average_volume), float(Symbol.previous_days_close), float(Symbol.pm),
+					float(Symbol.pp), float(Symbol.l) });
 			}
 
-			num_symbols_left = 0; //symbols left to trade
-
-			for (symbol& Symbol : symbols) { if (!Symbol.is_an_outlier) num_symbols_left++; }
-
-			if (num_symbols_left <= 0) throw exceptions::exception("No stocks available to trade.");
+			models.precompute(symbol_features);
+#endif
 
 			symbolData final_symbols(ssl_context_wrapper, model);
 
+#ifdef USE_DAILY_INPUTS
+			final_symbols.daily_inputs = models.activeDailyInputs();
+#endif
+
 			final_symbols.account_endpoint = account_endpoint;
 			final_symbols.risk_per_trade = risk_per_trade;
 			final_symbols.buying_power = allocated_buying_power;
 			final_symbols.base_headers = headers;
 			final_symbols.timeout = timeout;
 
+#ifdef USE_REST_POOL
+			sharedRestPool().keepAlive(account_endpoint, "/v2/clock", headers); //keep the connection the orders are sent on open
+#endif
+
 			std::vector<std::string> tickers;
 
 			tickers.reserve(num_symbols_left);
 
 			std::cout << "WATCHING " << num_symbols_left << " SYMBOLS TODAY." << std::endl;
 
-			num_symbols_left--;
-
 			for (symbol& Symbol : symbols)
 			{
 				if (!Symbol.is_an_outlier) tickers.push_back(Symbol.ticker);
@@ -612,106 +457,54 @@ void tradingBot::start()
 			}
 
 			/*
-			perpare the same set of non-blocking clients to obtain volume from past minute bars of the current day for the remaining stocks
-			start the data websocket
-			subscribe to minute bar updates to update todays' cumulative volume sums (vsum for each stock)
-			run the websocket and clients asynchronously
+			obtain todays' cumulative volume sums (vsum for each stock) for the remaining stocks
+				wait until the websockets are open, authenticated, and subscribed to the minute bar updates of every remaining stock
+				with USE_SNAPSHOT_VOLUMES the volume sums come from a few snapshot requests
+				otherwise a set of non-blocking clients gathers the past minute bars of the current day while the websocket keeps running
 			*/
 
-			JSONArrayParser<bar, symbol, updateDailyBar, updateIntradayData> intradayParser; //used to parse arrays of intraday bars
-			tradeAndBarParser updateParser; //used to parse trade and bar updates
-
-			active_clients = num_clients;
-
-			//construct the data websocket
-
-			websocket data_ws(ssl_context_wrapper, "stream.data.alpaca.markets", false, false, timeout); //this websocket receives trade and bar updates
-
-			std::string last_msg; //the last message received by the data or account websocket
-
-			//prepare the subscription messages
+			if (!subscribed) streams.subscribeBars(tickers);
 
-			std::string symbol_list = "";
+			std::vector<std::string> held_messages = streams.finish(); //bar updates received while the websockets were opened
 
-			for (const std::string& ticker : tickers) symbol_list += "\"" + ticker + "\",";
+			std::cout << "DATA WEBSOCKET READY AFTER " << streams.data_ready_seconds << " SECONDS - ACCOUNT WEBSOCKET READY AFTER " << streams.account_ready_seconds;
+			std::cout << " SECONDS - SENT " << streams.subscriptions_sent << " BAR SUBSCRIPTIONS" << std::endl;
 
-			symbol_list.pop_back();
+			startup_timer.mark("WAITING FOR THE WEBSOCKETS");
 
-			std::string bar_sub_msg = "{\"action\": \"subscribe\", \"bars\": [" + symbol_list + "]}";
-			std::string trade_and_quote_sub_msg = "{\"action\": \"subscribe\", \"quotes\": [" + symbol_list + "], \"trades\": [" + symbol_list + "]}";
+			tradeAndBarParser updateParser; //used to parse trade and bar updates
 
-			//open the websocket connection and send the bar subscription message
+			std::string last_msg; //the last message received by the data or account websocket
 
-			dictionary ws_headers;
+#ifdef USE_SNAPSHOT_VOLUMES
 
-			ws_headers["APCA-API-KEY-ID"] = alpaca_api_key;
-			ws_headers["APCA-API-SECRET-KEY"] = alpaca_secret_key;
-			ws_headers["Upgrade"] = "websocket";
-			ws_headers["Connection"] = "Upgrade";
-			ws_headers["Sec-WebSocket-Version"] = "13";
-			ws_headers["Sec-Websocket-Key"] = generateRandomBase64String(16);
+			//the snapshots count every minute bar up to the latest one when they are taken - the bar updates received in the meantime ...
+			//... are held back and parsed afterwards so the ones the snapshots already counted are skipped (see updateSymbolData)
 
-			response.clear();
+			auto holdMessages = [&]() { if (data_ws.recv(last_msg)) held_messages.push_back(last_msg); };
 
-			data_ws.reInit();
-			data_ws.open(ws_headers, "/v2/sip", response);
+			getSnapshotVolumes(final_symbols, tickers, headers, timeout, allowed_retries, holdMessages);
 
-			if (response.status_code != 101) //should be 101 switching protocols
+			for (std::string& message : held_messages)
 			{
-				throw exceptions::exception(std::to_string(response.status_code) + " status code not accounted for.");
+				if (message.size() >= 2) parseUpdates(updateParser, message, final_symbols);
 			}
-
-			//the first message should indicate a successful connection
-
-			while (!data_ws.recv(last_msg)) continue; //ADD TIMEOUT MECH
-
-			response_data.clear();
-
-			json_parser.parseJSON(response_data, last_msg); //expecting a JSON array with one json object
-
-			if (response_data.find("msg") == response_data.end()) throw exceptions::exception("Could not confirm connection for the data websocket.");
-			if (response_data["msg"] != "connected") throw exceptions::exception("Unexpected message received; Expecting \"connected\".");
-			if (response_data.find("T") == response_data.end()) throw exceptions::exception("Could not confirm connection for the data websocket.");
-			if (response_data["T"] != "success") throw exceptions::exception("Connection attempt for the data websocket was unsuccessful.");
-
-			//the second message should indicate successful authentication
-
-			while (!data_ws.recv(last_msg)) continue; //ADD TIMEOUT MECH
-
-			response_data.clear();
-
-			json_parser.parseJSON(response_data, last_msg); //expecting a JSON array with one json object
-
-			if (response_data.find("msg") == response_data.end()) throw exceptions::exception("Could not verify authentication for the data websocket.");
-			if (response_data["msg"] != "authenticated") throw exceptions::exception("Unexpected message received; Expecting \"authenticated\".");
-			if (response_data.find("T") == response_data.end()) throw exceptions::exception("Could not verify authentication for the data websocket.");
-			if (response_data["T"] != "success") throw exceptions::exception("Authentication attempt for the data websocket was unsuccessful.");
-
-			//send the bar subscription message and wait for the resulting subscription confirmation
-
-			data_ws.send(bar_sub_msg, WS_TEXT_FRAME);
-
-			while (!data_ws.recv(last_msg)) continue; //ADD TIMEOUT MECH
-
-			response_data.clear();
-
-			json_parser.parseJSON(response_data, last_msg); //expecting a JSON array with one json object
-
-			if (response_data.find("T") == response_data.end()) throw exceptions::exception("Could not subscribe to bar updates.");
-			if (response_data["T"] != "subscription") throw exceptions::exception("Could not subscribe to bar updates.");
-
-			//wait until the first bar update message is received
+#else
+			//wait until the first bar update message is received - unless one was received while the websockets were opened
 			//I didn't include a timeout mechanism here so that the bot won't stop if started long before ...
 			//... the market open time or during trading periods where we may not expect many bar updates
-			
-			while (!data_ws.recv(last_msg)) continue;
+
+			if (held_messages.size()) last_msg = held_messages.front();
+			else while (!data_ws.recv(last_msg)) continue;
 
 			//parse the message, update vsums, then set the end time to one minute behind the timestamp received
 
-			if (last_msg.size() >= 2) updateParser.parseJSONArray(last_msg, final_symbols);
+			if (last_msg.size() >= 2) parseUpdates(updateParser, last_msg, final_symbols);
 			else throw exceptions::exception("Did not receive the first minute bar update.");
 			
-			//reinitialize the clients to gather minute data
+			//initialize the clients to gather minute data
+
+			parameters.clear();
 
 			parameters["timeframe"] = "1Min";
 			parameters["start"] = std::string(time_proto.date) + "T00:00:00Z";
@@ -740,333 +533,1099 @@ void tradingBot::start()
 
 			parameters["end"] = end_date;
 
-			client_parameters.clear();
-			current_symbols.clear();
-			retired.clear();
+			//the bar updates received after the first one are newer than the end time
 
-			for (i = 0; i < num_clients; i++)
-			{
-				client_parameters.push_back(parameters);
-				retired.push_back(false);
+			for (size_t i = 1; i < held_messages.size(); i++) parseUpdates(updateParser, held_messages[i], final_symbols);
 
-				client_parameters[i]["symbols"] = tickers[num_symbols_left];
+			parameters["limit"] = "10000";
+			parameters["adjustment"] = "all";
+			parameters["feed"] = "sip";
 
-				current_symbols.push_back(num_symbols_left);
+			barPool bar_clients(ssl_context_wrapper, request_scheduler, parameters, headers, timeout, data_endpoint);
 
-				num_symbols_left--;
+			//read data from minute bars and add the volumes to vsums
+			bar intraday_bar;
 
-				responses[i].clear();
+			auto addVolumes = [&](const size_t position, const jsonFields& fields)
+			{
+				applyFields<bar, updateDailyBar>(fields, intraday_bar);
+				updateIntradayData(intraday_bar, final_symbols[tickers[position]]);
+			};
+			auto ignoreCompletion = [](const size_t) {};
 
-				data_clients[i].reConnect();
-				data_clients[i].get(client_parameters[i], client_headers[i], "/v2/stocks/bars");
-			}
+			bar_clients.start(tickers, std::vector<std::string>());
 
 			//run the websocket and http clients asynchronously
-			std::string ticker; //ticker symbol for the current stock
-
-			while (active_clients > 0)
+			do
 			{
 				//check for websocket message here
 
-				if (data_ws.recv(last_msg)) updateParser.parseJSONArray(last_msg, final_symbols);
+				if (data_ws.recv(last_msg)) parseUpdates(updateParser, last_msg, final_symbols);
 
-				//continue receiving intraday data from clients
+			} while (bar_clients.poll(addVolumes, ignoreCompletion, 1)); //continue receiving intraday data from clients - wait at most 1ms so the websocket keeps up
 
-				for (i = 0; i < num_clients; i++)
-				{
-					if (retired[i]) continue;
+			std::cout << "SENT " << bar_clients.requests_sent << " INTRADAY BAR REQUESTS FOR " << tickers.size() << " SYMBOLS" << std::endl;
+#endif
 
-					http::httpClient& current_client = data_clients[i];
-					http::httpResponse& current_response = responses[i];
+			startup_timer.mark("VOLUME SUMS");
 
-					try { current_status = current_client.recvResponse(current_response); }
-					catch (const SSLNoReturn&)
-					{
-						current_response.clear();
+			//subscribe to trade and quote updates on the data websocket and wait for the subscription confirmation - bar updates can arrive first
 
-						current_client.reConnect();
-						current_client.get(client_parameters[i], client_headers[i], "/v2/stocks/bars");
+			std::string symbol_list = "";
 
-						continue;
-					}
+			for (const std::string& ticker : tickers) symbol_list += "\"" + ticker + "\",";
 
-					if (current_status == http::status::TIMED_OUT) throw exceptions::exception("Timed out while retrieving stock data.");
-					if (current_status == http::status::RECEIVED_RESPONSE)
-					{
-						if (current_response.status_code == 429)
-						{
-							throw exceptions::exception("Exceeded the Alpaca API Rate limit. Reduce the maximum number of http clients retrieving data.");
-						}
+			symbol_list.pop_back();
 
-						if (current_response.status_code != 200)
-						{
-							throw exceptions::exception("Received an unexpected status code : " + std::to_string(current_response.status_code)\
-								+ " - with the following message : " + current_response.status_message);
-						}
+			data_ws.send("{\"action\": \"subscribe\", \"quotes\": [" + symbol_list + "], \"trades\": [" + symbol_list + "]}", WS_TEXT_FRAME);
 
-						response_data.clear();
+			while (true)
+			{
+				while (!data_ws.recv(last_msg)) continue; //ADD TIMEOUT MECH
 
-						json_parser.parseJSON(response_data, current_response.message);
+				if (hasMessageType(last_msg, "subscription")) break;
 
-						ticker = tickers[current_symbols[i]];
+				parseUpdates(updateParser, last_msg, final_symbols);
+			}
 
-						if (response_data.find("bars") != response_data.end())
-						{
-							if (response_data["bars"].size() > 2)
-							{
-								json_parser.parseJSON(response_data, response_data["bars"]);
+			startup_timer.mark("TRADE AND QUOTE SUBSCRIPTION");
+			
+			time_t END = time(nullptr);
 
-								//read data from minute bars and add the volumes to vsums
-								intradayParser.parseJSONArray(response_data[ticker], final_symbols[ticker]);
+			std::cout << "TOOK ~" << double(END - START) / 60.0 << " MINUTES TO GATHER DATA AND INITIALIZE BOT." << std::endl;
 
-								if (response_data.find("next_page_token") == response_data.end()) last_page = true;
-								else if (response_data["next_page_token"] == "null") last_page = true;
-								else last_page = false;
-							}
-							else last_page = true;
-						}
-						else last_page = true;
+			startup_timer.print();
+			printConnectionReport();
 
-						if (last_page)
-						{
-							client_parameters[i]["page_token"] = "";
+			if (startup_only) return;
 
-							if (num_symbols_left > 0)
-							{
-								current_symbols[i] = num_symbols_left;
-								client_parameters[i]["symbols"] = tickers[num_symbols_left];
+#ifdef USE_MODEL_SWAP
+			models.watch(model_path, model.quantized ? calibration_path : std::string());
+#endif
+
+			/*
+			wait until trading start time
+			start trading
+			*/
 
-								num_symbols_left--;
+			dictionary last_trade_update;
 
-								current_response.clear();
+			streamDelays data_delays;
+			streamDelays account_delays;
 
-								current_client.get(client_parameters[i], client_headers[i], "/v2/stocks/bars");
-							}
-							else
-							{
-								active_clients--;
-								retired[i] = true;
-							}
-						}
-						else
-						{
-							client_parameters[i]["page_token"] = response_data["next_page_token"];
+			time_t next_delay_report = time(nullptr) + delay_report_seconds;
 
-							current_response.clear();
+			auto current_symbol_iterator = final_symbols.begin();
+			auto start_symbol_iterator = final_symbols.begin();
+			auto end_symbol_iterator = final_symbols.end();
 
-							current_client.get(client_parameters[i], client_headers[i], "/v2/stocks/bars");
-						}
-					}
-				}
-			}
+			//while waiting to start trading handle account and minute bar updates
+			//if current time >= trading start time then start trading (go to next loop)
+			while (time(nullptr) <= trading_start_time)
+			{
+				if (account_ws.recv(last_msg)) //expecting individual json objects
+				{
+					recordDelays(account_ws, last_msg, account_delays);
+					handleTradeUpdate(last_msg, last_trade_update, final_symbols);
+				}
+
+				if (data_ws.recv(last_msg)) //handle bar, trade, and quote updates, and errors
+				{
+					recordDelays(data_ws, last_msg, data_delays);
+					parseUpdates(updateParser, last_msg, final_symbols);
+				}
+
+				//if the bot isn't busy handling updates then it can spend some time cleaning the quote deques
+				else
+				{
+					cleanQuoteDeque(current_symbol_iterator, start_symbol_iterator, end_symbol_iterator);
+					probeRestConnections();
+					reportDelays(data_delays, account_delays, next_delay_report);
+
+					swapModel(models, final_symbols);
+				}
+			}
+
+			//start trading
+
+			char current_time[9];
+
+			time_proto.getCurrentTime(current_time);
+
+			std::cout << "STARTED TRADING AT " << current_time << std::endl;
+
+			printDelayReport(data_delays, account_delays);
+
+			next_delay_report = time(nullptr) + delay_report_seconds;
+
+			current_symbol_iterator = start_symbol_iterator;
+
+			while (current_symbol_iterator < end_symbol_iterator) (current_symbol_iterator++)->trading_permitted = true;
+
+			try
+			{
+				//if current time >= trading end time then stop trading
+				while (time(nullptr) <= trading_end_time)
+				{
+					if (account_ws.recv(last_msg)) //expecting individual json objects - 41% of runtime spent here
+					{
+						//std::cout << last_msg << std::endl << std::endl << std::endl;
+						recordDelays(account_ws, last_msg, account_delays);
+						handleTradeUpdate(last_msg, last_trade_update, final_symbols);
+					}
+
+					if (data_ws.recv(last_msg)) //49% of runtime spent here
+					{
+						recordDelays(data_ws, last_msg, data_delays);
+						parseUpdates(updateParser, last_msg, final_symbols);
+					}
+					else
+					{
+						cleanQuoteDeque(current_symbol_iterator, start_symbol_iterator, end_symbol_iterator);
+						probeRestConnections();
+						reportDelays(data_delays, account_delays, next_delay_report);
+
+						swapModel(models, final_symbols);
+					}
+				}
+
+				//stop trading
+
+				time_proto.getCurrentTime(current_time);
+
+				std::cout << "STOPPED TRADING AT " << current_time << std::endl;
+
+				printConnectionReport();
+				printBatchReport(final_symbols);
+				printDelayReport(data_delays, account_delays);
+
+				closeAllPositions(final_symbols, data_ws, account_ws);
+			}
+			catch (const std::runtime_error& runtime_error) { closeAllPositions(final_symbols, data_ws, account_ws); throw runtime_error; }
+			catch (const exceptions::exception& exception) { closeAllPositions(final_symbols, data_ws, account_ws); throw exception; }
+			catch (const SSLNoReturn& no_return) { std::cout << "LAST MSG : " << last_msg << std::endl; closeAllPositions(final_symbols, data_ws, account_ws); throw no_return; }
+			catch (const std::exception& exception) { closeAllPositions(final_symbols, data_ws, account_ws); throw exception; }
+		}
+	}
+	catch (const std::runtime_error& runtime_error) { throw runtime_error; }
+	catch (const exceptions::exception& exception) { throw exception; }
+	catch (const SSLNoReturn& no_return) { throw no_return; }
+	catch (const std::exception& exception) { throw exception; }
+}
+
+void tradingBot::buildSnapshot()
+{
+	time_proto.update();
+
+	time_t timeout = 10; //timeout in seconds
+	int allowed_retries = 6; //number of times some requests can be retried
+
+	dictionary headers;
+
+	headers["APCA-API-SECRET-KEY"] = alpaca_secret_key;
+	headers["APCA-API-KEY-ID"] = alpaca_api_key;
+	headers["User-Agent"] = "c++20-requests";
+	headers["Connection"] = "close";
+
+	std::vector<symbol> symbols;
+
+	getSymbols(symbols, headers, timeout, allowed_retries);
+
+	//the next connection will be reused
+	headers["Connection"] = "keep-alive";
+
+	MLModel model; //only the inlier ranges are needed here
+
+	model.loadScales(scales_path);
+
+	//today's daily bar is only complete after the close - otherwise the last completed daily bar is yesterday's
+	char end_date[11];
+
+	if (time(nullptr) > time_proto.getSecondsSinceEpoch(0, 16, 15, 0)) time_proto.getPastDate(end_date, 0);
+	else time_proto.getPastDate(end_date, 1);
+
+	time_t START = time(nullptr);
+
+	/*
+	update the sliding window accumulators saved by the last snapshot with the daily bars since then
+		each request starts at the last bar an accumulator has seen - if that bar changed then the history was adjusted ...
+		... and the accumulator is rebuilt from the full history along with the symbols that don't have an accumulator yet
+	*/
+
+	const uint64_t ranges_checksum = dailyRangesChecksum(model.ranges);
+
+	qplAccumulatorContainer accumulators;
+
+	if (!loadQplAccumulators(qpl_accumulator_path, ranges_checksum, accumulators)) std::cout << "NO USABLE ACCUMULATORS FOUND - REBUILDING ALL OF THEM" << std::endl;
+
+	char start_date[11];
+
+	time_proto.getPastDate(start_date, past_days);
+
+	std::vector<size_t> incremental_indices; //symbols whose accumulators only need the bars since the last snapshot
+	std::vector<size_t> full_indices; //symbols whose accumulators are rebuilt from the full history
+	std::vector<std::string> start_dates(symbols.size());
+
+	for (size_t index = 0; index < symbols.size(); index++)
+	{
+		auto accumulator = accumulators.find(symbols[index].ticker);
+
+		if (accumulator != accumulators.end() && accumulator->second.lastTimestamp().size() >= 10)
+		{
+			incremental_indices.push_back(index);
+			start_dates[index] = accumulator->second.lastTimestamp().substr(0, 10);
+		}
+		else full_indices.push_back(index);
+	}
+
+	size_t num_adjusted = 0; //number of accumulators invalidated by adjustments
+
+	auto extendAccumulator = [&](const size_t index, dailyBarContainer& daily_bars)
+	{
+		if (accumulators[symbols[index].ticker].extend(daily_bars)) return;
+
+		full_indices.push_back(index);
+		num_adjusted++;
+	};
+
+	gatherDailyBars(symbols, incremental_indices, start_dates, headers, std::string(end_date), timeout, extendAccumulator);
+
+	//only rebuild the accumulators of the symbols that pass the checks that only need the most recent daily bars
+	//the others are outliers for this session and will go through the prefilter again in the next snapshot
+
+	std::vector<size_t> survivors = prefilterSymbols(symbols, full_indices, model.ranges, headers, std::string(end_date), timeout);
+
+	for (const size_t& index : full_indices) accumulators.erase(symbols[index].ticker); //drop the accumulators invalidated by adjustments
+
+	full_indices = std::move(survivors);
+
+	for (const size_t& index : full_indices) start_dates[index] = std::string(start_date);
+
+	auto rebuildAccumulator = [&](const size_t index, dailyBarContainer& daily_bars)
+	{
+		qplAccumulator& accumulator = accumulators[symbols[index].ticker];
+
+		accumulator.reset(model.ranges);
+
+		for (const bar& daily_bar : daily_bars) accumulator.push(daily_bar.t, daily_bar.c, daily_bar.v);
+	};
+
+	gatherDailyBars(symbols, full_indices, start_dates, headers, std::string(end_date), timeout, rebuildAccumulator);
+
+	std::cout << "UPDATED " << incremental_indices.size() - num_adjusted << " ACCUMULATORS";
+	std::cout << " - " << full_indices.size() << " WERE REBUILT (" << num_adjusted << " BECAUSE OF ADJUSTMENTS)" << std::endl;
+
+	//compute the daily features from the accumulators - symbols without daily bars don't get one
+
+	std::string bar_session; //date of the last daily bar received - the snapshot is valid for the session after this one
+
+	std::vector<dailyFeatureRecord> records;
+	qplAccumulatorContainer current_accumulators; //only keep the accumulators of symbols that are still available
+
+	size_t num_histogram_rebuilds = 0; //number of histograms rebuilt because their inlier range changed
+
+	records.reserve(symbols.size());
+	current_accumulators.reserve(symbols.size());
+
+	for (symbol& Symbol : symbols)
+	{
+		auto accumulator = accumulators.find(Symbol.ticker);
+
+		dailyFeatureRecord record = getDailyFeatureRecord(Symbol);
+
+		if (accumulator != accumulators.end() && accumulator->second.lastTimestamp().size() >= 10)
+		{
+			accumulator->second.computeFeatures(record, model.ranges);
+
+			num_histogram_rebuilds += accumulator->second.histogram_rebuilds;
+
+			if (accumulator->second.lastTimestamp().compare(0, 10, bar_session) > 0) bar_session = accumulator->second.lastTimestamp().substr(0, 10);
+
+			current_accumulators[Symbol.ticker] = std::move(accumulator->second);
+		}
+
+		applyDailyFeatures(Symbol, &record);
+		records.push_back(record);
+	}
+
+	if (bar_session.empty()) throw exceptions::exception("Did not receive any daily bars.");
+
+	saveDailySnapshot(daily_snapshot_path, bar_session, ranges_checksum, records);
+	saveQplAccumulators(qpl_accumulator_path, ranges_checksum, current_accumulators);
+
+	std::cout << "REBUILT THE HISTOGRAMS OF " << num_histogram_rebuilds << " OF " << current_accumulators.size() << " ACCUMULATORS" << std::endl;
+
+	size_t num_inliers = 0;
+
+	for (const symbol& Symbol : symbols) { if (!Symbol.is_an_outlier) num_inliers++; }
+
+	time_t END = time(nullptr);
+
+	std::cout << "SAVED THE DAILY FEATURES OF " << records.size() << " SYMBOLS (" << num_inliers << " INLIERS) FOR THE SESSION OF " << bar_session;
+	std::cout << " IN ~" << double(END - START) / 60.0 << " MINUTES." << std::endl;
+}
+
+void tradingBot::buildQplTable(const std::vector<qplConfiguration>& configurations)
+{
+	time_proto.update();
+
+	time_t timeout = 10; //timeout in seconds
+	int allowed_retries = 6; //number of times some requests can be retried
+
+	dictionary headers;
+
+	headers["APCA-API-SECRET-KEY"] = alpaca_secret_key;
+	headers["APCA-API-KEY-ID"] = alpaca_api_key;
+	headers["User-Agent"] = "c++20-requests";
+	headers["Connection"] = "close";
+
+	std::vector<symbol> symbols;
+
+	getSymbols(symbols, headers, timeout, allowed_retries);
+
+	//the next connection will be reused
+	headers["Connection"] = "keep-alive";
+
+	MLModel model; //the inlier ranges other than the qpl configurations are shared by every configuration
+
+	model.loadScales(scales_path);
+
+	//today's daily bar is only complete after the close - otherwise the last completed daily bar is yesterday's
+	char end_date[11];
+
+	if (time(nullptr) > time_proto.getSecondsSinceEpoch(0, 16, 15, 0)) time_proto.getPastDate(end_date, 0);
+	else time_proto.getPastDate(end_date, 1);
+
+	char start_date[11];
+
+	time_proto.getPastDate(start_date, past_days);
+
+	time_t START = time(nullptr);
+
+	std::vector<size_t> indices(symbols.size());
+	std::vector<std::string> start_dates(symbols.size(), std::string(start_date));
+
+	for (size_t index = 0; index < symbols.size(); index++) indices[index] = index;
+
+	//the previous close and average volume checks don't depend on the configuration
+	std::vector<size_t> survivors = prefilterSymbols(symbols, indices, model.ranges, headers, std::string(end_date), timeout);
+
+	std::string bar_session; //date of the last daily bar received
+
+	std::vector<std::string> tickers;
+	std::vector<qplFeatures> features;
+	std::vector<double> returns; //relative returns reused by every symbol
+
+	tickers.reserve(survivors.size());
+	features.reserve(survivors.size() * configurations.size());
+
+	auto computeTable = [&](const size_t index, dailyBarContainer& daily_bars)
+	{
+		if (daily_bars.size() && daily_bars.back().t.compare(0, 10, bar_session) > 0) bar_session = daily_bars.back().t.substr(0, 10);
+
+		tickers.push_back(symbols[index].ticker);
+		features.resize(features.size() + configurations.size());
+
+		computeQplTable(daily_bars, configurations, model.ranges, returns, features.data() + features.size() - configurations.size());
+	};
+
+	gatherDailyBars(symbols, survivors, start_dates, headers, std::string(end_date), timeout, computeTable);
+
+	if (bar_session.empty()) throw exceptions::exception("Did not receive any daily bars.");
+
+	saveQplTable(qpl_table_path, bar_session, configurations, tickers, features);
+
+	time_t END = time(nullptr);
+
+	std::cout << "SAVED THE DAILY FEATURES OF " << configurations.size() << " QPL CONFIGURATIONS FOR " << tickers.size() << " SYMBOLS";
+	std::cout << " IN ~" << double(END - START) / 60.0 << " MINUTES." << std::endl;
+}
+
+void tradingBot::getSymbols(std::vector<symbol>& symbols, const dictionary& headers, time_t timeout, int allowed_retries)
+{
+	dictionary parameters;
+	http::httpResponse response;
+
+	parameters["status"] = "active";
+	parameters["asset_class"] = "us_equity";
+
+	getUntil(ssl_context_wrapper, response, parameters, headers, account_endpoint, "/v2/assets", timeout, allowed_retries);
+
+	if (response.status_code != 200) throw exceptions::exception(std::to_string(response.status_code) + " status code not accounted for.");
+
+	symbols.reserve(10000);
+
+	//gather all active symbols
+	getAvailableSymbols(symbols, response.message);
+
+	if (!symbols.size()) throw exceptions::exception("No symbols available to trade.");
+}
+
+std::string tradingBot::getLastSession(const dictionary& headers, time_t timeout, int allowed_retries)
+{
+	dictionary parameters;
+	http::httpResponse response;
+
+	char start_date[11];
+	char yesterday[11];
+
+	//there are never more than a few non-trading days in a row
+	time_proto.getPastDate(start_date, 10);
+	time_proto.getPastDate(yesterday, 1);
+
+	parameters["date_type"] = "TRADING";
+	parameters["start"] = std::string(start_date);
+	parameters["end"] = std::string(yesterday);
+
+	getUntil(ssl_context_wrapper, response, parameters, headers, account_endpoint, "/v2/calendar", timeout, allowed_retries);
+
+	if (response.status_code != 200) throw exceptions::exception(std::to_string(response.status_code) + " status code not accounted for.");
+
+	JSONArrayParser<calendarDay, std::vector<std::string>, updateCalendarDay, updateCalendarData> calendarParser;
+	std::vector<std::string> sessions;
+
+	if (response.message.size() > 2) calendarParser.parseJSONArray(response.message, sessions);
+
+	if (!sessions.size()) throw exceptions::exception("Could not obtain the date of the last trading session.");
+
+	return sessions.back();
+}
+
+void tradingBot::getSnapshotVolumes(symbolData& symbol_data, const std::vector<std::string>& tickers, const dictionary& headers, time_t timeout,
+	int allowed_retries, auto& wait_handler)
+{
+	dictionary parameters;
+	http::httpResponse response;
+
+	parameters["feed"] = "sip";
+
+	snapshotStream snapshot_parser;
+	bar snapshot_bar;
+
+	const std::string date(time_proto.date);
+
+	//the daily bar holds the volume of every minute bar of the day up to and including the latest minute bar
+	//both are skipped if they are not from today (the symbol has not traded yet)
+	auto updateVolume = [&](const std::string& ticker, const std::string& part, const jsonFields& fields)
+	{
+		snapshot_bar = bar();
+
+		applyFields<bar, updateDailyBar>(fields, snapshot_bar);
+
+		if (snapshot_bar.t.compare(0, date.size(), date) != 0) return;
+
+		symbol& current_symbol = symbol_data[ticker];
+
+		if (part == "dailyBar") current_symbol.vsum = snapshot_bar.v;
+		else if (part == "minuteBar") current_symbol.vsum_through = snapshot_bar.t;
+	};
+
+	size_t requests_sent = 0;
+
+	for (size_t first = 0; first < tickers.size(); first += max_snapshot_symbols)
+	{
+		std::string symbol_list;
+
+		for (size_t i = first; i < tickers.size() && i < first + max_snapshot_symbols; i++) symbol_list += tickers[i] + ",";
+
+		symbol_list.pop_back();
+
+		parameters["symbols"] = symbol_list;
+
+		while (true)
+		{
+			while (!request_scheduler.canSend()) wait_handler();
+
+			request_scheduler.onSend();
+			requests_sent++;
+
+			response.clear();
+
+			getUntil(ssl_context_wrapper, response, parameters, headers, data_endpoint, "/v2/stocks/snapshots", timeout, allowed_retries);
+
+			if (response.status_code != 429) break;
+
+			request_scheduler.onRateLimited(response); //send the same batch again once the limit resets
+		}
+
+		request_scheduler.onResponse(response);
+
+		if (response.status_code != 200) throw exceptions::exception(std::to_string(response.status_code) + " status code not accounted for.");
+
+		snapshot_parser.reset();
+		snapshot_parser.feed(response.message.data(), response.message.size(), updateVolume);
+
+		if (!snapshot_parser.complete()) throw exceptions::exception("Received an incomplete snapshot response.");
+
+		wait_handler();
+	}
+
+	std::cout << "SENT " << requests_sent << " SNAPSHOT REQUESTS FOR " << tickers.size() << " SYMBOLS" << std::endl;
+}
+
+void tradingBot::gatherDailyFeatures(std::vector<symbol>& symbols, const inlierRanges& ranges, const dictionary& headers, const std::string& end_date,
+	time_t timeout, std::string& bar_session, auto& inlier_handler)
+{
+	char start_date[11];
+
+	time_proto.getPastDate(start_date, past_days);
+
+	std::vector<size_t> indices(symbols.size());
+	std::vector<std::string> start_dates(symbols.size(), std::string(start_date));
+
+	for (size_t index = 0; index < symbols.size(); index++) indices[index] = index;
+
+	//only gather the full history of the symbols that pass the checks that only need the most recent daily bars
+
+	auto START = std::chrono::steady_clock::now();
+
+	std::vector<size_t> survivors = prefilterSymbols(symbols, indices, ranges, headers, end_date, timeout);
+
+	auto PREFILTERED = std::chrono::steady_clock::now();
+
+	auto computeFeatures = [&](const size_t index, dailyBarContainer& daily_bars)
+	{
+		//keep track of the most recent session included in the daily bars
+		if (daily_bars.size() && daily_bars.back().t.compare(0, 10, bar_session) > 0) bar_session = daily_bars.back().t.substr(0, 10);
+
+		if (computeDailyFeatures(symbols[index], daily_bars, ranges)) inlier_handler(symbols[index]);
+	};
+
+	gatherDailyBars(symbols, survivors, start_dates, headers, end_date, timeout, computeFeatures);
+
+	auto END = std::chrono::steady_clock::now();
+
+	std::cout << "PREFILTERED " << symbols.size() << " SYMBOLS IN " << std::chrono::duration<double>(PREFILTERED - START).count() << " SECONDS";
+	std::cout << " - GATHERED THE HISTORY OF " << survivors.size() << " SYMBOLS IN " << std::chrono::duration<double>(END - PREFILTERED).count() << " SECONDS" << std::endl;
+}
+
+std::vector<size_t> tradingBot::prefilterSymbols(std::vector<symbol>& symbols, const std::vector<size_t>& indices, const inlierRanges& ranges,
+	const dictionary& headers, const std::string& end_date, time_t timeout)
+{
+	//enough calendar days to include average_volume_period trading days - accounts for weekends and a few market holidays
+	const int prefilter_days = ranges.average_volume_period * 7 / 5 + 14;
+
+	char start_date[11];
+
+	time_proto.getPastDate(start_date, prefilter_days);
+
+	std::vector<std::string> start_dates(symbols.size(), std::string(start_date));
+	std::vector<size_t> survivors;
+
+	survivors.reserve(indices.size());
+
+	auto checkRecentBars = [&](const size_t index, dailyBarContainer& daily_bars)
+	{
+		if (prefilterDailyFeatures(symbols[index], daily_bars, ranges)) survivors.push_back(index);
+	};
+
+	gatherDailyBars(symbols, indices, start_dates, headers, end_date, timeout, checkRecentBars);
+
+	//keep the symbols in the order they were given so that batches with the same start date stay together
+	std::sort(survivors.begin(), survivors.end());
+
+	std::cout << survivors.size() << " OF " << indices.size() << " SYMBOLS PASSED THE PREFILTER" << std::endl;
+
+	return survivors;
+}
+
+size_t tradingBot::gatherDailyBars(std::vector<symbol>& symbols, const std::vector<size_t>& indices, const std::vector<std::string>& start_dates,
+	const dictionary& headers, const std::string& end_date, time_t timeout, auto& handler)
+{
+	if (!indices.size()) return 0;
+
+	dictionary parameters;
+
+	parameters["timeframe"] = "1Day";
+	parameters["end"] = end_date;
+	parameters["limit"] = "10000";
+	parameters["adjustment"] = "all";
+	parameters["feed"] = "sip";
+
+	std::vector<std::string> tickers; //tickers of the requested symbols in the same order as the indices
+	std::vector<std::string> batch_start_dates;
+
+	tickers.reserve(indices.size());
+	batch_start_dates.reserve(indices.size());
+
+	for (const size_t& index : indices)
+	{
+		tickers.push_back(symbols[index].ticker);
+		batch_start_dates.push_back(start_dates[index]);
+	}
+
+	//a symbol's bars can be split across pages so they are kept until the symbol is complete
+	//only the symbols on the last couple of pages of each client are pending at any time so the containers are recycled
+
+	std::unordered_map<size_t, std::unique_ptr<dailyBarContainer>> pending_bars; //daily bars of incomplete symbols by position
+	std::vector<std::unique_ptr<dailyBarContainer>> free_containers;
+
+	dailyBarContainer no_bars; //handed to symbols without any daily bars
+
+	bar daily_bar;
+
+	//the bars are passed one at a time and the bars of a symbol usually follow each other so its container is kept at hand
+	size_t current_position = static_cast<size_t>(-1);
+	dailyBarContainer* current_bars = nullptr;
+
+	auto appendBar = [&](const size_t position, const jsonFields& fields)
+	{
+		if (position != current_position)
+		{
+			std::unique_ptr<dailyBarContainer>& daily_bars = pending_bars[position];
+
+			if (!daily_bars)
+			{
+				if (free_containers.size())
+				{
+					daily_bars = std::move(free_containers.back());
+					free_containers.pop_back();
+				}
+				else daily_bars = std::make_unique<dailyBarContainer>();
+			}
+
+			current_position = position;
+			current_bars = daily_bars.get();
+		}
+
+		applyFields<bar, updateDailyBar>(fields, daily_bar);
+		updateDailyData(daily_bar, *current_bars);
+	};
+
+	auto completeSymbol = [&](const size_t position)
+	{
+		if (position == current_position) current_position = static_cast<size_t>(-1);
+
+		auto daily_bars = pending_bars.find(position);
+
+		if (daily_bars == pending_bars.end())
+		{
+			handler(indices[position], no_bars);
+
+			return;
+		}
+
+		handler(indices[position], *daily_bars->second);
+
+		daily_bars->second->clear();
+
+		free_containers.push_back(std::move(daily_bars->second));
+		pending_bars.erase(daily_bars);
+	};
+
+	barPool bar_clients(ssl_context_wrapper, request_scheduler, parameters, headers, timeout, data_endpoint);
+
+	bar_clients.start(tickers, batch_start_dates);
+
+	//use non-blocking IO to read data from multiple sockets in a single thread
+	while (bar_clients.poll(appendBar, completeSymbol)) continue;
+
+	std::cout << "SENT " << bar_clients.requests_sent << " DAILY BAR REQUESTS FOR " << indices.size() << " SYMBOLS";
+	std::cout << " - RECEIVED " << double(bar_clients.bytes_received) / 1048576.0 << " MB";
+	std::cout << " - " << request_scheduler.rate_limited_responses << " RATE LIMITED RESPONSES SO FAR" << std::endl;
+
+	return bar_clients.bytes_received;
+}
+
+/*
+Since many of the keys in trade, quote, and bar updates are only 1 or 2 characters long,
+we can greatly speed up the parsing process by using switch statements - which require numerical
+or enumerated types - instead of if/else statements by integer-encoding the strings.
+
+This only works for small strings (integer-type values can only be so large).
+*/
+
+constexpr inline size_t encodeString(const std::string& string)
+{
+	size_t h = 0;
+
+	for (const char& c : string) { if (256 * h + c <= h && c != '\0') return 0; h = 256 * h + c; }
+
+	return h;
+}
+
+//needed on non-windows machines
+constexpr inline size_t encodeString(const char* string)
+{
+	size_t h = 0;
+	const char* c = string;
+
+	while (*c != '\0') { if (256 * h + *c <= h && *c != '\0') return 0; h = 256 * h + *(c++); }
+
+	return h;
+}
+
+void updateDailyBar(bar& daily_bar, const std::string& key, const std::string& value)
+{
+	//faster than if/else statements - only works when key strings are small
+
+	switch (encodeString(key))
+	{
+		case encodeString("t"): { daily_bar.t = value; break; }
+		case encodeString("c"): { daily_bar.c = convert<double>(value); break; }
+		case encodeString("v"): { daily_bar.v = convert<long long>(value); break; }
+		default: break;
+	}
+}
+
+void updateDailyData(const bar& daily_bar, dailyBarContainer& daily_bars)
+{
+	daily_bars.push_back(daily_bar);
+}
+
+void updateIntradayData(const bar& intraday_bar, symbol& Symbol)
+{
+	Symbol.vsum += intraday_bar.v;
+}
+
+bool computeDailyFeatures(symbol& current_symbol, dailyBarContainer& daily_bars, const inlierRanges& ranges)
+{
+	int lookback_period = 0; //the lookback period for the qpl calculation
+	bar* bar_ptr = nullptr; //bar pointer used to iterate through daily bars
 
-			/*
-			when the clients finish gathering data up to the same minute the websocket was started, ...
-			... start the account updates websocket, subscribe to trade updates on the data websocket, ...
-			... and then and run both websockets asynchronous
-			*/
+	double average_volume = 0.0; //70-day daily average volume
 
-			websocket account_ws(ssl_context_wrapper, trade_update_stream, false, false, timeout); //this websocket receives account updates
+	double r_min = 0.0; //minimum relative return
+	double r_max = 0.0; //maximum relative return
 
-			ws_headers.erase("APCA-API-KEY-ID");
-			ws_headers.erase("APCA-API-SECRET-KEY");
+	double mean = 0.0; //average relative return
+	double std = 0.0; //standard deviation of relative returns
 
-			ws_headers["Sec-Websocket-Key"] = generateRandomBase64String(16); //generate a new key for the account update websocket
+	int total_count = 0; //total number of returns used to calculate the mean, std, and probability density
 
-			response.clear();
+	int pp_partial_count = 0; //number of returns used to calculate the probability density at mean + dr
+	int pm_partial_count = 0; //number of returns used to calculate the probability density at mean - dr
 
-			account_ws.reInit();
-			account_ws.open(ws_headers, "/stream", response);
+	double r_scale = 0.0; //bin width per unit return
+	double dr = 0.0;
 
-			if (response.status_code != 101) //should be 101 switching protocols
-			{
-				throw exceptions::exception(std::to_string(response.status_code) + " status code not accounted for.");
-			}
+	int drp1 = 0; //index of the bin at mean + dr
+	int drm1 = 0; //index of the bin at mean - dr
 
-			//send an authorization message to start listening for account updates and wait for confirmation
-			//the response message should indicate a successful authentication
+	double pm = 0.0; //p(mean - dr)
+	double pp = 0.0; //p(mean + dr)
 
-			account_ws.send("{\"action\": \"auth\", \"key\": \"" + alpaca_api_key + "\", \"secret\": \"" + alpaca_secret_key + "\"}", WS_TEXT_FRAME);
+	double rps = 0.0;
+	double rms = 0.0;
 
-			while (!account_ws.recv(last_msg)) continue; //ADD TIMEOUT MECH
+	double C0 = 0.0;
+	double C1 = 0.0;
 
-			response_data.clear();
+	double l = 0.0; //lambda
+	double l_numerator = 0.0; //numerator of lambda
+	double l_denominator = 0.0; //denominator of lambda
 
-			json_parser.parseJSON(response_data, last_msg);
+	current_symbol.is_an_outlier = true; //if all inlier conditions are met this will be set to false
 
-			if (response_data.find("stream") == response_data.end()) throw exceptions::exception("Unknown message received from the account websocket.");
-			if (response_data["stream"] != "authorization") throw exceptions::exception("Unexpected message received from the account websocket.");
-			if (response_data.find("data") == response_data.end()) throw exceptions::exception("Could not confirm authorization for the account websocket.");
+	if (daily_bars.size() >= ranges.min_completed_trading_days) //I require at least 500 closing prices to calculate the price levels
+	{
+		bar_ptr = &daily_bars.back();
 
-			json_parser.parseJSON(response_data, response_data["data"]);
+		//check that the previous day's closing price is not an outlier
+		if (bar_ptr->c >= ranges.min_previous_days_closing_price && bar_ptr->c <= ranges.max_previous_days_closing_price)
+		{
+			current_symbol.previous_days_close = bar_ptr->c;
 
-			if (response_data.find("action") == response_data.end()) throw exceptions::exception("Unknown message received from the account websocket.");
-			if (response_data["action"] != "authenticate") throw exceptions::exception("Could not confirm authorization for the account websocket.");
-			if (response_data.find("status") == response_data.end()) throw exceptions::exception("Unknown message received from the account websocket.");
-			if (response_data["status"] != "authorized") throw exceptions::exception("Authorization for the account websocket failed.");
+			//calculate the daily average volume
+			average_volume = 0;
 
-			//send a message to start listening for account updates and wait for confirmation
-			//the second message should indicate an active trade updates stream
+			//assumes MIN_COMPLETED_TRADING_DAYS >= AVERAGE_VOLUME_PERIOD
+			for (bar_ptr; bar_ptr > &daily_bars.back() - ranges.average_volume_period; bar_ptr--) average_volume += bar_ptr->v;
 
-			account_ws.send("{\"action\": \"listen\", \"data\": {\"streams\": [\"trade_updates\"]}}", WS_TEXT_FRAME);
+			average_volume /= ranges.average_volume_period;
 
-			while (!account_ws.recv(last_msg)) continue; //ADD TIMEOUT MECH
+			//check that the average volume is not an outlier
+			if (average_volume >= ranges.min_average_volume && average_volume <= ranges.max_average_volume)
+			{
+				current_symbol.average_volume = average_volume;
+				lookback_period = (ranges.lookback_period >= daily_bars.size()) ? (daily_bars.size() - 1) : ranges.lookback_period; //every return needs the close before it
 
-			response_data.clear();
+				total_count = 0;
+				mean = 0.0;
 
-			json_parser.parseJSON(response_data, last_msg);
+				//calculate the relative returns - use the variable c to store them
+				for (bar_ptr = &daily_bars.back(); bar_ptr > &daily_bars.back() - lookback_period; bar_ptr--)
+				{
+					if ((bar_ptr - 1)->c > 0.0)
+					{
+						bar_ptr->c = bar_ptr->c / (bar_ptr - 1)->c;
 
-			if (response_data.find("stream") == response_data.end()) throw exceptions::exception("Unknown message received from the account websocket.");
-			if (response_data["stream"] != "listening") throw exceptions::exception("Unexpected message received from the account websocket.");
-			if (response_data.find("data") == response_data.end()) throw exceptions::exception("Could not subscribe to trade updates for the account websocket.");
+						total_count++;
+						mean += bar_ptr->c;
+					}
+					else bar_ptr->c = -1.0; //minimum should be 0.0, any value with -1.0 will not be used to calculate std
+				}
 
-			json_parser.parseJSON(response_data, response_data["data"]);
+				if (total_count) mean /= total_count;
 
-			if (response_data.find("streams") == response_data.end()) throw exceptions::exception("The account websocket is not listening to any streams.");
-			if (response_data["streams"].find("\"trade_updates\"") == std::string::npos) throw exceptions::exception("The account websocket is not listening for trade updates.");
+				//check that the mean is not an outlier
+				if (mean >= ranges.min_mean && mean <= ranges.max_mean && total_count)
+				{
+					current_symbol.mean = mean;
+					std = 0.0;
 
-			//send the trade and quote subscription message and wait for the resulting subscription confirmation
+					//calculate standard deviation
+					for (bar_ptr = &daily_bars.back(); bar_ptr > &daily_bars.back() - lookback_period; bar_ptr--)
+					{
+						if (bar_ptr->c >= 0.0) std += (bar_ptr->c - mean) * (bar_ptr->c - mean);
+					}
 
-			data_ws.send(trade_and_quote_sub_msg, WS_TEXT_FRAME);
+					std /= total_count;
 
-			while (!data_ws.recv(last_msg)) continue; //ADD TIMEOUT MECH
+					//check that the standard deviation is not an outlier
+					if (std >= ranges.min_std * ranges.min_std && std <= ranges.max_std * ranges.max_std)
+					{
+						r_min = 999999999.0;
+						r_max = -999999999.0;
 
-			response_data.clear();
+						total_count = 0; //count the number of inliers
 
-			json_parser.parseJSON(response_data, last_msg); //will raise an error if a bar update is received before the subscription confirmation
+						//find the minimum and maximum returns that are within STD_MAX standard deviations from the mean
+						for (bar_ptr = &daily_bars.back(); bar_ptr > &daily_bars.back() - lookback_period; bar_ptr--)
+						{
+							if ((bar_ptr->c - mean) * (bar_ptr->c - mean) <= std * ranges.std_max * ranges.std_max)
+							{
+								if (bar_ptr->c >= 0.0)
+								{
+									total_count++;
 
-			if (response_data.find("T") == response_data.end()) throw exceptions::exception("Could not subscribe to trade and quote updates.");
-			if (response_data["T"] != "subscription") throw exceptions::exception("Could not subscribe to trade and quote updates.");
-			
-			time_t END = time(nullptr);
+									if (bar_ptr->c < r_min) r_min = bar_ptr->c;
+									if (bar_ptr->c > r_max) r_max = bar_ptr->c;
+								}
+							}
+						}
 
-			std::cout << "TOOK ~" << double(END - START) / 60.0 << " MINUTES TO GATHER DATA AND INITIALIZE BOT." << std::endl;
+						//calculate lambda and the ground state energy
+						if (r_max > r_min && total_count && r_min >= 0.0)
+						{
+							std = sqrt(std);
 
-			/*
-			wait until trading start time
-			start trading
-			*/
+							current_symbol.std = std;
 
-			dictionary last_trade_update;
+							r_scale = (ranges.number_of_bins - 1.0) / (r_max - r_min);
+							dr = 2.0 * std * ranges.std_max / ranges.number_of_bins; //assumes that NUMBER_OF_BINS != 0
 
-			auto current_symbol_iterator = final_symbols.begin();
-			auto start_symbol_iterator = final_symbols.begin();
-			auto end_symbol_iterator = final_symbols.end();
+							drp1 = static_cast<int>(r_scale * (mean + dr - r_min));
+							drm1 = static_cast<int>(r_scale * (mean - dr - r_min));
 
-			//while waiting to start trading handle account and minute bar updates
-			//if current time >= trading start time then start trading (go to next loop)
-			while (time(nullptr) <= trading_start_time)
-			{
-				if (account_ws.recv(last_msg)) handleTradeUpdate(last_msg, last_trade_update, final_symbols); //expecting individual json objects
-				if (data_ws.recv(last_msg)) updateParser.parseJSONArray(last_msg, final_symbols); //handle bar, trade, and quote updates, and errors
+							pp_partial_count = 0;
+							pm_partial_count = 0;
 
-				//if the bot isn't busy handling updates then it can spend some time cleaning the quote deques
-				else cleanQuoteDeque(current_symbol_iterator, start_symbol_iterator, end_symbol_iterator);
-			}
+							//find the number of returns that have the same bin index as drp1 and drm1
+							for (bar_ptr = &daily_bars.back(); bar_ptr > &daily_bars.back() - lookback_period; bar_ptr--)
+							{
+								if (bar_ptr->c >= r_min)
+								{
+									if (bar_ptr->c <= r_max)
+									{
+										if (static_cast<int>(r_scale * (bar_ptr->c - r_min)) == drp1) pp_partial_count++;
+										if (static_cast<int>(r_scale * (bar_ptr->c - r_min)) == drm1) pm_partial_count++;
+									}
+								}
+							}
 
-			//start trading
+							pp = static_cast<double>(pp_partial_count) / static_cast<double>(total_count); //p(mean+dr)
+							pm = static_cast<double>(pm_partial_count) / static_cast<double>(total_count); //p(mean-dr)
 
-			char current_time[9];
+							if (pp >= ranges.min_ppdx && pp <= ranges.max_ppdx && pm >= ranges.min_pmdx && pm <= ranges.max_pmdx)
+							{
+								rps = (mean + dr) * (mean + dr);
+								rms = (mean - dr) * (mean - dr);
 
-			time_proto.getCurrentTime(current_time);
+								l_denominator = rps * rps * pp - rms * rms * pm;
 
-			std::cout << "STARTED TRADING AT " << current_time << std::endl;
+								current_symbol.pp = pp;
+								current_symbol.pm = pm;
 
-			current_symbol_iterator = start_symbol_iterator;
+								//if the denominator for lambda is not zero then calculate lambda
+								if (l_denominator)
+								{
+									l_numerator = rms * pm - rps * pp;
 
-			while (current_symbol_iterator < end_symbol_iterator) (current_symbol_iterator++)->trading_permitted = true;
+									l = l_numerator / l_denominator;
 
-			try
-			{
-				//if current time >= trading end time then stop trading
-				while (time(nullptr) <= trading_end_time)
-				{
-					if (account_ws.recv(last_msg)) //expecting individual json objects - 41% of runtime spent here
-					{
-						//std::cout << last_msg << std::endl << std::endl << std::endl;
-						handleTradeUpdate(last_msg, last_trade_update, final_symbols);
-					}
+									if (l < 0.0) l = -l; //absolute value of lambda
 
-					if (data_ws.recv(last_msg)) updateParser.parseJSONArray(last_msg, final_symbols); //49% of runtime spent here
-					else cleanQuoteDeque(current_symbol_iterator, start_symbol_iterator, end_symbol_iterator);
-				}
+									//check that lambda is not an outlier
+									if (l >= ranges.min_lambda && l <= ranges.max_lambda)
+									{
+										//calculate ground state energy E0 - then thats it
 
-				//stop trading
+										C0 = -K0(0.0) * l;
+										C1 = sqrt(0.25 * C0 * C0 - 1.0 / 27.0);
 
-				time_proto.getCurrentTime(current_time);
+										current_symbol.l = l;
+										current_symbol.E0 = cbrt(-0.5 * C0 + C1) + cbrt(-0.5 * C0 - C1);
 
-				std::cout << "STOPPED TRADING AT " << current_time << std::endl;
+										if (current_symbol.E0 != 0.0)
+										{
+											//the stock satisfies the inlier conditions that only depend on daily data
+											current_symbol.is_an_outlier = false;
 
-				closeAllPositions(final_symbols, data_ws, account_ws);
+											//wait until a specified start trading time to allow trading
+											current_symbol.trading_permitted = false;
+										}
+									}
+								}
+							}
+						}
+					}
+				}
 			}
-			catch (const std::runtime_error& runtime_error) { closeAllPositions(final_symbols, data_ws, account_ws); throw runtime_error; }
-			catch (const exceptions::exception& exception) { closeAllPositions(final_symbols, data_ws, account_ws); throw exception; }
-			catch (const SSLNoReturn& no_return) { std::cout << "LAST MSG : " << last_msg << std::endl; closeAllPositions(final_symbols, data_ws, account_ws); throw no_return; }
-			catch (const std::exception& exception) { closeAllPositions(final_symbols, data_ws, account_ws); throw exception; }
 		}
 	}
-	catch (const std::runtime_error& runtime_error) { throw runtime_error; }
-	catch (const exceptions::exception& exception) { throw exception; }
-	catch (const SSLNoReturn& no_return) { throw no_return; }
-	catch (const std::exception& exception) { throw exception; }
+
+	return !current_symbol.is_an_outlier;
 }
 
-/*
-Since many of the keys in trade, quote, and bar updates are only 1 or 2 characters long,
-we can greatly speed up the parsing process by using switch statements - which require numerical
-or enumerated types - instead of if/else statements by integer-encoding the strings.
+bool prefilterDailyFeatures(symbol& current_symbol, const dailyBarContainer& daily_bars, const inlierRanges& ranges)
+{
+	//this can't tell if there are at least min_completed_trading_days daily bars, so only symbols with enough recent bars ...
+	//... to replicate the previous close and average volume checks of computeDailyFeatures can be rejected
+	if (daily_bars.size() < static_cast<size_t>(ranges.average_volume_period)) return true;
 
-This only works for small strings (integer-type values can only be so large).
-*/
+	const bar* bar_ptr = &daily_bars.back();
 
-constexpr inline size_t encodeString(const std::string& string)
-{
-	size_t h = 0;
+	//check that the previous day's closing price is not an outlier
+	if (bar_ptr->c < ranges.min_previous_days_closing_price || bar_ptr->c > ranges.max_previous_days_closing_price)
+	{
+		current_symbol.is_an_outlier = true;
 
-	for (const char& c : string) { if (256 * h + c <= h && c != '\0') return 0; h = 256 * h + c; }
+		return false;
+	}
 
-	return h;
+	//calculate the daily average volume the same way computeDailyFeatures does so that both agree
+	double average_volume = 0.0;
+
+	for (; bar_ptr > &daily_bars.back() - ranges.average_volume_period; bar_ptr--) average_volume += bar_ptr->v;
+
+	average_volume /= ranges.average_volume_period;
+
+	//check that the average volume is not an outlier
+	if (average_volume < ranges.min_average_volume || average_volume > ranges.max_average_volume)
+	{
+		current_symbol.is_an_outlier = true;
+
+		return false;
+	}
+
+	return true;
 }
 
-//needed on non-windows machines
-constexpr inline size_t encodeString(const char* string)
+bool verifyAccumulator(qplAccumulator& accumulator, const dailyBarContainer& daily_bars, const inlierRanges& ranges)
 {
-	size_t h = 0;
-	const char* c = string;
+	dailyFeatureRecord record;
 
-	while (*c != '\0') { if (256 * h + *c <= h && *c != '\0') return 0; h = 256 * h + *(c++); }
+	accumulator.computeFeatures(record, ranges);
 
-	return h;
+	symbol expected;
+	std::unique_ptr<dailyBarContainer> bars = std::make_unique<dailyBarContainer>(daily_bars); //computeDailyFeatures overwrites the closing prices
+
+	computeDailyFeatures(expected, *bars, ranges);
+
+	auto isClose = [](const double value, const double expected_value, const double tolerance)
+	{
+		return std::abs(value - expected_value) <= tolerance * std::abs(expected_value);
+	};
+
+	if (expected.is_an_outlier != (record.is_an_outlier != 0)) return false;
+	if (expected.is_an_outlier) return true; //the features of outliers are not used
+
+	if (record.previous_days_close != expected.previous_days_close || record.average_volume != expected.average_volume) return false;
+	if (record.pp != expected.pp || record.pm != expected.pm) return false;
+
+	if (!isClose(record.mean, expected.mean, qpl_accumulator_tolerance)) return false;
+	if (!isClose(record.std, expected.std, qpl_accumulator_tolerance)) return false;
+	if (!isClose(record.l, expected.l, qpl_derived_tolerance)) return false;
+	if (!isClose(record.E0, expected.E0, qpl_derived_tolerance)) return false;
+
+	return true;
 }
 
-void updateDailyBar(bar& daily_bar, const std::string& key, const std::string& value)
+uint64_t dailyRangesChecksum(const inlierRanges& ranges)
 {
-	//faster than if/else statements - only works when key strings are small
+	uint64_t checksum = fnv1a(&daily_snapshot_version, sizeof(daily_snapshot_version));
+
+	checksum = fnv1a(&ranges.lookback_period, sizeof(ranges.lookback_period), checksum);
+	checksum = fnv1a(&ranges.std_max, sizeof(ranges.std_max), checksum);
+	checksum = fnv1a(&ranges.number_of_bins, sizeof(ranges.number_of_bins), checksum);
+	checksum = fnv1a(&ranges.min_completed_trading_days, sizeof(ranges.min_completed_trading_days), checksum);
+	checksum = fnv1a(&ranges.average_volume_period, sizeof(ranges.average_volume_period), checksum);
+	checksum = fnv1a(&ranges.min_previous_days_closing_price, sizeof(ranges.min_previous_days_closing_price), checksum);
+	checksum = fnv1a(&ranges.max_previous_days_closing_price, sizeof(ranges.max_previous_days_closing_price), checksum);
+	checksum = fnv1a(&ranges.min_average_volume, sizeof(ranges.min_average_volume), checksum);
+	checksum = fnv1a(&ranges.max_average_volume, sizeof(ranges.max_average_volume), checksum);
+	checksum = fnv1a(&ranges.min_mean, sizeof(ranges.min_mean), checksum);
+	checksum = fnv1a(&ranges.max_mean, sizeof(ranges.max_mean), checksum);
+	checksum = fnv1a(&ranges.min_std, sizeof(ranges.min_std), checksum);
+	checksum = fnv1a(&ranges.max_std, sizeof(ranges.max_std), checksum);
+	checksum = fnv1a(&ranges.min_lambda, sizeof(ranges.min_lambda), checksum);
+	checksum = fnv1a(&ranges.max_lambda, sizeof(ranges.max_lambda), checksum);
+	checksum = fnv1a(&ranges.min_pmdx, sizeof(ranges.min_pmdx), checksum);
+	checksum = fnv1a(&ranges.max_pmdx, sizeof(ranges.max_pmdx), checksum);
+	checksum = fnv1a(&ranges.min_ppdx, sizeof(ranges.min_ppdx), checksum);
+	checksum = fnv1a(&ranges.max_ppdx, sizeof(ranges.max_ppdx), checksum);
+
+	return checksum;
+}
 
-	switch (encodeString(key))
+void applyDailyFeatures(symbol& Symbol, const dailyFeatureRecord* record)
+{
+	if (record == nullptr) //symbols that are not in the snapshot were not listed when it was made so they can't have enough daily data
 	{
-		case encodeString("t"): { daily_bar.t = value; break; }
-		case encodeString("c"): { daily_bar.c = convert<double>(value); break; }
-		case encodeString("v"): { daily_bar.v = convert<long long>(value); break; }
-		default: break;
+		Symbol.is_an_outlier = true;
+		return;
 	}
+
+	Symbol.previous_days_close = record->previous_days_close;
+	Symbol.average_volume = record->average_volume;
+	Symbol.mean = record->mean;
+	Symbol.std = record->std;
+	Symbol.pp = record->pp;
+	Symbol.pm = record->pm;
+	Symbol.l = record->l;
+	Symbol.E0 = record->E0;
+
+	Symbol.is_an_outlier = record->is_an_outlier != 0;
+	Symbol.trading_permitted = false;
 }
 
-void updateDailyData(const bar& daily_bar, dailyBarContainer& daily_bars)
+dailyFeatureRecord getDailyFeatureRecord(const symbol& Symbol)
 {
-	daily_bars.push_back(daily_bar);
+	dailyFeatureRecord record;
+
+	std::memset(record.ticker, 0, sizeof(record.ticker));
+	std::memcpy(record.ticker, Symbol.ticker.c_str(), (Symbol.ticker.size() < sizeof(record.ticker)) ? Symbol.ticker.size() : sizeof(record.ticker) - 1);
+
+	record.previous_days_close = Symbol.previous_days_close;
+	record.average_volume = Symbol.average_volume;
+	record.mean = Symbol.mean;
+	record.std = Symbol.std;
+	record.pp = Symbol.pp;
+	record.pm = Symbol.pm;
+	record.l = Symbol.l;
+	record.E0 = Symbol.E0;
+
+	record.is_an_outlier = Symbol.is_an_outlier;
+
+	return record;
 }
 
-void updateIntradayData(const bar& intraday_bar, symbol& Symbol)
+void updateCalendarDay(calendarDay& day, const std::string& key, const std::string& value)
 {
-	Symbol.vsum += intraday_bar.v;
+	if (key == "date") day.date = value;
+}
+
+void updateCalendarData(const calendarDay& day, std::vector<std::string>& dates)
+{
+	dates.push_back(day.date);
 }
 
 void getAvailableSymbols(std::vector<symbol>& symbols, std::string& assets_json)
 {
-	JSONArrayParser<symbol, std::vector<symbol>, updateSymbol, updateSymbolData> symbol_data_parser;
+	jsonArrayStream<symbol, std::vector<symbol>, updateSymbol, updateSymbolData> symbol_data_parser;
 
-	symbol_data_parser.parseJSONArray(assets_json, symbols); //expecting a single-level json array
+	symbol_data_parser.parseJSONArray(assets_json, symbols); //expecting a single-level json array - parsed in one pass
 }
 
 void updateSymbol(symbol& Symbol, const std::string& key, const std::string& value)
@@ -1180,6 +1739,9 @@ void updateSymbolData(const tradeOrBarUpdate& update, symbolData& symbol_data)
 
 		symbol& current_symbol = symbol_data[update.S];
 
+		//an earlier trade of this message queued a position update - it is done before this trade changes the symbol
+		if (current_symbol.update_pending) symbol_data.decidePendingUpdates();
+
 		//calculate current time in nanoseconds since midnight - convert the current hour, minute, and last whole second
 		current_symbol.t = convertUTC(update.t);
 
@@ -1192,7 +1754,7 @@ void updateSymbolData(const tradeOrBarUpdate& update, symbolData& symbol_data)
 		current_symbol.dt = current_symbol.t - current_symbol.time_stamps.front();
 		current_symbol.dp = update.p / current_symbol.prices.front();
 
-		while (current_symbol.dt >= symbol_data.model.ranges.rolling_period)
+		while (current_symbol.dt >= symbol_data.model->ranges.rolling_period)
 		{
 			current_symbol.rolling_vsum -= current_symbol.sizes.front();
 
@@ -1274,27 +1836,27 @@ void updateSymbolData(const tradeOrBarUpdate& update, symbolData& symbol_data)
 
 			//if at least ROLLING_PERIOD_MIN_TRADES trades have occured within the last ROLLING_PERIOD
 			//current_symbol.rolling_csum = current_symbol.sizes.size();
-			if (current_symbol.sizes.size() >= 10 + 0 * symbol_data.model.ranges.rolling_period_min_trades && \
-				current_symbol.sizes.size() <= symbol_data.model.ranges.rolling_period_max_trades)
+			if (current_symbol.sizes.size() >= 10 + 0 * symbol_data.model->ranges.rolling_period_min_trades && \
+				current_symbol.sizes.size() <= symbol_data.model->ranges.rolling_period_max_trades)
 			{
-				if (current_symbol.new_n >= symbol_data.model.ranges.min_n && current_symbol.new_n <= symbol_data.model.ranges.max_n)
+				if (current_symbol.new_n >= symbol_data.model->ranges.min_n && current_symbol.new_n <= symbol_data.model->ranges.max_n)
 				{
-					if (current_symbol.vsum >= symbol_data.model.ranges.min_vsum && current_symbol.vsum <= symbol_data.model.ranges.max_vsum)
+					if (current_symbol.vsum >= symbol_data.model->ranges.min_vsum && current_symbol.vsum <= symbol_data.model->ranges.max_vsum)
 					{
-						if (update.s >= symbol_data.model.ranges.min_size && update.s <= symbol_data.model.ranges.max_size)
+						if (update.s >= symbol_data.model->ranges.min_size && update.s <= symbol_data.model->ranges.max_size)
 						{
-							if (current_symbol.rolling_vsum >= symbol_data.model.ranges.rolling_volume_min && \
-								current_symbol.rolling_vsum <= symbol_data.model.ranges.rolling_volume_max && current_symbol.rolling_vsum * current_price >= 10000.0)
+							if (current_symbol.rolling_vsum >= symbol_data.model->ranges.rolling_volume_min && \
+								current_symbol.rolling_vsum <= symbol_data.model->ranges.rolling_volume_max && current_symbol.rolling_vsum * current_price >= 10000.0)
 							{
-								if (current_symbol.dp >= symbol_data.model.ranges.min_dp && current_symbol.dp <= symbol_data.model.ranges.max_dp)
+								if (current_symbol.dp >= symbol_data.model->ranges.min_dp && current_symbol.dp <= symbol_data.model->ranges.max_dp)
 								{
 									float relative_volume = static_cast<double>(current_symbol.vsum) / current_symbol.average_volume;
 
-									if (relative_volume >= symbol_data.model.ranges.min_rvol && relative_volume <= symbol_data.model.ranges.max_rvol)
+									if (relative_volume >= symbol_data.model->ranges.min_rvol && relative_volume <= symbol_data.model->ranges.max_rvol)
 									{
 										float dt = static_cast<long double>(current_symbol.dt) / 1000000000.0L; //convert nanoseconds to seconds
 
-										if (dt >= symbol_data.model.ranges.min_dt && dt <= symbol_data.model.ranges.max_dt)
+										if (dt >= symbol_data.model->ranges.min_dt && dt <= symbol_data.model->ranges.max_dt)
 										{
 											//if the rest of the outlier conditions are satisfied, calculate potential gain, loss, and probability of success
 
@@ -1307,45 +1869,27 @@ void updateSymbolData(const tradeOrBarUpdate& update, symbolData& symbol_data)
 
 											float time_of_day = static_cast<long double>(current_symbol.t) / 60000000000.0L; //convert nanoseconds to minute of day
 
+											//the features in the order of the arguments of MLModel::predict
+											levelCrossing crossing = { &current_symbol, { time_of_day, relative_volume, static_cast<float>(current_symbol.new_n),
+												static_cast<float>(current_symbol.mean), static_cast<float>(current_symbol.dp), static_cast<float>(current_symbol.std), dt,
+												static_cast<float>(current_symbol.vsum), static_cast<float>(current_symbol.average_volume), static_cast<float>(current_symbol.previous_days_close),
+												static_cast<float>(current_symbol.sizes.size()), static_cast<float>(current_symbol.rolling_vsum), static_cast<float>(current_symbol.pm),
+												static_cast<float>(update.s), static_cast<float>(current_symbol.pp), static_cast<float>(current_symbol.l) },
+												potential_gain_per_share, potential_loss_per_share };
+
+#ifdef USE_BATCHED_PREDICTIONS
+											//the crossings of a message are scored together once the whole message was parsed - the position is updated then
+											symbol_data.queuePositionUpdate(current_symbol, &crossing);
+
+											return;
+#else
 											//predict the probability of the next transition being +1 price level
-											float probability_of_success = symbol_data.model.predict(time_of_day, relative_volume, current_symbol.new_n, current_symbol.mean,
-												current_symbol.dp, current_symbol.std, dt, current_symbol.vsum, current_symbol.average_volume, current_symbol.previous_days_close,
-												current_symbol.sizes.size(), current_symbol.rolling_vsum, current_symbol.pm, update.s, current_symbol.pp, current_symbol.l);
-
-											//probability_of_success = godSays(); //see how well the bot handles orders when making random buy and sell decisions
-											
-											//based on those variables, decide whether or not to hold, enter, or adjust a position
-											if (probability_of_success * (potential_gain_per_share + potential_loss_per_share) > potential_loss_per_share)
-											{
-												if (potential_gain_per_share > 0.0 && potential_loss_per_share > 0.0 && current_symbol.entry_price > 0.0)
-												{
-													//calculate the maximum number of shares the bot should hold
-													current_symbol.quantity_desired = static_cast<int>(symbol_data.risk_per_trade / potential_loss_per_share);
-//#ifdef TRADE_BOT_DEBUG
-													//*
-													std::cout << "XXXPRED Symbol : " << update.S << " - time_of_day : " << time_of_day << " - relative_volume : " << relative_volume;
-													std::cout << " - n : " << current_symbol.new_n << " - mean : " << current_symbol.mean << " - dp : " << current_symbol.dp;
-													std::cout << " - std : " << current_symbol.std << " - dt : " << dt << " - vsum : " << current_symbol.vsum;
-													std::cout << " - average_volume : " << current_symbol.average_volume << " - previous_days_close : " << current_symbol.previous_days_close;
-													std::cout << " - rolling_csum : " << current_symbol.sizes.size() << " - rolling_vsum : " << current_symbol.rolling_vsum;
-													std::cout << " - pm : " << current_symbol.pm << " - size : " << update.s << " - pp : " << current_symbol.pp;
-													std::cout << " - lambda : " << current_symbol.l << " - chance_of_+1_transition : " << probability_of_success;
-													std::cout << " - reward_per_share : " << potential_gain_per_share << " - risk_per_share : " << potential_loss_per_share;
-													std::cout << " - last_ask : " << current_symbol.last_ask << " - last_bid : " << current_symbol.last_bid;
-													std::cout << " - time_passed_since_last_quote[ns] : " << current_symbol.t - current_symbol.old_t << std::endl;
-//#endif
-													//*/
-
-													/*
-													std::cout << "Buy " << current_symbol.quantity_desired << " shares of " << update.S << " at " << current_symbol.entry_price << std::endl;
-													std::cout << "\tSell for a gain at " << potential_gain_per_share + current_symbol.entry_price << std::endl;
-													std::cout << "\tSell for a loss at " << current_symbol.entry_price - potential_loss_per_share << std::endl;
-													std::cout << "\tHas a " << 100.0 * probability_of_success << "% chance of succeeding." << std::endl << std::endl;
-
-													current_symbol.quantity_desired = 0;
-													*/
-												}
-											}
+#ifdef USE_DAILY_INPUTS
+											symbol_data.decideCrossing(crossing, symbol_data.model->predict(symbol_data.daily_inputs[current_symbol.daily_index], crossing.features));
+#else
+											symbol_data.decideCrossing(crossing, symbol_data.model->predict(crossing.features));
+#endif
+#endif
 										}
 									}
 								}
@@ -1356,46 +1900,24 @@ void updateSymbolData(const tradeOrBarUpdate& update, symbolData& symbol_data)
 			}
 		}
 
-		/*
-		adjust our current position to match max_possible_shares(keeping our risk - per - trade constant)
-		*/
+#ifdef USE_BATCHED_PREDICTIONS
+		//behind the crossings of earlier trades of the message since it can spend the buying power they are about to claim
+		symbol_data.queuePositionUpdate(current_symbol, nullptr);
+#else
+		updateSymbolPosition(current_symbol, symbol_data);
+#endif
+	}
+	else if (update.T == "b") //this is a bar update
+	{
+		symbol& current_symbol = symbol_data[update.S];
 
-		//only place orders if trading is permitted
-		if (current_symbol.trading_permitted)
+		//bars up to the minute the volume sum was initialized through are already counted - the timestamps have the same format so they compare as strings
+		if (update.t > current_symbol.vsum_through)
 		{
-			try { current_symbol.updatePosition(symbol_data); }
-			catch (const std::runtime_error& runtime_error) { std::cout << "RUNTIME ERROR FROM POSITION UPDATE" << std::endl; throw runtime_error; }
-			catch (const exceptions::exception& exception)
-			{
-				std::cout << "EXCEPTION FROM POSITION UPDATE" << std::endl;
-
-				if (symbol_data.response.status_code == 301)
-				{
-					std::cout << "RESPONSE FIELDS" << std::endl;
-
-					for (const auto pair : symbol_data.response.fields) { std::cout << pair.first << " : " << pair.second << std::endl; }
-
-					std::cout << std::endl;
-					std::cout << "ORDER FIELDS" << std::endl;
-
-					for (const auto pair : symbol_data.order_data) { std::cout << pair.first << " : " << pair.second << std::endl; }
-
-					std::cout << std::endl;
-					std::cout << "TICKER : " << current_symbol.ticker << std::endl;
-					std::cout << "ORDER ID : " << current_symbol.order_id << std::endl;
-					std::cout << "REPLACEMENT ORDER ID : " << current_symbol.replacement_order_id << std::endl;
-				}
-
-				throw exception;
-			}
-			catch (const SSLNoReturn& no_return) { std::cout << "SSL NO RETURN FROM POSITION UPDATE" << std::endl; throw no_return; }
-			catch (const std::exception& exception) { std::cout << "BASE EXCEPTION FROM POSITION UPDATE" << std::endl; throw exception; }
+			current_symbol.vsum += update.v;
+			current_symbol.vsum_through = update.t;
 		}
-		else current_symbol.quantity_desired = 0;
-
-		current_symbol.n = current_symbol.new_n;
 	}
-	else if (update.T == "b") symbol_data[update.S].vsum += update.v; //this is a bar update
 	else if (update.T == "error") //something went wrong or will go wrong
 	{
 		throw exceptions::exception(std::string("Error : \"") + update.msg + std::string("\" occured with status code - ") + std::to_string(update.code) + std::string("."));
@@ -1412,6 +1934,55 @@ void updateSymbolData(const tradeOrBarUpdate& update, symbolData& symbol_data)
 #endif
 }
 
+void updateSymbolPosition(symbol& current_symbol, symbolData& symbol_data)
+{
+	/*
+	adjust our current position to match max_possible_shares(keeping our risk - per - trade constant)
+	*/
+
+	//only place orders if trading is permitted
+	if (current_symbol.trading_permitted)
+	{
+		try { current_symbol.updatePosition(symbol_data); }
+		catch (const std::runtime_error& runtime_error) { std::cout << "RUNTIME ERROR FROM POSITION UPDATE" << std::endl; throw runtime_error; }
+		catch (const exceptions::exception& exception)
+		{
+			std::cout << "EXCEPTION FROM POSITION UPDATE" << std::endl;
+
+			if (symbol_data.response.status_code == 301)
+			{
+				std::cout << "RESPONSE FIELDS" << std::endl;
+
+				for (const auto pair : symbol_data.response.fields) { std::cout << pair.first << " : " << pair.second << std::endl; }
+
+				std::cout << std::endl;
+				std::cout << "ORDER FIELDS" << std::endl;
+
+				for (const auto pair : symbol_data.order_data) { std::cout << pair.first << " : " << pair.second << std::endl; }
+
+				std::cout << std::endl;
+				std::cout << "TICKER : " << current_symbol.ticker << std::endl;
+				std::cout << "ORDER ID : " << current_symbol.order_id << std::endl;
+				std::cout << "REPLACEMENT ORDER ID : " << current_symbol.replacement_order_id << std::endl;
+			}
+
+			throw exception;
+		}
+		catch (const SSLNoReturn& no_return) { std::cout << "SSL NO RETURN FROM POSITION UPDATE" << std::endl; throw no_return; }
+		catch (const std::exception& exception) { std::cout << "BASE EXCEPTION FROM POSITION UPDATE" << std::endl; throw exception; }
+	}
+	else current_symbol.quantity_desired = 0;
+
+	current_symbol.n = current_symbol.new_n;
+}
+
+void parseUpdates(tradeAndBarParser& update_parser, std::string& message, symbolData& symbol_data)
+{
+	update_parser.parseJSONArray(message, symbol_data);
+
+	symbol_data.decidePendingUpdates();
+}
+
 void handleTradeUpdate(std::string& last_msg, dictionary& trade_update_info, symbolData& final_symbols)
 {
 	trade_update_info.clear();
@@ -1981,10 +2552,143 @@ void symbol::updatePosition(symbolData& symbol_data)
 #endif
 
 symbolData::symbolData(const SSLContextWrapper& SSL_context_wrapper, const MLModel& Model)
-	: ssl_context_wrapper(const_cast<SSLContextWrapper&>(SSL_context_wrapper)), model(const_cast<MLModel&>(Model)), symbolContainer() {}
+	: ssl_context_wrapper(const_cast<SSLContextWrapper&>(SSL_context_wrapper)), model(&const_cast<MLModel&>(Model)), symbolContainer()
+{
+	//a message rarely has more crossings than this so parsing one doesn't allocate
+	pending_crossings.reserve(max_batch_size * 4);
+	deciding_crossings.reserve(max_batch_size * 4);
+
+	pending_updates.reserve(max_batch_size * 16);
+	deciding_updates.reserve(max_batch_size * 16);
+
+	probabilities.reserve(max_batch_size * 4);
+}
 
 symbolData::~symbolData() {}
 
+void symbolData::decideCrossing(const levelCrossing& crossing, const float probability_of_success)
+{
+	symbol& current_symbol = *crossing.crossing_symbol;
+
+	const double potential_gain_per_share = crossing.potential_gain_per_share;
+	const double potential_loss_per_share = crossing.potential_loss_per_share;
+
+	//probability_of_success = godSays(); //see how well the bot handles orders when making random buy and sell decisions
+
+	//based on those variables, decide whether or not to hold, enter, or adjust a position
+	if (probability_of_success * (potential_gain_per_share + potential_loss_per_share) > potential_loss_per_share)
+	{
+		if (potential_gain_per_share > 0.0 && potential_loss_per_share > 0.0 && current_symbol.entry_price > 0.0)
+		{
+			//calculate the maximum number of shares the bot should hold
+			current_symbol.quantity_desired = static_cast<int>(risk_per_trade / potential_loss_per_share);
+//#ifdef TRADE_BOT_DEBUG
+			//*
+			std::cout << "XXXPRED Symbol : " << current_symbol.ticker << " - time_of_day : " << crossing.features[0] << " - relative_volume : " << crossing.features[1];
+			std::cout << " - n : " << current_symbol.new_n << " - mean : " << current_symbol.mean << " - dp : " << current_symbol.dp;
+			std::cout << " - std : " << current_symbol.std << " - dt : " << crossing.features[6] << " - vsum : " << current_symbol.vsum;
+			std::cout << " - average_volume : " << current_symbol.average_volume << " - previous_days_close : " << current_symbol.previous_days_close;
+			std::cout << " - rolling_csum : " << current_symbol.sizes.size() << " - rolling_vsum : " << current_symbol.rolling_vsum;
+			std::cout << " - pm : " << current_symbol.pm << " - size : " << crossing.features[13] << " - pp : " << current_symbol.pp;
+			std::cout << " - lambda : " << current_symbol.l << " - chance_of_+1_transition : " << probability_of_success;
+			std::cout << " - reward_per_share : " << potential_gain_per_share << " - risk_per_share : " << potential_loss_per_share;
+			std::cout << " - last_ask : " << current_symbol.last_ask << " - last_bid : " << current_symbol.last_bid;
+			std::cout << " - time_passed_since_last_quote[ns] : " << current_symbol.t - current_symbol.old_t << std::endl;
+//#endif
+			//*/
+
+			/*
+			std::cout << "Buy " << current_symbol.quantity_desired << " shares of " << current_symbol.ticker << " at " << current_symbol.entry_price << std::endl;
+			std::cout << "\tSell for a gain at " << potential_gain_per_share + current_symbol.entry_price << std::endl;
+			std::cout << "\tSell for a loss at " << current_symbol.entry_price - potential_loss_per_share << std::endl;
+			std::cout << "\tHas a " << 100.0 * probability_of_success << "% chance of succeeding." << std::endl << std::endl;
+
+			current_symbol.quantity_desired = 0;
+			*/
+		}
+	}
+}
+
+void symbolData::queuePositionUpdate(symbol& update_symbol, const levelCrossing* crossing)
+{
+	//nothing of this message waits for a prediction - the trade can't overtake anything
+	if (crossing == nullptr && pending_updates.empty())
+	{
+		updateSymbolPosition(update_symbol, *this);
+
+		return;
+	}
+
+	positionUpdate update = { &update_symbol };
+
+	if (crossing != nullptr)
+	{
+		update.crossing = static_cast<int>(pending_crossings.size());
+		pending_crossings.push_back(*crossing);
+	}
+
+	update_symbol.update_pending = true;
+	pending_updates.push_back(update);
+}
+
+void symbolData::decidePendingUpdates()
+{
+	if (pending_updates.empty()) return;
+
+	//the updates are taken out first so none of them is done twice if a position update throws
+	deciding_crossings.swap(pending_crossings);
+	deciding_updates.swap(pending_updates);
+
+	pending_crossings.clear();
+	pending_updates.clear();
+
+	for (const positionUpdate& update : deciding_updates) update.update_symbol->update_pending = false;
+
+	//every crossing of the message is scored before the first position is updated
+	probabilities.resize(deciding_crossings.size());
+
+	float features[max_batch_size][MLModel::input_length];
+
+#ifdef USE_DAILY_INPUTS
+	const dailyInputs* batch_daily_inputs[max_batch_size];
+#endif
+
+	size_t scored = 0;
+
+	while (scored < deciding_crossings.size())
+	{
+		const size_t rows = std::min(deciding_crossings.size() - scored, max_batch_size);
+
+		for (size_t row = 0; row < rows; row++)
+		{
+			std::copy(std::begin(deciding_crossings[scored + row].features), std::end(deciding_crossings[scored + row].features), features[row]);
+
+#ifdef USE_DAILY_INPUTS
+			batch_daily_inputs[row] = daily_inputs + deciding_crossings[scored + row].crossing_symbol->daily_index;
+#endif
+		}
+
+#ifdef USE_DAILY_INPUTS
+		model->predict(batch_daily_inputs, features, probabilities.data() + scored, rows);
+#else
+		model->predict(features, probabilities.data() + scored, rows);
+#endif
+
+		scored += rows;
+		model_calls++;
+	}
+
+	scored_crossings += scored;
+
+	//in the order the trades were received
+	for (const positionUpdate& update : deciding_updates)
+	{
+		if (update.crossing >= 0) decideCrossing(deciding_crossings[update.crossing], probabilities[update.crossing]);
+
+		updateSymbolPosition(*update.update_symbol, *this);
+	}
+}
+
 void symbolData::submitOrder(const std::string& Symbol, const int& quantity, const std::string& side, const double& limit_price)
 {
 	body = "{\"symbol\":\"" + Symbol + "\", \"qty\":" + std::to_string(quantity) + ", \"side\":\"" + side \
@@ -1996,7 +2700,7 @@ void symbolData::submitOrder(const std::string& Symbol, const int& quantity, con
 	order_data.clear();
 	response.clear();
 
-	http::post(ssl_context_wrapper, response, base_parameters, base_headers, account_endpoint, "/v2/orders", body, timeout);
+	sendOrderRequest(ssl_context_wrapper, response, "POST", base_parameters, base_headers, account_endpoint, "/v2/orders", body, timeout);
 
 	if (response.message.size() > 2) json_parser.parseJSON(order_data, response.message);
 
@@ -2015,7 +2719,7 @@ void symbolData::submitOrder(const std::string& Symbol, const int& quantity, con
 	order_data.clear();
 	response.clear();
 
-	http::post(ssl_context_wrapper, response, base_parameters, base_headers, account_endpoint, "/v2/orders", body, timeout);
+	sendOrderRequest(ssl_context_wrapper, response, "POST", base_parameters, base_headers, account_endpoint, "/v2/orders", body, timeout);
 
 	if (response.message.size() > 2) json_parser.parseJSON(order_data, response.message);
 
@@ -2033,7 +2737,7 @@ void symbolData::replaceOrder(const std::string& order_id, const int& quantity,
 	order_data.clear();
 	response.clear();
 
-	http::patch(ssl_context_wrapper, response, base_parameters, base_headers, account_endpoint, "/v2/orders/" + order_id, body, timeout);
+	sendOrderRequest(ssl_context_wrapper, response, "PATCH", base_parameters, base_headers, account_endpoint, "/v2/orders/" + order_id, body, timeout);
 
 	if (response.message.size() > 2) json_parser.parseJSON(order_data, response.message);
 
@@ -2046,7 +2750,7 @@ void symbolData::cancelOrder(const std::string& order_id)
 	order_data.clear();
 	response.clear();
 
-	http::del(ssl_context_wrapper, response, base_parameters, base_headers, account_endpoint, "/v2/orders/" + order_id, timeout);
+	sendOrderRequest(ssl_context_wrapper, response, "DELETE", base_parameters, base_headers, account_endpoint, "/v2/orders/" + order_id, "", timeout);
 }
 
 void symbolData::cancelAllOrders()
@@ -2056,7 +2760,7 @@ void symbolData::cancelAllOrders()
 
 	base_headers["Content-Length"] = "0";
 
-	http::del(ssl_context_wrapper, response, base_parameters, base_headers, account_endpoint, "/v2/orders", timeout);
+	sendOrderRequest(ssl_context_wrapper, response, "DELETE", base_parameters, base_headers, account_endpoint, "/v2/orders", "", timeout);
 
 	base_headers.erase("Content-Length");
 }
@@ -2068,14 +2772,14 @@ void symbolData::closeAllPositions()
 
 	base_headers["Content-Length"] = "0";
 
-	http::del(ssl_context_wrapper, response, base_parameters, base_headers, account_endpoint, "/v2/positions", timeout);
+	sendOrderRequest(ssl_context_wrapper, response, "DELETE", base_parameters, base_headers, account_endpoint, "/v2/positions", "", timeout);
 
 	base_headers.erase("Content-Length");
 }
 
 #ifdef USE_MARKET_ORDERS
 
-void closeAllPositions(symbolData& final_symbols, websocket& data_ws, websocket& account_ws)
+void closeAllPositions(symbolData& final_symbols, botWebsocket& data_ws, botWebsocket& account_ws)
 {
 	std::cout << "CLOSING EXISTING POSITIONS" << std::endl;
 
@@ -2087,7 +2791,7 @@ void closeAllPositions(symbolData& final_symbols, websocket& data_ws, websocket&
 
 #else
 
-void closeAllPositions(symbolData& final_symbols, websocket& data_ws, websocket& account_ws)
+void closeAllPositions(symbolData& final_symbols, botWebsocket& data_ws, botWebsocket& account_ws)
 {
 	std::cout << "CLOSING EXISTING POSITIONS" << std::endl;
 
@@ -2129,7 +2833,7 @@ void closeAllPositions(symbolData& final_symbols, websocket& data_ws, websocket&
 
 			data_ws.recv(last_msg);
 
-			if (last_msg.size() > 2) updateParser.parseJSONArray(last_msg, final_symbols);
+			if (last_msg.size() > 2) parseUpdates(updateParser, last_msg, final_symbols);
 		}
 
 		total_shares_owned = 0;
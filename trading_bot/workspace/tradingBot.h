@@ -6,7 +6,15 @@
 
 #include "arrayUtils.h"
 #include "modelUtils.h"
+#include "modelSwapUtils.h"
+#include "snapshotUtils.h"
+#include "qplUtils.h"
+#include "barUtils.h"
 #include "jsonUtils.h"
+#include "jsonStreamUtils.h"
+#include "startupUtils.h"
+#include "asyncWsUtils.h"
+#include "latencyUtils.h"
 #include "wsUtils.h"
 #include "ntpUtils.h"
 #include "httpUtils.h"
@@ -24,19 +32,47 @@
 #include <chrono>
 #include <ctime>
 #include <cmath>
+#include <memory>
 #include <deque>
 
 //#define TRADE_BOT_DEBUG
 #define USE_MARKET_ORDERS //can result in negative buying power (very unlikely but still possible)
-#define K0(n) ((1.1924 + 33.2383 * n + 56.2169 * n * n) / (1.0 + 43.6196 * n)) //cubic root is not necessary
+//#define USE_SNAPSHOT_VOLUMES //initialize today's volume sums with a few snapshot requests instead of gathering every minute bar of the day - off until the snapshot volumes are checked against the minute bar sums
+#define USE_BATCHED_PREDICTIONS //score the price level crossings of a data message together once the whole message was parsed - comment out to score each one when it is parsed
+//#define USE_DAILY_INPUTS //run the daily features of each symbol through the first layer of the model once at startup - no faster end to end when measured (see modelBenchmark)
+#define USE_MODEL_FILE //load the model from the binary file written by model_converter (model_file_path) - the json files are only read if it is missing or invalid
+//#define USE_QUANTIZED_MODEL //predict with the 8 bit integer network calibrated with model_calibration_path (see modelUtils.h) - compare it to the float network with modelBenchmark first
+
+//USE_CONSTANT_MODEL (the BOT_CONSTANT_MODEL option of CMake) predicts with the weights compiled in (see constantModelUtils.h) - they only change ...
+//... when the bot is built again so the model file is not read and the model is not swapped while the bot runs
+#ifdef USE_CONSTANT_MODEL
+#undef USE_MODEL_FILE
+#undef USE_QUANTIZED_MODEL
+#undef USE_DAILY_INPUTS
+#endif
+
+#ifdef USE_MODEL_FILE
+#define USE_MODEL_SWAP //load model_file_path on a background thread whenever model_converter replaces it and swap it in between messages (see modelSwapUtils.h)
+#endif
 
-//this bot can use up to 64 non-blocking clients  to gather data before it starts trading (it can use more but improvement in speed quickly diminishes)
-//however it runs the risk of exceeding Alpaca's API rate limit for the unlimited plan (10000 per minute for unlimited accounts and 200 per minute otherwise)
-//if that happens the bot will shut down gracefully - for that reason, I would suggest sticking with at most 20 clients
+#ifdef USE_ASYNC_RUNTIME
+#define USE_REST_POOL //send the REST requests (orders included) on persistent connections that resume their TLS sessions - comment out to use the http clients
+#endif
 
 const int past_days = 2000; //number of days we look back to gather data (includes non-trading days)
-const int max_clients = 20; //maximum number of http clients used to gather data asynchronously
 const int max_allowed_quote_removals = 20; //maximum allowed quotes that can be removed from quote deques per trade or quote update - this prevents the bot from stalling
+const int max_snapshot_symbols = 500; //number of symbols in each snapshot request - keeps the query string well below common URL length limits
+
+//the model files are relative to the working directory of the bot - the tradingBot members initialized with them (model_path, weights_path, ...) can point anywhere else
+const std::string model_weights_path = "model_weights.json"; //written by retrain_model.py
+const std::string model_scales_path = "scaler_info.json"; //written by retrain_model.py
+const std::string model_calibration_path = "calibration_data.json"; //written by retrain_model.py - only read with USE_QUANTIZED_MODEL
+
+const std::string model_file_path = "qpl_model.bin"; //written by model_converter from model_weights.json and scaler_info.json - run it again after retraining
+
+const std::string daily_snapshot_path = "daily_features.snapshot"; //written by the offline snapshot mode and loaded at the start of each trading day
+const std::string qpl_accumulator_path = "qpl_accumulators.bin"; //sliding window statistics saved by the offline snapshot mode
+const std::string qpl_table_path = "qpl_table.csv"; //daily features of each qpl configuration written by the qpl table mode
 
 //errors we can safely ignore when submitting certain orders
 const std::string order_not_open = "order is not open";
@@ -45,6 +81,7 @@ const std::string qty_le_filled_bin = "qty must be \\u003e filled_qty"; // suppo
 
 struct bar;
 struct symbol;
+struct calendarDay;
 struct tradeOrBarUpdate;
 
 typedef staticUnorderedMap<std::string, symbol, 10000, 10000> symbolContainer;
@@ -59,6 +96,17 @@ void updateDailyBar(bar&, const std::string&, const std::string&); //get the dai
 void updateDailyData(const bar&, dailyBarContainer&); //append the daily bar to a container
 void updateIntradayData(const bar&, symbol&); //add the volume of this intraday bar to the cumulative traded volume over the day for a symbol
 
+bool computeDailyFeatures(symbol&, dailyBarContainer&, const inlierRanges&); //calculate the features that only depend on daily data - returns false if any of them is an outlier
+bool prefilterDailyFeatures(symbol&, const dailyBarContainer&, const inlierRanges&); //check the previous close and average volume from the most recent daily bars - returns false if the symbol is certainly an outlier
+bool verifyAccumulator(qplAccumulator&, const dailyBarContainer&, const inlierRanges&); //check that an accumulator that saw exactly these daily bars matches a full recomputation of the daily features (see accumulatorCheck.cpp)
+
+uint64_t dailyRangesChecksum(const inlierRanges&); //checksum of the inlier ranges the daily features depend on
+void applyDailyFeatures(symbol&, const dailyFeatureRecord*); //copy the daily features of a snapshot record to a symbol
+dailyFeatureRecord getDailyFeatureRecord(const symbol&); //copy the daily features of a symbol to a snapshot record
+
+void updateCalendarDay(calendarDay&, const std::string&, const std::string&); //get the date of a trading session from a parsed json object
+void updateCalendarData(const calendarDay&, std::vector<std::string>&); //append the date of a trading session to a container
+
 void getAvailableSymbols(std::vector<symbol>&, std::string&); //get available symbols to trade
 
 void updateSymbol(symbol&, const std::string&, const std::string&); //update individual symbol data
@@ -71,7 +119,10 @@ void updateSymbolData(const tradeOrBarUpdate&, symbolData&); //update features o
 
 typedef JSONArrayParser<tradeOrBarUpdate, symbolData, updateTradeOrBarInfo, updateSymbolData> tradeAndBarParser;
 
-void closeAllPositions(symbolData&, websocket&, websocket&);
+void updateSymbolPosition(symbol&, symbolData&); //adjust the position of a symbol after a trade (see symbol::updatePosition) - the price level crossing is handled
+void parseUpdates(tradeAndBarParser&, std::string&, symbolData&); //parse a data websocket message and decide the price level crossings it contained
+
+void closeAllPositions(symbolData&, botWebsocket&, botWebsocket&);
 
 //put all relevant features and model inputs for each ticker symbol here
 struct symbol
@@ -99,12 +150,17 @@ struct symbol
 	double E0 = 0.0;
 	double l = 0.0; //lambda
 
+#ifdef USE_DAILY_INPUTS
+	size_t daily_index = 0; //of the symbol's daily inputs in symbolData::daily_inputs - the part of the first layer of the model set by the features above
+#endif
+
 	long long dt = 0; //difference in time between the first and last filtered trade within the last rolling time period - in nanoseconds
 	double dp = 0.0; //difference in price between the first and last filtered trade within the last rolling time period
 
 	//int rolling_csum; //number of filtered trades that occured within the last rolling time period
 	int rolling_vsum = 0; //total shares traded of all the filtered trades that occured within the last rolling time period
 	long long vsum = 0; //volume sum over the current day - updated every minute
+	std::string vsum_through; //timestamp of the latest minute bar counted in vsum - bar updates up to this time are skipped
 
 	int new_n = 0; //n of the current quantum price level
 	int n = 0; //n of the most recently hit quantum price level
@@ -113,6 +169,7 @@ struct symbol
 
 	bool found_first_n = false; //true if this symbol already has a reference n - this prevents the bot from taking trades before n is initialized
 	bool has_past_quote = false; //true if this symbol has a quote update that occured (on the current trading day) before the most recent trade
+	bool update_pending = false; //true if a position update of this symbol waits for the predictions of its message (see USE_BATCHED_PREDICTIONS)
 
 	std::deque<long long> time_stamps; //timestamp in nanoseconds since midnight of each filtered trade for this stock traded in the past 2 seconds
 	std::deque<double> prices; //price of each filtered trade for this stock traded in the past 2 seconds
@@ -197,6 +254,29 @@ struct bar
 	std::string t; //time that the trade occured at in number of nanoseconds since epoch -- long long
 };
 
+//contains the date of a trading session from the market calendar
+struct calendarDay
+{
+	std::string date; //YYYY-MM-DD
+};
+
+struct levelCrossing //a price level crossing that passed the outlier conditions - the position is updated once the probability of a +1 transition is known
+{
+	symbol* crossing_symbol = nullptr;
+
+	float features[MLModel::input_length]; //the inputs of MLModel::predict
+
+	double potential_gain_per_share = 0.0;
+	double potential_loss_per_share = 0.0;
+};
+
+struct positionUpdate //a trade whose position update waits for the crossings of its message to be scored
+{
+	symbol* update_symbol = nullptr;
+
+	int crossing = -1; //index of its price level crossing in pending_crossings - -1 if the trade didn't cross a price level
+};
+
 class symbolData : public symbolContainer
 {
 public:
@@ -225,7 +305,10 @@ public:
 	JSONParser json_parser;
 
 	SSLContextWrapper& ssl_context_wrapper;
-	MLModel& model;
+	MLModel* model; //the active model of the model holder - swapModel points it to a new one between messages
+#ifdef USE_DAILY_INPUTS
+	const dailyInputs* daily_inputs = nullptr; //of every symbol computed with the active model (see modelHolder::precompute)
+#endif
 
 	void submitOrder(const std::string&, const int&, const std::string&, const double&); //limit order
 	void submitOrder(const std::string&, const int&, const std::string&); //market order
@@ -235,6 +318,22 @@ public:
 
 	void cancelAllOrders();
 	void closeAllPositions(); //with market orders
+
+	std::vector<levelCrossing> pending_crossings; //the crossings of the message being parsed - only with USE_BATCHED_PREDICTIONS
+	std::vector<positionUpdate> pending_updates; //the position updates of the message being parsed in the order of its trades
+
+	size_t model_calls = 0; //number of batches decidePendingUpdates scored
+	size_t scored_crossings = 0; //number of crossings in them
+
+	void decideCrossing(const levelCrossing&, const float); //set the number of shares the bot wants to own from the probability of a +1 transition
+	void queuePositionUpdate(symbol&, const levelCrossing*); //update the position after the crossings of the message are scored - right away if there are none yet
+	void decidePendingUpdates(); //score the pending crossings in batches, then update the positions in the order of the trades
+
+private:
+	std::vector<levelCrossing> deciding_crossings;
+	std::vector<positionUpdate> deciding_updates;
+
+	std::vector<float> probabilities; //of the deciding crossings
 };
 
 class tradingBot
@@ -243,6 +342,20 @@ public:
 	tradingBot(const SSLContextWrapper&, const std::string, const std::string, const std::string, const std::string, const double, const double);
 
 	void start(); //start the bot
+	void buildSnapshot(); //compute the daily features of all available symbols and save them to a snapshot - run after the close or overnight
+	void buildQplTable(const std::vector<qplConfiguration>&); //compute the daily features of several qpl configurations for all available symbols and save them to a table
+
+	//the startup benchmark points the bot at a local stand-in server (the hosts can then include a port) and its own model files
+
+	std::string data_endpoint = "data.alpaca.markets"; //historical bars and snapshots
+	std::string data_stream = "stream.data.alpaca.markets"; //bar, trade, and quote updates
+
+	std::string model_path = model_file_path;
+	std::string weights_path = model_weights_path;
+	std::string scales_path = model_scales_path;
+	std::string calibration_path = model_calibration_path;
+
+	bool startup_only = false; //return from start() as soon as the bot is ready to trade - the waits for the trading hours are skipped
 
 private:
 	double allocated_buying_power; //total amount of cash the bot is allowed to use
@@ -257,6 +370,24 @@ private:
 
 	SSLContextWrapper& ssl_context_wrapper;
 	ntpClient time_proto;
+
+	requestScheduler request_scheduler; //shared by every bar client pool so the rate limit budget carries over from one phase to the next
+
+	void getSymbols(std::vector<symbol>&, const dictionary&, time_t, int); //get all available symbols to trade
+	std::string getLastSession(const dictionary&, time_t, int); //get the date of the last completed trading session before today
+
+	//gather the daily bars of the symbols at the given indices starting at the given dates - each symbol's bars are passed to a handler when they are complete
+	//returns the number of bytes received
+	size_t gatherDailyBars(std::vector<symbol>&, const std::vector<size_t>&, const std::vector<std::string>&, const dictionary&, const std::string&, time_t, auto&);
+
+	//gather the most recent daily bars of the symbols at the given indices and return the indices of the ones that pass the cheap inlier checks
+	std::vector<size_t> prefilterSymbols(std::vector<symbol>&, const std::vector<size_t>&, const inlierRanges&, const dictionary&, const std::string&, time_t);
+
+	//gather daily bars for each symbol and calculate the features that only depend on daily data - each symbol that passes is passed to a handler right away
+	void gatherDailyFeatures(std::vector<symbol>&, const inlierRanges&, const dictionary&, const std::string&, time_t, std::string&, auto&);
+
+	//set today's volume sum of each symbol from the snapshot endpoint - a handler is called while waiting so the data websocket keeps up
+	void getSnapshotVolumes(symbolData&, const std::vector<std::string>&, const dictionary&, time_t, int, auto&);
 };
 
 #endif